@@ -0,0 +1,203 @@
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <unistd.h>
+#include <omp.h>
+
+#include "rng.h"
+#include "placement.h"
+#include "text_output.h"
+
+#include "anf.h"
+
+namespace {
+    // Salt of the hashes of the vertex IDs, fixed so runs are reproducible
+    const uint64_t HASH_SALT = 0x5DEECE66DULL;
+
+    // HyperLogLog counters of every vertex for the steps an edge can span, the counter of vertex v at step s is at Counters[(s % Slots) * Vertices + v]
+    class counter_ring {
+        public:
+            int Vertices;
+            int Registers;
+            int Log2Registers;
+            int Slots;
+            placement::array<uint8_t> Counters;
+            // 2^-r for each register value r
+            double InversePowers[66];
+            // Bias correction constant of the estimate
+            double Alpha;
+
+            counter_ring(int vertices, int LOG2_REGISTERS, int slots) : Vertices(vertices), Registers(1 << LOG2_REGISTERS), Log2Registers(LOG2_REGISTERS), Slots(slots) {
+                this->Counters.resize((uint64_t) slots * vertices * this->Registers);
+                for (int r = 0; r < 66; r++){
+                    this->InversePowers[r] = std::ldexp(1.0, -r);
+                }
+                switch (this->Registers){
+                    case 16: this->Alpha = 0.673; break;
+                    case 32: this->Alpha = 0.697; break;
+                    case 64: this->Alpha = 0.709; break;
+                    default: this->Alpha = 0.7213 / (1 + 1.079 / this->Registers);
+                }
+            }
+
+            uint8_t *counter(int64_t step, int v){
+                return this->Counters.data() + ((uint64_t) (step % this->Slots) * this->Vertices + v) * this->Registers;
+            }
+
+            // Adds a vertex to a counter: the first Log2Registers bits of its hash pick the register, which keeps the longest run of leading zeros seen
+            void add(uint8_t *counter, int v){
+                uint64_t hash = rng::mix64((uint64_t) v * rng::GOLDEN_GAMMA + HASH_SALT);
+                int index = hash >> (64 - this->Log2Registers);
+                uint64_t rest = hash << this->Log2Registers;
+                uint8_t rank = rest == 0 ? 64 - this->Log2Registers + 1 : __builtin_clzll(rest) + 1;
+                counter[index] = std::max(counter[index], rank);
+            }
+
+            // Estimated number of distinct vertices added to a counter, with the linear counting correction of small counts
+            double estimate(const uint8_t *counter){
+                double sum = 0;
+                int zeros = 0;
+                for (int j = 0; j < this->Registers; j++){
+                    sum += this->InversePowers[counter[j]];
+                    zeros += counter[j] == 0;
+                }
+                double estimate = this->Alpha * this->Registers * this->Registers / sum;
+                if (estimate <= 2.5 * this->Registers && zeros > 0){
+                    return this->Registers * std::log((double) this->Registers / zeros);
+                }
+                return estimate;
+            }
+    };
+
+    // Length of an edge in steps
+    int edge_steps(double weight, double WIDTH){
+        return std::max(1LL, std::llround(weight / WIDTH));
+    }
+
+    /**
+     * Runs HyperANF where every edge spans a whole number of steps
+     * @param graph The graph
+     * @param STEPS The length of each edge of graph in steps
+     * @param SPAN The largest length of an edge
+     * @param MAX_STEPS The last step counted
+     * @param STEP_WIDTH The distance covered by a step
+     * @param LOG2_REGISTERS The log2 of the registers of each counter
+    */
+    anf::neighborhood_function run(const compact_graph &graph, const std::vector<int> &STEPS, int SPAN, int64_t MAX_STEPS, double STEP_WIDTH, int LOG2_REGISTERS){
+        const int VERTICES = graph.Vertices;
+        counter_ring ring(VERTICES, LOG2_REGISTERS, SPAN + 1);
+        const int REGISTERS = ring.Registers;
+        anf::neighborhood_function function;
+        function.StepWidth = STEP_WIDTH;
+        function.Registers = REGISTERS;
+        function.RelativeStandardError = 1.04 / std::sqrt((double) REGISTERS);
+        function.Converged = false;
+
+        // Estimate of the current counter of each vertex, only recomputed when the counter changes
+        std::vector<double> estimates(VERTICES);
+        // Whether the counter of vertex v changed at step s, entry (s % Slots) * VERTICES + v. A neighbor whose counter did not change at the
+        // step merged is skipped, since its counter of the step before was already merged into the previous counter of the vertex.
+        std::vector<char> grew((uint64_t) ring.Slots * VERTICES, true);
+        double total = 0;
+        #pragma omp parallel for schedule(static) reduction(+:total)
+        for (int v = 0; v < VERTICES; v++){
+            // The counters are left uninitialized by the allocator, each step writes its counters before they are read
+            std::memset(ring.counter(0, v), 0, REGISTERS);
+            ring.add(ring.counter(0, v), v);
+            estimates[v] = ring.estimate(ring.counter(0, v));
+            total += estimates[v];
+        }
+        function.Cumulative.push_back(total);
+
+        // The counters stay the same once no counter changed for SPAN steps in a row
+        int64_t unchanged_steps = 0;
+        for (int64_t step = 1; step <= MAX_STEPS; step++){
+            bool changed = false;
+            total = 0;
+            #pragma omp parallel for schedule(dynamic, 1024) reduction(+:total) reduction(||:changed)
+            for (int v = 0; v < VERTICES; v++){
+                uint8_t *counter = ring.counter(step, v);
+                const uint8_t *previous = ring.counter(step - 1, v);
+                std::memcpy(counter, previous, REGISTERS);
+                bool merged = false;
+                for (int64_t i = graph.Offsets[v]; i < graph.Offsets[v+1]; i++){
+                    if (STEPS[i] > step || !grew[(uint64_t) ((step - STEPS[i]) % ring.Slots) * VERTICES + graph.Targets[i]]){
+                        continue;
+                    }
+                    const uint8_t *neighbor = ring.counter(step - STEPS[i], graph.Targets[i]);
+                    merged = true;
+                    for (int j = 0; j < REGISTERS; j++){
+                        counter[j] = std::max(counter[j], neighbor[j]);
+                    }
+                }
+                bool counter_grew = merged && std::memcmp(counter, previous, REGISTERS) != 0;
+                grew[(uint64_t) (step % ring.Slots) * VERTICES + v] = counter_grew;
+                if (counter_grew){
+                    changed = true;
+                    estimates[v] = ring.estimate(counter);
+                }
+                total += estimates[v];
+            }
+            function.Cumulative.push_back(total);
+            unchanged_steps = changed ? 0 : unchanged_steps + 1;
+            if (unchanged_steps >= SPAN && step >= SPAN){
+                function.Converged = true;
+                break;
+            }
+        }
+        // Drop the steps past the last growth, their frequencies are all 0
+        if (function.Converged){
+            function.Cumulative.resize(function.Cumulative.size() - unchanged_steps);
+        }
+        return function;
+    }
+}
+
+int anf::bucket_span(const compact_graph &graph, double WIDTH){
+    int span = 1;
+    for (int64_t i = 0; i < graph.edge_count(); i++){
+        if (graph.Weights[i] / WIDTH > anf::MAX_BUCKET_SPAN){
+            return anf::MAX_BUCKET_SPAN + 1;
+        }
+        span = std::max(span, edge_steps(graph.Weights[i], WIDTH));
+    }
+    return span;
+}
+
+uint64_t anf::counter_bytes(int vertices, int LOG2_REGISTERS, int SPAN){
+    return (uint64_t) (SPAN + 1) * vertices * (1ULL << LOG2_REGISTERS);
+}
+
+anf::neighborhood_function anf::hop_neighborhood_function(const compact_graph &graph, int MAX_HOPS, int LOG2_REGISTERS){
+    std::vector<int> steps(graph.edge_count(), 1);
+    return run(graph, steps, 1, MAX_HOPS, 1, LOG2_REGISTERS);
+}
+
+anf::neighborhood_function anf::info_neighborhood_function(const compact_graph &graph, double tau, double WIDTH, int LOG2_REGISTERS){
+    std::vector<int> steps(graph.edge_count());
+    for (int64_t i = 0; i < graph.edge_count(); i++){
+        steps[i] = edge_steps(graph.Weights[i], WIDTH);
+    }
+    return run(graph, steps, anf::bucket_span(graph, WIDTH), (int64_t) std::floor(tau / WIDTH), WIDTH, LOG2_REGISTERS);
+}
+
+void anf::print_neighborhood_function(const anf::neighborhood_function &function, std::string LABEL){
+    text_output::buffered_writer output(STDOUT_FILENO);
+    std::string lines = "Registers per counter: ";
+    text_output::append_int(lines, function.Registers);
+    lines += " | Relative standard error of CUMULATIVE: ";
+    text_output::append_general(lines, function.RelativeStandardError);
+    lines += function.Converged ? " | Converged\n" : " | Limit reached\n";
+    for (size_t step = 0; step < function.Cumulative.size(); step++){
+        lines += LABEL + ":";
+        text_output::append_general(lines, step * function.StepWidth);
+        lines += " = PAIRS:";
+        text_output::append_general(lines, function.Cumulative[step] - (step > 0 ? function.Cumulative[step-1] : 0), 10);
+        lines += " | CUMULATIVE:";
+        text_output::append_general(lines, function.Cumulative[step], 10);
+        lines += "\n";
+    }
+    output.write(lines);
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "compact_graph.h"
+
+/**
+ * Approximate neighborhood function (HyperANF) for the distance distributions of networks too large for all pairs searches.
+ * Every vertex holds a HyperLogLog counter of the vertices within distance t of it. Step t merges the counters of its out-neighbors at
+ * step t - (length of the edge), so each step is one parallel pass over the edges, and the counters use memory linear in the vertices.
+ * Summing the estimates of the counters gives the number of ordered pairs within distance t, the differences between steps the distance
+ * frequencies. Network distances have steps of one edge. Information distances are bucketed: every edge counts as its weight divided by
+ * the bucket width, rounded to the nearest whole number of buckets (at least one), and the counters of the last (longest edge) steps are kept.
+*/
+namespace anf {
+    // Default log2 of the registers of each counter (128 registers, a relative standard error of 9.2%)
+    const int DEFAULT_LOG2_REGISTERS = 7;
+    const int MIN_LOG2_REGISTERS = 4;
+    const int MAX_LOG2_REGISTERS = 12;
+    // Largest number of buckets an edge may span, since the counters of that many steps are held at once
+    const int MAX_BUCKET_SPAN = 64;
+
+    // Approximate neighborhood function of a graph
+    class neighborhood_function {
+        public:
+            // Distance covered by a step (1 for network distances, the bucket width for information distances)
+            double StepWidth;
+            // Registers of each counter
+            int Registers;
+            // Relative standard error of each cumulative estimate, 1.04 / sqrt(Registers)
+            double RelativeStandardError;
+            // Estimated ordered pairs (src, dest) within StepWidth * t of each other, src included, for each step t.
+            // Ends at the limit, or at the last step that grew a neighborhood.
+            std::vector<double> Cumulative;
+            // Whether every neighborhood stopped growing before the limit
+            bool Converged;
+    };
+
+    /**
+     * Returns the number of buckets spanned by the longest edge of a graph
+     * @param graph The graph, whose edges all have non-negative weights
+     * @param WIDTH The bucket width
+     * @return The number of buckets
+    */
+    int bucket_span(const compact_graph &graph, double WIDTH);
+
+    /**
+     * Returns the bytes of the counters of a run
+     * @param vertices The number of vertices of the graph
+     * @param LOG2_REGISTERS The log2 of the registers of each counter
+     * @param SPAN The number of buckets spanned by the longest edge (1 for network distances)
+     * @return The bytes of the counters
+    */
+    uint64_t counter_bytes(int vertices, int LOG2_REGISTERS, int SPAN);
+
+    /**
+     * Approximates the neighborhood function over network distance (number of edges)
+     * @param graph The graph
+     * @param MAX_HOPS The largest network distance counted
+     * @param LOG2_REGISTERS The log2 of the registers of each counter
+     * @return The neighborhood function
+    */
+    neighborhood_function hop_neighborhood_function(const compact_graph &graph, int MAX_HOPS, int LOG2_REGISTERS);
+
+    /**
+     * Approximates the neighborhood function over bucketed information distance (sum of edge weights)
+     * @param graph The graph, whose edges all have non-negative weights spanning at most MAX_BUCKET_SPAN buckets
+     * @param tau The largest information distance counted
+     * @param WIDTH The bucket width
+     * @param LOG2_REGISTERS The log2 of the registers of each counter
+     * @return The neighborhood function
+    */
+    neighborhood_function info_neighborhood_function(const compact_graph &graph, double tau, double WIDTH, int LOG2_REGISTERS);
+
+    /**
+     * Prints the distance frequencies of a neighborhood function, one "[LABEL]:distance = PAIRS:x | CUMULATIVE:y" line per step
+     * @param function The neighborhood function
+     * @param LABEL The label of the distances, eg. "NET"
+    */
+    void print_neighborhood_function(const neighborhood_function &function, std::string LABEL);
+};
@@ -0,0 +1,397 @@
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <filesystem>
+#include <functional>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <omp.h>
+#include <unistd.h>
+
+#include "edgelist.h"
+#include "utils.h"
+#include "network_metrics.h"
+#include "compact_graph.h"
+#include "generators.h"
+#include "placement.h"
+#include "funcs.h"
+
+/*
+Benchmark harness for the pipeline stages: generates seeded networks of the given sizes, times every stage at each thread count
+and writes the results as JSON (one result object per line), optionally comparing them with a stored baseline.
+*/
+
+// Settings shared by every benchmarked network
+struct bench_config {
+    std::vector<std::string> generators;
+    std::vector<int> sizes;
+    std::vector<int> threads;
+    int repeats;
+    int sources;
+    uint64_t seed;
+    int k;
+    double tau;
+    double gamma;
+    int L;
+};
+
+// Timing of one stage on one network at one thread count
+struct bench_result {
+    std::string generator;
+    int size;
+    long long edges;
+    int threads;
+    std::string stage;
+    double median_s;
+    double min_s;
+    // Amount of work done by one run of the stage, in the given unit (edges of the network, sources searched or w_func lookups)
+    long long items;
+    std::string unit;
+    // Speedup and scaling efficiency relative to the smallest thread count run
+    double speedup;
+    double efficiency;
+};
+
+/**
+ * Generates the benchmarked network of a generator
+ * @param edgelist The edgelist (presumed empty) the network is generated into
+ * @param GENERATOR One of watts_strogatz, erdos_renyi, barabasi_albert, chung_lu, random_geometric or lattice_2d
+ * @param SIZE The vertex count (rounded down to a square for lattice_2d)
+ * @param SEED The seed of the generator
+*/
+void generate_bench_network(edgelist &edgelist, std::string GENERATOR, int SIZE, uint64_t SEED){
+    // Every generator is set to an average degree of about 10 with uniform weights
+    const generators::weight_distribution WEIGHTS = generators::weight_distribution::uniform;
+    if (GENERATOR == "watts_strogatz"){
+        generate_watts_strogatz_small_world_network(edgelist, SIZE, 10, 0.1, SEED);
+    } else if (GENERATOR == "erdos_renyi"){
+        generators::erdos_renyi(edgelist, SIZE, 5LL * SIZE, SEED, WEIGHTS);
+    } else if (GENERATOR == "barabasi_albert"){
+        generators::barabasi_albert(edgelist, SIZE, 5, SEED, WEIGHTS);
+    } else if (GENERATOR == "chung_lu"){
+        generators::chung_lu(edgelist, SIZE, 10, 2.5, SEED, WEIGHTS);
+    } else if (GENERATOR == "random_geometric"){
+        generators::random_geometric(edgelist, SIZE, std::sqrt(10 / (M_PI * SIZE)), SEED, WEIGHTS);
+    } else if (GENERATOR == "lattice_2d"){
+        int side = std::max(2, (int) std::sqrt(SIZE));
+        generators::lattice_2d(edgelist, side, side, true, SEED, WEIGHTS);
+    } else {
+        std::cerr << "ERROR: Unknown benchmark generator " << GENERATOR << ".\n";
+        exit(1);
+    }
+}
+
+/**
+ * Runs a stage the given number of times
+ * @param repeats The number of timed runs
+ * @param stage The stage, called once per run
+ * @return The wall clock seconds of each run
+*/
+std::vector<double> time_stage(int repeats, std::function<void()> stage){
+    std::vector<double> seconds;
+    for (int run = 0; run < repeats; run++){
+        auto start = std::chrono::steady_clock::now();
+        stage();
+        seconds.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    return seconds;
+}
+
+/**
+ * Formats a result as a single line JSON object
+ * @param result The result
+ * @return The JSON object
+*/
+std::string result_to_json(const bench_result &result){
+    std::stringstream json;
+    json << std::setprecision(9);
+    json << "{\"generator\": \"" << result.generator << "\", \"size\": " << result.size << ", \"edges\": " << result.edges
+        << ", \"threads\": " << result.threads << ", \"stage\": \"" << result.stage << "\", \"median_s\": " << result.median_s
+        << ", \"min_s\": " << result.min_s << ", \"items\": " << result.items << ", \"unit\": \"" << result.unit
+        << "\", \"items_per_s\": " << (result.median_s > 0 ? result.items / result.median_s : 0)
+        << ", \"speedup\": " << result.speedup << ", \"efficiency\": " << result.efficiency << "}";
+    return json.str();
+}
+
+/**
+ * Reads the value of a field from a single line JSON object written by result_to_json
+ * @param line The line
+ * @param field The name of the field
+ * @return The value (without quotes), empty if the field is missing
+*/
+std::string json_field(const std::string &line, std::string field){
+    size_t key = line.find("\"" + field + "\": ");
+    if (key == std::string::npos){
+        return "";
+    }
+    size_t start = key + field.size() + 4;
+    if (start < line.size() && line[start] == '"'){
+        return line.substr(start + 1, line.find('"', start + 1) - start - 1);
+    }
+    return line.substr(start, line.find_first_of(",}", start) - start);
+}
+
+/**
+ * Benchmarks every stage on one network at every thread count
+ * @param GENERATOR The generator of the network
+ * @param SIZE The vertex count of the network
+ * @param config The benchmark settings
+ * @param results The results are appended to it
+*/
+void bench_network(std::string GENERATOR, int SIZE, const bench_config &config, std::vector<bench_result> &results){
+    edgelist network;
+    std::vector<double> generate_seconds = time_stage(1, [&](){
+        generate_bench_network(network, GENERATOR, SIZE, config.seed);
+    });
+    const long long EDGES = network.get_edges().size();
+    std::cerr << "Benchmarking " << GENERATOR << " with " << SIZE << " vertices and " << EDGES << " edges\n";
+
+    // The network is loaded back from a plaintext copy
+    const std::string EDGELIST_FILE = (std::filesystem::temp_directory_path() / ("bench_" + std::to_string(getpid()) + "_edgelist.txt")).string();
+    network.save_edgelist_as_plaintext(EDGELIST_FILE);
+
+    edgelist neg_laplacian = network.take_neg_laplacian();
+    edgelist g_tilda = neg_laplacian.neg_laplacian_to_g();
+    metrics::laplacian_stats stats = metrics::compute_laplacian_stats(neg_laplacian);
+    compact_graph g_tilda_graph(g_tilda, stats.dim + 1);
+
+    // Sources spread evenly over the vertex IDs
+    const int VERTICES = network.max_vertex() + 1;
+    std::vector<int> sources;
+    for (int i = 0; i < std::min(config.sources, VERTICES); i++){
+        sources.push_back((long long) i * VERTICES / std::min(config.sources, VERTICES));
+    }
+
+    // Without a given tau, three times the mean ~G edge weight
+    double tau = config.tau;
+    if (tau <= 0){
+        long double total = 0;
+        for (int64_t i = 0; i < g_tilda_graph.edge_count(); i++){
+            total += g_tilda_graph.Weights[i];
+        }
+        tau = g_tilda_graph.edge_count() ? 3 * total / g_tilda_graph.edge_count() : 1;
+    }
+
+    // The y values neg_laplacian_to_g looks up: KAPPA over the absolute weight of every off-diagonal negative laplacian edge
+    std::vector<double> w_func_inputs;
+    for (edge &e : neg_laplacian.get_edges()){
+        if (e.src != e.dest && e.weight != 0){
+            w_func_inputs.push_back(stats.kappa / std::abs(e.weight));
+        }
+    }
+
+    // Each stage with the amount of work it does per run
+    struct stage {
+        std::string name;
+        long long items;
+        std::string unit;
+        std::function<void()> run;
+    };
+    std::vector<stage> stages = {
+        {"load", EDGES, "edges", [&](){
+            edgelist loaded = edgelist_from_file(true, EDGELIST_FILE);
+        }},
+        {"take_neg_laplacian", EDGES, "edges", [&](){
+            edgelist result = network.take_neg_laplacian();
+        }},
+        {"neg_laplacian_to_g", EDGES, "edges", [&](){
+            edgelist result = neg_laplacian.neg_laplacian_to_g();
+        }},
+        {"w_func", (long long) w_func_inputs.size(), "lookups", [&](){
+            double total = 0;
+            #pragma omp parallel for reduction(+:total)
+            for (size_t i = 0; i < w_func_inputs.size(); i++){
+                total += funcs::w_func(w_func_inputs[i]);
+            }
+            volatile double sink = total;
+            (void) sink;
+        }},
+        {"geodesic_distance_k", (long long) sources.size(), "sources", [&](){
+            #pragma omp parallel for schedule(dynamic, 1)
+            for (size_t i = 0; i < sources.size(); i++){
+                metrics::geodesic_distance_k(g_tilda, sources[i], config.k);
+            }
+        }},
+        {"geodesic_distance_tau", (long long) sources.size(), "sources", [&](){
+            #pragma omp parallel for schedule(dynamic, 1)
+            for (size_t i = 0; i < sources.size(); i++){
+                metrics::geodesic_distance_tau(g_tilda, sources[i], tau);
+            }
+        }},
+        {"n_tilda_gamma_neighborhood", (long long) sources.size(), "sources", [&](){
+            #pragma omp parallel for schedule(dynamic, 1)
+            for (size_t i = 0; i < sources.size(); i++){
+                metrics::n_tilda_gamma_neighborhood(g_tilda, stats, sources[i], config.gamma);
+            }
+        }},
+        {"s_avg_gamma", EDGES, "edges", [&](){
+            metrics::s_avg_gamma(g_tilda_graph, stats, config.gamma);
+        }},
+        {"L_neighborhood_reduction_rate_average", EDGES, "edges", [&](){
+            metrics::L_neighborhood_reduction_rate_average(g_tilda, stats, config.L);
+        }}
+    };
+
+    results.push_back({GENERATOR, SIZE, EDGES, omp_get_max_threads(), "generate", generate_seconds[0], generate_seconds[0], EDGES, "edges", 1, 1});
+    for (stage &stage : stages){
+        double base_seconds = 0;
+        int base_threads = 0;
+        for (int threads : config.threads){
+            omp_set_num_threads(threads);
+            std::vector<double> seconds = time_stage(config.repeats, stage.run);
+            std::sort(seconds.begin(), seconds.end());
+            double median = seconds[seconds.size() / 2];
+            if (base_threads == 0){
+                base_seconds = median;
+                base_threads = threads;
+            }
+            double speedup = median > 0 ? base_seconds / median : 1;
+            results.push_back({GENERATOR, SIZE, EDGES, threads, stage.name, median, seconds[0], stage.items, stage.unit,
+                speedup, speedup * base_threads / threads});
+            std::cout << std::left << std::setw(18) << GENERATOR << std::setw(10) << SIZE << std::setw(40) << stage.name
+                << std::setw(4) << threads << std::right << std::fixed << std::setprecision(6) << std::setw(14) << median << " s"
+                << std::setprecision(0) << std::setw(16) << (median > 0 ? stage.items / median : 0) << " " << stage.unit << "/s"
+                << std::setprecision(2) << std::setw(8) << results.back().efficiency << "\n" << std::defaultfloat;
+        }
+    }
+    omp_set_num_threads(config.threads.back());
+    std::filesystem::remove(EDGELIST_FILE);
+}
+
+/**
+ * Compares results with a baseline JSON file written by an earlier run and prints the ratio of the median times of the stages in both
+ * @param BASELINE_FILE The filepath of the baseline
+ * @param results The current results
+ * @param TOLERANCE The relative slowdown above which a stage is reported as a regression
+ * @return The number of regressions
+*/
+int compare_with_baseline(std::string BASELINE_FILE, const std::vector<bench_result> &results, double TOLERANCE){
+    std::ifstream file(BASELINE_FILE);
+    if (!file.is_open()){
+        std::cerr << "ERROR: Could not open the baseline " << BASELINE_FILE << ".\n";
+        exit(1);
+    }
+    std::map<std::string, double> baseline;
+    std::string line;
+    while (std::getline(file, line)){
+        std::string median = json_field(line, "median_s");
+        if (json_field(line, "stage").empty() || median.empty()){
+            continue;
+        }
+        baseline[json_field(line, "generator") + " " + json_field(line, "size") + " " + json_field(line, "stage") + " " + json_field(line, "threads")] = std::stod(median);
+    }
+
+    int regressions = 0;
+    std::cout << "\nComparison with " << BASELINE_FILE << " (current / baseline median time)\n";
+    for (const bench_result &result : results){
+        std::string key = result.generator + " " + std::to_string(result.size) + " " + result.stage + " " + std::to_string(result.threads);
+        if (!baseline.count(key) || baseline[key] <= 0 || result.stage == "generate"){
+            continue;
+        }
+        double ratio = result.median_s / baseline[key];
+        std::cout << std::left << std::setw(72) << key << std::right << std::fixed << std::setprecision(3) << std::setw(8) << ratio << std::defaultfloat;
+        if (ratio > 1 + TOLERANCE){
+            std::cout << "  SLOWER";
+            regressions++;
+        } else if (ratio < 1 - TOLERANCE){
+            std::cout << "  FASTER";
+        }
+        std::cout << "\n";
+    }
+    return regressions;
+}
+
+int main(int argc, char* argv[]){
+    std::map<std::string, std::string> flags = extract_flags(argc, argv);
+    placement::configure(flags);
+    if (argc != 1){
+        std::cerr << "Usage: bench.bin [--generators=LIST] [--sizes=LIST] [--threads=LIST] [--repeats=N] [--sources=N] [--seed=SEED] [--k=K] [--tau=TAU] [--gamma=GAMMA] [--L=L] [--output=FILE] [--baseline=FILE] [--tolerance=FRACTION]\n";
+        exit(1);
+    }
+
+    bench_config config;
+    std::stringstream generator_list(flags.count("generators") ? flags["generators"] : "watts_strogatz,erdos_renyi,chung_lu,lattice_2d");
+    std::string generator;
+    while (std::getline(generator_list, generator, ',')){
+        config.generators.push_back(generator);
+    }
+    for (double size : parse_value_list(flags.count("sizes") ? flags["sizes"] : "500,2000")){
+        config.sizes.push_back((int) size);
+    }
+    // 1 and every power of two up to the available threads unless given
+    std::set<int> thread_counts;
+    if (flags.count("threads")){
+        for (double threads : parse_value_list(flags["threads"])){
+            thread_counts.insert((int) threads);
+        }
+    } else {
+        for (int threads = 1; threads < omp_get_max_threads(); threads *= 2){
+            thread_counts.insert(threads);
+        }
+        thread_counts.insert(omp_get_max_threads());
+    }
+    config.threads.assign(thread_counts.begin(), thread_counts.end());
+    config.repeats = flags.count("repeats") ? std::stoi(flags["repeats"]) : 3;
+    config.sources = flags.count("sources") ? std::stoi(flags["sources"]) : 256;
+    config.seed = flags.count("seed") ? std::stoull(flags["seed"]) : 1;
+    config.k = flags.count("k") ? std::stoi(flags["k"]) : 3;
+    config.tau = flags.count("tau") ? std::stod(flags["tau"]) : 0;
+    config.gamma = flags.count("gamma") ? std::stod(flags["gamma"]) : 0.05;
+    config.L = flags.count("L") ? std::stoi(flags["L"]) : 5;
+    const std::string OUTPUT_FILE = flags.count("output") ? flags["output"] : "bench.json";
+    const double TOLERANCE = flags.count("tolerance") ? std::stod(flags["tolerance"]) : 0.1;
+
+    if (config.threads.empty() || config.threads.front() < 1 || config.repeats < 1 || config.sources < 1 || config.sizes.empty()){
+        std::cerr << "ERROR: Invalid benchmark settings given.\n";
+        exit(1);
+    }
+    if ( !( config.gamma > 0 && config.gamma < 1) ){
+        std::cerr << "ERROR: Invalid Gamma value given.\n";
+        exit(1);
+    }
+
+    // The w_func table is generated once per process, its cost is reported on its own
+    std::vector<bench_result> results;
+    std::vector<double> table_seconds = time_stage(1, [](){
+        funcs::w_func(1);
+    });
+    results.push_back({"none", 0, 0, 1, "w_func_table", table_seconds[0], table_seconds[0], 1, "tables", 1, 1});
+
+    for (std::string &generator : config.generators){
+        for (int size : config.sizes){
+            bench_network(generator, size, config, results);
+        }
+    }
+
+    std::ofstream output(OUTPUT_FILE);
+    if (!output.is_open()){
+        std::cerr << "ERROR: Could not open the output " << OUTPUT_FILE << ".\n";
+        exit(1);
+    }
+    char hostname[256] = "";
+    gethostname(hostname, sizeof(hostname) - 1);
+    output << "{\n\"host\": \"" << hostname << "\",\n\"procs\": " << omp_get_num_procs() << ",\n\"repeats\": " << config.repeats
+        << ",\n\"sources\": " << config.sources << ",\n\"seed\": " << config.seed << ",\n\"results\": [\n";
+    for (size_t i = 0; i < results.size(); i++){
+        output << result_to_json(results[i]) << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    output << "]\n}\n";
+    output.close();
+    std::cout << "Results written to " << OUTPUT_FILE << "\n";
+
+    if (flags.count("baseline")){
+        int regressions = compare_with_baseline(flags["baseline"], results, TOLERANCE);
+        if (regressions > 0){
+            std::cerr << "ERROR: " << regressions << " stages are slower than the baseline.\n";
+            exit(1);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,236 @@
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <bit>
+#include <atomic>
+#include <cstdint>
+#include <omp.h>
+
+#include "bfs.h"
+
+namespace {
+    // One bit per source of a batch, the fixed width lets the compiler vectorize the loops over the words
+    template <int WORDS>
+    using lanes = std::array<uint64_t, WORDS>;
+
+    // State of the batches searched by one thread, every bit is clear between batches
+    template <int WORDS>
+    struct batch_scratch {
+        std::vector<lanes<WORDS>> seen;
+        std::vector<lanes<WORDS>> frontier;
+        std::vector<lanes<WORDS>> next;
+        // Vertices with a set bit in frontier, then in next
+        std::vector<int> active;
+        std::vector<int> next_active;
+        std::vector<bfs::hop_row> rows;
+    };
+
+    // Searches the COUNT sources starting at FIRST as one batch
+    template <int WORDS>
+    void search_batch(const compact_graph &graph, int FIRST, int COUNT, int MAX_HOPS, batch_scratch<WORDS> &scratch, const std::function<void(int, bfs::hop_row&)> &consume){
+        if (scratch.seen.empty()){
+            scratch.seen.resize(graph.Vertices);
+            scratch.frontier.resize(graph.Vertices);
+            scratch.next.resize(graph.Vertices);
+            scratch.rows.resize(64 * WORDS);
+        }
+        std::vector<lanes<WORDS>> &seen = scratch.seen;
+        std::vector<lanes<WORDS>> &frontier = scratch.frontier;
+        std::vector<lanes<WORDS>> &next = scratch.next;
+
+        scratch.active.clear();
+        for (int lane = 0; lane < COUNT; lane++){
+            int src = FIRST + lane;
+            seen[src][lane / 64] |= uint64_t(1) << (lane % 64);
+            frontier[src][lane / 64] |= uint64_t(1) << (lane % 64);
+            scratch.active.push_back(src);
+            scratch.rows[lane].assign(1, {src, 0});
+        }
+
+        for (int hops = 1; !scratch.active.empty() && (MAX_HOPS < 0 || hops <= MAX_HOPS); hops++){
+            scratch.next_active.clear();
+            // Every source with from in its frontier reaches the neighbors of from it has not seen
+            for (int from : scratch.active){
+                const lanes<WORDS> &reach = frontier[from];
+                for (int64_t i = graph.Offsets[from]; i < graph.Offsets[from+1]; i++){
+                    int to = graph.Targets[i];
+                    // Ignore self edges
+                    if (to == from){
+                        continue;
+                    }
+                    lanes<WORDS> &to_next = next[to];
+                    const lanes<WORDS> &to_seen = seen[to];
+                    uint64_t before = 0;
+                    uint64_t after = 0;
+                    for (int word = 0; word < WORDS; word++){
+                        before |= to_next[word];
+                        to_next[word] |= reach[word] & ~to_seen[word];
+                        after |= to_next[word];
+                    }
+                    if (before == 0 && after != 0){
+                        scratch.next_active.push_back(to);
+                    }
+                }
+            }
+            for (int from : scratch.active){
+                frontier[from] = {};
+            }
+
+            // The new bits of a vertex are the sources reaching it at this many hops
+            for (int to : scratch.next_active){
+                lanes<WORDS> &found = next[to];
+                for (int word = 0; word < WORDS; word++){
+                    seen[to][word] |= found[word];
+                    for (uint64_t bits = found[word]; bits != 0; bits &= bits - 1){
+                        scratch.rows[word * 64 + std::countr_zero(bits)].emplace_back(to, hops);
+                    }
+                }
+                frontier[to] = found;
+                found = {};
+            }
+            std::swap(scratch.active, scratch.next_active);
+        }
+        for (int from : scratch.active){
+            frontier[from] = {};
+        }
+
+        // The rows list every vertex with a set bit in seen
+        for (int lane = 0; lane < COUNT; lane++){
+            bfs::hop_row &row = scratch.rows[lane];
+            for (const std::pair<int, int> &reached : row){
+                seen[reached.first] = {};
+            }
+            std::sort(row.begin(), row.end());
+            consume(FIRST + lane, row);
+        }
+    }
+
+    // Splits the sources FIRST to LAST into batches of 64 * WORDS sources, searched in parallel
+    template <int WORDS>
+    void search_batches(const compact_graph &graph, int FIRST, int LAST, int MAX_HOPS, const std::function<void(int, bfs::hop_row&)> &consume){
+        const int BATCH_SOURCES = 64 * WORDS;
+        int batches = (LAST - FIRST + BATCH_SOURCES) / BATCH_SOURCES;
+        #pragma omp parallel
+        {
+            batch_scratch<WORDS> scratch;
+            #pragma omp for schedule(dynamic, 1)
+            for (int batch = 0; batch < batches; batch++){
+                int first = FIRST + batch * BATCH_SOURCES;
+                search_batch<WORDS>(graph, first, std::min(BATCH_SOURCES, LAST + 1 - first), MAX_HOPS, scratch, consume);
+            }
+        }
+    }
+}
+
+void bfs::multi_source_hops(const compact_graph &graph, int FIRST, int LAST, int MAX_HOPS, const std::function<void(int, bfs::hop_row&)> &consume){
+    if (LAST < FIRST){
+        return;
+    }
+    // Wider batches share each pass over the edges between more sources, but every thread needs a batch of its own
+    if (LAST - FIRST + 1 >= 256 * omp_get_max_threads()){
+        search_batches<4>(graph, FIRST, LAST, MAX_HOPS, consume);
+    } else {
+        search_batches<1>(graph, FIRST, LAST, MAX_HOPS, consume);
+    }
+}
+
+bfs::hop_row bfs::direction_optimizing_hops(const compact_graph &graph, const compact_graph &reverse_graph, int src, int MAX_HOPS){
+    const int VERTICES = graph.Vertices;
+    const int WORDS = (VERTICES + 63) / 64;
+    std::vector<int> hops(VERTICES, -1);
+    hops[src] = 0;
+
+    // The frontier is a list of vertices for top-down levels and a bitset for bottom-up levels
+    std::vector<int> frontier(1, src);
+    std::vector<uint64_t> frontier_bits;
+    std::vector<uint64_t> next_bits;
+    int64_t frontier_size = 1;
+    bool bottom_up = false;
+    // Edges entering the vertices not reached yet, the work of a bottom-up level
+    int64_t unreached_edges = reverse_graph.edge_count() - reverse_graph.degree(src);
+
+    for (int level = 1; frontier_size > 0 && (MAX_HOPS < 0 || level <= MAX_HOPS); level++){
+        if (!bottom_up){
+            int64_t frontier_edges = 0;
+            for (int from : frontier){
+                frontier_edges += graph.degree(from);
+            }
+            if (frontier_edges > unreached_edges / BOTTOM_UP_ALPHA){
+                bottom_up = true;
+                frontier_bits.assign(WORDS, 0);
+                next_bits.assign(WORDS, 0);
+                for (int from : frontier){
+                    frontier_bits[from / 64] |= uint64_t(1) << (from % 64);
+                }
+            }
+        } else if (frontier_size < VERTICES / TOP_DOWN_BETA){
+            bottom_up = false;
+            frontier.clear();
+            for (int word = 0; word < WORDS; word++){
+                for (uint64_t bits = frontier_bits[word]; bits != 0; bits &= bits - 1){
+                    frontier.push_back(word * 64 + std::countr_zero(bits));
+                }
+            }
+        }
+
+        int64_t reached = 0;
+        int64_t reached_edges = 0;
+        if (bottom_up){
+            // Each thread owns whole words of the next bitset, so the bits are set without atomics
+            #pragma omp parallel for schedule(dynamic, 64) reduction(+:reached, reached_edges) if(VERTICES >= PARALLEL_LEVEL_VERTICES)
+            for (int word = 0; word < WORDS; word++){
+                uint64_t found = 0;
+                for (int to = word * 64; to < std::min(VERTICES, word * 64 + 64); to++){
+                    if (hops[to] >= 0){
+                        continue;
+                    }
+                    for (int64_t i = reverse_graph.Offsets[to]; i < reverse_graph.Offsets[to+1]; i++){
+                        int from = reverse_graph.Targets[i];
+                        if ((frontier_bits[from / 64] >> (from % 64)) & 1){
+                            hops[to] = level;
+                            found |= uint64_t(1) << (to % 64);
+                            reached++;
+                            reached_edges += reverse_graph.degree(to);
+                            break;
+                        }
+                    }
+                }
+                next_bits[word] = found;
+            }
+            std::swap(frontier_bits, next_bits);
+        } else {
+            std::vector<int> next;
+            #pragma omp parallel reduction(+:reached_edges) if((int64_t) frontier.size() >= PARALLEL_LEVEL_VERTICES)
+            {
+                std::vector<int> thread_next;
+                #pragma omp for schedule(dynamic, 64) nowait
+                for (size_t j = 0; j < frontier.size(); j++){
+                    int from = frontier[j];
+                    for (int64_t i = graph.Offsets[from]; i < graph.Offsets[from+1]; i++){
+                        int to = graph.Targets[i];
+                        std::atomic_ref<int> to_hops(hops[to]);
+                        int unreached = -1;
+                        if (to_hops.load(std::memory_order_relaxed) < 0 && to_hops.compare_exchange_strong(unreached, level, std::memory_order_relaxed)){
+                            thread_next.push_back(to);
+                            reached_edges += reverse_graph.degree(to);
+                        }
+                    }
+                }
+                #pragma omp critical
+                next.insert(next.end(), thread_next.begin(), thread_next.end());
+            }
+            frontier.swap(next);
+            reached = frontier.size();
+        }
+        frontier_size = reached;
+        unreached_edges -= reached_edges;
+    }
+
+    bfs::hop_row row;
+    for (int v = 0; v < VERTICES; v++){
+        if (hops[v] >= 0){
+            row.emplace_back(v, hops[v]);
+        }
+    }
+    return row;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <functional>
+
+#include "compact_graph.h"
+
+/**
+ * Breadth first searches of compact graphs whose edges all have the same weight, where the shortest paths are the paths with the fewest edges.
+ * The multi-source BFS searches a batch of 64 or 256 sources at once: every vertex holds one bit per source of the batch in its seen, frontier
+ * and next bitsets, so one pass over the edges of a level advances every source of the batch with word wide OR and AND NOT operations.
+ * The direction-optimizing BFS searches from one source, switching between expanding the frontier (top-down) and letting every unreached
+ * vertex look for a frontier vertex among its in-neighbors (bottom-up) when the frontier holds a large share of the remaining edges.
+*/
+namespace bfs {
+    // Top-down levels switch to bottom-up once the edges leaving the frontier exceed 1/ALPHA of the edges entering the unreached vertices
+    const int64_t BOTTOM_UP_ALPHA = 14;
+    // Bottom-up levels switch back to top-down once the frontier holds fewer than 1/BETA of the vertices
+    const int64_t TOP_DOWN_BETA = 24;
+    // Smallest frontier (or number of vertices for bottom-up levels) expanded in parallel
+    const int64_t PARALLEL_LEVEL_VERTICES = 4096;
+
+    // Vertices reached from one source as (vertex, hops) pairs sorted by vertex, the source itself included at 0 hops
+    typedef std::vector<std::pair<int, int>> hop_row;
+
+    /**
+     * Finds the vertices within MAX_HOPS edges of each of the sources FIRST to LAST with multi-source BFS, the batches of sources are searched in parallel
+     * @param graph The graph to search
+     * @param FIRST The first source
+     * @param LAST The last source (inclusive)
+     * @param MAX_HOPS The largest number of edges from a source to a reached vertex (negative for no limit)
+     * @param consume Called by the searching thread with each source and its row, the row is reused once it returns
+    */
+    void multi_source_hops(const compact_graph &graph, int FIRST, int LAST, int MAX_HOPS, const std::function<void(int, hop_row&)> &consume);
+
+    /**
+     * Finds the vertices within MAX_HOPS edges of a source with a direction-optimizing BFS, large levels are expanded in parallel
+     * @param graph The graph to search
+     * @param reverse_graph The graph with every edge reversed (the graph itself if it is undirected)
+     * @param src The source
+     * @param MAX_HOPS The largest number of edges from the source to a reached vertex (negative for no limit)
+     * @return The row of the source
+    */
+    hop_row direction_optimizing_hops(const compact_graph &graph, const compact_graph &reverse_graph, int src, int MAX_HOPS);
+};
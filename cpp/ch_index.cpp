@@ -0,0 +1,516 @@
+#include <string>
+#include <vector>
+#include <queue>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <unistd.h>
+#include <omp.h>
+
+#include "ch_index.h"
+
+namespace {
+    // Identifies a hierarchy file. Files are written in host byte order since the index is local to the machine.
+    const char INDEX_MAGIC[8] = {'N', 'L', 'E', 'C', 'H', 'X', '1', '\0'};
+
+    const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+    const uint64_t FNV_PRIME = 1099511628211ULL;
+
+    // FNV-1a hash of a block of bytes, continuing from the given hash
+    uint64_t fnv1a(const char *data, size_t length, uint64_t hash = FNV_OFFSET_BASIS){
+        for (size_t i = 0; i < length; i++){
+            hash ^= (unsigned char) data[i];
+            hash *= FNV_PRIME;
+        }
+        return hash;
+    }
+
+    // Length of a path, ordered by information distance then network distance
+    struct cost {
+        double info;
+        int hops;
+
+        bool operator<(const cost &other) const {
+            return this->info < other.info || (this->info == other.info && this->hops < other.hops);
+        }
+
+        cost operator+(const cost &other) const {
+            return {this->info + other.info, this->hops + other.hops};
+        }
+    };
+
+    const cost UNREACHED = {INFINITY, INT32_MAX};
+
+    typedef std::pair<cost, int> queued_vertex;
+
+    // Orders a heap so the shortest queued vertex is on top
+    struct farther {
+        bool operator()(const queued_vertex &a, const queued_vertex &b) const {
+            return b.first < a.first;
+        }
+    };
+
+    // An edge of the graph being contracted, to or from an uncontracted vertex
+    struct arc {
+        int to;
+        cost length;
+    };
+
+    // Dijkstra search from a vertex that avoids the vertex being contracted, reusing its distances between searches
+    class witness_search {
+        public:
+            std::vector<cost> Distance;
+            std::vector<int> Touched;
+            // Queue of the search, a heap kept between searches so its storage is reused
+            std::vector<queued_vertex> Queue;
+            // Vertices whose Target entry equals Round are the targets of the current search
+            std::vector<int> Target;
+            int Round = 0;
+
+            witness_search(int vertices) : Distance(vertices, UNREACHED), Target(vertices, -1) {}
+
+            // Starts a round of searches towards the given arcs, returns the number of targets
+            int set_targets(const std::vector<arc> &targets){
+                this->Round++;
+                for (const arc &target : targets){
+                    this->Target[target.to] = this->Round;
+                }
+                return targets.size();
+            }
+
+            // Searches until every target or every vertex closer than limit is settled, or settle_limit vertices are
+            void run(const std::vector<std::vector<arc>> &out_arcs, int src, int avoid, cost limit, int targets, int settle_limit){
+                for (int v : this->Touched){
+                    this->Distance[v] = UNREACHED;
+                }
+                this->Touched.clear();
+                this->Queue.clear();
+                this->Distance[src] = {0, 0};
+                this->Touched.push_back(src);
+                this->Queue.push_back({this->Distance[src], src});
+                int settled = 0;
+                while (!this->Queue.empty()){
+                    std::pop_heap(this->Queue.begin(), this->Queue.end(), farther());
+                    auto [from_cost, from] = this->Queue.back();
+                    this->Queue.pop_back();
+                    if (this->Distance[from] < from_cost){
+                        continue;
+                    }
+                    if (limit < from_cost || ++settled > settle_limit){
+                        break;
+                    }
+                    if (this->Target[from] == this->Round && --targets == 0){
+                        break;
+                    }
+                    for (const arc &edge : out_arcs[from]){
+                        if (edge.to == avoid){
+                            continue;
+                        }
+                        cost possible = from_cost + edge.length;
+                        if (possible < this->Distance[edge.to]){
+                            if (this->Distance[edge.to].hops == INT32_MAX){
+                                this->Touched.push_back(edge.to);
+                            }
+                            this->Distance[edge.to] = possible;
+                            this->Queue.push_back({possible, edge.to});
+                            std::push_heap(this->Queue.begin(), this->Queue.end(), farther());
+                        }
+                    }
+                }
+            }
+    };
+
+    // A shortcut u -> w replacing the path u -> v -> w through a contracted vertex v
+    struct shortcut {
+        int from;
+        int to;
+        cost length;
+    };
+
+    // Finds the shortcuts needed to contract a vertex, the paths through it without a witness at least as short among the first settle_limit vertices settled
+    void find_shortcuts(const std::vector<std::vector<arc>> &out_arcs, const std::vector<std::vector<arc>> &in_arcs, int v, witness_search &witness, std::vector<shortcut> &shortcuts, int settle_limit){
+        shortcuts.clear();
+        if (out_arcs[v].empty()){
+            return;
+        }
+        cost longest_out = {0, 0};
+        for (const arc &out : out_arcs[v]){
+            if (longest_out < out.length){
+                longest_out = out.length;
+            }
+        }
+        const int TARGETS = witness.set_targets(out_arcs[v]);
+        for (const arc &in : in_arcs[v]){
+            witness.run(out_arcs, in.to, v, in.length + longest_out, TARGETS, settle_limit);
+            for (const arc &out : out_arcs[v]){
+                if (out.to == in.to){
+                    continue;
+                }
+                cost through = in.length + out.length;
+                if (through < witness.Distance[out.to]){
+                    shortcuts.push_back({in.to, out.to, through});
+                }
+            }
+        }
+    }
+
+    // Adds an arc to a list, or shortens the arc already there
+    void add_arc(std::vector<arc> &arcs, int to, cost length){
+        for (arc &existing : arcs){
+            if (existing.to == to){
+                if (length < existing.length){
+                    existing.length = length;
+                }
+                return;
+            }
+        }
+        arcs.push_back({to, length});
+    }
+
+    void remove_arc(std::vector<arc> &arcs, int to){
+        for (size_t i = 0; i < arcs.size(); i++){
+            if (arcs[i].to == to){
+                arcs[i] = arcs.back();
+                arcs.pop_back();
+                return;
+            }
+        }
+    }
+
+    // Copies the arcs of each vertex (to higher ranked vertices) into an upward graph
+    ch::upward_graph to_upward_graph(const std::vector<std::vector<arc>> &arcs){
+        ch::upward_graph graph;
+        graph.Offsets.resize(arcs.size() + 1, 0);
+        for (size_t v = 0; v < arcs.size(); v++){
+            graph.Offsets[v+1] = graph.Offsets[v] + arcs[v].size();
+        }
+        graph.Targets.reserve(graph.Offsets.back());
+        graph.Info.reserve(graph.Offsets.back());
+        graph.Hops.reserve(graph.Offsets.back());
+        for (const std::vector<arc> &vertex_arcs : arcs){
+            for (const arc &edge : vertex_arcs){
+                graph.Targets.push_back(edge.to);
+                graph.Info.push_back(edge.length.info);
+                graph.Hops.push_back(edge.length.hops);
+            }
+        }
+        return graph;
+    }
+
+    // Distances of the forward (0) and backward (1) searches of the queries of a thread, reset through the touched vertices after each query
+    struct query_scratch {
+        std::vector<cost> distance[2];
+        std::vector<int> touched[2];
+        // Queues of the searches, heaps kept between queries so their storage is reused
+        std::vector<queued_vertex> queue[2];
+
+        void prepare(int vertices){
+            for (int side = 0; side < 2; side++){
+                if ((int) this->distance[side].size() < vertices){
+                    this->distance[side].resize(vertices, UNREACHED);
+                }
+            }
+        }
+
+        void reset(){
+            for (int side = 0; side < 2; side++){
+                for (int v : this->touched[side]){
+                    this->distance[side][v] = UNREACHED;
+                }
+                this->touched[side].clear();
+                this->queue[side].clear();
+            }
+        }
+    };
+
+    template <typename T>
+    void write_value(std::ofstream &file, T value){
+        file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    void write_array(std::ofstream &file, const std::vector<T> &values){
+        write_value<uint64_t>(file, values.size());
+        file.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+    }
+
+    template <typename T>
+    T read_value(std::ifstream &file){
+        T value{};
+        file.read(reinterpret_cast<char*>(&value), sizeof(T));
+        return value;
+    }
+
+    template <typename T>
+    std::vector<T> read_array(std::ifstream &file, uint64_t max_count){
+        uint64_t count = read_value<uint64_t>(file);
+        std::vector<T> values;
+        if (!file || count > max_count){
+            file.setstate(std::ios::failbit);
+            return values;
+        }
+        values.resize(count);
+        file.read(reinterpret_cast<char*>(values.data()), count * sizeof(T));
+        return values;
+    }
+
+    void write_upward_graph(std::ofstream &file, const ch::upward_graph &graph){
+        write_array(file, graph.Offsets);
+        write_array(file, graph.Targets);
+        write_array(file, graph.Info);
+        write_array(file, graph.Hops);
+    }
+
+    // Reads an upward graph, returns false if the file does not hold a consistent graph of the given number of vertices
+    bool read_upward_graph(std::ifstream &file, ch::upward_graph &graph, int vertices, uint64_t max_edges){
+        graph.Offsets = read_array<int64_t>(file, (uint64_t) vertices + 1);
+        graph.Targets = read_array<int>(file, max_edges);
+        graph.Info = read_array<double>(file, max_edges);
+        graph.Hops = read_array<int>(file, max_edges);
+        if (!file || graph.Offsets.size() != (size_t) vertices + 1 || graph.Offsets[0] != 0 || graph.Offsets.back() != (int64_t) graph.Targets.size()
+            || graph.Info.size() != graph.Targets.size() || graph.Hops.size() != graph.Targets.size()){
+            return false;
+        }
+        for (int v = 0; v < vertices; v++){
+            if (graph.Offsets[v] > graph.Offsets[v+1]){
+                return false;
+            }
+        }
+        return std::all_of(graph.Targets.begin(), graph.Targets.end(), [vertices](int target){ return target >= 0 && target < vertices; });
+    }
+}
+
+uint64_t ch::fingerprint(const compact_graph &graph){
+    uint64_t hash = fnv1a(reinterpret_cast<const char*>(&graph.Vertices), sizeof(graph.Vertices));
+    hash = fnv1a(reinterpret_cast<const char*>(&graph.Directional), sizeof(graph.Directional), hash);
+    hash = fnv1a(reinterpret_cast<const char*>(graph.Offsets.data()), graph.Offsets.size() * sizeof(int64_t), hash);
+    hash = fnv1a(reinterpret_cast<const char*>(graph.Targets.data()), graph.Targets.size() * sizeof(int), hash);
+    return fnv1a(reinterpret_cast<const char*>(graph.Weights.data()), graph.Weights.size() * sizeof(double), hash);
+}
+
+ch::contraction_hierarchy::contraction_hierarchy(){}
+
+ch::contraction_hierarchy::contraction_hierarchy(const compact_graph &graph){
+    const int VERTICES = graph.Vertices;
+    this->Vertices = VERTICES;
+    this->Directional = graph.Directional;
+    this->GraphFingerprint = ch::fingerprint(graph);
+
+    // Arcs between uncontracted vertices (the shortest of parallel edges, without self edges)
+    std::vector<std::vector<arc>> out_arcs(VERTICES);
+    std::vector<std::vector<arc>> in_arcs(VERTICES);
+    for (int from = 0; from < VERTICES; from++){
+        std::vector<arc> &arcs = out_arcs[from];
+        for (int64_t i = graph.Offsets[from]; i < graph.Offsets[from+1]; i++){
+            if (graph.Targets[i] != from){
+                arcs.push_back({graph.Targets[i], {graph.Weights[i], 1}});
+            }
+        }
+        std::sort(arcs.begin(), arcs.end(), [](const arc &a, const arc &b){ return a.to < b.to || (a.to == b.to && a.length < b.length); });
+        arcs.erase(std::unique(arcs.begin(), arcs.end(), [](const arc &a, const arc &b){ return a.to == b.to; }), arcs.end());
+        for (const arc &edge : arcs){
+            in_arcs[edge.to].push_back({from, edge.length});
+        }
+    }
+
+    // Priority of each vertex, the shortcuts its contraction adds less the arcs it removes, plus its contracted neighbors and its level
+    // (one more than the highest level of the contracted neighbors) so the contraction spreads evenly and the hierarchy stays shallow
+    std::vector<int> contracted_neighbors(VERTICES, 0);
+    std::vector<int> level(VERTICES, 0);
+    auto priority = [&](int v, witness_search &witness, std::vector<shortcut> &shortcuts){
+        find_shortcuts(out_arcs, in_arcs, v, witness, shortcuts, ch::ESTIMATE_SETTLE_LIMIT);
+        return (int64_t) shortcuts.size() - (int64_t) out_arcs[v].size() - (int64_t) in_arcs[v].size() + contracted_neighbors[v] + level[v];
+    };
+
+    std::vector<std::pair<int64_t, int>> initial(VERTICES);
+    #pragma omp parallel
+    {
+        witness_search witness(VERTICES);
+        std::vector<shortcut> shortcuts;
+        #pragma omp for schedule(dynamic, 256)
+        for (int v = 0; v < VERTICES; v++){
+            initial[v] = {priority(v, witness, shortcuts), v};
+        }
+    }
+    std::priority_queue<std::pair<int64_t, int>, std::vector<std::pair<int64_t, int>>, std::greater<std::pair<int64_t, int>>> order(std::greater<std::pair<int64_t, int>>(), std::move(initial));
+
+    // Arcs of each vertex to the vertices still uncontracted when it was contracted, the higher ranked vertices
+    std::vector<std::vector<arc>> up_arcs(VERTICES);
+    std::vector<std::vector<arc>> down_arcs(VERTICES);
+    std::vector<bool> contracted(VERTICES, false);
+    witness_search witness(VERTICES);
+    std::vector<shortcut> shortcuts;
+    while (!order.empty()){
+        int v = order.top().second;
+        order.pop();
+        if (contracted[v]){
+            continue;
+        }
+        // Priorities are updated lazily, a vertex whose priority grew goes back in the queue
+        int64_t current = priority(v, witness, shortcuts);
+        if (!order.empty() && current > order.top().first){
+            order.push({current, v});
+            continue;
+        }
+
+        find_shortcuts(out_arcs, in_arcs, v, witness, shortcuts, ch::WITNESS_SETTLE_LIMIT);
+        contracted[v] = true;
+        for (const arc &out : out_arcs[v]){
+            remove_arc(in_arcs[out.to], v);
+            contracted_neighbors[out.to]++;
+            level[out.to] = std::max(level[out.to], level[v] + 1);
+        }
+        for (const arc &in : in_arcs[v]){
+            remove_arc(out_arcs[in.to], v);
+            contracted_neighbors[in.to]++;
+            level[in.to] = std::max(level[in.to], level[v] + 1);
+        }
+        up_arcs[v] = std::move(out_arcs[v]);
+        down_arcs[v] = std::move(in_arcs[v]);
+        std::vector<arc>().swap(out_arcs[v]);
+        std::vector<arc>().swap(in_arcs[v]);
+        for (const shortcut &added : shortcuts){
+            add_arc(out_arcs[added.from], added.to, added.length);
+            add_arc(in_arcs[added.to], added.from, added.length);
+        }
+    }
+
+    this->Up = to_upward_graph(up_arcs);
+    this->Down = to_upward_graph(down_arcs);
+}
+
+ch::path_distance ch::contraction_hierarchy::query(int src, int dest) const {
+    if (src < 0 || src >= this->Vertices || dest < 0 || dest >= this->Vertices){
+        return {INFINITY, -1};
+    }
+    static thread_local query_scratch scratch;
+    scratch.prepare(this->Vertices);
+    const ch::upward_graph *graphs[2] = {&this->Up, &this->Down};
+    std::vector<queued_vertex> *queues = scratch.queue;
+    const int ENDS[2] = {src, dest};
+    for (int side = 0; side < 2; side++){
+        scratch.distance[side][ENDS[side]] = {0, 0};
+        scratch.touched[side].push_back(ENDS[side]);
+        queues[side].push_back({{0, 0}, ENDS[side]});
+    }
+
+    // Both searches climb to the highest ranked vertex of the shortest path, so the shortest meeting vertex is final once every queued vertex is farther
+    cost best = UNREACHED;
+    while (!queues[0].empty() || !queues[1].empty()){
+        int side = queues[0].empty() || (!queues[1].empty() && queues[1].front().first < queues[0].front().first);
+        auto [from_cost, from] = queues[side].front();
+        if (!(from_cost < best)){
+            break;
+        }
+        std::pop_heap(queues[side].begin(), queues[side].end(), farther());
+        queues[side].pop_back();
+        std::vector<cost> &distance = scratch.distance[side];
+        if (distance[from] < from_cost){
+            continue;
+        }
+        const cost &other_side = scratch.distance[1-side][from];
+        if (other_side.hops != INT32_MAX && from_cost + other_side < best){
+            best = from_cost + other_side;
+        }
+        // Stall on demand: a vertex reached more shortly through a higher ranked vertex is not on a shortest path, so its edges are not relaxed
+        const ch::upward_graph &downward = *graphs[1-side];
+        bool stalled = false;
+        for (int64_t i = downward.Offsets[from]; i < downward.Offsets[from+1] && !stalled; i++){
+            const cost &higher = distance[downward.Targets[i]];
+            stalled = higher.hops != INT32_MAX && higher + cost{downward.Info[i], downward.Hops[i]} < from_cost;
+        }
+        if (stalled){
+            continue;
+        }
+        const ch::upward_graph &upward = *graphs[side];
+        for (int64_t i = upward.Offsets[from]; i < upward.Offsets[from+1]; i++){
+            int to = upward.Targets[i];
+            cost possible = from_cost + cost{upward.Info[i], upward.Hops[i]};
+            if (possible < distance[to]){
+                if (distance[to].hops == INT32_MAX){
+                    scratch.touched[side].push_back(to);
+                }
+                distance[to] = possible;
+                queues[side].push_back({possible, to});
+                std::push_heap(queues[side].begin(), queues[side].end(), farther());
+            }
+        }
+    }
+    scratch.reset();
+
+    if (best.hops == INT32_MAX){
+        return {INFINITY, -1};
+    }
+    return {best.info, best.hops};
+}
+
+std::vector<ch::path_distance> ch::contraction_hierarchy::query_batch(const std::vector<std::pair<int,int>> &pairs) const {
+    std::vector<ch::path_distance> distances(pairs.size());
+    #pragma omp parallel for schedule(dynamic, 64)
+    for (size_t i = 0; i < pairs.size(); i++){
+        distances[i] = this->query(pairs[i].first, pairs[i].second);
+    }
+    return distances;
+}
+
+bool ch::contraction_hierarchy::save(std::string filepath) const {
+    std::error_code ec;
+    std::filesystem::path tmp_path = filepath;
+    tmp_path += ".tmp" + std::to_string(getpid());
+    std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()){
+        return false;
+    }
+    file.write(INDEX_MAGIC, 8);
+    write_value<int32_t>(file, this->Vertices);
+    write_value<uint8_t>(file, this->Directional);
+    write_value<uint64_t>(file, this->GraphFingerprint);
+    write_upward_graph(file, this->Up);
+    write_upward_graph(file, this->Down);
+    file.close();
+    if (!file){
+        std::filesystem::remove(tmp_path, ec);
+        return false;
+    }
+    std::filesystem::rename(tmp_path, filepath, ec);
+    return !ec;
+}
+
+bool ch::contraction_hierarchy::load(std::string filepath){
+    *this = ch::contraction_hierarchy();
+    std::ifstream file(filepath, std::ios::binary);
+    if (!file.is_open()){
+        return false;
+    }
+    char magic[8];
+    file.read(magic, 8);
+    int vertices = read_value<int32_t>(file);
+    bool directional = read_value<uint8_t>(file);
+    uint64_t graph_fingerprint = read_value<uint64_t>(file);
+    if (!file || std::memcmp(magic, INDEX_MAGIC, 8) != 0 || vertices < 0){
+        return false;
+    }
+    // Bounds the array lengths read by the size of the file, so a corrupt length is rejected instead of allocated
+    std::error_code ec;
+    uint64_t max_edges = std::filesystem::file_size(filepath, ec);
+    if (ec || !read_upward_graph(file, this->Up, vertices, max_edges) || !read_upward_graph(file, this->Down, vertices, max_edges)){
+        *this = ch::contraction_hierarchy();
+        return false;
+    }
+    this->Vertices = vertices;
+    this->Directional = directional;
+    this->GraphFingerprint = graph_fingerprint;
+    return true;
+}
+
+uint64_t ch::contraction_hierarchy::memory_bytes() const {
+    uint64_t bytes = 0;
+    for (const ch::upward_graph *graph : {&this->Up, &this->Down}){
+        bytes += graph->Offsets.capacity() * sizeof(int64_t) + graph->Targets.capacity() * sizeof(int) + graph->Info.capacity() * sizeof(double) + graph->Hops.capacity() * sizeof(int);
+    }
+    return bytes;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <utility>
+
+#include "compact_graph.h"
+
+/**
+ * Contraction hierarchy index for repeated point to point distance queries on the same network (eg. a g tilda or road network).
+ * Preprocessing contracts the vertices one at a time in order of edge difference, adding a shortcut u -> w for the path u -> v -> w whenever a
+ * bounded witness search finds no path from u to w avoiding v that is as short. The edges of each vertex to higher ranked vertices form the upward
+ * graphs, and a query is a bidirectional Dijkstra search that only climbs them (skipping the vertices reached more shortly from above), usually
+ * settling a few hundred vertices on road-like networks.
+ * Distances compare (information, network) exactly, where the label correcting searches treat information distances within
+ * MINIMAL_PERCENT_ROUNDING_ERR as equal, so the network distance of a query can differ from theirs between nearly equally long paths.
+ * Needs non-negative edge weights.
+*/
+namespace ch {
+    // Number of vertices a witness search settles before giving up (a missed witness only adds a redundant shortcut)
+    const int WITNESS_SETTLE_LIMIT = 500;
+    // Smaller limit of the witness searches estimating the shortcuts of a vertex to order the contraction
+    const int ESTIMATE_SETTLE_LIMIT = 50;
+
+    // Distance of the chosen path between two vertices, the shortest information distance and the fewest edges among the paths as short
+    struct path_distance {
+        // Information distance (INFINITY when dest cannot be reached)
+        double info_distance;
+        // Network distance (-1 when dest cannot be reached)
+        int net_distance;
+    };
+
+    // Edges of each vertex to higher ranked vertices, the edges of vertex v are the entries Offsets[v] to Offsets[v+1] (exclusive) of the other arrays
+    class upward_graph {
+        public:
+            std::vector<int64_t> Offsets;
+            // Other end of each edge
+            std::vector<int> Targets;
+            // Information distance of each edge (shortcuts hold the distance of the path they replace)
+            std::vector<double> Info;
+            // Network distance of each edge (1 for edges of the network)
+            std::vector<int> Hops;
+    };
+
+    /**
+     * Returns the fingerprint of a graph, a hash of its edges, stored with a hierarchy so it is only reused for the network it was built from
+     * @param graph The graph
+     * @return The fingerprint
+    */
+    uint64_t fingerprint(const compact_graph &graph);
+
+    class contraction_hierarchy {
+        public:
+            // Number of vertices of the graph
+            int Vertices = 0;
+            // Whether if the graph is directional
+            bool Directional = false;
+            // Fingerprint of the graph the hierarchy was built from
+            uint64_t GraphFingerprint = 0;
+            // Edges leaving each vertex towards higher ranked vertices, climbed by the search from the source
+            upward_graph Up;
+            // Edges entering each vertex from higher ranked vertices (stored at the entered vertex), climbed by the search from the destination
+            upward_graph Down;
+
+            // Construct an empty hierarchy (to load)
+            contraction_hierarchy();
+
+            /**
+             * Builds the hierarchy of a graph whose edges all have non-negative weights
+             * @param graph The graph
+            */
+            contraction_hierarchy(const compact_graph &graph);
+
+            /**
+             * Returns the distance between two vertices
+             * @param src The vertex that the distance is measured from
+             * @param dest The vertex that the distance is measured to
+             * @return The distance, unreachable when dest cannot be reached from src
+            */
+            path_distance query(int src, int dest) const;
+
+            /**
+             * Returns the distances between many pairs of vertices, the queries answered in parallel
+             * @param pairs The (src, dest) pairs
+             * @return The distance of each pair, in the order of pairs
+            */
+            std::vector<path_distance> query_batch(const std::vector<std::pair<int,int>> &pairs) const;
+
+            /**
+             * Saves the hierarchy to a binary file (written to a temporary file first so an interrupted save leaves no partial file)
+             * @param filepath The filepath of the file
+             * @return Whether if the file was written
+            */
+            bool save(std::string filepath) const;
+
+            /**
+             * Loads a hierarchy saved with save
+             * @param filepath The filepath of the file
+             * @return Whether if the file held a complete hierarchy (the hierarchy is left empty otherwise)
+            */
+            bool load(std::string filepath);
+
+            // Returns the number of bytes held by the upward graphs
+            uint64_t memory_bytes() const;
+    };
+};
@@ -0,0 +1,135 @@
+#include <map>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <omp.h>
+#include <unistd.h>
+
+#include "checkpoint.h"
+
+namespace {
+    // First line of a checkpoint file, followed by the KEY, NEXT and VALUE lines
+    const std::string CHECKPOINT_HEADER = "NLCHECKPOINT 1";
+}
+
+checkpoint::source_progress::source_progress(){
+    this->last_save = std::chrono::steady_clock::now();
+}
+
+checkpoint::source_progress::source_progress(std::string filepath, std::string key, bool resume, double interval_seconds){
+    this->filepath = filepath;
+    this->key = key;
+    this->interval_seconds = interval_seconds;
+    this->last_save = std::chrono::steady_clock::now();
+
+    std::ifstream file(filepath);
+    if (!resume || !file.is_open()){
+        if (resume){
+            std::cout << "No checkpoint at " << filepath << ", starting from the first source.\n";
+        }
+        return;
+    }
+
+    std::string line;
+    if (!std::getline(file, line) || line != CHECKPOINT_HEADER){
+        std::cerr << "ERROR: " << filepath << " is not a checkpoint file.\n";
+        exit(1);
+    }
+    while (std::getline(file, line)){
+        if (line.compare(0, 4, "KEY ") == 0){
+            if (line.substr(4) != key){
+                std::cerr << "ERROR: The checkpoint " << filepath << " was saved by another computation (" << line.substr(4) << ").\n";
+                exit(1);
+            }
+        } else if (line.compare(0, 5, "NEXT ") == 0){
+            this->next_source = std::stoi(line.substr(5));
+        } else if (line.compare(0, 6, "VALUE ") == 0){
+            this->values.push_back(line.substr(6));
+        }
+    }
+    std::cout << "Resuming from source " << this->next_source << " of checkpoint " << filepath << ".\n";
+}
+
+bool checkpoint::source_progress::enabled() const {
+    return !this->filepath.empty();
+}
+
+int checkpoint::source_progress::block_sources() const {
+    return checkpoint::BLOCK_SOURCES_PER_THREAD * omp_get_max_threads();
+}
+
+void checkpoint::source_progress::save(int next_source, const std::vector<std::string> &values, bool force){
+    this->next_source = next_source;
+    this->values = values;
+    if (!this->enabled() || (!force && std::chrono::duration<double>(std::chrono::steady_clock::now() - this->last_save).count() < this->interval_seconds)){
+        return;
+    }
+
+    // Written beside the checkpoint and renamed over it, so a stop while saving leaves the previous state intact
+    std::string temp_filepath = this->filepath + ".tmp";
+    FILE *file = fopen(temp_filepath.c_str(), "w");
+    if (file == NULL){
+        std::cerr << "ERROR: Failed to open checkpoint file " << temp_filepath << " for writing.\n";
+        exit(1);
+    }
+    fprintf(file, "%s\nKEY %s\nNEXT %d\n", CHECKPOINT_HEADER.c_str(), this->key.c_str(), next_source);
+    for (const std::string &value : values){
+        fprintf(file, "VALUE %s\n", value.c_str());
+    }
+    if (fflush(file) != 0 || fsync(fileno(file)) != 0 || fclose(file) != 0 || std::rename(temp_filepath.c_str(), this->filepath.c_str()) != 0){
+        std::cerr << "ERROR: Failed to write checkpoint file " << this->filepath << "\n";
+        exit(1);
+    }
+    this->last_save = std::chrono::steady_clock::now();
+    #ifdef _DEBUG
+    std::cout << "Checkpoint saved at source " << next_source << "\n";
+    #endif
+}
+
+void checkpoint::source_progress::finish(){
+    if (this->enabled()){
+        std::remove(this->filepath.c_str());
+    }
+}
+
+checkpoint::source_progress checkpoint::from_flags(std::map<std::string, std::string> &flags, std::string key){
+    if (!flags.count("checkpoint")){
+        if (flags.count("resume")){
+            std::cerr << "ERROR: --resume needs the --checkpoint=FILE to resume from.\n";
+            exit(1);
+        }
+        return checkpoint::source_progress();
+    }
+    double interval_seconds = checkpoint::DEFAULT_INTERVAL_SECONDS;
+    if (flags.count("checkpoint-interval")){
+        try {
+            interval_seconds = std::stod(flags["checkpoint-interval"]);
+        } catch (...){
+            interval_seconds = -1;
+        }
+        if ( !(interval_seconds >= 0) ){
+            std::cerr << "ERROR: Invalid --checkpoint-interval value.\n";
+            exit(1);
+        }
+    }
+    return checkpoint::source_progress(flags["checkpoint"], key, flags.count("resume") > 0, interval_seconds);
+}
+
+std::string checkpoint::encode_long_double(long double value){
+    char formatted[64];
+    snprintf(formatted, sizeof(formatted), "%La", value);
+    return formatted;
+}
+
+long double checkpoint::decode_long_double(std::string value){
+    char *end;
+    long double decoded = strtold(value.c_str(), &end);
+    if (value.empty() || *end != '\0'){
+        std::cerr << "ERROR: Invalid checkpoint value " << value << ".\n";
+        exit(1);
+    }
+    return decoded;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include <chrono>
+
+/**
+ * Checkpointing of long computations over every source vertex, so a run stopped partway (a crash or a preempted machine) can resume.
+ * The sources are done in ascending order in blocks. After a block the first source not done yet and the partial reductions of the sources
+ * before it (eg. the running sum) are saved to a small text file, replacing the previous state.
+*/
+namespace checkpoint {
+    // Default number of seconds between two saves
+    const double DEFAULT_INTERVAL_SECONDS = 60;
+
+    // Number of sources of a block for each thread, the state can only be saved between blocks
+    const int BLOCK_SOURCES_PER_THREAD = 64;
+
+    // Progress of a computation over every source, disabled (nothing is saved or resumed) unless constructed with a filepath
+    class source_progress {
+        public:
+            // The first source not done yet
+            int next_source = 0;
+            // The partial reductions of the sources before next_source, their meaning is up to the computation
+            std::vector<std::string> values;
+
+            // Construct disabled progress
+            source_progress();
+
+            /**
+             * Construct the progress of a computation saved to a file, resuming it from the file if asked to
+             * @param filepath The filepath of the checkpoint file
+             * @param key Identifies the computation (action, parameters and input), a file saved by another computation is not resumed
+             * @param resume Whether to resume from the file if it exists, otherwise the computation starts over
+             * @param interval_seconds The smallest number of seconds between two saves
+            */
+            source_progress(std::string filepath, std::string key, bool resume, double interval_seconds = DEFAULT_INTERVAL_SECONDS);
+
+            // Returns whether the progress is saved to a file
+            bool enabled() const;
+
+            // Returns the number of sources of a block
+            int block_sources() const;
+
+            /**
+             * Records the progress after a block, saving it if the interval passed since the last save. Exits if the file cannot be written.
+             * @param next_source The first source not done yet
+             * @param values The partial reductions of the sources before next_source
+             * @param force Whether to save even if the interval has not passed
+            */
+            void save(int next_source, const std::vector<std::string> &values, bool force = false);
+
+            // Removes the checkpoint file once the computation is done
+            void finish();
+
+        private:
+            std::string filepath;
+            std::string key;
+            double interval_seconds = DEFAULT_INTERVAL_SECONDS;
+            std::chrono::steady_clock::time_point last_save;
+    };
+
+    /**
+     * Constructs the progress of a computation from the --checkpoint=FILE, --resume and --checkpoint-interval=SECONDS flags (disabled without --checkpoint)
+     * @param flags The flags given on the command line
+     * @param key Identifies the computation (action, parameters and input)
+     * @return The progress
+    */
+    source_progress from_flags(std::map<std::string, std::string> &flags, std::string key);
+
+    /**
+     * Formats a long double so it is parsed back to the exact same value (hexadecimal floating point)
+     * @param value The value
+     * @return The formatted value
+    */
+    std::string encode_long_double(long double value);
+
+    /**
+     * Parses a value formatted by encode_long_double. Exits if the value is invalid.
+     * @param value The formatted value
+     * @return The value
+    */
+    long double decode_long_double(std::string value);
+};
@@ -0,0 +1,71 @@
+#include <vector>
+#include <algorithm>
+#include <omp.h>
+
+#include "edgelist.h"
+
+#include "compact_graph.h"
+
+compact_graph::compact_graph(){
+    this->Vertices = 0;
+    this->Directional = false;
+    this->Offsets.assign(1, 0);
+}
+
+compact_graph::compact_graph(edgelist &edgelist, int min_vertices){
+    this->Vertices = std::max(edgelist.max_vertex() + 1, min_vertices);
+    this->Directional = edgelist.is_directional();
+
+    // Count the edges leaving each vertex, then lay the rows out back to back
+    this->Offsets.assign(this->Vertices + 1, 0);
+    #pragma omp parallel for schedule(dynamic, 256)
+    for (int v = 0; v < this->Vertices; v++){
+        this->Offsets[v+1] = edgelist.get_edges(v).size();
+    }
+    for (int v = 0; v < this->Vertices; v++){
+        this->Offsets[v+1] += this->Offsets[v];
+    }
+
+    // Resizing leaves the edge arrays untouched, so their pages are first touched (and placed) by the threads filling the rows
+    this->Targets.resize(this->Offsets.back());
+    this->Weights.resize(this->Offsets.back());
+    #pragma omp parallel for schedule(dynamic, 256)
+    for (int v = 0; v < this->Vertices; v++){
+        int64_t position = this->Offsets[v];
+        for (struct edge edge : edgelist.get_edges(v)){
+            this->Targets[position] = edge.dest;
+            this->Weights[position] = edge.weight;
+            position++;
+        }
+    }
+}
+
+compact_graph compact_graph::reversed() const {
+    compact_graph reverse_graph;
+    reverse_graph.Vertices = this->Vertices;
+    reverse_graph.Directional = this->Directional;
+
+    // Count the edges entering each vertex, then place every edge in its destination's row (sources in ascending order)
+    reverse_graph.Offsets.assign(this->Vertices + 1, 0);
+    for (int64_t i = 0; i < this->edge_count(); i++){
+        reverse_graph.Offsets[this->Targets[i] + 1]++;
+    }
+    for (int v = 0; v < this->Vertices; v++){
+        reverse_graph.Offsets[v+1] += reverse_graph.Offsets[v];
+    }
+    reverse_graph.Targets.resize(this->edge_count());
+    reverse_graph.Weights.resize(this->edge_count());
+    std::vector<int64_t> position(reverse_graph.Offsets.begin(), reverse_graph.Offsets.end() - 1);
+    for (int v = 0; v < this->Vertices; v++){
+        for (int64_t i = this->Offsets[v]; i < this->Offsets[v+1]; i++){
+            int64_t reverse_position = position[this->Targets[i]]++;
+            reverse_graph.Targets[reverse_position] = v;
+            reverse_graph.Weights[reverse_position] = this->Weights[i];
+        }
+    }
+    return reverse_graph;
+}
+
+uint64_t compact_graph::memory_bytes() const {
+    return this->Offsets.capacity() * sizeof(int64_t) + this->Targets.capacity() * sizeof(int) + this->Weights.capacity() * sizeof(double);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "edgelist.h"
+#include "placement.h"
+
+/**
+ * Read-only compressed sparse row (CSR) copy of an edgelist for traversals that expand every vertex many times.
+ * The edges leaving a vertex are stored contiguously in the same order edgelist::get_edges returns them,
+ * so traversals over the compact graph visit edges in the same order as traversals over the edgelist.
+*/
+class compact_graph {
+    public:
+        // Number of vertex slots (largest vertex ID + 1)
+        int Vertices;
+        // Whether if the network represented by the graph is directional
+        bool Directional;
+        // The edges leaving vertex v are the entries Offsets[v] to Offsets[v+1] (exclusive) of Targets and Weights.
+        // The arrays come from placement::array_allocator so they can be backed by huge pages.
+        placement::array<int64_t> Offsets;
+        // Destination vertex ID of each edge
+        placement::array<int> Targets;
+        // Weight of each edge
+        placement::array<double> Weights;
+
+        // Construct an empty compact graph
+        compact_graph();
+
+        /**
+         * Construct the compact copy of an edgelist
+         * @param edgelist The edgelist to copy
+         * @param min_vertices The minimum number of vertex slots, so vertices without edges past the largest vertex ID stay addressable
+        */
+        compact_graph(edgelist &edgelist, int min_vertices = 0);
+
+        // Returns the number of edges leaving the given vertex
+        int64_t degree(int src) const {
+            return this->Offsets[src+1] - this->Offsets[src];
+        }
+
+        // Returns the total number of stored edges (undirected edges are stored once per direction)
+        int64_t edge_count() const {
+            return this->Offsets.back();
+        }
+
+        // Returns the graph with every edge reversed, the edges entering each vertex in order of their source
+        compact_graph reversed() const;
+
+        // Returns the number of bytes held by the arrays of the graph
+        uint64_t memory_bytes() const;
+};
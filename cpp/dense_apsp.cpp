@@ -0,0 +1,112 @@
+#include <cmath>
+#include <cstdint>
+#include <omp.h>
+
+#include "network_metrics.h"
+
+#include "dense_apsp.h"
+
+namespace {
+    // Relaxes tile C through tile A (same rows as C) and tile B (same columns as C), each given by the entry at its top left corner
+    void relax_tile(double *c_info, double *c_hops, const double *a_info, const double *a_hops, const double *b_info, const double *b_hops, int stride){
+        const double ROUNDING_ERR = MINIMAL_PERCENT_ROUNDING_ERR;
+        for (int k = 0; k < dense::BLOCK; k++){
+            const double *k_info = b_info + (int64_t) k * stride;
+            const double *k_hops = b_hops + (int64_t) k * stride;
+            for (int i = 0; i < dense::BLOCK; i++){
+                const double through_info = a_info[(int64_t) i * stride + k];
+                if (through_info == INFINITY){
+                    continue;
+                }
+                const double through_hops = a_hops[(int64_t) i * stride + k];
+                double *row_info = c_info + (int64_t) i * stride;
+                double *row_hops = c_hops + (int64_t) i * stride;
+                // Same test as the searches: a shorter information distance, or an equal one (within the rounding error) with fewer edges
+                #pragma omp simd
+                for (int j = 0; j < dense::BLOCK; j++){
+                    double possible_info = through_info + k_info[j];
+                    double possible_hops = through_hops + k_hops[j];
+                    double current_info = row_info[j];
+                    double current_hops = row_hops[j];
+                    double tolerance = possible_info * ROUNDING_ERR;
+                    // Written as selects only, so the loop compiles to vector blends
+                    double tied_hops = std::fabs(current_info - possible_info) < tolerance ? (current_hops > possible_hops ? possible_hops : current_hops) : current_hops;
+                    row_hops[j] = current_info - possible_info > tolerance ? possible_hops : tied_hops;
+                    row_info[j] = current_info - possible_info > tolerance ? possible_info : current_info;
+                }
+            }
+        }
+    }
+}
+
+uint64_t dense::matrix_bytes(int vertices){
+    uint64_t stride = (uint64_t) (vertices + dense::BLOCK - 1) / dense::BLOCK * dense::BLOCK;
+    return stride * stride * 2 * sizeof(double);
+}
+
+dense::distance_matrix::distance_matrix(const compact_graph &graph){
+    this->Vertices = graph.Vertices;
+    this->Stride = (graph.Vertices + dense::BLOCK - 1) / dense::BLOCK * dense::BLOCK;
+    const int STRIDE = this->Stride;
+    const int TILES = STRIDE / dense::BLOCK;
+    this->Info.resize((int64_t) STRIDE * STRIDE);
+    this->Hops.resize((int64_t) STRIDE * STRIDE);
+    double *info = this->Info.data();
+    double *hops = this->Hops.data();
+
+    // Each row starts with the edges leaving its vertex (the shortest of parallel edges)
+    #pragma omp parallel for schedule(dynamic, 64)
+    for (int src = 0; src < STRIDE; src++){
+        double *row_info = info + (int64_t) src * STRIDE;
+        double *row_hops = hops + (int64_t) src * STRIDE;
+        for (int dest = 0; dest < STRIDE; dest++){
+            row_info[dest] = INFINITY;
+            row_hops[dest] = INFINITY;
+        }
+        row_info[src] = 0;
+        row_hops[src] = 0;
+        if (src >= graph.Vertices){
+            continue;
+        }
+        for (int64_t i = graph.Offsets[src]; i < graph.Offsets[src+1]; i++){
+            int dest = graph.Targets[i];
+            if (dest != src && graph.Weights[i] < row_info[dest]){
+                row_info[dest] = graph.Weights[i];
+                row_hops[dest] = 1;
+            }
+        }
+    }
+
+    // Entry at the top left corner of tile (row, col) of either matrix
+    auto tile = [STRIDE](auto *matrix, int row, int col){
+        return matrix + (int64_t) row * dense::BLOCK * STRIDE + (int64_t) col * dense::BLOCK;
+    };
+
+    for (int kb = 0; kb < TILES; kb++){
+        relax_tile(tile(info, kb, kb), tile(hops, kb, kb), tile(info, kb, kb), tile(hops, kb, kb), tile(info, kb, kb), tile(hops, kb, kb), STRIDE);
+
+        // The tiles of the row and column of the diagonal tile only go through the diagonal tile
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (int other = 0; other < 2 * TILES; other++){
+            int tb = other % TILES;
+            if (tb == kb){
+                continue;
+            }
+            if (other < TILES){
+                relax_tile(tile(info, kb, tb), tile(hops, kb, tb), tile(info, kb, kb), tile(hops, kb, kb), tile(info, kb, tb), tile(hops, kb, tb), STRIDE);
+            } else {
+                relax_tile(tile(info, tb, kb), tile(hops, tb, kb), tile(info, tb, kb), tile(hops, tb, kb), tile(info, kb, kb), tile(hops, kb, kb), STRIDE);
+            }
+        }
+
+        #pragma omp parallel for collapse(2) schedule(dynamic, 1)
+        for (int ib = 0; ib < TILES; ib++){
+            for (int jb = 0; jb < TILES; jb++){
+                if (ib == kb || jb == kb){
+                    continue;
+                }
+                relax_tile(tile(info, ib, jb), tile(hops, ib, jb), tile(info, ib, kb), tile(hops, ib, kb), tile(info, kb, jb), tile(hops, kb, jb), STRIDE);
+            }
+        }
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+
+#include "compact_graph.h"
+#include "placement.h"
+
+/**
+ * Dense all pairs distances of small networks with a cache blocked Floyd-Warshall over min-plus matrices.
+ * Every pair holds its information distance and, in a second matrix, its network distance, both updated under the (information, network)
+ * tie-break of the searches. The matrices are split in BLOCK x BLOCK tiles. For each diagonal tile the tile itself is relaxed, then the tiles
+ * of its row and column, then every other tile, the tiles of each step in parallel and the loops over a tile row vectorized with omp simd.
+*/
+namespace dense {
+    // Width of the square tiles, three tiles of both matrices fit in the L2 cache
+    const int BLOCK = 64;
+
+    /**
+     * Returns the bytes of the matrices of a graph
+     * @param vertices The number of vertices of the graph
+     * @return The bytes of both matrices
+    */
+    uint64_t matrix_bytes(int vertices);
+
+    // Distances between every pair of vertices of a graph, the pair (src, dest) is entry src * Stride + dest of each matrix
+    class distance_matrix {
+        public:
+            // Number of vertices of the graph
+            int Vertices;
+            // Length of a row, Vertices rounded up to whole tiles
+            int Stride;
+            // Information distance of each pair (INFINITY when dest cannot be reached)
+            placement::array<double> Info;
+            // Network distance of each pair, as doubles (exact for any count of edges) so the loops over both matrices vectorize alike
+            placement::array<double> Hops;
+
+            /**
+             * Computes the distances between every pair of vertices of a graph whose edges all have positive weights
+             * @param graph The graph
+            */
+            distance_matrix(const compact_graph &graph);
+    };
+};
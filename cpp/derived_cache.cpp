@@ -0,0 +1,301 @@
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <unistd.h>
+
+#include "funcs.h"
+#include "utils.h"
+
+#include "derived_cache.h"
+
+namespace {
+    // Identifies a cache entry file. Entries are written in host byte order since the cache is local to the machine.
+    const char CACHE_MAGIC[8] = {'N', 'L', 'E', 'D', 'G', 'C', '1', '\0'};
+    const std::string CACHE_EXTENSION = ".gcache";
+
+    const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+    const uint64_t FNV_PRIME = 1099511628211ULL;
+
+    // FNV-1a hash of a block of bytes, continuing from the given hash
+    uint64_t fnv1a(const char *data, size_t length, uint64_t hash = FNV_OFFSET_BASIS){
+        for (size_t i = 0; i < length; i++){
+            hash ^= (unsigned char) data[i];
+            hash *= FNV_PRIME;
+        }
+        return hash;
+    }
+
+    // Formats the bit pattern of a value as hex so the key changes with any change to the value
+    template <typename T>
+    std::string hex_bits(T value){
+        unsigned char bytes[sizeof(T)];
+        std::memcpy(bytes, &value, sizeof(T));
+        std::string hex;
+        char digits[3];
+        for (unsigned char byte : bytes){
+            snprintf(digits, sizeof(digits), "%02x", byte);
+            hex += digits;
+        }
+        return hex;
+    }
+
+    // Returns the cache directory, or an empty path if caching is disabled
+    std::filesystem::path cache_dir(){
+        const char *dir = std::getenv("DERIVED_CACHE_DIR");
+        if (dir == nullptr){
+            return derived_cache::DEFAULT_CACHE_DIR;
+        }
+        return std::filesystem::path(dir);
+    }
+
+    uint64_t max_cache_bytes(){
+        const char *max_bytes = std::getenv("DERIVED_CACHE_MAX_BYTES");
+        if (max_bytes == nullptr){
+            return derived_cache::DEFAULT_MAX_CACHE_BYTES;
+        }
+        return std::strtoull(max_bytes, nullptr, 10);
+    }
+
+    std::filesystem::path entry_path(std::string &key){
+        return cache_dir() / (hex_bits(fnv1a(key.data(), key.size())) + CACHE_EXTENSION);
+    }
+
+    template <typename T>
+    void write_value(std::ofstream &file, T value){
+        file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    void write_array(std::ofstream &file, const std::vector<T> &values){
+        write_value<uint64_t>(file, values.size());
+        file.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+    }
+
+    template <typename T>
+    T read_value(std::ifstream &file){
+        T value{};
+        file.read(reinterpret_cast<char*>(&value), sizeof(T));
+        return value;
+    }
+
+    template <typename T>
+    std::vector<T> read_array(std::ifstream &file){
+        uint64_t count = read_value<uint64_t>(file);
+        std::vector<T> values;
+        if (!file){
+            return values;
+        }
+        values.resize(count);
+        file.read(reinterpret_cast<char*>(values.data()), count * sizeof(T));
+        return values;
+    }
+
+    // Writes an edgelist as its directionality followed by the SRC, DEST and WEIGHT columns of its edges
+    void write_edgelist(std::ofstream &file, edgelist &edgelist, bool directional){
+        std::vector<edge> edges = edgelist.get_edges();
+        std::vector<int32_t> srcs(edges.size());
+        std::vector<int32_t> dests(edges.size());
+        std::vector<double> weights(edges.size());
+        for (size_t i = 0; i < edges.size(); i++){
+            srcs[i] = edges[i].src;
+            dests[i] = edges[i].dest;
+            weights[i] = edges[i].weight;
+        }
+        write_value<uint8_t>(file, directional);
+        write_array(file, srcs);
+        write_array(file, dests);
+        write_array(file, weights);
+    }
+
+    bool read_edgelist(std::ifstream &file, edgelist &edgelist){
+        bool directional = read_value<uint8_t>(file);
+        std::vector<int32_t> srcs = read_array<int32_t>(file);
+        std::vector<int32_t> dests = read_array<int32_t>(file);
+        std::vector<double> weights = read_array<double>(file);
+        if (!file || srcs.size() != dests.size() || srcs.size() != weights.size()){
+            return false;
+        }
+        edgelist.set_directional(directional);
+        for (size_t i = 0; i < srcs.size(); i++){
+            edgelist.insert_edge(srcs[i], dests[i], weights[i]);
+        }
+        return true;
+    }
+
+    // Loads a cache entry, returns false if there is no valid entry for the key
+    bool load_entry(std::string &key, edgelist &neg_laplacian_edgelist, edgelist &g_tilda_edgelist, metrics::laplacian_stats &stats){
+        std::filesystem::path path = entry_path(key);
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()){
+            return false;
+        }
+        char magic[8];
+        file.read(magic, 8);
+        std::string stored_key(read_value<uint32_t>(file), '\0');
+        file.read(stored_key.data(), stored_key.size());
+        if (!file || std::memcmp(magic, CACHE_MAGIC, 8) != 0 || stored_key != key){ // Also guards against hash collisions of the file name
+            return false;
+        }
+
+        stats.dim = read_value<int32_t>(file);
+        stats.kappa = read_value<double>(file);
+        stats.mu = read_array<double>(file);
+        if (!read_edgelist(file, neg_laplacian_edgelist) || !read_edgelist(file, g_tilda_edgelist)){
+            std::cerr << "WARNING: Ignoring corrupt derived graph cache entry " << path << "\n";
+            neg_laplacian_edgelist = edgelist();
+            g_tilda_edgelist = edgelist();
+            return false;
+        }
+
+        // Mark the entry as recently used for the eviction policy
+        std::error_code ec;
+        std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+        return true;
+    }
+
+    // Stores a cache entry, written to a temporary file first so concurrent readers never see a partial entry
+    void store_entry(std::string &key, edgelist &neg_laplacian_edgelist, edgelist &g_tilda_edgelist, metrics::laplacian_stats &stats){
+        std::error_code ec;
+        std::filesystem::create_directories(cache_dir(), ec);
+        std::filesystem::path path = entry_path(key);
+        std::filesystem::path tmp_path = path;
+        tmp_path += ".tmp" + std::to_string(getpid());
+
+        std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()){
+            std::cerr << "WARNING: Unable to write derived graph cache entry " << path << "\n";
+            return;
+        }
+        file.write(CACHE_MAGIC, 8);
+        write_value<uint32_t>(file, key.size());
+        file.write(key.data(), key.size());
+        write_value<int32_t>(file, stats.dim);
+        write_value<double>(file, stats.kappa);
+        write_array(file, stats.mu);
+        write_edgelist(file, neg_laplacian_edgelist, true);
+        write_edgelist(file, g_tilda_edgelist, false);
+        file.close();
+        if (!file){
+            std::cerr << "WARNING: Unable to write derived graph cache entry " << path << "\n";
+            std::filesystem::remove(tmp_path, ec);
+            return;
+        }
+        std::filesystem::rename(tmp_path, path, ec);
+    }
+
+    void derive(edgelist &a_edgelist, edgelist &neg_laplacian_edgelist, edgelist &g_tilda_edgelist, metrics::laplacian_stats &stats){
+        neg_laplacian_edgelist = a_edgelist.take_neg_laplacian();
+        g_tilda_edgelist = neg_laplacian_edgelist.neg_laplacian_to_g();
+        stats = metrics::compute_laplacian_stats(neg_laplacian_edgelist);
+    }
+}
+
+std::string derived_cache::cache_key(std::string filepath, bool weighted, bool directed){
+    std::ifstream file(filepath, std::ios::binary);
+    if (!file.is_open()){
+        std::cerr << "FAILED TO OPEN FILE!\n";
+        exit(1);
+    }
+    uint64_t content_hash = FNV_OFFSET_BASIS;
+    std::vector<char> block(1 << 20);
+    while (file){
+        file.read(block.data(), block.size());
+        content_hash = fnv1a(block.data(), file.gcount(), content_hash);
+    }
+
+    // Appended piece by piece, chaining operator+ onto a temporary makes GCC warn (-Wrestrict) about an overlap that cannot happen
+    std::string key;
+    key.reserve(256);
+    key.append("v").append(std::to_string(derived_cache::CODE_VERSION));
+    key.append(";file=").append(hex_bits(content_hash));
+    key.append(";weighted=").append(std::to_string(weighted));
+    key.append(";directed=").append(std::to_string(directed));
+    key.append(";alpha=").append(hex_bits(funcs::ALPHA));
+    key.append(";beta=").append(hex_bits(funcs::BETA));
+    key.append(";q=").append(hex_bits(funcs::Q));
+    key.append(";epsilon=").append(hex_bits(funcs::EPSILON));
+    key.append(";step=").append(hex_bits(funcs::STEP_SIZE));
+    return key;
+}
+
+void derived_cache::load_or_derive(std::string filepath, bool weighted, bool directed, edgelist &neg_laplacian_edgelist, edgelist &g_tilda_edgelist, metrics::laplacian_stats &stats){
+    if (cache_dir().empty()){
+        edgelist a_edgelist = edgelist_from_file(weighted, filepath);
+        a_edgelist.set_directional(directed);
+        derive(a_edgelist, neg_laplacian_edgelist, g_tilda_edgelist, stats);
+        return;
+    }
+    std::string key = derived_cache::cache_key(filepath, weighted, directed);
+    if (load_entry(key, neg_laplacian_edgelist, g_tilda_edgelist, stats)){
+        #ifdef _DEBUG
+        std::cout << "Loaded derived graphs from cache.\n";
+        #endif
+        return;
+    }
+    edgelist a_edgelist = edgelist_from_file(weighted, filepath);
+    a_edgelist.set_directional(directed);
+    derive(a_edgelist, neg_laplacian_edgelist, g_tilda_edgelist, stats);
+    store_entry(key, neg_laplacian_edgelist, g_tilda_edgelist, stats);
+    derived_cache::evict(max_cache_bytes());
+}
+
+void derived_cache::load_or_derive(std::string filepath, bool weighted, bool directed, edgelist &a_edgelist, edgelist &neg_laplacian_edgelist, edgelist &g_tilda_edgelist, metrics::laplacian_stats &stats){
+    if (cache_dir().empty()){
+        derive(a_edgelist, neg_laplacian_edgelist, g_tilda_edgelist, stats);
+        return;
+    }
+    std::string key = derived_cache::cache_key(filepath, weighted, directed);
+    if (load_entry(key, neg_laplacian_edgelist, g_tilda_edgelist, stats)){
+        #ifdef _DEBUG
+        std::cout << "Loaded derived graphs from cache.\n";
+        #endif
+        return;
+    }
+    derive(a_edgelist, neg_laplacian_edgelist, g_tilda_edgelist, stats);
+    store_entry(key, neg_laplacian_edgelist, g_tilda_edgelist, stats);
+    derived_cache::evict(max_cache_bytes());
+}
+
+void derived_cache::evict(uint64_t max_bytes){
+    std::error_code ec;
+    std::filesystem::path dir = cache_dir();
+    if (dir.empty() || !std::filesystem::is_directory(dir, ec)){
+        return;
+    }
+
+    // Collect the entries with their sizes and last use times
+    struct cache_entry {
+        std::filesystem::path path;
+        uint64_t size;
+        std::filesystem::file_time_type last_used;
+    };
+    std::vector<cache_entry> entries;
+    uint64_t total_bytes = 0;
+    for (auto &dir_entry : std::filesystem::directory_iterator(dir, ec)){
+        if (!dir_entry.is_regular_file(ec) || dir_entry.path().extension() != CACHE_EXTENSION){
+            continue;
+        }
+        cache_entry entry = {dir_entry.path(), dir_entry.file_size(ec), dir_entry.last_write_time(ec)};
+        total_bytes += entry.size;
+        entries.push_back(entry);
+    }
+
+    // Delete the least recently used entries first
+    std::sort(entries.begin(), entries.end(), [](const cache_entry &a, const cache_entry &b){
+        return a.last_used < b.last_used;
+    });
+    for (cache_entry &entry : entries){
+        if (total_bytes <= max_bytes){
+            break;
+        }
+        if (std::filesystem::remove(entry.path, ec)){
+            total_bytes -= entry.size;
+        }
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+#include "edgelist.h"
+#include "network_metrics.h"
+
+namespace derived_cache {
+    // Version of the code deriving the cached graphs. Increment whenever take_neg_laplacian, neg_laplacian_to_g or the v/w functions change so stale entries are no longer matched.
+    const uint32_t CODE_VERSION = 1;
+
+    // Directory the cache entries are stored in (overridden by the DERIVED_CACHE_DIR environment variable, caching is disabled if it is set to an empty string)
+    const std::string DEFAULT_CACHE_DIR = ".derived_cache";
+
+    // Total size the cache directory is kept under by evicting the least recently used entries (overridden by DERIVED_CACHE_MAX_BYTES)
+    const uint64_t DEFAULT_MAX_CACHE_BYTES = 4ULL << 30;
+
+    /**
+     * Calculates the key identifying the derived graphs of an input file: a hash of the file contents combined with the load options,
+     * the ALPHA/BETA/Q/EPSILON/STEP_SIZE constants and CODE_VERSION
+     * @param filepath The filepath of the edgelist file
+     * @param weighted If the network represented by the edgelist is weighted
+     * @param directed If the network represented by the edgelist is directed
+     * @return The cache key as a string
+    */
+    std::string cache_key(std::string filepath, bool weighted, bool directed);
+
+    /**
+     * Loads the negative laplacian, g_tilda edgelist and laplacian statistics of an edgelist file from the cache,
+     * deriving (and caching) them from the file if no matching entry exists
+     * @param filepath The filepath of the edgelist file in the "SRC DEST [WEIGHT]" line format
+     * @param weighted If the network represented by the edgelist is weighted
+     * @param directed If the network represented by the edgelist is directed
+     * @param neg_laplacian_edgelist Edgelist (presumed empty) the negative laplacian is loaded into
+     * @param g_tilda_edgelist Edgelist (presumed empty) the g_tilda edgelist is loaded into
+     * @param stats The laplacian statistics of the negative laplacian
+    */
+    void load_or_derive(std::string filepath, bool weighted, bool directed, edgelist &neg_laplacian_edgelist, edgelist &g_tilda_edgelist, metrics::laplacian_stats &stats);
+
+    /**
+     * Same as load_or_derive, but derives from an edgelist the caller already loaded from the file when there is no matching entry
+     * @param filepath The filepath a_edgelist was loaded from
+     * @param weighted If the network represented by the edgelist is weighted
+     * @param directed If the network represented by the edgelist is directed
+     * @param a_edgelist The edgelist loaded from the file
+     * @param neg_laplacian_edgelist Edgelist (presumed empty) the negative laplacian is loaded into
+     * @param g_tilda_edgelist Edgelist (presumed empty) the g_tilda edgelist is loaded into
+     * @param stats The laplacian statistics of the negative laplacian
+    */
+    void load_or_derive(std::string filepath, bool weighted, bool directed, edgelist &a_edgelist, edgelist &neg_laplacian_edgelist, edgelist &g_tilda_edgelist, metrics::laplacian_stats &stats);
+
+    /**
+     * Deletes the least recently used cache entries until the cache directory is no larger than max_bytes
+     * @param max_bytes The size the cache directory is reduced to
+    */
+    void evict(uint64_t max_bytes);
+};
@@ -0,0 +1,263 @@
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include <sqlite3.h>
+#include <omp.h>
+
+#include "network_metrics.h"
+#include "text_output.h"
+#include "reduction.h"
+
+#include "distance_histogram.h"
+
+namespace {
+    // Counts a pair of a source into the histogram of the thread and the running totals of the source
+    void count_pair(histogram::joint_histogram &local, histogram::vertex_summary &vertex, long double info, int net, long double &info_sum, long double &net_sum, uint64_t sources = 1){
+        local.add(info, net, sources);
+        vertex.reached++;
+        info_sum += info;
+        net_sum += net;
+        vertex.max_info_distance = std::max<double>(vertex.max_info_distance, info);
+        vertex.max_net_distance = std::max(vertex.max_net_distance, net);
+    }
+
+    // Sets the means of a source once its pairs are counted
+    void finish_vertex(histogram::vertex_summary &vertex, long double info_sum, long double net_sum){
+        if (vertex.reached > 0){
+            vertex.mean_info_distance = info_sum / vertex.reached;
+            vertex.mean_net_distance = net_sum / vertex.reached;
+        }
+    }
+}
+
+histogram::joint_histogram::joint_histogram() {}
+
+histogram::joint_histogram::joint_histogram(double WIDTH) : Width(WIDTH) {}
+
+void histogram::joint_histogram::add(long double info_distance, int net_distance, uint64_t pairs){
+    if (this->Counts.size() <= (size_t) net_distance){
+        this->Counts.resize(net_distance + 1);
+    }
+    std::vector<uint64_t> &row = this->Counts[net_distance];
+    size_t b = this->bucket(info_distance);
+    if (row.size() <= b){
+        row.resize(b + 1, 0);
+    }
+    row[b] += pairs;
+}
+
+void histogram::joint_histogram::merge(const histogram::joint_histogram &other){
+    if (this->Counts.size() < other.Counts.size()){
+        this->Counts.resize(other.Counts.size());
+    }
+    for (size_t net = 0; net < other.Counts.size(); net++){
+        std::vector<uint64_t> &row = this->Counts[net];
+        if (row.size() < other.Counts[net].size()){
+            row.resize(other.Counts[net].size(), 0);
+        }
+        for (size_t b = 0; b < other.Counts[net].size(); b++){
+            row[b] += other.Counts[net][b];
+        }
+    }
+}
+
+uint64_t histogram::joint_histogram::total() const {
+    uint64_t total = 0;
+    for (const std::vector<uint64_t> &row : this->Counts){
+        for (uint64_t count : row){
+            total += count;
+        }
+    }
+    return total;
+}
+
+histogram::distance_summary histogram::all_sources(const compact_graph &info_graph, double tau, double WIDTH, const compact_graph *net_graph, double NET_TAU, const twins::twin_classes *classes){
+    histogram::distance_summary summary;
+    summary.Histogram = histogram::joint_histogram(WIDTH);
+    summary.Vertices.resize(info_graph.Vertices);
+
+    #pragma omp parallel
+    {
+        // Counted by the thread and merged once its sources are done, each source writes only its own summary
+        histogram::joint_histogram local(WIDTH);
+        metrics::search_scratch info_scratch;
+        metrics::search_scratch net_scratch;
+        #pragma omp for schedule(dynamic, 64)
+        for (int src = 0; src < info_graph.Vertices; src++){
+            // The pairs of a representative count once for every vertex of its class
+            uint64_t sources = 1;
+            if (classes != nullptr && net_graph == nullptr){
+                if (!classes->is_representative(src)){
+                    continue;
+                }
+                sources = classes->ClassSize[src];
+            }
+            metrics::geodesic_search_tau(info_graph, src, tau, info_scratch);
+            // Network distances of the pairs, from the same search unless taken from the other graph
+            const std::vector<int> *net_distance = &info_scratch.net_distance;
+            if (net_graph != nullptr){
+                if (src >= net_graph->Vertices){
+                    continue;
+                }
+                metrics::geodesic_search_tau(*net_graph, src, NET_TAU, net_scratch);
+                net_distance = &net_scratch.net_distance;
+            }
+
+            histogram::vertex_summary &vertex = summary.Vertices[src];
+            long double info_sum = 0;
+            long double net_sum = 0;
+            for (int dest : info_scratch.reached){
+                if (dest == src || (size_t) dest >= net_distance->size() || (*net_distance)[dest] == INT32_MAX){
+                    continue;
+                }
+                count_pair(local, vertex, info_scratch.info_distance[dest], (*net_distance)[dest], info_sum, net_sum, sources);
+            }
+            finish_vertex(vertex, info_sum, net_sum);
+        }
+        #pragma omp critical
+        summary.Histogram.merge(local);
+    }
+    if (classes != nullptr && net_graph == nullptr){
+        for (int v = 0; v < info_graph.Vertices; v++){
+            summary.Vertices[v] = summary.Vertices[classes->Representative[v]];
+        }
+    }
+    return summary;
+}
+
+histogram::distance_summary histogram::all_sources(const reduction::reduced_graph &graph, double tau, double WIDTH){
+    histogram::distance_summary summary;
+    summary.Histogram = histogram::joint_histogram(WIDTH);
+    summary.Vertices.resize(graph.Vertices);
+
+    // The reduction searches in its own parallel region, each thread counts the rows it is handed
+    int threads = omp_get_max_threads();
+    std::vector<histogram::joint_histogram> locals(threads, histogram::joint_histogram(WIDTH));
+    graph.for_each_source(tau, [&summary, &locals](int src, const reduction::distance_row &row){
+        histogram::joint_histogram &local = locals[omp_get_thread_num()];
+        histogram::vertex_summary &vertex = summary.Vertices[src];
+        long double info_sum = 0;
+        long double net_sum = 0;
+        for (size_t i = 0; i < row.Vertices.size(); i++){
+            if (row.Vertices[i] != src){
+                count_pair(local, vertex, row.Info[i], row.Net[i], info_sum, net_sum);
+            }
+        }
+        finish_vertex(vertex, info_sum, net_sum);
+    });
+    for (const histogram::joint_histogram &local : locals){
+        summary.Histogram.merge(local);
+    }
+    return summary;
+}
+
+void histogram::print_distance_summary(const histogram::distance_summary &summary){
+    text_output::buffered_writer output(STDOUT_FILENO);
+    const histogram::joint_histogram &hist = summary.Histogram;
+    std::string lines;
+    for (size_t net = 0; net < hist.Counts.size(); net++){
+        for (size_t b = 0; b < hist.Counts[net].size(); b++){
+            if (hist.Counts[net][b] == 0){
+                continue;
+            }
+            lines += "INFO:(";
+            text_output::append_general(lines, b * hist.Width);
+            lines += ", ";
+            text_output::append_general(lines, (b + 1) * hist.Width);
+            lines += "] | NET:";
+            text_output::append_int(lines, net);
+            lines += " = PAIRS:";
+            text_output::append_int(lines, hist.Counts[net][b]);
+            lines += "\n";
+        }
+    }
+    output.write(lines);
+    text_output::write_formatted_chunks(output, summary.Vertices.size(), [&summary](std::string &out, size_t v){
+        const histogram::vertex_summary &vertex = summary.Vertices[v];
+        text_output::append_int(out, v);
+        out += " = REACHED:";
+        text_output::append_int(out, vertex.reached);
+        out += " | MEAN_INFO:";
+        text_output::append_general(out, vertex.mean_info_distance);
+        out += " | MAX_INFO:";
+        text_output::append_general(out, vertex.max_info_distance);
+        out += " | MEAN_NET:";
+        text_output::append_general(out, vertex.mean_net_distance);
+        out += " | MAX_NET:";
+        text_output::append_int(out, vertex.max_net_distance);
+        out += "\n";
+    });
+}
+
+void histogram::save_distance_summary_to_sqlite(const histogram::distance_summary &summary, std::string filepath, std::string PREFIX){
+    sqlite3 *db;
+    if (sqlite3_open(filepath.c_str(), &db)) {
+        fprintf(stderr, "Can't open database: %s\n", sqlite3_errmsg(db));
+        exit(1);
+    }
+    // A summary replaces the previous one, appended counts would be summed twice
+    std::string sql_create_tables_query = "DROP TABLE IF EXISTS " + PREFIX + "_histogram;" \
+      "DROP TABLE IF EXISTS " + PREFIX + "_vertex_summary;" \
+      "CREATE TABLE " + PREFIX + "_histogram (" \
+      "INFO_DIST_START    REAL    NOT NULL," \
+      "INFO_DIST_END      REAL    NOT NULL," \
+      "NET_DIST           INT     NOT NULL," \
+      "PAIRS              INT     NOT NULL);" \
+      "CREATE TABLE " + PREFIX + "_vertex_summary (" \
+      "VERTEX             INT     NOT NULL," \
+      "REACHED            INT     NOT NULL," \
+      "MEAN_INFO_DIST     REAL    NOT NULL," \
+      "MAX_INFO_DIST      REAL    NOT NULL," \
+      "MEAN_NET_DIST      REAL    NOT NULL," \
+      "MAX_NET_DIST       INT     NOT NULL);";
+    char *zErrMsg = 0;
+    if( sqlite3_exec(db, sql_create_tables_query.c_str(), NULL, 0, &zErrMsg) != SQLITE_OK ){
+        fprintf(stderr, "Table Creation SQL error: %s\n", zErrMsg);
+        sqlite3_free(zErrMsg);
+        exit(1);
+    }
+
+    sqlite3_stmt *histogram_stmt;
+    sqlite3_stmt *vertex_stmt;
+    if (sqlite3_prepare_v2(db, ("INSERT INTO " + PREFIX + "_histogram (INFO_DIST_START,INFO_DIST_END,NET_DIST,PAIRS) VALUES (?,?,?,?)").c_str(), -1, &histogram_stmt, NULL) != SQLITE_OK
+        || sqlite3_prepare_v2(db, ("INSERT INTO " + PREFIX + "_vertex_summary (VERTEX,REACHED,MEAN_INFO_DIST,MAX_INFO_DIST,MEAN_NET_DIST,MAX_NET_DIST) VALUES (?,?,?,?,?,?)").c_str(), -1, &vertex_stmt, NULL) != SQLITE_OK){
+        fprintf(stderr, "Insertion SQL error: %s\n", sqlite3_errmsg(db));
+        exit(1);
+    }
+
+    sqlite3_exec(db, "BEGIN TRANSACTION", NULL, NULL, &zErrMsg);
+    const histogram::joint_histogram &hist = summary.Histogram;
+    for (size_t net = 0; net < hist.Counts.size(); net++){
+        for (size_t b = 0; b < hist.Counts[net].size(); b++){
+            if (hist.Counts[net][b] == 0){
+                continue;
+            }
+            sqlite3_bind_double(histogram_stmt, 1, b * hist.Width);
+            sqlite3_bind_double(histogram_stmt, 2, (b + 1) * hist.Width);
+            sqlite3_bind_int(histogram_stmt, 3, net);
+            sqlite3_bind_int64(histogram_stmt, 4, hist.Counts[net][b]);
+            if (sqlite3_step(histogram_stmt) != SQLITE_DONE){
+                fprintf(stderr, "Insertion SQL error: %s\n", sqlite3_errmsg(db));
+            }
+            sqlite3_reset(histogram_stmt);
+        }
+    }
+    for (size_t v = 0; v < summary.Vertices.size(); v++){
+        const histogram::vertex_summary &vertex = summary.Vertices[v];
+        sqlite3_bind_int(vertex_stmt, 1, v);
+        sqlite3_bind_int64(vertex_stmt, 2, vertex.reached);
+        sqlite3_bind_double(vertex_stmt, 3, vertex.mean_info_distance);
+        sqlite3_bind_double(vertex_stmt, 4, vertex.max_info_distance);
+        sqlite3_bind_double(vertex_stmt, 5, vertex.mean_net_distance);
+        sqlite3_bind_int(vertex_stmt, 6, vertex.max_net_distance);
+        if (sqlite3_step(vertex_stmt) != SQLITE_DONE){
+            fprintf(stderr, "Insertion SQL error: %s\n", sqlite3_errmsg(db));
+        }
+        sqlite3_reset(vertex_stmt);
+    }
+    sqlite3_exec(db, "END TRANSACTION", NULL, NULL, &zErrMsg);
+    sqlite3_finalize(histogram_stmt);
+    sqlite3_finalize(vertex_stmt);
+    sqlite3_close(db);
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+#include "compact_graph.h"
+#include "reduction.h"
+#include "twins.h"
+
+/**
+ * Distance frequencies aggregated while searching from every source, for the figures that only plot how often each pair of
+ * (information distance, network distance) occurs. Each thread counts the pairs of its sources into its own histogram and
+ * summary rows, and the histograms are merged once every source is done, so the output grows with the number of vertices
+ * and distance buckets instead of the number of pairs.
+ * Information distances are bucketed into (b * WIDTH, (b + 1) * WIDTH] (distance 0 is counted in bucket 0), network distances are exact.
+ * A source is not paired with itself.
+*/
+namespace histogram {
+    // Pair counts by network distance and information distance bucket
+    class joint_histogram {
+        public:
+            // Width of the information distance buckets
+            double Width = 1;
+            // Counts[net][bucket] is the number of pairs at network distance net in the information distance bucket, rows grow as distances are added
+            std::vector<std::vector<uint64_t>> Counts;
+
+            // Construct an empty histogram with buckets of width 1
+            joint_histogram();
+
+            /**
+             * Construct an empty histogram
+             * @param WIDTH The width of the information distance buckets
+            */
+            joint_histogram(double WIDTH);
+
+            // Returns the bucket of an information distance
+            int64_t bucket(long double info_distance) const {
+                return std::max<int64_t>(0, (int64_t) std::ceil(info_distance / this->Width) - 1);
+            }
+
+            /**
+             * Counts a pair
+             * @param info_distance The information distance of the pair
+             * @param net_distance The network distance of the pair
+             * @param pairs The number of pairs at these distances
+            */
+            void add(long double info_distance, int net_distance, uint64_t pairs = 1);
+
+            /**
+             * Adds the counts of another histogram with the same width
+             * @param other The other histogram
+            */
+            void merge(const joint_histogram &other);
+
+            // Returns the number of pairs counted
+            uint64_t total() const;
+    };
+
+    // Distances from one source to the vertices paired with it
+    struct vertex_summary {
+        // Number of vertices paired with the source
+        int64_t reached = 0;
+        double mean_info_distance = 0;
+        double max_info_distance = 0;
+        double mean_net_distance = 0;
+        int max_net_distance = 0;
+    };
+
+    // Histogram of every pair and the summary of every source
+    class distance_summary {
+        public:
+            joint_histogram Histogram;
+            // Summary of each source, indexed by vertex ID
+            std::vector<vertex_summary> Vertices;
+    };
+
+    /**
+     * Searches from every source and aggregates the distances of the pairs reached within tau
+     * @param info_graph The graph whose information distances are counted (and network distances, without net_graph)
+     * @param tau The upper bound of information distance of the searches over info_graph
+     * @param WIDTH The width of the information distance buckets
+     * @param net_graph If given, the network distances are taken from searches over this graph instead (eg. the input network of a ~G graph), and only pairs reached in both are counted
+     * @param NET_TAU The upper bound of information distance of the searches over net_graph
+     * @param classes If given (without net_graph), the twin classes of info_graph: one source per class is searched, its pairs are counted once per
+     * vertex of the class and its summary is copied to its twins (a twin pairs with the same distances, the representative taking its own place)
+     * @return The histogram and the summaries
+    */
+    distance_summary all_sources(const compact_graph &info_graph, double tau, double WIDTH, const compact_graph *net_graph = nullptr, double NET_TAU = INFINITY, const twins::twin_classes *classes = nullptr);
+
+    /**
+     * Same as all_sources over the graph the reduction was built from, searching only its kernel
+     * @param graph The reduced graph
+     * @param tau The upper bound of information distance
+     * @param WIDTH The width of the information distance buckets
+     * @return The histogram and the summaries
+    */
+    distance_summary all_sources(const reduction::reduced_graph &graph, double tau, double WIDTH);
+
+    /**
+     * Prints the non-empty buckets of a histogram as "INFO:(start, end] | NET:n = PAIRS:count" lines, followed by one
+     * "v = REACHED:r | MEAN_INFO:x | MAX_INFO:y | MEAN_NET:z | MAX_NET:m" line per source
+     * @param summary The histogram and summaries
+    */
+    void print_distance_summary(const distance_summary &summary);
+
+    /**
+     * Saves a histogram into the table [PREFIX]_histogram (INFO_DIST_START, INFO_DIST_END, NET_DIST, PAIRS) and the summaries into
+     * [PREFIX]_vertex_summary (VERTEX, REACHED, MEAN_INFO_DIST, MAX_INFO_DIST, MEAN_NET_DIST, MAX_NET_DIST) of a SQLite3 db, replacing the tables if they exist
+     * @param summary The histogram and summaries
+     * @param filepath The filepath of the db
+     * @param PREFIX The prefix of the table names
+    */
+    void save_distance_summary_to_sqlite(const distance_summary &summary, std::string filepath, std::string PREFIX);
+};
@@ -10,6 +10,8 @@
 
 #include "utils.h"
 #include "funcs.h"
+#include "text_output.h"
+#include "memory_accounting.h"
 
 #include "edgelist.h"
 
@@ -51,6 +53,76 @@ void edgelist::insert_edge(int src, int dest, double weight){
     this->RevEdges[dest][src].push_back(weight);
 }
 
+namespace {
+    // Inserts edges sorted by (key, sub key) into a two level map. Consecutive edges share the outer node and land at the end of the inner map, so the hints make insertion amortized O(1) when the map is empty.
+    template <typename KeyFunc, typename SubKeyFunc>
+    void insert_sorted_edges(std::map<int, std::map<int, std::vector<double>>> &edge_map, std::vector<edge> &sorted_edges, KeyFunc key, SubKeyFunc sub_key){
+        auto outer = edge_map.end();
+        for (struct edge &edge : sorted_edges){
+            if (outer == edge_map.end() || outer->first != key(edge)){
+                outer = edge_map.try_emplace(edge_map.end(), key(edge));
+            }
+            auto inner = outer->second.try_emplace(outer->second.end(), sub_key(edge));
+            inner->second.push_back(edge.weight);
+        }
+    }
+
+    // Appends the weights of the src -> dest entry of a two level map (if any)
+    void append_weights(const std::map<int, std::map<int, std::vector<double>>> &edge_map, int src, int dest, std::vector<double> &weights){
+        auto outer = edge_map.find(src);
+        if (outer == edge_map.end()){
+            return;
+        }
+        auto inner = outer->second.find(dest);
+        if (inner != outer->second.end()){
+            weights.insert(weights.end(), inner->second.begin(), inner->second.end());
+        }
+    }
+
+    // Appends an edge for every weight stored under src in a two level map
+    void append_edges_from(const std::map<int, std::map<int, std::vector<double>>> &edge_map, int src, std::vector<edge> &edges){
+        auto outer = edge_map.find(src);
+        if (outer == edge_map.end()){
+            return;
+        }
+        for (auto &connection : outer->second){
+            for (double weight : connection.second){
+                edges.push_back({src, connection.first, weight});
+            }
+        }
+    }
+
+    // Appends the sub keys stored under src in a two level map
+    void append_sub_keys(const std::map<int, std::map<int, std::vector<double>>> &edge_map, int src, std::vector<int> &keys){
+        auto outer = edge_map.find(src);
+        if (outer == edge_map.end()){
+            return;
+        }
+        for (auto &connection : outer->second){
+            keys.push_back(connection.first);
+        }
+    }
+
+    // Sorts and removes duplicates from a list of vertex IDs
+    void sort_unique(std::vector<int> &vertices){
+        std::sort(vertices.begin(), vertices.end());
+        vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+    }
+}
+
+void edgelist::insert_edges(std::vector<edge> &edges){
+    std::vector<edge> sorted_edges = edges;
+    std::stable_sort(sorted_edges.begin(), sorted_edges.end(), [](const edge &a, const edge &b){
+        return a.src < b.src || (a.src == b.src && a.dest < b.dest);
+    });
+    insert_sorted_edges(this->Edges, sorted_edges, [](const edge &e){ return e.src; }, [](const edge &e){ return e.dest; });
+
+    std::stable_sort(sorted_edges.begin(), sorted_edges.end(), [](const edge &a, const edge &b){
+        return a.dest < b.dest || (a.dest == b.dest && a.src < b.src);
+    });
+    insert_sorted_edges(this->RevEdges, sorted_edges, [](const edge &e){ return e.dest; }, [](const edge &e){ return e.src; });
+}
+
 void edgelist::rm_edge(int src, int dest){
     if (this->Edges.find(src) != this->Edges.end()){
         this->Edges[src].erase(dest);
@@ -74,6 +146,10 @@ void edgelist::set_directional(bool isDirectional){
     this->Directional = isDirectional;
 }
 
+bool edgelist::is_directional(){
+    return this->Directional;
+}
+
 std::vector<edge> edgelist::get_edges(){
     std::vector<edge> edges;
     for (auto iter_layer_one : this->Edges){
@@ -136,88 +212,45 @@ std::vector<edge> edgelist::get_edges_duplicate_on_undirectional(){
 }
 
 std::vector<edge> edgelist::get_edges(int src){
+    // Read the maps in place, this is called once per frontier vertex by every traversal
     std::vector<edge> edges;
-    if (this->Edges.find(src) != this->Edges.end()){
-        std::map<int, std::vector<double>> connections = this->Edges.at(src);
-        for (auto iter_layer_two : connections){
-            int dest = iter_layer_two.first;
-            std::vector<double> edge_weights = iter_layer_two.second;
-            for (double weight : edge_weights){
-                struct edge new_edge = {
-                    .src = src,
-                    .dest = dest,
-                    .weight = weight,
-                };
-                edges.push_back(new_edge);
-            }
-        }
-    }
-    if (!this->Directional && this->RevEdges.find(src) != this->RevEdges.end()){
-        std::map<int, std::vector<double>> connections = this->RevEdges.at(src);
-        for (auto iter_layer_two : connections){
-            int dest = iter_layer_two.first;
-            std::vector<double> edge_weights = iter_layer_two.second;
-            for (double weight : edge_weights){
-                struct edge new_edge = {
-                    .src = src,
-                    .dest = dest,
-                    .weight = weight,
-                };
-                edges.push_back(new_edge);
-            }
-        }
+    append_edges_from(this->Edges, src, edges);
+    if (!this->Directional){
+        append_edges_from(this->RevEdges, src, edges);
     }
     return edges;
 }
 
 std::vector<int> edgelist::get_adjacent_vertices(int src){
     std::vector<int> vertices;
-    if (this->Edges.find(src) != this->Edges.end()){
-        std::map<int, std::vector<double>> connections = this->Edges.at(src);
-        for (auto iter_layer_two : connections){
-            int dest = iter_layer_two.first;
-            vertices.push_back(dest);
-        }
-    }
-    if (!this->Directional && this->RevEdges.find(src) != this->RevEdges.end()){
-        std::map<int, std::vector<double>> connections = this->RevEdges.at(src);
-        for (auto iter_layer_two : connections){
-            int dest = iter_layer_two.first;
-            vertices.push_back(dest);
-        }
+    append_sub_keys(this->Edges, src, vertices);
+    if (!this->Directional){
+        append_sub_keys(this->RevEdges, src, vertices);
     }
     return vertices;
 }
 
 std::string edgelist::to_string(){
-    std::string result_str = "";
     std::vector<edge> edges = get_edges();
-    result_str += "Edgelist Edges:\n";
+    std::string result_str = "Edgelist Edges:\n";
+    result_str.reserve(result_str.size() + edges.size() * 40); // Room for "src -> dest = weight" lines, avoids regrowing the string per edge
     for (struct edge edge : edges){
-        result_str += std::to_string(edge.src) + " -> " + std::to_string(edge.dest) + " = ";
-        char edge_weight [20];
-        sprintf(edge_weight, "%.10E", edge.weight);
-        result_str += std::string(edge_weight) + "\n";
+        text_output::append_int(result_str, edge.src);
+        result_str += " -> ";
+        text_output::append_int(result_str, edge.dest);
+        result_str += " = ";
+        text_output::append_scientific(result_str, edge.weight, 10);
+        result_str += '\n';
     }
     return result_str;
 }
 
 std::vector<double>  edgelist::get_edge_weights(int src, int dest){
     std::vector<double> edge_weights;
-    if (this->Edges.find(src) != this->Edges.end() && this->Edges.at(src).find(dest) != this->Edges.at(src).end()){
-        std::vector<double> weights = this->Edges.at(src).at(dest);
-        for (double weight : weights){
-            edge_weights.push_back(weight);
-        }
-    }
-    
-    if (!this->Directional && this->RevEdges.find(src) != this->RevEdges.end() && this->RevEdges.at(src).find(dest) != this->RevEdges.at(src).end()){
-        std::vector<double> weights = this->RevEdges.at(src).at(dest);
-        for (double weight : weights){
-            edge_weights.push_back(weight);
-        }
+    append_weights(this->Edges, src, dest, edge_weights);
+    if (!this->Directional){
+        append_weights(this->RevEdges, src, dest, edge_weights);
     }
-
     return edge_weights;
 }
 
@@ -233,67 +266,73 @@ int edgelist::max_vertex(){
     return -1;
 }
 
+bool edgelist::uniform_weight(double &weight){
+    bool found = false;
+    for (auto &row : this->Edges){
+        for (auto &weights : row.second){
+            for (double edge_weight : weights.second){
+                if (!found){
+                    weight = edge_weight;
+                    found = true;
+                } else if (edge_weight != weight){
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+uint64_t edgelist::memory_bytes(){
+    // Node of the outer map (key and inner map header), nodes of the inner maps (key and weight vector) and the weight buffers
+    uint64_t bytes = 0;
+    for (auto *edges : {&this->Edges, &this->RevEdges}){
+        for (auto &row : *edges){
+            bytes += memory::MAP_NODE_OVERHEAD_BYTES + sizeof(row);
+            for (auto &weights : row.second){
+                bytes += memory::MAP_NODE_OVERHEAD_BYTES + sizeof(weights) + weights.second.capacity() * sizeof(double);
+            }
+        }
+    }
+    return bytes;
+}
+
 edgelist edgelist::take_neg_laplacian(){
     edgelist neg_laplacian = edgelist(true);
     int dim = max_vertex();
     #ifdef _DEBUG
-    std::cout << "Calculating negative laplacian non-diagonal...\n";
+    std::cout << "Calculating negative laplacian...\n";
     #endif
 
-    omp_lock_t writelock;
-    omp_init_lock(&writelock);
-
-    // Iterate through all non-diagonals
-    #pragma omp parallel for collapse(2)
+    // Only the vertices adjacent to i have a non-zero entry in row i, so each row is built from the adjacency of i (in ascending j order) instead of testing every j
+    std::vector<std::vector<edge>> rows(dim+1);
+    #pragma omp parallel for schedule(dynamic, 64)
     for (int i = 0; i <= dim; i++){
-        for (int j = 0; j <= dim; j++){
+        std::vector<int> adjacent = get_adjacent_vertices(i);
+        sort_unique(adjacent);
 
+        double diagonal_weight = 0;
+        for (int j : adjacent){
             if (i == j) { // Skip diagonal, thus ignoring self edges
                 continue;
             }
 
             std::vector<double> edge_weights = get_edge_weights(i,j);
-            
-            if (!edge_weights.empty()){
-                double total_weight = 0;
-                for (double weight : edge_weights){ // Find total weight if multiple edges exist
-                    total_weight += weight;
-                }
-                omp_set_lock(&writelock);
-                neg_laplacian.insert_edge(i, j, total_weight); // Set value to -1 * (-1 * weight) for non-diagonal elements b/c negative laplacian
-                omp_unset_lock(&writelock);
+            double total_weight = 0;
+            for (double weight : edge_weights){ // Find total weight if multiple edges exist
+                total_weight += weight;
+                diagonal_weight += weight;
             }
+            rows[i].push_back({i, j, total_weight}); // Set value to -1 * (-1 * weight) for non-diagonal elements b/c negative laplacian
         }
+        rows[i].push_back({i, i, -diagonal_weight}); // Set diagonal as negative of total weight b/c negative laplacian
     }
 
-    omp_destroy_lock(&writelock);
-
-    #ifdef _DEBUG
-    std::cout << "Calculating negative laplacian diagonal...\n";
-    #endif
-    // Iterate along diagonal
-    double* diagonal_vals = new double[dim+1];
-    #pragma omp parallel for
-    for (int i = 0; i <= dim; i++){ // For each element on the diagonal
-        double total_weight = 0;
-        for (int j = 0; j <=dim; j++){ // Iterate through all connected edges
-            if (i == j){ // Skip self edges
-                continue;
-            }
-            std::vector<double> edge_weights = get_edge_weights(i,j);
-            if (!edge_weights.empty()){
-                for (double weight : edge_weights){
-                    total_weight += weight; // Find total weight for edges if multiple edges exist
-                }
-            }
-        }
-        diagonal_vals[i] = -total_weight; // Set as negative of total weight b/c negative laplacian
-    }
-
-    for (int i = 0; i <= dim; i++){
-        neg_laplacian.insert_edge(i, i, diagonal_vals[i]);
+    std::vector<edge> entries;
+    for (std::vector<edge> &row : rows){
+        entries.insert(entries.end(), row.begin(), row.end());
     }
-    delete[] diagonal_vals;
+    neg_laplacian.insert_edges(entries);
 
     return neg_laplacian;
 }
@@ -315,13 +354,19 @@ edgelist edgelist::neg_laplacian_to_g(){
     #ifdef _DEBUG
     std::cout << "Calculating g...\n";
     #endif
-    omp_lock_t writelock;
-    omp_init_lock(&writelock);
-    #pragma omp parallel for
+    // Generate the w_func table before the threads read it
+    funcs::w_func(1);
+    std::vector<std::vector<edge>> rows(dim+1);
+    #pragma omp parallel for schedule(dynamic, 64)
     for (int i = 0; i <= dim; i++){
-        for (int j = 0; j <= dim; j++){
-            // For each i,j pair
+        // Only the pairs i,j with an edge in either direction have a g entry
+        std::vector<int> connected;
+        append_sub_keys(this->Edges, i, connected);
+        append_sub_keys(this->RevEdges, i, connected);
+        sort_unique(connected);
 
+        for (int j : connected){
+            // For each i,j pair
             std::vector<double> edge_weights = get_edge_weights(i,j);
             std::vector<double> edge_weights_rev = get_edge_weights(j,i);
             edge_weights.insert(edge_weights.end(),edge_weights_rev.begin(),edge_weights_rev.end());
@@ -337,17 +382,20 @@ edgelist edgelist::neg_laplacian_to_g(){
                 }
                 // calculate y
                 double y = max_absolute_weight / max_abs_weight_for_edge;
-                omp_set_lock(&writelock);
                 // use y to approximate the result of the inverse of v(x) to get approximate x with linear interpolation
                 double x = funcs::w_func(y);
                 // Set the edge in the g_edgelist as the maximum between x and epsilon
                 double g = std::max(x,funcs::EPSILON);
-                g_edgelist.insert_edge(i, j, g);
-                omp_unset_lock(&writelock);
+                rows[i].push_back({i, j, g});
             }
         }
     }
-    omp_destroy_lock(&writelock);
+
+    std::vector<edge> g_edges;
+    for (std::vector<edge> &row : rows){
+        g_edges.insert(g_edges.end(), row.begin(), row.end());
+    }
+    g_edgelist.insert_edges(g_edges);
     return g_edgelist;
 }
 
@@ -388,16 +436,17 @@ void edgelist::save_edgelist_to_sqlite(std::string filepath, std::string table_n
 }
 
 void edgelist::save_edgelist_as_plaintext(std::string filepath){
-    std::ofstream output_file;
-    output_file.open(filepath);
+    text_output::buffered_writer output_file(filepath);
 
-    output_file << "% asym weighted" << "\n";
+    output_file.write("% asym weighted\n");
 
     std::vector<edge> edges = get_edges();
-    for (struct edge edge : edges){
-        char edge_weight [20];
-        sprintf(edge_weight, "%.10E", edge.weight);
-        output_file << edge.src << " " << edge.dest << " " << edge_weight << "\n";
-    }
-    output_file.close();
+    text_output::write_formatted_chunks(output_file, edges.size(), [&edges](std::string &out, size_t i){
+        text_output::append_int(out, edges[i].src);
+        out += ' ';
+        text_output::append_int(out, edges[i].dest);
+        out += ' ';
+        text_output::append_scientific(out, edges[i].weight, 10);
+        out += '\n';
+    }, 4096);
 }
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <stdexcept>
 #include <map>
 #include <vector>
+#include <cstdint>
 
 // Represents an edge (can be directed depending on edgelist)
 struct edge {
@@ -50,6 +51,13 @@ class edgelist {
         */
         void insert_edge(int src, int dest, double weight);
 
+        /**
+         * Insert many edges into the edgelist at once (can cause duplicate edges).
+         * The edges are sorted first so the maps are built with hinted insertions instead of a full lookup per edge.
+         * @param edges The edges to insert. Edges with the same src and dest keep their relative order.
+        */
+        void insert_edges(std::vector<edge> &edges);
+
         /**
          * Removes an edge from the edgelist (only if it exists)
          * @param src The source vertex ID the edge points from. Relevant in directed networks.
@@ -63,6 +71,9 @@ class edgelist {
         */
         void set_directional(bool directional);
 
+        // Returns whether if the network represented by the edgelist is directional
+        bool is_directional();
+
         // Returns the edgelist as a vector of edges
         std::vector<edge> get_edges();
 
@@ -89,6 +100,16 @@ class edgelist {
         // Returns the largest vertex ID in the edgelist
         int max_vertex();
 
+        /**
+         * Finds whether every edge has the same weight, in which case the shortest paths are the paths with the fewest edges
+         * @param weight Set to the weight of the edges if they all have the same weight (left untouched without edges)
+         * @return Whether if every edge has the same weight (true without edges)
+        */
+        bool uniform_weight(double &weight);
+
+        // Returns the estimated number of bytes held by the maps of the edgelist
+        uint64_t memory_bytes();
+
         // Returns an edgelist object representing the negative laplacian of the edgelist
         edgelist take_neg_laplacian();
 
@@ -1,35 +1,65 @@
 #include "edgelist.h"
 #include "utils.h"
 #include "network_metrics.h"
+#include "instrument.h"
+#include "compact_graph.h"
+#include "distance_histogram.h"
 
 /**
- * Generates a Watts Strogatz network with SIZE 1,000 AVG_DEG 20 and REWIRING_PROB of 10% and compute various distances.
- * Save the information and network distances between all vertex pairs for the original, neg-laplacian, and g-tilda edgelist into a SQLite3 database.
+ * Generates a Watts Strogatz network with SIZE 1,000 AVG_DEG 20 and REWIRING_PROB of 10% (from a fixed seed) and compute various distances.
+ * Save the frequencies of the g_tilda information distances by network distance in the original network into a SQLite3 database, counted while searching from every source.
+ * With --pairs the information and network distances between all vertex pairs for the original and g-tilda edgelist are saved as well.
  * ---
  * Creates the following tables:
  * - `a_edgelist`: Edgelist representing the generated network
  * - `neg_laplacian_edgelist`: Edgelist representing the calculated Negative Laplacian
  * - `g_edgelist Edgelist`: representing the g_tilda network
- * - `a_dbv_tau`: Information and network distances between all vertex pairs for a_edgelist using limit tau = 1000
+ * - `g_info_a_net_histogram`: Pairs by g_edgelist information distance (limit tau = 10000, buckets of 0.5) and a_edgelist network distance (limit tau = 1000)
+ * - `g_info_a_net_vertex_summary`: Mean and max of those distances from each vertex
+ * - `a_dbv_tau`: Information and network distances between all vertex pairs for a_edgelist using limit tau = 1000 (--pairs)
  * - `a_dbv_k`: Information and network distances between all vertex pairs for a_edgelist using limit k = 10
  * - `nl_dbv_tau`: Information and network distances between all vertex pairs for neg_laplacian_edgelist using limit tau = 1000
- * - `g_dbv_tau`: Information and network distances between all vertex pairs for g_edgelist using limit tau = 1000
+ * - `g_dbv_tau`: Information and network distances between all vertex pairs for g_edgelist using limit tau = 10000 (--pairs)
  * - `g_dbv_k`: Information and network distances between all vertex pairs for g_edgelist using limit k = 10
 */
-int main() {
+int main(int argc, char* argv[]) {
+    std::map<std::string, std::string> flags = extract_flags(argc, argv);
+    // Whether to also save every pair, which grows with the square of the network size
+    const bool SAVE_PAIRS = flags.count("pairs") > 0;
+    instrument::dump_at_exit();
     edgelist a_edgelist;
     const std::string OUTPUT_DB = "cross_distances-output.db"; // File path of the database to be stored into.
-    generate_watts_strogatz_small_world_network(a_edgelist,1000,20,0.1);
+    const uint64_t WATTS_STROGATZ_SEED = 1; // Seed of the generated network, fixed so the figure can be reproduced
+    instrument::phase_timer generate_timer("generate");
+    generate_watts_strogatz_small_world_network(a_edgelist,1000,20,0.1,WATTS_STROGATZ_SEED);
+    generate_timer.stop();
     a_edgelist.save_edgelist_to_sqlite(OUTPUT_DB,"a_edgelist");
 
+    instrument::phase_timer neg_laplacian_timer("take_neg_laplacian");
     edgelist neg_laplacian = a_edgelist.take_neg_laplacian();
+    neg_laplacian_timer.stop();
     neg_laplacian.save_edgelist_to_sqlite(OUTPUT_DB,"neg_laplacian_edgelist");
 
+    instrument::phase_timer g_tilda_timer("neg_laplacian_to_g");
     edgelist g_edgelist = neg_laplacian.neg_laplacian_to_g();
+    g_tilda_timer.stop();
     g_edgelist.save_edgelist_to_sqlite(OUTPUT_DB,"g_edgelist");
 
+    std::cout << "g_info_a_net histogram\n";
+    instrument::phase_timer histogram_timer("distance_histogram");
+    compact_graph a_graph(a_edgelist);
+    compact_graph g_graph(g_edgelist);
+    histogram::distance_summary g_info_a_net = histogram::all_sources(g_graph, 10000, 0.5, &a_graph, 1000);
+    histogram_timer.stop();
+    histogram::save_distance_summary_to_sqlite(g_info_a_net, OUTPUT_DB, "g_info_a_net");
+    if (!SAVE_PAIRS){
+        return 0;
+    }
+
     std::cout << "a_edgelist geodesic_tau\n";
+    instrument::phase_timer a_search_timer("cross_geodesic_distance_tau");
     metrics::distance_btwn_vertices a_dbv_tau = metrics::cross_geodesic_distance_tau(a_edgelist, 1000);
+    a_search_timer.stop();
     //metrics::print_distance_to_vertices(a_dbv_tau);
     //save_distance_btwn_vertices_to_file("a_dbv_tau.csv", a_dbv_tau);
     metrics::dbv_to_sqlite(OUTPUT_DB, "a_dbv_tau", a_dbv_tau);
@@ -50,7 +80,9 @@ int main() {
     */
 
     std::cout << "g_edgelist geodesic_tau\n";
+    instrument::phase_timer g_search_timer("cross_geodesic_distance_tau");
     metrics::distance_btwn_vertices g_dbv_tau = metrics::cross_geodesic_distance_tau(g_edgelist, 10000);
+    g_search_timer.stop();
     //metrics::print_distance_to_vertices(g_dbv_tau);
     metrics::dbv_to_sqlite(OUTPUT_DB, "g_dbv_tau", g_dbv_tau);
 
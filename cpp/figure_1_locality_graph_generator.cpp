@@ -1,9 +1,10 @@
 #include "edgelist.h"
 #include "utils.h"
 #include "network_metrics.h"
+#include "instrument.h"
 
 /**
- * Generates a Watts Strogatz network with SIZE 1,000 AVG_DEG 20 and REWIRING_PROB of 10% and compute various distances.
+ * Generates a Watts Strogatz network with SIZE 1,000 AVG_DEG 20 and REWIRING_PROB of 10% (from a fixed seed) and compute various distances.
  * Save the information and network distances between all vertex pairs for the original, neg-laplacian, and g-tilda edgelist into a SQLite3 database.
  * ---
  * Creates the following tables:
@@ -14,25 +15,37 @@
  * - `g_dbv_k`: Information and network distances between all vertex pairs for g_edgelist using limit k = 10 FROM SRC 1
 */
 int main(){
+    instrument::dump_at_exit();
     edgelist a_edgelist;
     const std::string OUTPUT_DB = "cross_distances-output.db"; // File path of the database to be stored into.
-    generate_watts_strogatz_small_world_network(a_edgelist,1000,20,0.1);
+    const uint64_t WATTS_STROGATZ_SEED = 1; // Seed of the generated network, fixed so the figure can be reproduced
+    instrument::phase_timer generate_timer("generate");
+    generate_watts_strogatz_small_world_network(a_edgelist,1000,20,0.1,WATTS_STROGATZ_SEED);
+    generate_timer.stop();
     a_edgelist.save_edgelist_to_sqlite(OUTPUT_DB,"a_edgelist");
 
+    instrument::phase_timer neg_laplacian_timer("take_neg_laplacian");
     edgelist neg_laplacian = a_edgelist.take_neg_laplacian();
+    neg_laplacian_timer.stop();
     neg_laplacian.save_edgelist_to_sqlite(OUTPUT_DB,"neg_laplacian_edgelist");
 
+    instrument::phase_timer g_tilda_timer("neg_laplacian_to_g");
     edgelist g_edgelist = neg_laplacian.neg_laplacian_to_g();
+    g_tilda_timer.stop();
     g_edgelist.save_edgelist_to_sqlite(OUTPUT_DB,"g_edgelist");
 
     std::cout << "a_edgelist geodesic_k\n";
+    instrument::phase_timer a_search_timer("geodesic_distance_k");
     metrics::distance_to_vertices a_dtv_k = metrics::geodesic_distance_k(a_edgelist, 1, 10);
+    a_search_timer.stop();
     //metrics::print_distance_to_vertices(a_dtv_k);
     metrics::distance_btwn_vertices a_dbv_k = metrics::dtv_to_dbv(a_dtv_k, 1);
     metrics::dbv_to_sqlite(OUTPUT_DB, "a_dbv_k", a_dbv_k);
 
     std::cout << "g_edgelist geodesic_k\n";
+    instrument::phase_timer g_search_timer("geodesic_distance_k");
     metrics::distance_to_vertices g_dtv_k = metrics::geodesic_distance_k(g_edgelist, 1, 10);
+    g_search_timer.stop();
     //metrics::print_distance_to_vertices(g_dtv_k);
     metrics::distance_btwn_vertices g_dbv_k = metrics::dtv_to_dbv(g_dtv_k, 1);
     metrics::dbv_to_sqlite(OUTPUT_DB, "g_dbv_k", g_dbv_k);
@@ -3,6 +3,8 @@
 #include "edgelist.h"
 #include "utils.h"
 #include "network_metrics.h"
+#include "derived_cache.h"
+#include "instrument.h"
 
 /**
  * Loads a network from a given file and calculates the Gamma Neighborhood S_avg to be saved in the results SQLite3 db under a task id.
@@ -23,10 +25,12 @@ void process_network_s_avg(std::string ID, std::string FILEPATH, bool WEIGHTED,
 
     // load network file
     std::cout << ID <<";" << FILEPATH << ";"<< std::to_string(WEIGHTED) << ";"<< std::to_string(DIRECTED) << "\n";
-    edgelist a_edgelist = edgelist_from_file(WEIGHTED, FILEPATH);
-    a_edgelist.set_directional(DIRECTED);
-    edgelist neg_laplacian = a_edgelist.take_neg_laplacian();
-    edgelist g_edgelist = neg_laplacian.neg_laplacian_to_g();
+    edgelist neg_laplacian;
+    edgelist g_edgelist;
+    metrics::laplacian_stats stats;
+    instrument::phase_timer load_timer("load_and_derive");
+    derived_cache::load_or_derive(FILEPATH, WEIGHTED, DIRECTED, neg_laplacian, g_edgelist, stats);
+    load_timer.stop();
     //std::cout << neg_laplacian.to_string();
 
     std::string sql_create_s_avg_table_query = "CREATE TABLE IF NOT EXISTs " \
@@ -41,7 +45,9 @@ void process_network_s_avg(std::string ID, std::string FILEPATH, bool WEIGHTED,
     }
     
     // Calculate S_Avg
-    double S_avg = metrics::s_avg_gamma(neg_laplacian, g_edgelist, GAMMA);
+    instrument::phase_timer s_avg_timer("s_avg_gamma");
+    double S_avg = metrics::s_avg_gamma(g_edgelist, stats, GAMMA);
+    s_avg_timer.stop();
     std::string sql_insert_query = "INSERT INTO S_average (NET_ID,GAMMA,avg_s) " \
     "VALUES ('" + ID + "', "+std::to_string(GAMMA)+", " + std::to_string(S_avg) + ")\n";
 
@@ -55,6 +61,7 @@ int main(int argc, char* argv[]){
     if (argc < 4){
         exit(1);
     }
+    instrument::dump_at_exit();
     const std::string ID = argv[1];
     const std::string FILEPATH = argv[2];
     const bool WEIGHTED = bool(atoi(argv[3]));
@@ -0,0 +1,359 @@
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <iostream>
+#include <filesystem>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <cstdlib>
+#include <sqlite3.h>
+#include <omp.h>
+#include <unistd.h>
+
+#include "edgelist.h"
+#include "utils.h"
+#include "network_metrics.h"
+#include "derived_cache.h"
+#include "compact_graph.h"
+#include "placement.h"
+#include "funcs.h"
+#include "instrument.h"
+#include "sampling.h"
+
+/*
+Batch runner for the figure 2 tasks: replaces scripts/calculate_figure_two_tasks_wrapper.py.
+A loader thread locates (or fetches), parses and derives the next networks while the main thread calculates S_avg,
+small networks are calculated concurrently with one thread each and large networks alone with every thread.
+*/
+
+// Rough peak bytes held while parsing and deriving a network, per byte of its edgelist file (three map based edgelists)
+const uint64_t LOAD_BYTES_PER_FILE_BYTE = 40;
+
+// The loader derives networks with one thread per this many threads of the main thread's S_avg regions, which run at the same time
+const int LOADER_THREAD_DIVISOR = 4;
+
+// One row of the tasks table
+struct figure_2_task {
+    std::string ID;
+    std::string URL;
+    bool WEIGHTED;
+    bool DIRECTED;
+};
+
+// A network that was loaded and derived, waiting for (or undergoing) the S_avg calculation
+struct loaded_network {
+    figure_2_task task;
+    // Directory created by the fetch command, deleted once the task is done (empty if the data was already local)
+    std::string fetched_dir;
+    metrics::laplacian_stats stats;
+    compact_graph g_tilda_graph;
+    // Bytes held until the task is done: the compact graph and the search scratch of the threads calculating it
+    uint64_t bytes;
+};
+
+/**
+ * Quotes an argument for the shell
+ * @param arg The argument
+ * @return The argument in single quotes
+*/
+std::string shell_quote(std::string arg){
+    std::string quoted = "'";
+    for (char c : arg){
+        if (c == '\''){
+            quoted += "'\\''";
+        } else {
+            quoted += c;
+        }
+    }
+    return quoted + "'";
+}
+
+/**
+ * Finds the edgelist file ("out.*", as unpacked from a Konect archive) in the directory of a task
+ * @param dir The directory of the task
+ * @return The filepath, or an empty string if there is none
+*/
+std::string find_data_file(std::filesystem::path dir){
+    std::error_code ec;
+    if (!std::filesystem::is_directory(dir, ec)){
+        return "";
+    }
+    for (auto &entry : std::filesystem::recursive_directory_iterator(dir, ec)){
+        if (entry.is_regular_file(ec) && entry.path().filename().string().rfind("out.", 0) == 0){
+            return entry.path().string();
+        }
+    }
+    return "";
+}
+
+/**
+ * Runs the pending tasks of a tasks db: calculates S_avg(GAMMA) of each network, saves it into the S_average table of the results db
+ * and marks the task as COMPLETED in the same transaction.
+ * @param TASKS_DB The filepath of the db containing the tasks table (TASK_ID URL WEIGHTED DIRECTED COMPLETED)
+ * @param DATASETS_DIR The directory holding one directory per TASK_ID with the unpacked edgelist file
+ * @param FETCH_CMD Command run as `FETCH_CMD TASK_ID URL DIR` when a task has no local edgelist file (skipped if empty)
+ * @param RESULTS_DB The filepath of the db the results are saved into
+ * @param GAMMA Value of gamma when calculating the neighborhood
+ * @param MEM_BUDGET The number of bytes the loaded networks are kept under (at least one network is always admitted)
+ * @param INNER_PARALLEL_MIN_SIZE The smallest network size (vertex count) calculated with all threads
+ * @param PLAN The sampling plan, when enabled S_avg is estimated from a sample of the sources of each network
+*/
+void run_figure_2_tasks(std::string TASKS_DB, std::string DATASETS_DIR, std::string FETCH_CMD, std::string RESULTS_DB, double GAMMA, uint64_t MEM_BUDGET, int INNER_PARALLEL_MIN_SIZE, sampling::plan PLAN){
+    // Initialize database, the results db is attached so results and completion are committed together
+    sqlite3 *db;
+    char *zErrMsg = 0;
+    if (sqlite3_open(TASKS_DB.c_str(), &db)) {
+        fprintf(stderr, "Can't open database: %s\n", sqlite3_errmsg(db));
+        exit(1);
+    }
+    std::string sql_create_s_avg_table_query = "CREATE TABLE IF NOT EXISTs " \
+      "results.S_average ("  \
+      "NET_ID          TEXT     NOT NULL," \
+      "GAMMA          REAL     NOT NULL," \
+      "avg_s    REAL    NOT NULL);";
+    // The filepath is bound rather than pasted into the statement, so quotes in it cannot break the statement
+    sqlite3_stmt *attach_stmt;
+    if (sqlite3_prepare_v2(db, "ATTACH DATABASE ? AS results;", -1, &attach_stmt, NULL) != SQLITE_OK){
+        fprintf(stderr, "Attach SQL error: %s\n", sqlite3_errmsg(db));
+        exit(1);
+    }
+    sqlite3_bind_text(attach_stmt, 1, RESULTS_DB.c_str(), -1, SQLITE_TRANSIENT);
+    if (sqlite3_step(attach_stmt) != SQLITE_DONE){
+        fprintf(stderr, "Attach SQL error: %s\n", sqlite3_errmsg(db));
+        exit(1);
+    }
+    sqlite3_finalize(attach_stmt);
+    if( sqlite3_exec(db, sql_create_s_avg_table_query.c_str(), NULL, 0, &zErrMsg) != SQLITE_OK ){
+        fprintf(stderr, "Table Creation SQL error: %s\n", zErrMsg);
+        sqlite3_free(zErrMsg);
+        exit(1);
+    }
+    sampling::add_estimate_columns(db, "results.S_average");
+
+    std::vector<figure_2_task> tasks;
+    sqlite3_stmt *select_stmt;
+    if (sqlite3_prepare_v2(db, "SELECT TASK_ID, URL, WEIGHTED, DIRECTED FROM tasks WHERE COMPLETED = 0", -1, &select_stmt, NULL) != SQLITE_OK){
+        fprintf(stderr, "Task Selection SQL error: %s\n", sqlite3_errmsg(db));
+        exit(1);
+    }
+    while (sqlite3_step(select_stmt) == SQLITE_ROW){
+        const unsigned char *url = sqlite3_column_text(select_stmt, 1);
+        tasks.push_back({
+            (const char *) sqlite3_column_text(select_stmt, 0),
+            url == NULL ? "" : (const char *) url,
+            sqlite3_column_int(select_stmt, 2) != 0,
+            sqlite3_column_int(select_stmt, 3) != 0
+        });
+    }
+    sqlite3_finalize(select_stmt);
+    std::cout << tasks.size() << " pending tasks.\n";
+
+    sqlite3_stmt *insert_stmt;
+    sqlite3_stmt *complete_stmt;
+    if (sqlite3_prepare_v2(db, "INSERT INTO results.S_average (NET_ID,GAMMA,avg_s,ci_low,ci_high,sample_size) VALUES (?,?,?,?,?,?)", -1, &insert_stmt, NULL) != SQLITE_OK
+        || sqlite3_prepare_v2(db, "UPDATE tasks SET COMPLETED = 1 WHERE TASK_ID = ?", -1, &complete_stmt, NULL) != SQLITE_OK){
+        fprintf(stderr, "Insertion SQL error: %s\n", sqlite3_errmsg(db));
+        exit(1);
+    }
+
+    // Shared by every network, generated before any thread reads it
+    funcs::w_func(1);
+    const int threads = omp_get_max_threads();
+
+    // Loaded networks waiting for the main thread, and the bytes held by networks that are loaded but not done yet
+    std::mutex queue_mutex;
+    std::condition_variable queue_changed;
+    std::deque<loaded_network*> ready;
+    uint64_t held_bytes = 0;
+    bool loader_done = false;
+
+    std::thread loader([&](){
+        // Started by the main thread, so without this the loader and its team would share the main thread's pinned CPU
+        placement::unpin_current_thread();
+        // The thread count set here only applies to the parallel regions this thread starts
+        omp_set_num_threads(std::max(1, threads / LOADER_THREAD_DIVISOR));
+        for (figure_2_task &task : tasks){
+            std::filesystem::path task_dir = std::filesystem::path(DATASETS_DIR) / task.ID;
+            std::string fetched_dir;
+            std::string filepath = find_data_file(task_dir);
+            if (filepath.empty() && !FETCH_CMD.empty()){
+                std::error_code ec;
+                if (!std::filesystem::exists(task_dir, ec)){
+                    fetched_dir = task_dir.string();
+                }
+                std::string command = FETCH_CMD + " " + shell_quote(task.ID) + " " + shell_quote(task.URL) + " " + shell_quote(task_dir.string());
+                instrument::phase_timer fetch_timer("fetch");
+                if (std::system(command.c_str()) != 0){
+                    std::cerr << "Error fetching " << task.ID << "!\n";
+                }
+                filepath = find_data_file(task_dir);
+            }
+            if (filepath.empty()){
+                std::cerr << "Error locating " << task.ID << "'s data file!\n";
+                continue;
+            }
+
+            // Admission: wait for enough of the budget to parse and derive the network, unless nothing else is held
+            std::error_code ec;
+            uint64_t load_bytes = std::filesystem::file_size(filepath, ec) * LOAD_BYTES_PER_FILE_BYTE;
+            {
+                std::unique_lock<std::mutex> lock(queue_mutex);
+                queue_changed.wait(lock, [&](){ return held_bytes == 0 || held_bytes + load_bytes <= MEM_BUDGET; });
+            }
+
+            std::cout << task.ID << ";" << filepath << ";" << std::to_string(task.WEIGHTED) << ";" << std::to_string(task.DIRECTED) << "\n";
+            loaded_network *network = new loaded_network();
+            network->task = task;
+            network->fetched_dir = fetched_dir;
+            {
+                instrument::phase_timer load_timer("load_and_derive");
+                edgelist neg_laplacian;
+                edgelist g_edgelist;
+                derived_cache::load_or_derive(filepath, task.WEIGHTED, task.DIRECTED, neg_laplacian, g_edgelist, network->stats);
+                neg_laplacian = edgelist();
+                network->g_tilda_graph = compact_graph(g_edgelist, network->stats.dim + 1);
+            }
+            uint64_t scratch_bytes = metrics::search_scratch::bytes_for(network->g_tilda_graph.Vertices);
+            network->bytes = network->g_tilda_graph.memory_bytes() + scratch_bytes * (network->g_tilda_graph.Vertices >= INNER_PARALLEL_MIN_SIZE ? threads : 1);
+
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            held_bytes += network->bytes;
+            ready.push_back(network);
+            queue_changed.notify_all();
+        }
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        loader_done = true;
+        queue_changed.notify_all();
+    });
+
+    // Saves the result of a network and marks its task as completed in one transaction
+    auto record = [&](loaded_network *network, const sampling::estimate &S_avg){
+        instrument::phase_timer record_timer("save_results");
+        sqlite3_exec(db, "BEGIN TRANSACTION", NULL, NULL, &zErrMsg);
+        sqlite3_bind_text(insert_stmt, 1, network->task.ID.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_double(insert_stmt, 2, GAMMA);
+        sqlite3_bind_double(insert_stmt, 3, S_avg.Mean);
+        sqlite3_bind_double(insert_stmt, 4, S_avg.Low);
+        sqlite3_bind_double(insert_stmt, 5, S_avg.High);
+        sqlite3_bind_int64(insert_stmt, 6, S_avg.Samples);
+        sqlite3_bind_text(complete_stmt, 1, network->task.ID.c_str(), -1, SQLITE_TRANSIENT);
+        if (sqlite3_step(insert_stmt) != SQLITE_DONE || sqlite3_step(complete_stmt) != SQLITE_DONE){
+            fprintf(stderr, "Insertion SQL error: %s\n", sqlite3_errmsg(db));
+            sqlite3_exec(db, "ROLLBACK", NULL, NULL, &zErrMsg);
+        } else {
+            sqlite3_exec(db, "COMMIT", NULL, NULL, &zErrMsg);
+        }
+        sqlite3_reset(insert_stmt);
+        sqlite3_reset(complete_stmt);
+        std::cout << network->task.ID << " S_avg= " << S_avg.Mean << "\n";
+        if (PLAN.Enabled){
+            sampling::print_estimate(S_avg, PLAN);
+        }
+    };
+
+    // Calculates S_avg of a network, or estimates it from a sample of its sources
+    auto calculate = [&](loaded_network *network){
+        if (PLAN.Enabled){
+            return metrics::s_avg_gamma_estimate(network->g_tilda_graph, network->stats, GAMMA, PLAN);
+        }
+        return sampling::exact(metrics::s_avg_gamma(network->g_tilda_graph, network->stats, GAMMA), network->stats.dim + 1);
+    };
+
+    // Releases a finished network and lets the loader admit more
+    auto release = [&](loaded_network *network){
+        if (!network->fetched_dir.empty()){
+            std::error_code ec;
+            std::filesystem::remove_all(network->fetched_dir, ec);
+        }
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        held_bytes -= network->bytes;
+        delete network;
+        queue_changed.notify_all();
+    };
+
+    int max_active_levels = omp_get_max_active_levels();
+    while (true){
+        // Take the next network, plus the small networks already loaded behind it if it is small
+        std::vector<loaded_network*> batch;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            queue_changed.wait(lock, [&](){ return !ready.empty() || loader_done; });
+            if (ready.empty()){
+                break;
+            }
+            batch.push_back(ready.front());
+            ready.pop_front();
+            while (batch.front()->g_tilda_graph.Vertices < INNER_PARALLEL_MIN_SIZE && (int) batch.size() < threads
+                && !ready.empty() && ready.front()->g_tilda_graph.Vertices < INNER_PARALLEL_MIN_SIZE){
+                batch.push_back(ready.front());
+                ready.pop_front();
+            }
+        }
+
+        if (batch.size() == 1){
+            // Large network (or nothing to pair it with): every thread works on its sources
+            loaded_network *network = batch.front();
+            instrument::phase_timer s_avg_timer("s_avg_gamma");
+            sampling::estimate S_avg = calculate(network);
+            s_avg_timer.stop();
+            record(network, S_avg);
+            release(network);
+            continue;
+        }
+
+        // Small networks: one thread each, nested parallel regions are serialized
+        std::vector<sampling::estimate> S_avgs(batch.size());
+        instrument::phase_timer batch_timer("s_avg_gamma_batch");
+        omp_set_max_active_levels(1);
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (size_t i = 0; i < batch.size(); i++){
+            S_avgs[i] = calculate(batch[i]);
+        }
+        omp_set_max_active_levels(max_active_levels);
+        batch_timer.stop();
+        for (size_t i = 0; i < batch.size(); i++){
+            record(batch[i], S_avgs[i]);
+            release(batch[i]);
+        }
+    }
+
+    loader.join();
+    sqlite3_finalize(insert_stmt);
+    sqlite3_finalize(complete_stmt);
+    sqlite3_close(db);
+}
+
+int main(int argc, char* argv[]){
+    std::map<std::string, std::string> flags = extract_flags(argc, argv);
+    placement::configure(flags);
+    instrument::configure(flags);
+    if (argc < 3){
+        std::cerr << "Usage: figure_2_task_runner.bin [TASKS DB] [DATASETS DIR] [--fetch-cmd=CMD] [--output=DB] [--gamma=GAMMA] [--mem-budget=BYTES] [--inner-parallel-min-size=SIZE] [--sample=uniform|degree [--rel-error=E] [--confidence=C] [--time-budget=SECONDS] [--seed=SEED]]\n";
+        exit(1);
+    }
+    const std::string TASKS_DB = argv[1];
+    const std::string DATASETS_DIR = argv[2];
+    const std::string FETCH_CMD = flags.count("fetch-cmd") ? flags["fetch-cmd"] : "";
+    const std::string RESULTS_DB = flags.count("output") ? flags["output"] : "s_avg_results.db";
+    const double GAMMA = flags.count("gamma") ? std::stod(flags["gamma"]) : 0.05;
+    const int INNER_PARALLEL_MIN_SIZE = flags.count("inner-parallel-min-size") ? std::stoi(flags["inner-parallel-min-size"]) : 20000;
+
+    // Half of the physical memory unless given
+    uint64_t MEM_BUDGET = (uint64_t) sysconf(_SC_PHYS_PAGES) * sysconf(_SC_PAGE_SIZE) / 2;
+    if (flags.count("mem-budget")){
+        MEM_BUDGET = parse_bytes(flags["mem-budget"]);
+    }
+
+    if ( !( GAMMA > 0 && GAMMA < 1) ){
+        std::cerr << "ERROR: Invalid Gamma value given.\n";
+        exit(1);
+    }
+
+    const sampling::plan PLAN = sampling::from_flags(flags);
+
+    run_figure_2_tasks(TASKS_DB, DATASETS_DIR, FETCH_CMD, RESULTS_DB, GAMMA, MEM_BUDGET, INNER_PARALLEL_MIN_SIZE, PLAN);
+    return 0;
+}
@@ -4,6 +4,7 @@
 #include <float.h>
 
 #include "funcs.h"
+#include "memory_accounting.h"
 
 
 double funcs::v_func(double x){
@@ -87,4 +88,9 @@ std::pair<double, double> funcs::max_approximation_threshold_w(double y){
     double lower_bound_x = max_y_iter->second;
 
     return std::pair<double, double>(lower_bound_x,lower_bound_y);
-} 
\ No newline at end of file
+} 
+
+uint64_t funcs::w_table_bytes(){
+    uint64_t entries = ValuePairs.size() ? ValuePairs.size() : (uint64_t) (705 / funcs::STEP_SIZE) + 1;
+    return entries * (memory::MAP_NODE_OVERHEAD_BYTES + sizeof(std::pair<const double, double>));
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <map>
+#include <cstdint>
 
 namespace funcs {
     namespace { // This anonymous namespace is used to store the value pairs of the v function calculated
@@ -35,6 +36,9 @@ namespace funcs {
     // The returns an approximation of the value of the inverse function of v(x), where w(y) = x, using linear interpolation and the precomputed results of v(x)
     double w_func(double y);
 
+    // Returns the estimated bytes held by the table of v(x) values behind w_func (estimated from STEP_SIZE if it is not generated yet)
+    uint64_t w_table_bytes();
+
     // Gives the maximum threshold y for approximation of the results of v(x) before v(x) needs to be calculated.
     // Returns the largest x,y pair where y < the value given. Possible only because v(x) is monotonous increasing function.
     std::pair<double, double> max_approximation_threshold_w(double y);
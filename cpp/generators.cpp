@@ -0,0 +1,299 @@
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+#include <omp.h>
+
+#include "rng.h"
+
+#include "generators.h"
+
+namespace {
+    // Number of fixed work blocks the generation is split into. Each block has its own random stream, so the result does not depend on how blocks are scheduled on threads.
+    const int WORK_BLOCKS = 1024;
+    // Mixed into the seed for the streams drawing edge weights so they are independent of the streams drawing the structure
+    const uint64_t WEIGHT_STREAM_SALT = 0x5745494748545321ULL;
+
+    double draw_weight(rng::counter_rng &stream, generators::weight_distribution weights){
+        switch (weights){
+            case generators::weight_distribution::exponential:
+                return -std::log1p(-stream.uniform());
+            case generators::weight_distribution::constant:
+                return 1;
+            case generators::weight_distribution::uniform:
+            default:
+                return 1 - stream.uniform(); // (0, 1] so no edge has a zero weight
+        }
+    }
+
+    // Concatenates the edges generated by each block (in block order), draws their weights in parallel and bulk inserts them
+    void emit_edges(edgelist &edgelist, std::vector<std::vector<edge>> &block_edges, uint64_t SEED, generators::weight_distribution WEIGHTS){
+        std::vector<size_t> block_offsets(block_edges.size() + 1, 0);
+        for (size_t block = 0; block < block_edges.size(); block++){
+            block_offsets[block+1] = block_offsets[block] + block_edges[block].size();
+        }
+        std::vector<edge> edges(block_offsets.back());
+        #pragma omp parallel for schedule(dynamic)
+        for (size_t block = 0; block < block_edges.size(); block++){
+            std::copy(block_edges[block].begin(), block_edges[block].end(), edges.begin() + block_offsets[block]);
+            std::vector<edge>().swap(block_edges[block]);
+        }
+
+        // The weight of the i-th edge only depends on (SEED, i)
+        #pragma omp parallel for schedule(static)
+        for (size_t i = 0; i < edges.size(); i++){
+            rng::counter_rng stream(SEED ^ WEIGHT_STREAM_SALT, i);
+            edges[i].weight = draw_weight(stream, WEIGHTS);
+        }
+
+        edgelist.set_directional(false);
+        edgelist.insert_edges(edges);
+    }
+
+    // First item of the given block when COUNT items are split into WORK_BLOCKS contiguous blocks
+    long long block_start(int block, long long COUNT){
+        return COUNT * block / WORK_BLOCKS;
+    }
+}
+
+generators::weight_distribution generators::parse_weight_distribution(std::string name){
+    if (name.compare("uniform") == 0){
+        return weight_distribution::uniform;
+    } else if (name.compare("exponential") == 0){
+        return weight_distribution::exponential;
+    } else if (name.compare("constant") == 0){
+        return weight_distribution::constant;
+    }
+    std::cerr << "ERROR: Invalid weight distribution " << name << ". Please pick uniform, exponential or constant.\n";
+    exit(1);
+}
+
+void generators::erdos_renyi(edgelist &edgelist, int SIZE, long long EDGES, uint64_t SEED, weight_distribution WEIGHTS){
+    const long long MAX_EDGES = (long long) SIZE * (SIZE - 1) / 2;
+    if (SIZE < 2 || EDGES < 0 || EDGES > MAX_EDGES){
+        std::cerr << "ERROR: Invalid Erdos-Renyi parameters. EDGES must be between 0 and SIZE*(SIZE-1)/2.\n";
+        exit(1);
+    }
+    // Unordered pairs are encoded as min*SIZE+max so duplicates can be removed by sorting
+    auto draw_pair = [SIZE](rng::counter_rng &stream){
+        uint64_t u, v;
+        do {
+            u = stream.below(SIZE);
+            v = stream.below(SIZE);
+        } while (u == v);
+        return std::min(u, v) * SIZE + std::max(u, v);
+    };
+
+    // Every block draws its share of the candidate pairs from its own stream
+    std::vector<std::vector<uint64_t>> block_pairs(WORK_BLOCKS);
+    #pragma omp parallel for schedule(dynamic)
+    for (int block = 0; block < WORK_BLOCKS; block++){
+        rng::counter_rng stream(SEED, block);
+        long long count = block_start(block + 1, EDGES) - block_start(block, EDGES);
+        block_pairs[block].reserve(count);
+        for (long long i = 0; i < count; i++){
+            block_pairs[block].push_back(draw_pair(stream));
+        }
+    }
+    std::vector<uint64_t> pairs;
+    pairs.reserve(EDGES);
+    for (std::vector<uint64_t> &block : block_pairs){
+        pairs.insert(pairs.end(), block.begin(), block.end());
+        std::vector<uint64_t>().swap(block);
+    }
+    std::sort(pairs.begin(), pairs.end());
+    pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+
+    // Replace the duplicates serially from a dedicated stream until there are EDGES distinct pairs
+    rng::counter_rng top_up_stream(SEED, WORK_BLOCKS);
+    while ((long long) pairs.size() < EDGES){
+        size_t deficit = EDGES - pairs.size();
+        for (size_t i = 0; i < deficit; i++){
+            pairs.push_back(draw_pair(top_up_stream));
+        }
+        std::sort(pairs.begin(), pairs.end());
+        pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+    }
+
+    std::vector<std::vector<edge>> block_edges(1);
+    block_edges[0].resize(pairs.size());
+    #pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < pairs.size(); i++){
+        block_edges[0][i] = {.src = int(pairs[i] / SIZE), .dest = int(pairs[i] % SIZE), .weight = 0};
+    }
+    emit_edges(edgelist, block_edges, SEED, WEIGHTS);
+}
+
+void generators::barabasi_albert(edgelist &edgelist, int SIZE, int EDGES_PER_VERTEX, uint64_t SEED, weight_distribution WEIGHTS){
+    if (EDGES_PER_VERTEX < 1 || SIZE <= EDGES_PER_VERTEX){
+        std::cerr << "ERROR: Invalid Barabasi-Albert parameters. Requires 0 < EDGES_PER_VERTEX < SIZE.\n";
+        exit(1);
+    }
+    const int CLIQUE_SIZE = EDGES_PER_VERTEX + 1;
+    std::vector<std::vector<edge>> block_edges(1);
+    std::vector<edge> &edges = block_edges[0];
+    edges.reserve((size_t) CLIQUE_SIZE * EDGES_PER_VERTEX / 2 + (size_t) (SIZE - CLIQUE_SIZE) * EDGES_PER_VERTEX);
+    // Every edge endpoint is recorded once, so drawing a uniform entry picks a vertex proportionally to its degree
+    std::vector<int> endpoints;
+    endpoints.reserve(edges.capacity() * 2);
+
+    for (int u = 0; u < CLIQUE_SIZE; u++){
+        for (int v = u + 1; v < CLIQUE_SIZE; v++){
+            edges.push_back({.src = u, .dest = v, .weight = 0});
+            endpoints.push_back(u);
+            endpoints.push_back(v);
+        }
+    }
+
+    rng::counter_rng stream(SEED, 0);
+    std::vector<int> targets;
+    for (int v = CLIQUE_SIZE; v < SIZE; v++){
+        targets.clear();
+        size_t existing_endpoints = endpoints.size();
+        while ((int) targets.size() < EDGES_PER_VERTEX){
+            int target = endpoints[stream.below(existing_endpoints)];
+            if (std::find(targets.begin(), targets.end(), target) == targets.end()){
+                targets.push_back(target);
+            }
+        }
+        for (int target : targets){
+            edges.push_back({.src = target, .dest = v, .weight = 0});
+            endpoints.push_back(target);
+            endpoints.push_back(v);
+        }
+    }
+    emit_edges(edgelist, block_edges, SEED, WEIGHTS);
+}
+
+void generators::chung_lu(edgelist &edgelist, int SIZE, double AVG_DEG, double EXPONENT, uint64_t SEED, weight_distribution WEIGHTS){
+    if (SIZE < 2 || AVG_DEG <= 0 || EXPONENT <= 2){
+        std::cerr << "ERROR: Invalid Chung-Lu parameters. Requires SIZE > 1, AVG_DEG > 0 and EXPONENT > 2.\n";
+        exit(1);
+    }
+    // Power law expected degrees, already in decreasing order: w_i proportional to (i+1)^(-1/(EXPONENT-1)), scaled to the requested average
+    std::vector<double> expected_degree(SIZE);
+    double total = 0;
+    for (int i = 0; i < SIZE; i++){
+        expected_degree[i] = std::pow(i + 1.0, -1.0 / (EXPONENT - 1));
+        total += expected_degree[i];
+    }
+    const double SCALE = AVG_DEG * SIZE / total;
+    for (double &degree : expected_degree){
+        degree *= SCALE;
+    }
+    const double DEGREE_SUM = AVG_DEG * SIZE;
+
+    std::vector<std::vector<edge>> block_edges(WORK_BLOCKS);
+    #pragma omp parallel for schedule(dynamic)
+    for (int block = 0; block < WORK_BLOCKS; block++){
+        for (int u = block_start(block, SIZE); u < block_start(block + 1, SIZE); u++){
+            rng::counter_rng stream(SEED, u);
+            // Skip over the candidates v > u geometrically using p, an upper bound of the edge probabilities still ahead (degrees are decreasing)
+            int v = u + 1;
+            double p = std::min(expected_degree[u] * expected_degree[v % SIZE] / DEGREE_SUM, 1.0);
+            while (v < SIZE && p > 0){
+                if (p != 1){
+                    double r = 1 - stream.uniform();
+                    double skip = std::floor(std::log(r) / std::log1p(-p));
+                    if (skip >= SIZE - v){
+                        break;
+                    }
+                    v += (int) skip;
+                }
+                double q = std::min(expected_degree[u] * expected_degree[v] / DEGREE_SUM, 1.0);
+                if (stream.uniform() < q / p){
+                    block_edges[block].push_back({.src = u, .dest = v, .weight = 0});
+                }
+                p = q;
+                v++;
+            }
+        }
+    }
+    emit_edges(edgelist, block_edges, SEED, WEIGHTS);
+}
+
+void generators::random_geometric(edgelist &edgelist, int SIZE, double RADIUS, uint64_t SEED, weight_distribution WEIGHTS){
+    if (SIZE < 2 || RADIUS <= 0 || RADIUS > 1){
+        std::cerr << "ERROR: Invalid random geometric parameters. Requires SIZE > 1 and 0 < RADIUS <= 1.\n";
+        exit(1);
+    }
+    // The position of vertex i only depends on (SEED, i)
+    std::vector<double> x(SIZE);
+    std::vector<double> y(SIZE);
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < SIZE; i++){
+        rng::counter_rng stream(SEED, i);
+        x[i] = stream.uniform();
+        y[i] = stream.uniform();
+    }
+
+    // Bucket the vertices into a grid of cells with sides of at least RADIUS (counting sort, so cell contents are in vertex order)
+    const int CELLS_PER_SIDE = std::max(1, std::min((int) (1 / RADIUS), (int) std::sqrt((double) SIZE) + 1));
+    auto cell_of = [CELLS_PER_SIDE](double coordinate){
+        return std::min((int) (coordinate * CELLS_PER_SIDE), CELLS_PER_SIDE - 1);
+    };
+    std::vector<int> cell_offsets((size_t) CELLS_PER_SIDE * CELLS_PER_SIDE + 1, 0);
+    for (int i = 0; i < SIZE; i++){
+        cell_offsets[(size_t) cell_of(y[i]) * CELLS_PER_SIDE + cell_of(x[i]) + 1]++;
+    }
+    for (size_t cell = 1; cell < cell_offsets.size(); cell++){
+        cell_offsets[cell] += cell_offsets[cell-1];
+    }
+    std::vector<int> cell_vertices(SIZE);
+    std::vector<int> cell_fill(cell_offsets.begin(), cell_offsets.end() - 1);
+    for (int i = 0; i < SIZE; i++){
+        cell_vertices[cell_fill[(size_t) cell_of(y[i]) * CELLS_PER_SIDE + cell_of(x[i])]++] = i;
+    }
+
+    const double RADIUS_SQUARED = RADIUS * RADIUS;
+    std::vector<std::vector<edge>> block_edges(WORK_BLOCKS);
+    #pragma omp parallel for schedule(dynamic)
+    for (int block = 0; block < WORK_BLOCKS; block++){
+        for (int u = block_start(block, SIZE); u < block_start(block + 1, SIZE); u++){
+            int cell_x = cell_of(x[u]);
+            int cell_y = cell_of(y[u]);
+            // Scan the 3x3 cells around the vertex, keeping each pair once (u < v)
+            for (int neighbor_y = std::max(0, cell_y - 1); neighbor_y <= std::min(CELLS_PER_SIDE - 1, cell_y + 1); neighbor_y++){
+                for (int neighbor_x = std::max(0, cell_x - 1); neighbor_x <= std::min(CELLS_PER_SIDE - 1, cell_x + 1); neighbor_x++){
+                    size_t cell = (size_t) neighbor_y * CELLS_PER_SIDE + neighbor_x;
+                    for (int i = cell_offsets[cell]; i < cell_offsets[cell+1]; i++){
+                        int v = cell_vertices[i];
+                        double dx = x[u] - x[v];
+                        double dy = y[u] - y[v];
+                        if (v > u && dx * dx + dy * dy < RADIUS_SQUARED){
+                            block_edges[block].push_back({.src = u, .dest = v, .weight = 0});
+                        }
+                    }
+                }
+            }
+        }
+    }
+    emit_edges(edgelist, block_edges, SEED, WEIGHTS);
+}
+
+void generators::lattice_2d(edgelist &edgelist, int ROWS, int COLS, bool PERIODIC, uint64_t SEED, weight_distribution WEIGHTS){
+    if (ROWS < 1 || COLS < 1 || (long long) ROWS * COLS < 2){
+        std::cerr << "ERROR: Invalid lattice parameters. Requires at least 2 vertices.\n";
+        exit(1);
+    }
+    // Wrapping a side of length 2 or less would duplicate an existing edge
+    const bool WRAP_COLS = PERIODIC && COLS > 2;
+    const bool WRAP_ROWS = PERIODIC && ROWS > 2;
+
+    std::vector<std::vector<edge>> block_edges(WORK_BLOCKS);
+    #pragma omp parallel for schedule(dynamic)
+    for (int block = 0; block < WORK_BLOCKS; block++){
+        for (int row = block_start(block, ROWS); row < block_start(block + 1, ROWS); row++){
+            for (int col = 0; col < COLS; col++){
+                int vertex = row * COLS + col;
+                if (col + 1 < COLS || WRAP_COLS){
+                    block_edges[block].push_back({.src = vertex, .dest = row * COLS + (col + 1) % COLS, .weight = 0});
+                }
+                if (row + 1 < ROWS || WRAP_ROWS){
+                    block_edges[block].push_back({.src = vertex, .dest = ((row + 1) % ROWS) * COLS + col, .weight = 0});
+                }
+            }
+        }
+    }
+    emit_edges(edgelist, block_edges, SEED, WEIGHTS);
+}
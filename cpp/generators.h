@@ -0,0 +1,84 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+#include "edgelist.h"
+
+/**
+ * Seeded synthetic network generators for scaling studies.
+ * Every generator draws from counter-based random streams tied to fixed blocks of work (not to threads), generates the blocks in parallel
+ * and bulk inserts the resulting edges, so the same seed always generates the same network regardless of the thread count.
+ * All generated networks are undirected.
+*/
+namespace generators {
+    // Distribution the edge weights of a generated network are drawn from
+    enum class weight_distribution {
+        uniform,     // Uniform in (0, 1]
+        exponential, // Exponential with mean 1
+        constant     // Every weight is 1 (unweighted network)
+    };
+
+    /**
+     * Parses the name of a weight distribution ("uniform", "exponential" or "constant")
+     * @param name The name of the distribution
+     * @return The weight distribution, exits if the name is unknown
+    */
+    weight_distribution parse_weight_distribution(std::string name);
+
+    /**
+     * Generates an Erdos-Renyi G(n,m) network: m distinct edges chosen uniformly among all vertex pairs
+     * @param edgelist The edgelist (presumed empty) the network is generated into
+     * @param SIZE The vertex count n
+     * @param EDGES The edge count m (at most n(n-1)/2)
+     * @param SEED The seed of the random streams
+     * @param WEIGHTS The distribution of the edge weights
+    */
+    void erdos_renyi(edgelist &edgelist, int SIZE, long long EDGES, uint64_t SEED, weight_distribution WEIGHTS);
+
+    /**
+     * Generates a Barabasi-Albert preferential attachment network. Starts from a clique of EDGES_PER_VERTEX+1 vertices,
+     * every later vertex attaches to EDGES_PER_VERTEX distinct existing vertices chosen proportionally to their degree.
+     * Attachment is inherently sequential, so only the weights are drawn in parallel (use chung_lu for a parallel heavy-tailed network).
+     * @param edgelist The edgelist (presumed empty) the network is generated into
+     * @param SIZE The vertex count
+     * @param EDGES_PER_VERTEX The number of edges each new vertex attaches with
+     * @param SEED The seed of the random streams
+     * @param WEIGHTS The distribution of the edge weights
+    */
+    void barabasi_albert(edgelist &edgelist, int SIZE, int EDGES_PER_VERTEX, uint64_t SEED, weight_distribution WEIGHTS);
+
+    /**
+     * Generates a Chung-Lu network with a power law expected degree sequence: edge (u,v) exists with probability min(1, w_u*w_v/sum(w)).
+     * Uses the O(n+m) skipping algorithm of Miller & Hagberg with the vertices ordered by decreasing expected degree.
+     * @param edgelist The edgelist (presumed empty) the network is generated into
+     * @param SIZE The vertex count
+     * @param AVG_DEG The expected average degree
+     * @param EXPONENT The power law exponent of the degree distribution (> 2)
+     * @param SEED The seed of the random streams
+     * @param WEIGHTS The distribution of the edge weights
+    */
+    void chung_lu(edgelist &edgelist, int SIZE, double AVG_DEG, double EXPONENT, uint64_t SEED, weight_distribution WEIGHTS);
+
+    /**
+     * Generates a random geometric network: vertices are uniform random points in the unit square, connected when closer than RADIUS.
+     * Neighbors are found with a grid of RADIUS sized cells.
+     * @param edgelist The edgelist (presumed empty) the network is generated into
+     * @param SIZE The vertex count
+     * @param RADIUS The connection radius (0 < RADIUS <= 1)
+     * @param SEED The seed of the random streams
+     * @param WEIGHTS The distribution of the edge weights
+    */
+    void random_geometric(edgelist &edgelist, int SIZE, double RADIUS, uint64_t SEED, weight_distribution WEIGHTS);
+
+    /**
+     * Generates a ROWS x COLS 2D grid lattice (vertex r*COLS+c is connected to its right and lower neighbor)
+     * @param edgelist The edgelist (presumed empty) the network is generated into
+     * @param ROWS The number of rows
+     * @param COLS The number of columns
+     * @param PERIODIC Whether if the lattice wraps around (torus)
+     * @param SEED The seed of the random streams
+     * @param WEIGHTS The distribution of the edge weights
+    */
+    void lattice_2d(edgelist &edgelist, int ROWS, int COLS, bool PERIODIC, uint64_t SEED, weight_distribution WEIGHTS);
+};
@@ -0,0 +1,179 @@
+#include <map>
+#include <vector>
+#include <string>
+#include <mutex>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+
+#include "instrument.h"
+#include "memory_accounting.h"
+
+#ifdef _INSTRUMENT
+namespace {
+    // Counters of one thread, on their own cache lines so threads never write to the same line
+    struct alignas(64) thread_counters {
+        instrument::kernel_counters kernels[instrument::KERNEL_COUNT];
+
+        thread_counters();
+        ~thread_counters();
+    };
+
+    // Totals of one phase name
+    struct phase_totals {
+        uint64_t calls = 0;
+        double seconds = 0;
+        // Largest peak resident set size of a call
+        uint64_t peak_rss_bytes = 0;
+    };
+
+    // Guards the registry of live thread counters, the retired totals and the phases
+    std::mutex RegistryMutex;
+    std::vector<thread_counters*> LiveThreads;
+    // Counters of the threads that already exited
+    instrument::kernel_counters Retired[instrument::KERNEL_COUNT];
+    // Phases in the order they first ended
+    std::vector<std::pair<std::string, phase_totals>> Phases;
+    // Peak resident set size read before each reset of the peak, so phases around nested phases still see the peaks of their inner phases
+    std::vector<uint64_t> PeaksBeforeReset;
+    std::string DumpFilepath;
+
+    // Adds the counters of a thread or search to a total
+    void merge(instrument::kernel_counters &total, const instrument::kernel_counters &counts){
+        total.searches += counts.searches;
+        total.vertices_popped += counts.vertices_popped;
+        total.re_expansions += counts.re_expansions;
+        total.edges_relaxed += counts.edges_relaxed;
+        total.successful_relaxations += counts.successful_relaxations;
+        if (counts.max_frontier > total.max_frontier){
+            total.max_frontier = counts.max_frontier;
+        }
+        for (int bucket = 0; bucket < instrument::HISTOGRAM_BUCKETS; bucket++){
+            total.neighborhood_histogram[bucket] += counts.neighborhood_histogram[bucket];
+        }
+    }
+
+    thread_counters::thread_counters(){
+        std::lock_guard<std::mutex> lock(RegistryMutex);
+        LiveThreads.push_back(this);
+    }
+
+    thread_counters::~thread_counters(){
+        std::lock_guard<std::mutex> lock(RegistryMutex);
+        for (int kernel = 0; kernel < instrument::KERNEL_COUNT; kernel++){
+            merge(Retired[kernel], this->kernels[kernel]);
+        }
+        for (size_t i = 0; i < LiveThreads.size(); i++){
+            if (LiveThreads[i] == this){
+                LiveThreads.erase(LiveThreads.begin() + i);
+                break;
+            }
+        }
+    }
+
+    thread_local thread_counters ThreadCounters;
+
+    const char* kernel_name(int kernel){
+        switch (kernel){
+            case instrument::geodesic_k: return "geodesic_k";
+            case instrument::geodesic_tau: return "geodesic_tau";
+            default: return "n_tilda";
+        }
+    }
+
+    // Writes the summed counters and the phases to DumpFilepath
+    void dump(){
+        std::lock_guard<std::mutex> lock(RegistryMutex);
+        instrument::kernel_counters totals[instrument::KERNEL_COUNT];
+        for (int kernel = 0; kernel < instrument::KERNEL_COUNT; kernel++){
+            totals[kernel] = Retired[kernel];
+            // The OpenMP threads are still alive (and idle) at exit
+            for (thread_counters *thread : LiveThreads){
+                merge(totals[kernel], thread->kernels[kernel]);
+            }
+        }
+
+        std::ofstream file(DumpFilepath);
+        if (!file.is_open()){
+            std::cerr << "ERROR: Could not write the instrumentation to " << DumpFilepath << ".\n";
+            return;
+        }
+        file << std::setprecision(9);
+        file << "{\n\"phases\": [";
+        for (size_t i = 0; i < Phases.size(); i++){
+            file << (i ? ",\n" : "\n") << "  {\"name\": \"" << Phases[i].first << "\", \"calls\": " << Phases[i].second.calls
+                << ", \"seconds\": " << Phases[i].second.seconds
+                << ", \"peak_rss_bytes\": " << Phases[i].second.peak_rss_bytes << "}";
+        }
+        file << "\n],\n\"kernels\": [";
+        for (int kernel = 0; kernel < instrument::KERNEL_COUNT; kernel++){
+            const instrument::kernel_counters &total = totals[kernel];
+            file << (kernel ? ",\n" : "\n") << "  {\"name\": \"" << kernel_name(kernel) << "\", \"searches\": " << total.searches
+                << ", \"vertices_popped\": " << total.vertices_popped << ", \"re_expansions\": " << total.re_expansions
+                << ", \"edges_relaxed\": " << total.edges_relaxed << ", \"successful_relaxations\": " << total.successful_relaxations
+                << ", \"max_frontier\": " << total.max_frontier << ", \"neighborhood_histogram\": [";
+            bool first = true;
+            for (int bucket = 0; bucket < instrument::HISTOGRAM_BUCKETS; bucket++){
+                if (total.neighborhood_histogram[bucket] == 0){
+                    continue;
+                }
+                file << (first ? "" : ", ") << "{\"min_size\": " << (bucket ? (1ULL << bucket) : 0) << ", \"searches\": " << total.neighborhood_histogram[bucket] << "}";
+                first = false;
+            }
+            file << "]}";
+        }
+        file << "\n]\n}\n";
+    }
+}
+
+void instrument::add_search(instrument::kernel KERNEL, const instrument::kernel_counters &counts){
+    merge(ThreadCounters.kernels[KERNEL], counts);
+}
+
+size_t instrument::start_phase(){
+    std::lock_guard<std::mutex> lock(RegistryMutex);
+    PeaksBeforeReset.push_back(memory::peak_rss_bytes());
+    memory::reset_peak_rss();
+    return PeaksBeforeReset.size();
+}
+
+void instrument::add_phase(const char *name, double seconds, size_t mark){
+    std::lock_guard<std::mutex> lock(RegistryMutex);
+    // The peak since the phase started is the current peak or a peak read at a reset after it started
+    uint64_t peak_rss = memory::peak_rss_bytes();
+    for (size_t i = mark; i < PeaksBeforeReset.size(); i++){
+        if (PeaksBeforeReset[i] > peak_rss){
+            peak_rss = PeaksBeforeReset[i];
+        }
+    }
+    for (std::pair<std::string, phase_totals> &phase : Phases){
+        if (phase.first == name){
+            phase.second.calls++;
+            phase.second.seconds += seconds;
+            if (peak_rss > phase.second.peak_rss_bytes){
+                phase.second.peak_rss_bytes = peak_rss;
+            }
+            return;
+        }
+    }
+    Phases.push_back({name, {1, seconds, peak_rss}});
+}
+
+void instrument::dump_at_exit(std::string filepath){
+    std::lock_guard<std::mutex> lock(RegistryMutex);
+    if (DumpFilepath.empty()){
+        std::atexit(dump);
+    }
+    DumpFilepath = filepath;
+}
+#else
+void instrument::dump_at_exit(std::string){
+}
+#endif
+
+void instrument::configure(std::map<std::string, std::string> &flags){
+    #ifdef _INSTRUMENT
+    instrument::dump_at_exit(flags.count("instrument-output") ? flags["instrument-output"] : "instrument.json");
+    #endif
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+
+/**
+ * Instrumentation of the traversal kernels and the pipeline stages, compiled in with -D_INSTRUMENT (make instrument).
+ * Without _INSTRUMENT every probe and timer is an empty inline call, so the kernels compile to the same code as before.
+ * Counters are kept per thread (each search adds its counts to its thread's counters once it ends) and summed when dumped as JSON at exit.
+*/
+namespace instrument {
+    // The traversal kernels counted separately
+    enum kernel {
+        geodesic_k,   // geodesic_distance_k (edgelist and compact graph)
+        geodesic_tau, // geodesic_distance_tau (edgelist and compact graph)
+        n_tilda,      // n_tilda_gamma_neighborhood and n_tilda_gamma_neighborhood_size
+        KERNEL_COUNT
+    };
+
+    // Number of buckets of the neighborhood size histogram, bucket b counts sizes in [2^b, 2^(b+1))
+    const int HISTOGRAM_BUCKETS = 64;
+
+    // Counters of one kernel
+    struct kernel_counters {
+        uint64_t searches = 0;
+        // Vertices taken from the frontier
+        uint64_t vertices_popped = 0;
+        // Pops beyond the first of each reached vertex
+        uint64_t re_expansions = 0;
+        // Edges tested from the popped vertices
+        uint64_t edges_relaxed = 0;
+        // Tested edges that shortened the distance to their destination
+        uint64_t successful_relaxations = 0;
+        // Largest number of vertices waiting in the frontier
+        uint64_t max_frontier = 0;
+        // Number of searches by the count of vertices they reached
+        uint64_t neighborhood_histogram[HISTOGRAM_BUCKETS] = {};
+    };
+
+    /**
+     * Writes the counters and phase timings as JSON when the program exits. Does nothing without _INSTRUMENT.
+     * @param filepath The filepath of the JSON file (overwritten if it exists)
+    */
+    void dump_at_exit(std::string filepath = "instrument.json");
+
+    /**
+     * Calls dump_at_exit with the --instrument-output=FILE flag (instrument.json if not given). Does nothing without _INSTRUMENT.
+     * @param flags The flags given on the command line
+    */
+    void configure(std::map<std::string, std::string> &flags);
+
+    #ifdef _INSTRUMENT
+    /**
+     * Adds the counts of a search to the calling thread's counters
+     * @param KERNEL The kernel of the search
+     * @param counts The counts of the search
+    */
+    void add_search(kernel KERNEL, const kernel_counters &counts);
+
+    /**
+     * Starts tracking the peak resident set size of a phase
+     * @return The mark to give to add_phase when the phase ends
+    */
+    size_t start_phase();
+
+    /**
+     * Adds the time and peak resident set size of a phase to the totals of its name
+     * @param name The name of the phase
+     * @param seconds The wall clock seconds of the phase
+     * @param mark The mark from start_phase when the phase started
+    */
+    void add_phase(const char *name, double seconds, size_t mark);
+
+    // Counts the work of one search, declared at the start of the search and finished with the number of vertices it reached
+    class search_probe {
+        public:
+            search_probe(kernel KERNEL) : KERNEL(KERNEL) {}
+
+            // A vertex was taken from the frontier, its edges are tested next
+            void pop(int64_t edges){
+                this->counts.vertices_popped++;
+                this->counts.edges_relaxed += edges;
+            }
+
+            // A tested edge shortened the distance to its destination
+            void relaxation(){
+                this->counts.successful_relaxations++;
+            }
+
+            // The frontier holds the given number of vertices
+            void frontier(size_t size){
+                if (size > this->counts.max_frontier){
+                    this->counts.max_frontier = size;
+                }
+            }
+
+            // The search ended having reached the given number of vertices
+            void finish(size_t reached){
+                this->counts.searches = 1;
+                this->counts.re_expansions = this->counts.vertices_popped > reached ? this->counts.vertices_popped - reached : 0;
+                int bucket = 0;
+                while (bucket + 1 < HISTOGRAM_BUCKETS && (reached >> (bucket + 1)) != 0){
+                    bucket++;
+                }
+                this->counts.neighborhood_histogram[bucket] = 1;
+                add_search(this->KERNEL, this->counts);
+            }
+
+        private:
+            kernel KERNEL;
+            kernel_counters counts;
+    };
+
+    // Times the enclosing scope (or until stop) as a phase of the given name
+    class phase_timer {
+        public:
+            phase_timer(const char *name) : name(name), mark(start_phase()), start(std::chrono::steady_clock::now()) {}
+
+            ~phase_timer(){
+                stop();
+            }
+
+            // Ends the phase before the end of the scope
+            void stop(){
+                if (this->name != nullptr){
+                    add_phase(this->name, std::chrono::duration<double>(std::chrono::steady_clock::now() - this->start).count(), this->mark);
+                    this->name = nullptr;
+                }
+            }
+
+        private:
+            const char *name;
+            size_t mark;
+            std::chrono::steady_clock::time_point start;
+    };
+    #else
+    class search_probe {
+        public:
+            search_probe(kernel){}
+            void pop(int64_t){}
+            void relaxation(){}
+            void frontier(size_t){}
+            void finish(size_t){}
+    };
+
+    class phase_timer {
+        public:
+            phase_timer(const char*){}
+            void stop(){}
+    };
+    #endif
+};
@@ -6,10 +6,34 @@
 #include <string>
 #include <assert.h>
 #include <random>
+#include <algorithm>
+#include <cstring>
+#include <set>
+#include <fstream>
+#include <unistd.h>
 
 #include "edgelist.h"
 #include "utils.h"
 #include "network_metrics.h"
+#include "derived_cache.h"
+#include "generators.h"
+#include "compact_graph.h"
+#include "placement.h"
+#include "funcs.h"
+#include "rng.h"
+#include "query_server.h"
+#include "instrument.h"
+#include "memory_accounting.h"
+#include "checkpoint.h"
+#include "text_output.h"
+#include "sssp.h"
+#include "ch_index.h"
+#include "anf.h"
+#include "sampling.h"
+#include "distance_histogram.h"
+#include "reduction.h"
+#include "twins.h"
+#include "reorder.h"
 
 /* 
 Manual test network:
@@ -52,8 +76,12 @@ void manual_test_network(edgelist &edgelist){
  * @param FILEPATH The path to the file storing the edgelist in the format of "src dest [weight]" each line
  * @param WEIGHTED Whether if the network in the edgelist file is weighted
  * @param DIRECTED Whether if the network in the edgelist is directed
+ * @param CHECKPOINT_FILEPATH The filepath the progress within each L is checkpointed to (not checkpointed if empty)
+ * @param RESUME Whether to skip the L already saved under the ID and resume the first remaining L from its checkpoint
+ * @param PLAN The sampling plan, when enabled each average is estimated from a sample of the sources (not checkpointed) and saved with its confidence interval
+ * @param TWINS Whether each twin class (with the same MU) is searched once per L, the classes being found once for every L
 */
-void process_network_l_neighborhood_reduction(std::string ID, std::string FILEPATH, bool WEIGHTED, bool DIRECTED){
+void process_network_l_neighborhood_reduction(std::string ID, std::string FILEPATH, bool WEIGHTED, bool DIRECTED, std::string CHECKPOINT_FILEPATH = "", bool RESUME = false, sampling::plan PLAN = sampling::plan(), bool TWINS = false){
     // Initialize database
     sqlite3 *db;
     if (sqlite3_open("results.db", &db)) {
@@ -71,20 +99,57 @@ void process_network_l_neighborhood_reduction(std::string ID, std::string FILEPA
         sqlite3_free(zErrMsg);
         exit(1);
     }
+    sampling::add_estimate_columns(db, "L_neighborhood_reduction_average");
 
     // load file
     std::cout << ID <<";" << FILEPATH << ";"<< std::to_string(WEIGHTED) << ";"<< std::to_string(DIRECTED) << "\n";
-    edgelist a_edgelist = edgelist_from_file(WEIGHTED, FILEPATH);
-    a_edgelist.set_directional(DIRECTED);
-    edgelist neg_laplacian = a_edgelist.take_neg_laplacian();
-    edgelist g_edgelist = neg_laplacian.neg_laplacian_to_g();
+    edgelist neg_laplacian;
+    edgelist g_edgelist;
+    metrics::laplacian_stats stats;
+    derived_cache::load_or_derive(FILEPATH, WEIGHTED, DIRECTED, neg_laplacian, g_edgelist, stats);
     //std::cout << neg_laplacian.to_string();
 
+    // Every saved L is a completed part of the run
+    std::set<int> saved_L;
+    if (RESUME){
+        sqlite3_stmt *select_stmt;
+        if (sqlite3_prepare_v2(db, "SELECT L FROM L_neighborhood_reduction_average WHERE NET_ID = ?", -1, &select_stmt, NULL) != SQLITE_OK){
+            fprintf(stderr, "Selection SQL error: %s\n", sqlite3_errmsg(db));
+            exit(1);
+        }
+        sqlite3_bind_text(select_stmt, 1, ID.c_str(), -1, SQLITE_TRANSIENT);
+        while (sqlite3_step(select_stmt) == SQLITE_ROW){
+            saved_L.insert(sqlite3_column_int(select_stmt, 0));
+        }
+        sqlite3_finalize(select_stmt);
+    }
+
+    twins::twin_classes classes;
+    if (TWINS){
+        classes = twins::find_twin_classes(compact_graph(g_edgelist, stats.dim + 1), &stats.mu);
+        twins::print_twin_stats(classes);
+    }
+
     // Calculate Avg L Reduction Neighborhood
+    bool resume_L = RESUME;
     for (int L = 1; L <=100; L++){
-        double avg_lnr = metrics::L_neighborhood_reduction_rate_average(neg_laplacian, g_edgelist, L);
-        std::string sql_insert_query = "INSERT INTO L_neighborhood_reduction_average (NET_ID,L,avg_lnr) " \
-        "VALUES ('" + ID + "', " + std::to_string(L) + ", " + std::to_string(avg_lnr) + ")\n";
+        if (saved_L.count(L)){
+            continue;
+        }
+        sampling::estimate avg_lnr;
+        if (PLAN.Enabled){
+            avg_lnr = metrics::L_neighborhood_reduction_rate_average_estimate(g_edgelist, stats, L, PLAN, TWINS ? &classes : nullptr);
+        } else {
+            checkpoint::source_progress progress;
+            if (!CHECKPOINT_FILEPATH.empty()){
+                // Only the first remaining L can have been stopped partway
+                progress = checkpoint::source_progress(CHECKPOINT_FILEPATH, "l_neighborhood_reduction " + ID + " L=" + std::to_string(L) + " file=" + derived_cache::cache_key(FILEPATH, WEIGHTED, DIRECTED), resume_L);
+                resume_L = false;
+            }
+            avg_lnr = sampling::exact(metrics::L_neighborhood_reduction_rate_average(g_edgelist, stats, L, progress, TWINS ? &classes : nullptr), stats.dim + 1);
+        }
+        std::string sql_insert_query = "INSERT INTO L_neighborhood_reduction_average (NET_ID,L,avg_lnr,ci_low,ci_high,sample_size) " \
+        "VALUES ('" + ID + "', " + std::to_string(L) + ", " + std::to_string(avg_lnr.Mean) + ", " + std::to_string(avg_lnr.Low) + ", " + std::to_string(avg_lnr.High) + ", " + std::to_string(avg_lnr.Samples) + ")\n";
 
         if (sqlite3_exec(db, sql_insert_query.c_str(), NULL, 0, &zErrMsg) != SQLITE_OK){
             fprintf(stderr, "Insertion SQL error: %s\n", zErrMsg);
@@ -97,11 +162,12 @@ void process_network_l_neighborhood_reduction(std::string ID, std::string FILEPA
  * Calculates & prints the Gamma Neighborhood S_avg for a given Watts_Strogatz network with the given configuration.
  * @param SIZE The size (vertex count) of the generated network.
  * @param AVG_DEG The average number of edges (undirected network) connected to each vertex in the generated network. Must be even.
- * @param REWIRING_PROB The probability that each edge in the initial network is rewired. Represented as a double between 0 and 1 (inclusive, accurate to 1E-3).
+ * @param REWIRING_PROB The probability that each edge in the initial network is rewired. Represented as a double between 0 and 1 (inclusive).
+ * @param SEED The seed the network is generated with.
 */
-void watts_strogatz_small_world_network_gamma_neighborhood_task(int SIZE, int AVG_DEG, double REWIRING_PROB){
+void watts_strogatz_small_world_network_gamma_neighborhood_task(int SIZE, int AVG_DEG, double REWIRING_PROB, uint64_t SEED){
     edgelist a_edgelist;
-    generate_watts_strogatz_small_world_network(a_edgelist,SIZE,AVG_DEG,REWIRING_PROB);
+    generate_watts_strogatz_small_world_network(a_edgelist,SIZE,AVG_DEG,REWIRING_PROB,SEED);
 
     edgelist neg_laplacian = a_edgelist.take_neg_laplacian();
 
@@ -120,12 +186,13 @@ void watts_strogatz_small_world_network_gamma_neighborhood_task(int SIZE, int AV
  * @param L Neighborhood size L
  * @param SIZE The size (vertex count) of the generated network.
  * @param AVG_DEG The average number of edges (undirected network) connected to each vertex in the generated network. Must be even.
- * @param REWIRING_PROB The probability that each edge in the initial network is rewired. Represented as a double between 0 and 1 (inclusive, accurate to 1E-3).
+ * @param REWIRING_PROB The probability that each edge in the initial network is rewired. Represented as a double between 0 and 1 (inclusive).
+ * @param SEED The seed the network is generated with.
  * @return The reduction average
 */
-double watts_strogatz_small_world_network_L_neighborhood_reduction_avg_task(int L, int SIZE, int AVG_DEG, double REWIRING_PROB){
+double watts_strogatz_small_world_network_L_neighborhood_reduction_avg_task(int L, int SIZE, int AVG_DEG, double REWIRING_PROB, uint64_t SEED){
     edgelist a_edgelist;
-    generate_watts_strogatz_small_world_network(a_edgelist,SIZE,AVG_DEG,REWIRING_PROB);
+    generate_watts_strogatz_small_world_network(a_edgelist,SIZE,AVG_DEG,REWIRING_PROB,SEED);
 
     edgelist neg_laplacian = a_edgelist.take_neg_laplacian();
 
@@ -141,13 +208,499 @@ double watts_strogatz_small_world_network_L_neighborhood_reduction_avg_task(int
     return L_neighborhood_reduction_avg;
 }
 
+// One network of a parameter sweep
+struct sweep_run {
+    int SIZE;
+    int AVG_DEG;
+    double REWIRING_PROB;
+    int REPLICATE;
+    uint64_t SEED;
+};
+
+/**
+ * Derives the seed of one network of a sweep from the sweep seed and the parameters of the network, so a network keeps its seed when the grid is extended.
+ * The seed fits in 63 bits so it can be stored in SQLite and passed back with --seed to regenerate the network.
+ * @param SEED The seed of the sweep
+ * @param SIZE The size (vertex count) of the network
+ * @param AVG_DEG The average degree of the network
+ * @param REWIRING_PROB The rewiring probability of the network
+ * @param REPLICATE The replicate index of the network
+ * @return The seed of the network
+*/
+uint64_t sweep_run_seed(uint64_t SEED, int SIZE, int AVG_DEG, double REWIRING_PROB, int REPLICATE){
+    uint64_t prob_bits;
+    std::memcpy(&prob_bits, &REWIRING_PROB, sizeof(prob_bits));
+    uint64_t stream = rng::mix64(rng::mix64(rng::mix64((uint64_t) SIZE) ^ (uint64_t) AVG_DEG) ^ prob_bits) ^ (uint64_t) REPLICATE;
+    return rng::counter_rng(SEED, stream).next() & INT64_MAX;
+}
+
+/**
+ * Calculates S_avg(Gamma) of Watts Strogatz networks for every combination of the given parameters in one process and saves the results into the sweep_s_avg table of a SQLite3 db.
+ * The w_func table is generated once for all networks, every network is searched over a compact copy of its g_tilda edgelist with per-thread scratch reused across sources,
+ * and all results are inserted with one prepared statement inside a single transaction.
+ * Networks smaller than INNER_PARALLEL_MIN_SIZE are spread over the threads (one network per thread), larger networks are processed one at a time with all threads working on each.
+ * @param SIZES The sizes (vertex count) of the generated networks
+ * @param AVG_DEGS The average degrees of the generated networks. Must be even.
+ * @param REWIRING_PROBS The rewiring probabilities of the generated networks
+ * @param REPLICATES The number of networks generated for each combination of SIZE, AVG_DEG and REWIRING_PROB
+ * @param GAMMAS The values of Gamma S_avg is calculated for on every network
+ * @param SEED The seed of the sweep, each network gets its own seed derived from it
+ * @param OUTPUT_DB The filepath of the SQLite3 db the results are saved into
+ * @param INNER_PARALLEL_MIN_SIZE The smallest network size processed with all threads
+*/
+void watts_strogatz_s_avg_sweep_task(std::vector<int> SIZES, std::vector<int> AVG_DEGS, std::vector<double> REWIRING_PROBS, int REPLICATES, std::vector<double> GAMMAS, uint64_t SEED, std::string OUTPUT_DB, int INNER_PARALLEL_MIN_SIZE){
+    // Enumerate the grid
+    std::vector<sweep_run> runs;
+    for (int SIZE : SIZES){
+        for (int AVG_DEG : AVG_DEGS){
+            for (double REWIRING_PROB : REWIRING_PROBS){
+                if ( !(SIZE > 0 && AVG_DEG > 0 && AVG_DEG % 2 == 0 && REWIRING_PROB >= 0 && REWIRING_PROB <= 1 && AVG_DEG < SIZE && (REWIRING_PROB == 0 || SIZE > 2 * AVG_DEG)) ){
+                    std::cerr << "ERROR: Invalid sweep configuration SIZE=" << SIZE << " AVG_DEG=" << AVG_DEG << " REWIRING_PROB=" << REWIRING_PROB << ".\n";
+                    exit(1);
+                }
+                for (int REPLICATE = 0; REPLICATE < REPLICATES; REPLICATE++){
+                    runs.push_back({SIZE, AVG_DEG, REWIRING_PROB, REPLICATE, sweep_run_seed(SEED, SIZE, AVG_DEG, REWIRING_PROB, REPLICATE)});
+                }
+            }
+        }
+    }
+    for (double GAMMA : GAMMAS){
+        if ( !( GAMMA > 0 && GAMMA < 1) ){
+            std::cerr << "ERROR: Invalid Gamma value given.\n";
+            exit(1);
+        }
+    }
+
+    // Initialize database
+    sqlite3 *db;
+    if (sqlite3_open(OUTPUT_DB.c_str(), &db)) {
+        fprintf(stderr, "Can't open database: %s\n", sqlite3_errmsg(db));
+        exit(1);
+    }
+    std::string sql_create_sweep_table_query = "CREATE TABLE IF NOT EXISTs " \
+      "sweep_s_avg ("  \
+      "SIZE            INT     NOT NULL," \
+      "AVG_DEG         INT     NOT NULL," \
+      "REWIRING_PROB   REAL    NOT NULL," \
+      "REPLICATE       INT     NOT NULL," \
+      "SEED            INT     NOT NULL," \
+      "GAMMA           REAL    NOT NULL," \
+      "avg_s           REAL    NOT NULL);";
+    char *zErrMsg = 0;
+    if( sqlite3_exec(db, sql_create_sweep_table_query.c_str(), NULL, 0, &zErrMsg) != SQLITE_OK ){
+        fprintf(stderr, "Table Creation SQL error: %s\n", zErrMsg);
+        sqlite3_free(zErrMsg);
+        exit(1);
+    }
+    sqlite3_stmt *insert_stmt;
+    if (sqlite3_prepare_v2(db, "INSERT INTO sweep_s_avg (SIZE,AVG_DEG,REWIRING_PROB,REPLICATE,SEED,GAMMA,avg_s) VALUES (?,?,?,?,?,?,?)", -1, &insert_stmt, NULL) != SQLITE_OK){
+        fprintf(stderr, "Insertion SQL error: %s\n", sqlite3_errmsg(db));
+        exit(1);
+    }
+    sqlite3_exec(db, "BEGIN TRANSACTION", NULL, NULL, &zErrMsg);
+
+    // Shared by every network, generated before any thread reads it
+    funcs::w_func(1);
+
+    size_t completed = 0;
+    auto process_run = [&](sweep_run &run){
+        // The derived graphs are dropped as soon as the next one is built to keep concurrent runs small
+        metrics::laplacian_stats stats;
+        compact_graph g_tilda_graph;
+        {
+            edgelist g_edgelist;
+            {
+                edgelist a_edgelist;
+                instrument::phase_timer generate_timer("generate");
+                generate_watts_strogatz_small_world_network(a_edgelist, run.SIZE, run.AVG_DEG, run.REWIRING_PROB, run.SEED);
+                generate_timer.stop();
+                instrument::phase_timer derive_timer("derive");
+                edgelist neg_laplacian = a_edgelist.take_neg_laplacian();
+                a_edgelist = edgelist();
+                stats = metrics::compute_laplacian_stats(neg_laplacian);
+                g_edgelist = neg_laplacian.neg_laplacian_to_g();
+            }
+            instrument::phase_timer compact_timer("compact_graph");
+            g_tilda_graph = compact_graph(g_edgelist, stats.dim + 1);
+        }
+
+        instrument::phase_timer s_avg_timer("s_avg_gamma");
+        std::vector<long double> S_avgs;
+        for (double GAMMA : GAMMAS){
+            S_avgs.push_back(metrics::s_avg_gamma(g_tilda_graph, stats, GAMMA));
+        }
+        s_avg_timer.stop();
+
+        #pragma omp critical(sweep_results)
+        {
+            for (size_t i = 0; i < GAMMAS.size(); i++){
+                sqlite3_bind_int(insert_stmt, 1, run.SIZE);
+                sqlite3_bind_int(insert_stmt, 2, run.AVG_DEG);
+                sqlite3_bind_double(insert_stmt, 3, run.REWIRING_PROB);
+                sqlite3_bind_int(insert_stmt, 4, run.REPLICATE);
+                sqlite3_bind_int64(insert_stmt, 5, (sqlite3_int64) run.SEED);
+                sqlite3_bind_double(insert_stmt, 6, GAMMAS[i]);
+                sqlite3_bind_double(insert_stmt, 7, (double) S_avgs[i]);
+                if (sqlite3_step(insert_stmt) != SQLITE_DONE){
+                    fprintf(stderr, "Insertion SQL error: %s\n", sqlite3_errmsg(db));
+                }
+                sqlite3_reset(insert_stmt);
+            }
+            completed++;
+            std::cout << "Sweep " << completed << "/" << runs.size() << ": SIZE=" << run.SIZE << " AVG_DEG=" << run.AVG_DEG << " REWIRING_PROB=" << run.REWIRING_PROB
+                << " REPLICATE=" << run.REPLICATE << " SEED=" << run.SEED << " S_avg=" << S_avgs[0] << "\n";
+        }
+    };
+
+    // Large networks first, one at a time with every thread working inside the network
+    std::vector<sweep_run> large_runs;
+    std::vector<sweep_run> small_runs;
+    for (sweep_run &run : runs){
+        (run.SIZE >= INNER_PARALLEL_MIN_SIZE ? large_runs : small_runs).push_back(run);
+    }
+    for (sweep_run &run : large_runs){
+        process_run(run);
+    }
+
+    // Then the small networks spread over the threads, largest first so the last ones to finish are short. Nested parallel regions are serialized so each runs on its own thread.
+    std::stable_sort(small_runs.begin(), small_runs.end(), [](const sweep_run &a, const sweep_run &b){
+        return (long long) a.SIZE * a.AVG_DEG > (long long) b.SIZE * b.AVG_DEG;
+    });
+    int max_active_levels = omp_get_max_active_levels();
+    omp_set_max_active_levels(1);
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (size_t i = 0; i < small_runs.size(); i++){
+        process_run(small_runs[i]);
+    }
+    omp_set_max_active_levels(max_active_levels);
+
+    sqlite3_exec(db, "END TRANSACTION", NULL, NULL, &zErrMsg);
+    sqlite3_finalize(insert_stmt);
+    sqlite3_close(db);
+}
+
+/**
+ * Reads the seed of a generated network from the --seed flag, otherwise draws one. The seed is printed so the network can be regenerated.
+ * @param flags The flags given on the command line
+ * @return The seed
+*/
+uint64_t seed_from_flags(std::map<std::string, std::string> &flags){
+    uint64_t SEED;
+    if (flags.count("seed")){
+        try {
+            SEED = std::stoull(flags["seed"]);
+        } catch (...){
+            std::cerr << "ERROR: Invalid --seed value.\n";
+            exit(1);
+        }
+    } else {
+        std::random_device rd;
+        SEED = ((uint64_t) rd() << 32) | rd();
+        // Kept so the checkpoint of the run records the drawn seed
+        flags["seed"] = std::to_string(SEED);
+    }
+    std::cout << "Network seed: " << SEED << "\n";
+    return SEED;
+}
+
+/**
+ * Reads the weight distribution of a generated network from the --weights flag (uniform by default)
+ * @param flags The flags given on the command line
+ * @return The weight distribution
+*/
+generators::weight_distribution weights_from_flags(std::map<std::string, std::string> &flags){
+    if (flags.count("weights")){
+        return generators::parse_weight_distribution(flags["weights"]);
+    }
+    return generators::weight_distribution::uniform;
+}
+
+/**
+ * Plans the distances between every pair of vertices under a memory budget, estimating the results from the searches of up to 16 sources spread over the network.
+ * Caps the OpenMP threads to the sources searched at once, exits if even one source at a time exceeds the budget.
+ * @param edgelist The edgelist searched
+ * @param ACTION The action planned, for the error message
+ * @param BINARY Whether the results are saved in the columnar binary format (which copies every result into its columns)
+ * @param BUDGET The memory budget in bytes
+ * @param search Searches from one source
+ * @param dense_bytes If given, the bytes of the dense all pairs matrices if they can be used (0 otherwise), set to 0 if they do not fit along with every result
+ * @return The plan
+*/
+memory::source_plan plan_dbv(edgelist &edgelist, std::string ACTION, bool BINARY, uint64_t BUDGET, std::function<metrics::distance_to_vertices(int)> search, uint64_t *dense_bytes = nullptr){
+    const int SOURCES = edgelist.max_vertex() + 1;
+    const int SAMPLES = std::min(SOURCES, 16);
+    uint64_t sampled_pairs = 0;
+    uint64_t max_row = 1;
+    for (int sample = 0; sample < SAMPLES; sample++){
+        uint64_t row = search((int) ((int64_t) sample * SOURCES / SAMPLES)).size();
+        sampled_pairs += row;
+        max_row = std::max(max_row, row);
+    }
+    const uint64_t avg_row = SAMPLES > 0 ? (sampled_pairs + SAMPLES - 1) / SAMPLES : 0;
+
+    // A search holds its row and the set of vertices in its frontier, every kept row is a node of the result map
+    // The process already holds the edgelist and its own code and buffers, so what is resident counts when it is more than the edgelist
+    uint64_t fixed_bytes = std::max(edgelist.memory_bytes(), memory::current_rss_bytes());
+    uint64_t per_source_bytes = max_row * (metrics::DTV_ENTRY_BYTES + memory::MAP_NODE_OVERHEAD_BYTES + sizeof(int));
+    uint64_t all_results_bytes = (uint64_t) SOURCES * (avg_row * metrics::DTV_ENTRY_BYTES + memory::MAP_NODE_OVERHEAD_BYTES);
+    if (BINARY){
+        // The source, destination, info and net distance columns
+        all_results_bytes += (uint64_t) SOURCES * avg_row * (3 * sizeof(int32_t) + sizeof(double));
+    }
+    memory::account("edgelist", edgelist.memory_bytes());
+    memory::source_plan plan = memory::plan_sources(BUDGET, fixed_bytes, per_source_bytes, all_results_bytes, SOURCES, omp_get_max_threads());
+    if (dense_bytes != nullptr && *dense_bytes > 0){
+        // The dense matrices give every result at once, so they are planned in only if they fit along with every result kept
+        memory::source_plan dense_plan = memory::plan_sources(BUDGET, fixed_bytes + *dense_bytes, per_source_bytes, all_results_bytes, SOURCES, omp_get_max_threads());
+        if (dense_plan.fits && dense_plan.keep_results){
+            plan = dense_plan;
+        } else {
+            *dense_bytes = 0;
+        }
+    }
+    if (!plan.fits){
+        memory::exit_over_budget(ACTION, plan.estimate_bytes, BUDGET);
+    }
+    std::cout << "Memory plan: " << (plan.keep_results ? "every result kept" : "blocks of " + std::to_string(plan.block_sources) + " sources")
+        << ", " << plan.concurrent_sources << " sources at once, estimated peak " << memory::format_bytes(plan.estimate_bytes) << "\n";
+    omp_set_num_threads(plan.concurrent_sources);
+    return plan;
+}
+
+/**
+ * Prints the distances between every pair of vertices or saves them in the columnar binary format as they are handed on in blocks.
+ * When checkpointed, the number of pairs written is saved after each block and a resumed run continues the columns of the stopped run.
+ * @param BINARY_FILEPATH The filepath of the binary file, the distances are printed if empty (not checkpointed)
+ * @param progress The progress of the sources
+ * @param stream Runs the searches from the given first source, handing each block of results to the given function
+*/
+void write_streamed_dbv(std::string BINARY_FILEPATH, checkpoint::source_progress &progress, std::function<void(int, std::function<void(metrics::distance_btwn_vertices&)>)> stream){
+    if (BINARY_FILEPATH.empty()){
+        stream(0, [](metrics::distance_btwn_vertices &block){
+            metrics::print_distance_to_vertices(block);
+        });
+    } else {
+        std::cout << "Attempting to write distances to binary file.\n";
+        metrics::dbv_binary_writer writer(BINARY_FILEPATH, true, progress.values.empty() ? 0 : std::stoull(progress.values[0]));
+        stream(progress.next_source, [&writer, &progress](metrics::distance_btwn_vertices &block){
+            writer.append(block);
+            if (progress.enabled() && !block.empty()){
+                writer.flush();
+                progress.save(block.rbegin()->first + 1, {std::to_string(writer.pairs())});
+            }
+        });
+        writer.finish();
+        progress.finish();
+    }
+}
+
+/**
+ * Identifies the computation of a command line for its checkpoint: the positional arguments, the flags changing the results (eg. the seed of a generated network)
+ * and the contents of a loaded edgelist file
+ * @param argc The count of positional arguments
+ * @param argv The positional arguments
+ * @param flags The flags given on the command line
+ * @param LOADED_FILEPATH The filepath of the loaded edgelist file, empty if the network was generated
+ * @param LOADED_WEIGHTED If the loaded network is weighted
+ * @param DIRECTED If the network is directed
+ * @return The key of the checkpoint
+*/
+std::string checkpoint_key(int argc, char* argv[], std::map<std::string, std::string> &flags, std::string LOADED_FILEPATH, bool LOADED_WEIGHTED, bool DIRECTED){
+    std::string key;
+    for (int i = 1; i < argc; i++){
+        key += std::string(argv[i]) + " ";
+    }
+    // Flags that only change how the run is carried out are left out, so a resumed run can change them
+    const std::set<std::string> RUN_FLAGS = {"checkpoint", "resume", "checkpoint-interval", "mem-budget", "mem-report", "pin", "numa", "huge-pages", "instrument-output"};
+    for (auto &flag : flags){
+        if (!RUN_FLAGS.count(flag.first)){
+            key += flag.first + "=" + flag.second + " ";
+        }
+    }
+    if (!LOADED_FILEPATH.empty()){
+        key += "file=" + derived_cache::cache_key(LOADED_FILEPATH, LOADED_WEIGHTED, DIRECTED);
+    }
+    return key;
+}
+
+/**
+ * Reads the --undirected-pairs flag, which keeps each unordered pair of an undirected network once (the searches still run in full). Exits if the network is directed.
+ * @param flags The flags given on the command line
+ * @param edgelist The network searched
+ * @return Whether if each unordered pair is kept once
+*/
+bool undirected_pairs_from_flags(std::map<std::string, std::string> &flags, edgelist &edgelist){
+    if (!flags.count("undirected-pairs")){
+        return false;
+    }
+    if (edgelist.is_directional()){
+        std::cerr << "ERROR: --undirected-pairs needs an undirected network.\n";
+        exit(1);
+    }
+    return true;
+}
+
+/**
+ * Reads the --sssp=label|delta flag picking the search of dtv_tau, and the --delta=WIDTH bucket width of delta-stepping. Exits on invalid values.
+ * @param flags The flags given on the command line
+ * @param DELTA Set to the --delta value, or 0 when not given (the average edge weight is used)
+ * @return Whether if delta-stepping was picked
+*/
+bool delta_stepping_from_flags(std::map<std::string, std::string> &flags, double &DELTA){
+    DELTA = 0;
+    if (flags.count("sssp") && flags["sssp"] != "label" && flags["sssp"] != "delta"){
+        std::cerr << "ERROR: Invalid --sssp value " << flags["sssp"] << ". Please pick label or delta.\n";
+        exit(1);
+    }
+    const bool DELTA_STEPPING = flags.count("sssp") && flags["sssp"] == "delta";
+    if (flags.count("delta")){
+        if (!DELTA_STEPPING){
+            std::cerr << "ERROR: --delta needs --sssp=delta.\n";
+            exit(1);
+        }
+        try {
+            DELTA = std::stod(flags["delta"]);
+        } catch (...){
+            DELTA = -1;
+        }
+        if ( !( DELTA > 0 ) ){
+            std::cerr << "ERROR: Invalid --delta value.\n";
+            exit(1);
+        }
+    }
+    return DELTA_STEPPING;
+}
+
+/**
+ * Returns the contraction hierarchy of a network, loaded from the --ch-index=FILE flag when the file holds the hierarchy of the same network,
+ * otherwise built (and saved to the file when the flag is given). Exits if the network has negative edge weights.
+ * @param flags The flags given on the command line
+ * @param edgelist The edgelist of the network
+ * @return The contraction hierarchy
+*/
+ch::contraction_hierarchy hierarchy_from_flags(std::map<std::string, std::string> &flags, edgelist &edgelist){
+    instrument::phase_timer compact_timer("compact_graph");
+    compact_graph graph(edgelist);
+    compact_timer.stop();
+    if (std::any_of(graph.Weights.begin(), graph.Weights.end(), [](double weight){ return weight < 0; })){
+        std::cerr << "ERROR: Contraction hierarchies need non-negative edge weights.\n";
+        exit(1);
+    }
+
+    ch::contraction_hierarchy hierarchy;
+    const std::string index_filepath = flags.count("ch-index") ? flags["ch-index"] : "";
+    if (!index_filepath.empty()){
+        instrument::phase_timer load_timer("load_ch_index");
+        if (hierarchy.load(index_filepath) && hierarchy.GraphFingerprint == ch::fingerprint(graph)){
+            return hierarchy;
+        }
+    }
+
+    std::cout << "Building contraction hierarchy.\n";
+    instrument::phase_timer build_timer("build_ch_index");
+    hierarchy = ch::contraction_hierarchy(graph);
+    build_timer.stop();
+    if (!index_filepath.empty() && !hierarchy.save(index_filepath)){
+        std::cerr << "WARNING: Unable to write contraction hierarchy file " << index_filepath << "\n";
+    }
+    return hierarchy;
+}
+
+/**
+ * Appends the line of a point to point distance, or of an unreachable destination
+ * @param out The text the line is appended to
+ * @param src The vertex that the distance is measured from
+ * @param dest The vertex that the distance is measured to
+ * @param distance The distance between the vertices
+*/
+void append_path_distance(std::string &out, int src, int dest, const ch::path_distance &distance){
+    text_output::append_int(out, src);
+    out += " -> ";
+    text_output::append_int(out, dest);
+    if (distance.net_distance < 0){
+        out += " = UNREACHABLE\n";
+        return;
+    }
+    out += " = INFO:";
+    text_output::append_general(out, distance.info_distance);
+    out += " | NET:";
+    text_output::append_int(out, distance.net_distance);
+    out += "\n";
+}
+
+/**
+ * Reads the --log2-registers=B flag setting the 2^B registers of each counter of the approximate neighborhood function. Exits on invalid values.
+ * @param flags The flags given on the command line
+ * @return The log2 of the registers (anf::DEFAULT_LOG2_REGISTERS when not given)
+*/
+int log2_registers_from_flags(std::map<std::string, std::string> &flags){
+    if (!flags.count("log2-registers")){
+        return anf::DEFAULT_LOG2_REGISTERS;
+    }
+    int LOG2_REGISTERS = -1;
+    try {
+        LOG2_REGISTERS = std::stoi(flags["log2-registers"]);
+    } catch (...){}
+    if ( !( LOG2_REGISTERS >= anf::MIN_LOG2_REGISTERS && LOG2_REGISTERS <= anf::MAX_LOG2_REGISTERS ) ){
+        std::cerr << "ERROR: Invalid --log2-registers value. Please pick a number between " << anf::MIN_LOG2_REGISTERS << " and " << anf::MAX_LOG2_REGISTERS << ".\n";
+        exit(1);
+    }
+    return LOG2_REGISTERS;
+}
+
+/**
+ * Finds the twin classes of a graph for --twins and prints their statistics
+ * @param graph The graph whose sources are searched
+ * @param labels If given, only vertices with the same label can be twins
+ * @return The classes
+*/
+twins::twin_classes twin_classes_of(const compact_graph &graph, const std::vector<double> *labels = nullptr){
+    instrument::phase_timer twins_timer("twin_classes");
+    twins::twin_classes classes = twins::find_twin_classes(graph, labels);
+    twins_timer.stop();
+    twins::print_twin_stats(classes);
+    return classes;
+}
+
+/**
+ * Relabels a graph for --reorder in place and prints "Reordered vertices (method): mean edge span x -> y"
+ * @param graph The graph whose sources are searched, replaced by its relabeled copy
+ * @param METHOD The method
+ * @return The order, mapping the results of the relabeled graph back to the original IDs
+*/
+reorder::vertex_order reorder_graph(compact_graph &graph, reorder::method METHOD){
+    instrument::phase_timer reorder_timer("reorder");
+    reorder::vertex_order order = reorder::find_order(graph, METHOD);
+    const double SPAN_BEFORE = reorder::mean_edge_span(graph);
+    graph = reorder::relabeled(graph, order);
+    reorder_timer.stop();
+    std::cout << "Reordered vertices (" << reorder::method_name(METHOD) << "): mean edge span " << SPAN_BEFORE << " -> " << reorder::mean_edge_span(graph) << "\n";
+    return order;
+}
+
+/**
+ * Reduces a graph for --reduce and prints "Reduced graph: ... kernel vertices with ... edges | ..."
+ * @param graph The graph whose sources are searched, freed once reduced
+ * @return The reduced graph
+*/
+reduction::reduced_graph reduce_graph(compact_graph &graph){
+    instrument::phase_timer reduction_timer("reduce_graph");
+    reduction::reduced_graph reduced(graph);
+    reduction_timer.stop();
+    graph = compact_graph();
+    std::cout << "Reduced graph: " << reduced.kernel_vertices() << " kernel vertices with " << reduced.Offsets.back() << " edges | "
+        << reduced.chain_vertices() << " chain vertices in " << reduced.ChainU.size() << " chains | " << reduced.tree_vertices() << " tree vertices\n";
+    return reduced;
+}
+
 int main(int argc, char* argv[]){
     std::setprecision(10);
-
-    
-    watts_strogatz_small_world_network_gamma_neighborhood_task(8E4, 6, 0.2);
-    return 0;
-    
+    std::map<std::string, std::string> flags = extract_flags(argc, argv);
+    placement::configure(flags);
+    instrument::configure(flags);
+    memory::configure(flags);
+    // Memory budget of the dbv_k, dbv_tau and s_avg actions, 0 if not given
+    const uint64_t MEM_BUDGET = flags.count("mem-budget") ? parse_bytes(flags["mem-budget"]) : 0;
 
     const std::string OUTPUT_DB = "output.db";
     int parsed_args = 0;
@@ -162,8 +715,57 @@ int main(int argc, char* argv[]){
         parsed_args ++;
     }
 
+    // The sweep generates its own networks, so it replaces the edgelist source and action
+    if (dataset_source.compare("sweep_watts_strogatz") == 0){
+        if (argc <= parsed_args + 5) {
+            std::cerr << "Insufficient Arguments To Sweep Watts Strogatz Networks.\n";
+            exit(1);
+        }
+        std::vector<int> SIZES;
+        std::vector<int> AVG_DEGS;
+        for (double size : parse_value_list(argv[parsed_args + 1])){
+            SIZES.push_back((int) size);
+        }
+        for (double avg_deg : parse_value_list(argv[parsed_args + 2])){
+            AVG_DEGS.push_back((int) avg_deg);
+        }
+        std::vector<double> REWIRING_PROBS = parse_value_list(argv[parsed_args + 3]);
+        const int REPLICATES = atoi(argv[parsed_args + 4]);
+        std::vector<double> GAMMAS = parse_value_list(argv[parsed_args + 5]);
+        parsed_args += 5;
+        if ( !(REPLICATES > 0) ){
+            std::cerr << "ERROR: Invalid REPLICATES value.\n";
+            exit(1);
+        }
+
+        const std::string output_db = flags.count("output") ? flags["output"] : "results.db";
+        const int inner_parallel_min_size = flags.count("inner-parallel-min-size") ? std::stoi(flags["inner-parallel-min-size"]) : 20000;
+        std::cout << "Attempting to sweep Watts Strogatz networks.\n";
+        watts_strogatz_s_avg_sweep_task(SIZES, AVG_DEGS, REWIRING_PROBS, REPLICATES, GAMMAS, seed_from_flags(flags), output_db, inner_parallel_min_size);
+        return 0;
+    }
+
+    // The server loads its graphs on request, so it replaces the edgelist source and action
+    if (dataset_source.compare("serve") == 0){
+        const int threads = flags.count("threads") ? std::stoi(flags["threads"]) : omp_get_max_threads();
+        if ( !(threads > 0) ){
+            std::cerr << "ERROR: Invalid --threads value.\n";
+            exit(1);
+        }
+        if (flags.count("socket")){
+            query_server::serve_unix_socket(flags["socket"], threads);
+        } else {
+            query_server::serve_stdin(threads);
+        }
+        return 0;
+    }
+
     // Determine Edgelist Source
     edgelist a_edgelist;
+    // The file the edgelist was loaded from (if any), used to look up its derived graphs in the cache
+    std::string loaded_filepath;
+    bool loaded_weighted = false;
+    instrument::phase_timer source_timer("generate_or_load");
     if (dataset_source.compare("gen_watts_strogatz") == 0){
         if (argc < parsed_args + 3) {
             std::cerr << "Insufficient Arguments To Generate Watts Strogatz Network.\n";
@@ -190,9 +792,69 @@ int main(int argc, char* argv[]){
         } else if ( !(REWIRING_PROB>=0 && REWIRING_PROB <= 1) ){
             std::cerr << "ERROR: Invalid REWIRING_PROB value. Please pick a number between 0 and 1 (inclusive).\n";
             exit(1);
+        } else if ( !(AVG_DEG < SIZE && (REWIRING_PROB == 0 || SIZE > 2 * AVG_DEG)) ){
+            std::cerr << "ERROR: Invalid SIZE value. SIZE must exceed AVG_DEG, and 2 * AVG_DEG if edges are rewired.\n";
+            exit(1);
         }
         parsed_args += 3;
-        generate_watts_strogatz_small_world_network(a_edgelist, SIZE, AVG_DEG, REWIRING_PROB);
+
+        generate_watts_strogatz_small_world_network(a_edgelist, SIZE, AVG_DEG, REWIRING_PROB, seed_from_flags(flags));
+
+    } else if (dataset_source.compare("gen_erdos_renyi") == 0){
+        if (argc < parsed_args + 3) {
+            std::cerr << "Insufficient Arguments To Generate Erdos Renyi Network.\n";
+            exit(1);
+        }
+        std::cout << "Attempting to generate an Erdos Renyi network.\n";
+        const int SIZE = atoi(argv[parsed_args + 1]);
+        const long long EDGES = atoll(argv[parsed_args + 2]);
+        parsed_args += 2;
+        generators::erdos_renyi(a_edgelist, SIZE, EDGES, seed_from_flags(flags), weights_from_flags(flags));
+
+    } else if (dataset_source.compare("gen_barabasi_albert") == 0){
+        if (argc < parsed_args + 3) {
+            std::cerr << "Insufficient Arguments To Generate Barabasi Albert Network.\n";
+            exit(1);
+        }
+        std::cout << "Attempting to generate a Barabasi Albert network.\n";
+        const int SIZE = atoi(argv[parsed_args + 1]);
+        const int EDGES_PER_VERTEX = atoi(argv[parsed_args + 2]);
+        parsed_args += 2;
+        generators::barabasi_albert(a_edgelist, SIZE, EDGES_PER_VERTEX, seed_from_flags(flags), weights_from_flags(flags));
+
+    } else if (dataset_source.compare("gen_chung_lu") == 0){
+        if (argc < parsed_args + 4) {
+            std::cerr << "Insufficient Arguments To Generate Chung Lu Network.\n";
+            exit(1);
+        }
+        std::cout << "Attempting to generate a Chung Lu network.\n";
+        const int SIZE = atoi(argv[parsed_args + 1]);
+        const double AVG_DEG = atof(argv[parsed_args + 2]);
+        const double EXPONENT = atof(argv[parsed_args + 3]);
+        parsed_args += 3;
+        generators::chung_lu(a_edgelist, SIZE, AVG_DEG, EXPONENT, seed_from_flags(flags), weights_from_flags(flags));
+
+    } else if (dataset_source.compare("gen_geometric") == 0){
+        if (argc < parsed_args + 3) {
+            std::cerr << "Insufficient Arguments To Generate Random Geometric Network.\n";
+            exit(1);
+        }
+        std::cout << "Attempting to generate a random geometric network.\n";
+        const int SIZE = atoi(argv[parsed_args + 1]);
+        const double RADIUS = atof(argv[parsed_args + 2]);
+        parsed_args += 2;
+        generators::random_geometric(a_edgelist, SIZE, RADIUS, seed_from_flags(flags), weights_from_flags(flags));
+
+    } else if (dataset_source.compare("gen_lattice") == 0){
+        if (argc < parsed_args + 3) {
+            std::cerr << "Insufficient Arguments To Generate Lattice Network.\n";
+            exit(1);
+        }
+        std::cout << "Attempting to generate a 2D lattice network.\n";
+        const int ROWS = atoi(argv[parsed_args + 1]);
+        const int COLS = atoi(argv[parsed_args + 2]);
+        parsed_args += 2;
+        generators::lattice_2d(a_edgelist, ROWS, COLS, flags.count("periodic") > 0, seed_from_flags(flags), weights_from_flags(flags));
 
     } else if (dataset_source.compare("load_file") == 0){
         if (argc < parsed_args + 3) {
@@ -207,10 +869,14 @@ int main(int argc, char* argv[]){
 
         a_edgelist = edgelist_from_file(weighted, filepath);
         a_edgelist.set_directional(directed);
+        loaded_filepath = filepath;
+        loaded_weighted = weighted;
     } else {
         std::cerr << "Invalid Edgelist Source Option\n";
         exit(1);
     }
+    source_timer.stop();
+    memory::account("edgelist", a_edgelist.memory_bytes());
 
     // Calculate neg_laplacian and g_tilda
     //edgelist nl_edgelist = a_edgelist.take_neg_laplacian();
@@ -227,6 +893,48 @@ int main(int argc, char* argv[]){
         parsed_args ++;
     }
 
+    // Single source searches only run in parallel within the search for dtv_tau
+    if (flags.count("sssp") && action.compare("dtv_tau") != 0){
+        std::cerr << "ERROR: --sssp only applies to dtv_tau.\n";
+        exit(1);
+    }
+    if (flags.count("ch-index") && action.compare("ch_dist") != 0 && action.compare("ch_dist_batch") != 0){
+        std::cerr << "ERROR: --ch-index only applies to ch_dist and ch_dist_batch.\n";
+        exit(1);
+    }
+    if (flags.count("log2-registers") && action.compare("anf_k") != 0 && action.compare("anf_tau") != 0){
+        std::cerr << "ERROR: --log2-registers only applies to anf_k and anf_tau.\n";
+        exit(1);
+    }
+    if (flags.count("twins") && action.compare("s_avg") != 0 && action.compare("lnr_avg") != 0 && action.compare("dist_hist") != 0 && action.compare("dbv_k") != 0 && action.compare("dbv_tau") != 0){
+        std::cerr << "ERROR: --twins only applies to s_avg, lnr_avg, dist_hist, dbv_k and dbv_tau.\n";
+        exit(1);
+    }
+    const bool TWINS = flags.count("twins") > 0;
+    if (flags.count("reorder") && action.compare("s_avg") != 0 && action.compare("lnr_avg") != 0 && action.compare("dist_hist") != 0 && action.compare("dbv_k") != 0 && action.compare("dbv_tau") != 0){
+        std::cerr << "ERROR: --reorder only applies to s_avg, lnr_avg, dist_hist, dbv_k and dbv_tau.\n";
+        exit(1);
+    }
+    const reorder::method REORDER = reorder::from_flags(flags);
+    if (flags.count("reduce") && action.compare("s_avg") != 0 && action.compare("lnr_avg") != 0 && action.compare("dist_hist") != 0){
+        std::cerr << "ERROR: --reduce only applies to s_avg, lnr_avg and dist_hist.\n";
+        exit(1);
+    }
+    const bool REDUCE = flags.count("reduce") > 0;
+    // The reduced graph shares searches along its chains and trees instead of between twins, and searches every source
+    for (std::string flag : {"twins", "sample", "checkpoint", "mem-budget"}){
+        if (REDUCE && flags.count(flag)){
+            std::cerr << "ERROR: --" << flag << " does not apply with --reduce.\n";
+            exit(1);
+        }
+    }
+    for (std::string flag : {"sample", "rel-error", "confidence", "time-budget"}){
+        if (flags.count(flag) && action.compare("s_avg") != 0 && action.compare("lnr_avg") != 0){
+            std::cerr << "ERROR: --" << flag << " only applies to s_avg and lnr_avg.\n";
+            exit(1);
+        }
+    }
+
     // Determine action
     if (action.compare("convert_g_tilda") == 0){
         if (argc < parsed_args + 1) {
@@ -236,10 +944,21 @@ int main(int argc, char* argv[]){
         const std::string filepath = argv[parsed_args + 1];
         parsed_args += 1;
 
-        edgelist nl_edgelist = a_edgelist.take_neg_laplacian();
-        edgelist g_edgelist = nl_edgelist.neg_laplacian_to_g();
+        edgelist nl_edgelist;
+        edgelist g_edgelist;
+        metrics::laplacian_stats stats;
+        instrument::phase_timer derive_timer("derive");
+        if (loaded_filepath.empty()){
+            nl_edgelist = a_edgelist.take_neg_laplacian();
+            g_edgelist = nl_edgelist.neg_laplacian_to_g();
+        } else {
+            derived_cache::load_or_derive(loaded_filepath, loaded_weighted, a_edgelist.is_directional(), a_edgelist, nl_edgelist, g_edgelist, stats);
+        }
+
+        derive_timer.stop();
 
         std::cout << "Attempting to write edgelist to file.\n";
+        instrument::phase_timer write_timer("write_edgelist");
         g_edgelist.save_edgelist_as_plaintext(filepath);
 
     } else if (action.compare("dtv_k") == 0){
@@ -264,7 +983,10 @@ int main(int argc, char* argv[]){
             exit(1);
         }
 
-        metrics::distance_to_vertices dtv = metrics::geodesic_distance_k(a_edgelist, src, k);
+        instrument::phase_timer search_timer("geodesic_distance_k");
+        metrics::distance_to_vertices dtv = metrics::query_geodesic_distance_k(a_edgelist, src, k);
+        search_timer.stop();
+        instrument::phase_timer print_timer("print_distances");
         metrics::print_distance_to_vertices(dtv);
 
     } else if (action.compare("dtv_tau") == 0){
@@ -295,9 +1017,96 @@ int main(int argc, char* argv[]){
             exit(1);
         }
 
-        metrics::distance_to_vertices dtv = metrics::geodesic_distance_tau(a_edgelist, src, tau);
+        double DELTA;
+        metrics::distance_to_vertices dtv;
+        if (delta_stepping_from_flags(flags, DELTA)){
+            instrument::phase_timer compact_timer("compact_graph");
+            compact_graph graph(a_edgelist);
+            compact_timer.stop();
+            if (std::any_of(graph.Weights.begin(), graph.Weights.end(), [](double weight){ return weight < 0; })){
+                std::cerr << "ERROR: --sssp=delta needs non-negative edge weights.\n";
+                exit(1);
+            }
+            if (DELTA == 0){
+                DELTA = sssp::default_delta(graph);
+            }
+            instrument::phase_timer search_timer("delta_stepping_tau");
+            dtv = sssp::delta_stepping_tau(graph, src, tau, DELTA);
+        } else {
+            instrument::phase_timer search_timer("geodesic_distance_tau");
+            dtv = metrics::query_geodesic_distance_tau(a_edgelist, src, tau);
+        }
+        instrument::phase_timer print_timer("print_distances");
         metrics::print_distance_to_vertices(dtv);
 
+    } else if (action.compare("ch_dist") == 0){
+        int src;
+        int dest;
+
+        if (argc < parsed_args + 2) {
+            std::cerr << "ERROR: Insufficient Arguments To Define Action.\n";
+            exit(1);
+        }
+
+        src = atoi(argv[parsed_args + 1]);
+        dest = atoi(argv[parsed_args + 2]);
+        parsed_args += 2;
+
+        if ( !( (src > 0 || (src == 0 && argv[parsed_args - 1][0] == '0' ) ) && src <= a_edgelist.max_vertex() ) ){
+            std::cerr << "ERROR: Invalid SRC vertex ID for Point To Point Distance operation.\n";
+            exit(1);
+        }
+        if ( !( (dest > 0 || (dest == 0 && argv[parsed_args][0] == '0' ) ) && dest <= a_edgelist.max_vertex() ) ){
+            std::cerr << "ERROR: Invalid DEST vertex ID for Point To Point Distance operation.\n";
+            exit(1);
+        }
+
+        ch::contraction_hierarchy hierarchy = hierarchy_from_flags(flags, a_edgelist);
+        instrument::phase_timer query_timer("ch_query");
+        ch::path_distance distance = hierarchy.query(src, dest);
+        query_timer.stop();
+        std::string line;
+        append_path_distance(line, src, dest, distance);
+        std::cout << line;
+
+    } else if (action.compare("ch_dist_batch") == 0){
+        if (argc < parsed_args + 1) {
+            std::cerr << "ERROR: Insufficient Arguments To Define Action.\n";
+            exit(1);
+        }
+        const std::string pairs_filepath = argv[parsed_args + 1];
+        parsed_args += 1;
+
+        // Each line of the pairs file holds a "SRC DEST" pair
+        std::ifstream pairs_file(pairs_filepath);
+        if (!pairs_file.is_open()){
+            std::cerr << "FAILED TO OPEN FILE!\n";
+            exit(1);
+        }
+        std::vector<std::pair<int,int>> pairs;
+        int src, dest;
+        while (pairs_file >> src >> dest){
+            if (src < 0 || src > a_edgelist.max_vertex() || dest < 0 || dest > a_edgelist.max_vertex()){
+                std::cerr << "ERROR: Invalid vertex ID in pair " << src << " " << dest << " of the pairs file.\n";
+                exit(1);
+            }
+            pairs.push_back({src, dest});
+        }
+        if (!pairs_file.eof()){
+            std::cerr << "ERROR: Invalid line " << pairs.size() + 1 << " of the pairs file.\n";
+            exit(1);
+        }
+
+        ch::contraction_hierarchy hierarchy = hierarchy_from_flags(flags, a_edgelist);
+        instrument::phase_timer query_timer("ch_query_batch");
+        std::vector<ch::path_distance> distances = hierarchy.query_batch(pairs);
+        query_timer.stop();
+        instrument::phase_timer print_timer("print_distances");
+        text_output::buffered_writer output(STDOUT_FILENO);
+        text_output::write_formatted_chunks(output, pairs.size(), [&](std::string &out, size_t i){
+            append_path_distance(out, pairs[i].first, pairs[i].second, distances[i]);
+        });
+
     } else if (action.compare("dbv_k") == 0){
         int k;
 
@@ -313,8 +1122,81 @@ int main(int argc, char* argv[]){
             exit(1);
         }
 
-        metrics::distance_btwn_vertices dbv = metrics::cross_geodesic_distance_k(a_edgelist, k);
-        metrics::print_distance_to_vertices(dbv);
+        // Optionally save the results in the columnar binary format instead of printing them
+        std::string binary_filepath;
+        if (argc > parsed_args + 1) {
+            binary_filepath = argv[parsed_args + 1];
+            parsed_args += 1;
+        }
+
+        // With --undirected-pairs each unordered pair is kept once (DST >= SRC)
+        const bool UNDIRECTED_PAIRS = undirected_pairs_from_flags(flags, a_edgelist);
+        if (flags.count("prune")){
+            std::cerr << "ERROR: --prune only applies to dbv_tau.\n";
+            exit(1);
+        }
+        memory::source_plan plan = {true, true, omp_get_max_threads(), 0, 0};
+        if (MEM_BUDGET > 0){
+            plan = plan_dbv(a_edgelist, action, !binary_filepath.empty(), MEM_BUDGET, [&a_edgelist, k](int src){
+                return metrics::geodesic_distance_k(a_edgelist, src, k);
+            });
+        }
+
+        checkpoint::source_progress progress = checkpoint::from_flags(flags, checkpoint_key(argc, argv, flags, loaded_filepath, loaded_weighted, a_edgelist.is_directional()));
+        if (progress.enabled() && binary_filepath.empty()){
+            std::cerr << "ERROR: --checkpoint needs the distances to be saved to an [OUTPUT FILE].\n";
+            exit(1);
+        }
+
+        if (!plan.keep_results || progress.enabled()){
+            // Every block is written before the next is searched
+            int block_sources = plan.keep_results ? progress.block_sources() : plan.block_sources;
+            if (progress.enabled()){
+                block_sources = std::min(block_sources, progress.block_sources());
+            }
+            if (TWINS){
+                std::cout << "Twin sources are searched on their own when the results are handed on in blocks.\n";
+            }
+            if (REORDER != reorder::method::none){
+                std::cout << "Sources are searched in their original order when the results are handed on in blocks.\n";
+            }
+            instrument::phase_timer stream_timer("stream_geodesic_distance_k");
+            write_streamed_dbv(binary_filepath, progress, [&a_edgelist, k, block_sources, UNDIRECTED_PAIRS](int first_source, std::function<void(metrics::distance_btwn_vertices&)> consume){
+                metrics::stream_cross_geodesic_distance_k(a_edgelist, k, block_sources, [&consume, UNDIRECTED_PAIRS](metrics::distance_btwn_vertices &block){
+                    if (UNDIRECTED_PAIRS){
+                        metrics::keep_upper_pairs(block);
+                    }
+                    consume(block);
+                }, first_source);
+            });
+        } else {
+            metrics::distance_btwn_vertices dbv;
+            twins::twin_classes classes;
+            if (REORDER != reorder::method::none){
+                // The relabeled compact graph is searched source by source, the rows are filed under the original IDs
+                compact_graph graph(a_edgelist);
+                reorder::vertex_order order = reorder_graph(graph, REORDER);
+                if (TWINS){
+                    classes = twin_classes_of(graph);
+                }
+                instrument::phase_timer search_timer("cross_geodesic_distance_k");
+                dbv = metrics::cross_geodesic_distance_k(graph, k, order, UNDIRECTED_PAIRS, TWINS ? &classes : nullptr);
+            } else {
+                if (TWINS){
+                    classes = twin_classes_of(compact_graph(a_edgelist));
+                }
+                instrument::phase_timer search_timer("cross_geodesic_distance_k");
+                dbv = UNDIRECTED_PAIRS ? metrics::cross_geodesic_distance_k_undirected(a_edgelist, k, TWINS ? &classes : nullptr) : metrics::cross_geodesic_distance_k(a_edgelist, k, TWINS ? &classes : nullptr);
+            }
+            memory::account("distance_btwn_vertices", metrics::dbv_memory_bytes(dbv));
+            instrument::phase_timer write_timer("write_distances");
+            if (binary_filepath.empty()){
+                metrics::print_distance_to_vertices(dbv);
+            } else {
+                std::cout << "Attempting to write distances to binary file.\n";
+                metrics::save_distance_btwn_vertices_to_binary(binary_filepath, dbv, true);
+            }
+        }
 
     } else if (action.compare("dbv_tau") == 0){
         double tau;
@@ -337,8 +1219,245 @@ int main(int argc, char* argv[]){
             exit(1);
         }
 
-        metrics::distance_btwn_vertices dbv = metrics::cross_geodesic_distance_tau(a_edgelist, tau);
-        metrics::print_distance_to_vertices(dbv);
+        // Optionally save the results in the columnar binary format instead of printing them
+        std::string binary_filepath;
+        if (argc > parsed_args + 1) {
+            binary_filepath = argv[parsed_args + 1];
+            parsed_args += 1;
+        }
+
+        // With --undirected-pairs each unordered pair is kept once (DST >= SRC)
+        const bool UNDIRECTED_PAIRS = undirected_pairs_from_flags(flags, a_edgelist);
+        // With --prune the searches of undirected pairs reuse the rows of the finished searches
+        const bool PRUNE = flags.count("prune") > 0;
+        if (PRUNE && !UNDIRECTED_PAIRS){
+            std::cerr << "ERROR: --prune needs --undirected-pairs.\n";
+            exit(1);
+        }
+        if (PRUNE && TWINS){
+            std::cerr << "ERROR: --prune does not apply with --twins.\n";
+            exit(1);
+        }
+        if (PRUNE && REORDER != reorder::method::none){
+            std::cerr << "ERROR: --prune does not apply with --reorder.\n";
+            exit(1);
+        }
+        memory::source_plan plan = {true, true, omp_get_max_threads(), 0, 0};
+        // Bytes the dense all pairs matrices may take, what the plan leaves over for them (none unless they were planned in)
+        uint64_t dense_budget = UINT64_MAX;
+        if (MEM_BUDGET > 0){
+            uint64_t dense_bytes = REORDER == reorder::method::none ? metrics::dense_tau_bytes(a_edgelist) : 0;
+            plan = plan_dbv(a_edgelist, action, !binary_filepath.empty(), MEM_BUDGET, [&a_edgelist, tau](int src){
+                return metrics::geodesic_distance_tau(a_edgelist, src, tau);
+            }, &dense_bytes);
+            dense_budget = dense_bytes > 0 ? MEM_BUDGET - (plan.estimate_bytes - dense_bytes) : 0;
+        }
+
+        checkpoint::source_progress progress = checkpoint::from_flags(flags, checkpoint_key(argc, argv, flags, loaded_filepath, loaded_weighted, a_edgelist.is_directional()));
+        if (progress.enabled() && binary_filepath.empty()){
+            std::cerr << "ERROR: --checkpoint needs the distances to be saved to an [OUTPUT FILE].\n";
+            exit(1);
+        }
+
+        if (!plan.keep_results || progress.enabled()){
+            // Every block is written before the next is searched
+            if (PRUNE){
+                std::cout << "Pruning is skipped when the results are handed on in blocks.\n";
+            }
+            int block_sources = plan.keep_results ? progress.block_sources() : plan.block_sources;
+            if (progress.enabled()){
+                block_sources = std::min(block_sources, progress.block_sources());
+            }
+            if (TWINS){
+                std::cout << "Twin sources are searched on their own when the results are handed on in blocks.\n";
+            }
+            if (REORDER != reorder::method::none){
+                std::cout << "Sources are searched in their original order when the results are handed on in blocks.\n";
+            }
+            instrument::phase_timer stream_timer("stream_geodesic_distance_tau");
+            write_streamed_dbv(binary_filepath, progress, [&a_edgelist, tau, block_sources, UNDIRECTED_PAIRS](int first_source, std::function<void(metrics::distance_btwn_vertices&)> consume){
+                metrics::stream_cross_geodesic_distance_tau(a_edgelist, tau, block_sources, [&consume, UNDIRECTED_PAIRS](metrics::distance_btwn_vertices &block){
+                    if (UNDIRECTED_PAIRS){
+                        metrics::keep_upper_pairs(block);
+                    }
+                    consume(block);
+                }, first_source);
+            });
+        } else {
+            metrics::distance_btwn_vertices dbv;
+            twins::twin_classes classes;
+            if (REORDER != reorder::method::none){
+                // The relabeled compact graph is searched source by source, the rows are filed under the original IDs
+                compact_graph graph(a_edgelist);
+                reorder::vertex_order order = reorder_graph(graph, REORDER);
+                if (TWINS){
+                    classes = twin_classes_of(graph);
+                }
+                instrument::phase_timer search_timer("cross_geodesic_distance_tau");
+                dbv = metrics::cross_geodesic_distance_tau(graph, tau, order, UNDIRECTED_PAIRS, TWINS ? &classes : nullptr);
+            } else {
+                if (TWINS){
+                    classes = twin_classes_of(compact_graph(a_edgelist));
+                }
+                instrument::phase_timer search_timer("cross_geodesic_distance_tau");
+                dbv = UNDIRECTED_PAIRS ? metrics::cross_geodesic_distance_tau_undirected(a_edgelist, tau, PRUNE, TWINS ? &classes : nullptr, dense_budget) : metrics::cross_geodesic_distance_tau(a_edgelist, tau, TWINS ? &classes : nullptr, dense_budget);
+            }
+            memory::account("distance_btwn_vertices", metrics::dbv_memory_bytes(dbv));
+            instrument::phase_timer write_timer("write_distances");
+            if (binary_filepath.empty()){
+                metrics::print_distance_to_vertices(dbv);
+            } else {
+                std::cout << "Attempting to write distances to binary file.\n";
+                metrics::save_distance_btwn_vertices_to_binary(binary_filepath, dbv, true);
+            }
+        }
+
+    } else if (action.compare("anf_k") == 0){
+        int k;
+
+        if (argc < parsed_args + 1) {
+            std::cerr << "ERROR: Insufficient Arguments To Define Action.\n";
+            exit(1);
+        }
+
+        k = atoi(argv[parsed_args + 1]);
+        parsed_args += 1;
+        if ( !( k > 0 ) ){
+            std::cerr << "ERROR: Invalid limit k for Neighborhood Function operation.\n";
+            exit(1);
+        }
+        const int LOG2_REGISTERS = log2_registers_from_flags(flags);
+
+        instrument::phase_timer compact_timer("compact_graph");
+        compact_graph graph(a_edgelist);
+        compact_timer.stop();
+        a_edgelist = edgelist();
+        const uint64_t COUNTER_BYTES = anf::counter_bytes(graph.Vertices, LOG2_REGISTERS, 1);
+        if (MEM_BUDGET > 0 && graph.memory_bytes() + COUNTER_BYTES > MEM_BUDGET){
+            memory::exit_over_budget(action, graph.memory_bytes() + COUNTER_BYTES, MEM_BUDGET);
+        }
+        memory::account("compact_graph", graph.memory_bytes());
+        memory::account("anf_counters", COUNTER_BYTES);
+
+        instrument::phase_timer anf_timer("hop_neighborhood_function");
+        anf::neighborhood_function function = anf::hop_neighborhood_function(graph, k, LOG2_REGISTERS);
+        anf_timer.stop();
+        anf::print_neighborhood_function(function, "NET");
+
+    } else if (action.compare("anf_tau") == 0){
+        double tau;
+        double WIDTH;
+
+        if (argc < parsed_args + 2) {
+            std::cerr << "ERROR: Insufficient Arguments To Define Action.\n";
+            exit(1);
+        }
+
+        try {
+            tau = std::stod(argv[parsed_args + 1]);
+            WIDTH = std::stod(argv[parsed_args + 2]);
+        } catch (...){
+            std::cerr << "ERROR: Invalid limit tau or bucket WIDTH for Neighborhood Function operation.\n";
+            exit(1);
+        }
+        parsed_args += 2;
+        if ( !( tau > 0 && WIDTH > 0 && WIDTH <= tau ) ){
+            std::cerr << "ERROR: Invalid limit tau or bucket WIDTH for Neighborhood Function operation. Requires 0 < WIDTH <= tau.\n";
+            exit(1);
+        }
+        const int LOG2_REGISTERS = log2_registers_from_flags(flags);
+
+        instrument::phase_timer compact_timer("compact_graph");
+        compact_graph graph(a_edgelist);
+        compact_timer.stop();
+        a_edgelist = edgelist();
+        if (std::any_of(graph.Weights.begin(), graph.Weights.end(), [](double weight){ return weight < 0; })){
+            std::cerr << "ERROR: anf_tau needs non-negative edge weights.\n";
+            exit(1);
+        }
+        const int SPAN = anf::bucket_span(graph, WIDTH);
+        if (SPAN > anf::MAX_BUCKET_SPAN){
+            std::cerr << "ERROR: The longest edge spans more than " << anf::MAX_BUCKET_SPAN << " buckets. Please pick a larger bucket WIDTH.\n";
+            exit(1);
+        }
+        const uint64_t COUNTER_BYTES = anf::counter_bytes(graph.Vertices, LOG2_REGISTERS, SPAN);
+        if (MEM_BUDGET > 0 && graph.memory_bytes() + COUNTER_BYTES > MEM_BUDGET){
+            memory::exit_over_budget(action, graph.memory_bytes() + COUNTER_BYTES, MEM_BUDGET);
+        }
+        memory::account("compact_graph", graph.memory_bytes());
+        memory::account("anf_counters", COUNTER_BYTES);
+
+        instrument::phase_timer anf_timer("info_neighborhood_function");
+        anf::neighborhood_function function = anf::info_neighborhood_function(graph, tau, WIDTH, LOG2_REGISTERS);
+        anf_timer.stop();
+        anf::print_neighborhood_function(function, "INFO");
+
+    } else if (action.compare("dist_hist") == 0){
+        double tau;
+        double WIDTH;
+
+        if (argc < parsed_args + 2) {
+            std::cerr << "ERROR: Insufficient Arguments To Define Action.\n";
+            exit(1);
+        }
+
+        try {
+            tau = std::stod(argv[parsed_args + 1]);
+            WIDTH = std::stod(argv[parsed_args + 2]);
+        } catch (...){
+            std::cerr << "ERROR: Invalid limit tau or bucket WIDTH for Distance Histogram operation.\n";
+            exit(1);
+        }
+        parsed_args += 2;
+        if ( !( tau > 0 && WIDTH > 0 ) ){
+            std::cerr << "ERROR: Invalid limit tau or bucket WIDTH for Distance Histogram operation.\n";
+            exit(1);
+        }
+
+        // Optionally save the histogram and summaries into a SQLite3 db instead of printing them
+        std::string output_db;
+        if (argc > parsed_args + 1) {
+            output_db = argv[parsed_args + 1];
+            parsed_args += 1;
+        }
+
+        instrument::phase_timer compact_timer("compact_graph");
+        compact_graph graph(a_edgelist);
+        compact_timer.stop();
+        a_edgelist = edgelist();
+        memory::account("compact_graph", graph.memory_bytes());
+
+        // The sources are searched in the new order, and the summaries are mapped back to the original IDs once done
+        reorder::vertex_order order;
+        if (REORDER != reorder::method::none){
+            order = reorder_graph(graph, REORDER);
+        }
+
+        histogram::distance_summary summary;
+        if (REDUCE){
+            // Search only the kernel left by peeling the pendant trees and contracting the chains
+            reduction::reduced_graph reduced = reduce_graph(graph);
+            instrument::phase_timer histogram_timer("distance_histogram");
+            summary = histogram::all_sources(reduced, tau, WIDTH);
+            histogram_timer.stop();
+        } else {
+            twins::twin_classes classes;
+            if (TWINS){
+                classes = twin_classes_of(graph);
+            }
+            instrument::phase_timer histogram_timer("distance_histogram");
+            summary = histogram::all_sources(graph, tau, WIDTH, nullptr, INFINITY, TWINS ? &classes : nullptr);
+            histogram_timer.stop();
+        }
+        if (REORDER != reorder::method::none){
+            summary.Vertices = order.to_original_ids(summary.Vertices);
+        }
+        instrument::phase_timer write_timer("write_distances");
+        if (output_db.empty()){
+            histogram::print_distance_summary(summary);
+        } else {
+            histogram::save_distance_summary_to_sqlite(summary, output_db, "distance");
+        }
 
     } else if (action.compare("s_avg") == 0){
         double GAMMA;
@@ -361,12 +1480,173 @@ int main(int argc, char* argv[]){
             exit(1);
         }
 
-        edgelist nl_edgelist = a_edgelist.take_neg_laplacian();
-        edgelist g_edgelist = nl_edgelist.neg_laplacian_to_g();
+        // The input, negative laplacian and g tilda edgelists are held together while deriving, with the table of w
+        if (MEM_BUDGET > 0 && 3 * a_edgelist.memory_bytes() + funcs::w_table_bytes() > MEM_BUDGET){
+            memory::exit_over_budget(action, 3 * a_edgelist.memory_bytes() + funcs::w_table_bytes(), MEM_BUDGET);
+        }
+
+        edgelist nl_edgelist;
+        edgelist g_edgelist;
+        metrics::laplacian_stats stats;
+        instrument::phase_timer derive_timer("derive");
+        if (loaded_filepath.empty()){
+            nl_edgelist = a_edgelist.take_neg_laplacian();
+            g_edgelist = nl_edgelist.neg_laplacian_to_g();
+            stats = metrics::compute_laplacian_stats(nl_edgelist);
+        } else {
+            derived_cache::load_or_derive(loaded_filepath, loaded_weighted, a_edgelist.is_directional(), a_edgelist, nl_edgelist, g_edgelist, stats);
+        }
+
+        derive_timer.stop();
+        memory::account("neg_laplacian_edgelist", nl_edgelist.memory_bytes());
+        memory::account("g_tilda_edgelist", g_edgelist.memory_bytes());
+        memory::account("w_table", funcs::w_table_bytes());
+
+        checkpoint::source_progress progress = checkpoint::from_flags(flags, checkpoint_key(argc, argv, flags, loaded_filepath, loaded_weighted, a_edgelist.is_directional()));
+        const sampling::plan PLAN = sampling::from_flags(flags);
+        if (PLAN.Enabled && progress.enabled()){
+            std::cerr << "ERROR: --checkpoint does not apply with --sample.\n";
+            exit(1);
+        }
+
+        double S_avg;
+        sampling::estimate estimate;
+        if (MEM_BUDGET > 0 || progress.enabled() || PLAN.Enabled || TWINS || REORDER != reorder::method::none || REDUCE){
+            // Only the compact g tilda graph is searched, so the edgelists are freed and the neighborhoods are only counted
+            a_edgelist = edgelist();
+            nl_edgelist = edgelist();
+            compact_graph g_tilda_graph(g_edgelist, stats.dim + 1);
+            g_edgelist = edgelist();
+            // The MU of each source moves with it, and S_avg does not depend on the order the sources are summed in
+            reorder::vertex_order order;
+            if (REORDER != reorder::method::none){
+                order = reorder_graph(g_tilda_graph, REORDER);
+                stats.mu = order.to_new_ids<double>(stats.mu, -INFINITY);
+            }
+            memory::account("g_tilda_graph", g_tilda_graph.memory_bytes());
+            if (MEM_BUDGET > 0){
+                memory::source_plan plan = memory::plan_sources(MEM_BUDGET, g_tilda_graph.memory_bytes() + funcs::w_table_bytes(), metrics::search_scratch::bytes_for(g_tilda_graph.Vertices), 0, g_tilda_graph.Vertices, omp_get_max_threads());
+                if (!plan.fits){
+                    memory::exit_over_budget(action, plan.estimate_bytes, MEM_BUDGET);
+                }
+                std::cout << "Memory plan: " << plan.concurrent_sources << " sources at once, estimated peak " << memory::format_bytes(plan.estimate_bytes) << "\n";
+                omp_set_num_threads(plan.concurrent_sources);
+            }
 
-        double S_avg = metrics::s_avg_gamma(nl_edgelist, g_edgelist, GAMMA);
+            // ~G keeps the pairs of the input graph, so its pendant trees and chains are searched from their roots and ends
+            reduction::reduced_graph reduced;
+            if (REDUCE){
+                reduced = reduce_graph(g_tilda_graph);
+            }
+
+            // The neighborhood of a source also depends on its MU, so only twins with the same MU share a search
+            twins::twin_classes classes;
+            if (TWINS){
+                classes = twin_classes_of(g_tilda_graph, &stats.mu);
+            }
+            instrument::phase_timer s_avg_timer("s_avg_gamma");
+            if (PLAN.Enabled){
+                estimate = metrics::s_avg_gamma_estimate(g_tilda_graph, stats, GAMMA, PLAN, TWINS ? &classes : nullptr, REORDER != reorder::method::none ? &order : nullptr);
+                S_avg = estimate.Mean;
+            } else {
+                // Printed like the edgelist search prints it, so the output matches the plain run
+                long double total_size_summation = REDUCE ? metrics::neighborhood_size_sum(reduced, stats, GAMMA) : metrics::neighborhood_size_sum(g_tilda_graph, stats, GAMMA, progress, TWINS ? &classes : nullptr);
+                #ifndef _DEBUG
+                std::cout << "Total Sum Of Neighborhood Sizes: " << total_size_summation << "\n";
+                #endif
+                S_avg = total_size_summation / (stats.dim+1);
+            }
+            s_avg_timer.stop();
+        } else {
+            instrument::phase_timer s_avg_timer("s_avg_gamma");
+            S_avg = metrics::s_avg_gamma(g_edgelist, stats, GAMMA);
+            s_avg_timer.stop();
+        }
 
         std::cout << "S_avg= " << S_avg << "\n";
+        if (PLAN.Enabled){
+            sampling::print_estimate(estimate, PLAN);
+        }
+    } else if (action.compare("lnr_avg") == 0){
+        if (argc < parsed_args + 2) {
+            std::cerr << "ERROR: Insufficient Arguments To Define Action.\n";
+            exit(1);
+        }
+        const int L = atoi(argv[parsed_args + 1]);
+        parsed_args += 1;
+        if ( !(L > 0) ){
+            std::cerr << "ERROR: Invalid L value given.\n";
+            exit(1);
+        }
+
+        edgelist nl_edgelist;
+        edgelist g_edgelist;
+        metrics::laplacian_stats stats;
+        instrument::phase_timer derive_timer("derive");
+        if (loaded_filepath.empty()){
+            nl_edgelist = a_edgelist.take_neg_laplacian();
+            g_edgelist = nl_edgelist.neg_laplacian_to_g();
+            stats = metrics::compute_laplacian_stats(nl_edgelist);
+        } else {
+            derived_cache::load_or_derive(loaded_filepath, loaded_weighted, a_edgelist.is_directional(), a_edgelist, nl_edgelist, g_edgelist, stats);
+        }
+        derive_timer.stop();
+
+        const sampling::plan PLAN = sampling::from_flags(flags);
+        if (REDUCE){
+            // The reduced compact g tilda graph is searched with each source limited to L-1 edges
+            compact_graph g_tilda_graph(g_edgelist, stats.dim + 1);
+            g_edgelist = edgelist();
+            reorder::vertex_order order;
+            if (REORDER != reorder::method::none){
+                order = reorder_graph(g_tilda_graph, REORDER);
+                stats.mu = order.to_new_ids<double>(stats.mu, -INFINITY);
+            }
+            reduction::reduced_graph reduced = reduce_graph(g_tilda_graph);
+            instrument::phase_timer lnr_timer("L_neighborhood_reduction_rate_average");
+            double avg_lnr = metrics::L_neighborhood_reduction_rate_average(reduced, stats, L, REORDER != reorder::method::none ? &order : nullptr);
+            lnr_timer.stop();
+            std::cout << "L_reduction_avg= " << avg_lnr << "\n";
+            return 0;
+        }
+        if (REORDER != reorder::method::none){
+            // The relabeled compact g tilda graph is searched with the MU of each source moved with it
+            compact_graph g_tilda_graph(g_edgelist, stats.dim + 1);
+            g_edgelist = edgelist();
+            reorder::vertex_order order = reorder_graph(g_tilda_graph, REORDER);
+            stats.mu = order.to_new_ids<double>(stats.mu, -INFINITY);
+            twins::twin_classes classes;
+            if (TWINS){
+                classes = twin_classes_of(g_tilda_graph, &stats.mu);
+            }
+            instrument::phase_timer lnr_timer("L_neighborhood_reduction_rate_average");
+            if (PLAN.Enabled){
+                sampling::estimate estimate = metrics::L_neighborhood_reduction_rate_average_estimate(g_tilda_graph, stats, L, PLAN, order, TWINS ? &classes : nullptr);
+                lnr_timer.stop();
+                std::cout << "L_reduction_avg= " << estimate.Mean << "\n";
+                sampling::print_estimate(estimate, PLAN);
+            } else {
+                double avg_lnr = metrics::L_neighborhood_reduction_rate_average(g_tilda_graph, stats, L, order, TWINS ? &classes : nullptr);
+                lnr_timer.stop();
+                std::cout << "L_reduction_avg= " << avg_lnr << "\n";
+            }
+            return 0;
+        }
+        twins::twin_classes classes;
+        if (TWINS){
+            classes = twin_classes_of(compact_graph(g_edgelist, stats.dim + 1), &stats.mu);
+        }
+        instrument::phase_timer lnr_timer("L_neighborhood_reduction_rate_average");
+        if (PLAN.Enabled){
+            sampling::estimate estimate = metrics::L_neighborhood_reduction_rate_average_estimate(g_edgelist, stats, L, PLAN, TWINS ? &classes : nullptr);
+            lnr_timer.stop();
+            std::cout << "L_reduction_avg= " << estimate.Mean << "\n";
+            sampling::print_estimate(estimate, PLAN);
+        } else {
+            double avg_lnr = metrics::L_neighborhood_reduction_rate_average(g_edgelist, stats, L, TWINS ? &classes : nullptr);
+            lnr_timer.stop();
+            std::cout << "L_reduction_avg= " << avg_lnr << "\n";
+        }
     } else {
         std::cerr << "Invalid Action Option\n";
         exit(1);
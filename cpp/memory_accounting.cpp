@@ -0,0 +1,129 @@
+#include <map>
+#include <vector>
+#include <string>
+#include <mutex>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cstdlib>
+
+#include "memory_accounting.h"
+
+namespace {
+    // Guards the accounted structures
+    std::mutex AccountMutex;
+    // Accounted structures in the order they were first recorded
+    std::vector<std::pair<std::string, uint64_t>> Structures;
+
+    // Reads a "NAME: VALUE kB" line of /proc/self/status (or another file of the same format)
+    uint64_t read_status_kb(std::string name, const char *filepath = "/proc/self/status"){
+        std::ifstream status(filepath);
+        std::string line;
+        while (std::getline(status, line)){
+            if (line.compare(0, name.size() + 1, name + ":") == 0){
+                std::stringstream value(line.substr(name.size() + 1));
+                uint64_t kb = 0;
+                value >> kb;
+                return kb << 10;
+            }
+        }
+        return 0;
+    }
+
+    void print_report(){
+        std::lock_guard<std::mutex> lock(AccountMutex);
+        std::cerr << "Memory report (estimated bytes of the structures):\n";
+        for (std::pair<std::string, uint64_t> &structure : Structures){
+            std::cerr << "  " << std::left << std::setw(32) << structure.first << std::right << memory::format_bytes(structure.second) << "\n";
+        }
+        std::cerr << "  " << std::left << std::setw(32) << "peak resident set size" << std::right << memory::format_bytes(memory::peak_rss_bytes()) << "\n";
+    }
+}
+
+uint64_t memory::current_rss_bytes(){
+    return read_status_kb("VmRSS");
+}
+
+uint64_t memory::peak_rss_bytes(){
+    return read_status_kb("VmHWM");
+}
+
+uint64_t memory::available_bytes(){
+    return read_status_kb("MemAvailable", "/proc/meminfo");
+}
+
+bool memory::reset_peak_rss(){
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    clear_refs << "5";
+    clear_refs.close();
+    return !clear_refs.fail();
+}
+
+std::string memory::format_bytes(uint64_t bytes){
+    const char *units[] = {"B", "KiB", "MiB", "GiB", "TiB"};
+    double value = bytes;
+    int unit = 0;
+    while (value >= 1024 && unit < 4){
+        value /= 1024;
+        unit++;
+    }
+    std::stringstream formatted;
+    formatted << std::fixed << std::setprecision(unit == 0 ? 0 : 2) << value << " " << units[unit];
+    return formatted.str();
+}
+
+void memory::account(std::string structure, uint64_t bytes){
+    std::lock_guard<std::mutex> lock(AccountMutex);
+    for (std::pair<std::string, uint64_t> &recorded : Structures){
+        if (recorded.first == structure){
+            recorded.second = std::max(recorded.second, bytes);
+            return;
+        }
+    }
+    Structures.push_back({structure, bytes});
+}
+
+void memory::configure(std::map<std::string, std::string> &flags){
+    if (flags.count("mem-report")){
+        std::atexit(print_report);
+    }
+}
+
+memory::source_plan memory::plan_sources(uint64_t BUDGET, uint64_t FIXED_BYTES, uint64_t PER_SOURCE_BYTES, uint64_t ALL_RESULTS_BYTES, int SOURCES, int MAX_CONCURRENT_SOURCES){
+    memory::source_plan plan;
+    const int threads = std::max(1, std::min(MAX_CONCURRENT_SOURCES, SOURCES));
+
+    // Every result kept, every thread searching
+    plan.estimate_bytes = FIXED_BYTES + ALL_RESULTS_BYTES + threads * PER_SOURCE_BYTES;
+    if (plan.estimate_bytes <= BUDGET){
+        plan.fits = true;
+        plan.keep_results = true;
+        plan.concurrent_sources = threads;
+        plan.block_sources = SOURCES;
+        return plan;
+    }
+
+    // Results handed on in blocks, as many sources per block as fit next to the fixed structures
+    plan.keep_results = ALL_RESULTS_BYTES == 0;
+    uint64_t fitting_sources = BUDGET > FIXED_BYTES ? (BUDGET - FIXED_BYTES) / std::max<uint64_t>(PER_SOURCE_BYTES, 1) : 0;
+    if (fitting_sources == 0){
+        plan.fits = false;
+        plan.concurrent_sources = 1;
+        plan.block_sources = 1;
+        plan.estimate_bytes = FIXED_BYTES + PER_SOURCE_BYTES;
+        return plan;
+    }
+    plan.fits = true;
+    plan.block_sources = (int) std::min<uint64_t>(fitting_sources, std::max(SOURCES, 1));
+    plan.concurrent_sources = std::min(threads, plan.block_sources);
+    plan.estimate_bytes = FIXED_BYTES + plan.block_sources * PER_SOURCE_BYTES;
+    return plan;
+}
+
+void memory::exit_over_budget(std::string what, uint64_t estimate_bytes, uint64_t BUDGET){
+    std::cerr << "ERROR: " << what << " needs at least an estimated " << memory::format_bytes(estimate_bytes) << ", over the --mem-budget of "
+        << memory::format_bytes(BUDGET) << ".\n";
+    exit(1);
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <cstdint>
+
+/**
+ * Memory accounting: resident set size of the process, estimated bytes of the large structures and planning of runs under a memory budget.
+ * Byte counts of map based structures are estimates (libstdc++ node layouts plus the allocator header), not exact allocations.
+*/
+namespace memory {
+    // Estimated bytes of one std::map / std::set node besides its key and value (tree links, color and the allocator header)
+    const uint64_t MAP_NODE_OVERHEAD_BYTES = 48;
+
+    // Returns the current resident set size of the process (VmRSS), 0 if unknown
+    uint64_t current_rss_bytes();
+
+    // Returns the peak resident set size of the process since it started or since the last reset_peak_rss (VmHWM), 0 if unknown
+    uint64_t peak_rss_bytes();
+
+    // Returns the memory available to new allocations without swapping (MemAvailable), 0 if unknown
+    uint64_t available_bytes();
+
+    // Resets the peak resident set size to the current one (through /proc/self/clear_refs), returns false if the kernel does not allow it
+    bool reset_peak_rss();
+
+    /**
+     * Formats a byte count with a binary unit, eg. "1.50 GiB"
+     * @param bytes The byte count
+     * @return The formatted count
+    */
+    std::string format_bytes(uint64_t bytes);
+
+    /**
+     * Records the bytes of a named structure for the memory report (the largest value recorded under a name is kept)
+     * @param structure The name of the structure
+     * @param bytes The bytes held by the structure
+    */
+    void account(std::string structure, uint64_t bytes);
+
+    /**
+     * Enables the memory report with the --mem-report flag: the accounted structures and the peak resident set size are printed to stderr at exit
+     * @param flags The flags given on the command line
+    */
+    void configure(std::map<std::string, std::string> &flags);
+
+    // How a run over every source is carried out under a memory budget
+    struct source_plan {
+        // Whether the estimated peak fits the budget
+        bool fits;
+        // Whether the results of every source are kept until the end (otherwise they are handed on in blocks of block_sources sources)
+        bool keep_results;
+        // Number of sources searched at once (the number of threads used)
+        int concurrent_sources;
+        // Number of sources whose results are held at once when they are not all kept
+        int block_sources;
+        // Estimated peak bytes of the plan
+        uint64_t estimate_bytes;
+    };
+
+    /**
+     * Plans a run over SOURCES sources: keeps every result if they fit the budget, otherwise hands them on in blocks,
+     * and caps the number of sources searched at once so their working memory fits.
+     * @param BUDGET The memory budget in bytes
+     * @param FIXED_BYTES The bytes held for the whole run (graphs, tables)
+     * @param PER_SOURCE_BYTES The bytes held for each source being searched or whose results are waiting to be handed on
+     * @param ALL_RESULTS_BYTES The bytes of the results of every source when they are all kept (0 if the results are only counts)
+     * @param SOURCES The number of sources
+     * @param MAX_CONCURRENT_SOURCES The largest number of sources searched at once (the number of threads)
+     * @return The plan, with fits false (and the estimate of one source at a time) if even that exceeds the budget
+    */
+    source_plan plan_sources(uint64_t BUDGET, uint64_t FIXED_BYTES, uint64_t PER_SOURCE_BYTES, uint64_t ALL_RESULTS_BYTES, int SOURCES, int MAX_CONCURRENT_SOURCES);
+
+    /**
+     * Exits with the estimate of a run that does not fit its memory budget, before any work is done
+     * @param what The run, eg. "dbv_tau"
+     * @param estimate_bytes The smallest estimated peak of the run
+     * @param BUDGET The memory budget in bytes
+    */
+    [[noreturn]] void exit_over_budget(std::string what, uint64_t estimate_bytes, uint64_t BUDGET);
+};
@@ -10,35 +10,86 @@
 #include <omp.h>
 #include <array>
 #include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <unistd.h>
+#include <memory>
+#include <mutex>
+#include <filesystem>
+#include <atomic>
 
 #include "edgelist.h"
 #include "funcs.h"
+#include "text_output.h"
+#include "placement.h"
+#include "instrument.h"
+#include "bfs.h"
+#include "dense_apsp.h"
+#include "memory_accounting.h"
 
 #include "network_metrics.h"
 
-const long double MINIMAL_PERCENT_ROUNDING_ERR = 0.00001;
+namespace {
+    // Formats one "from -> to = INFO:x | NET:n" line per pair of a row (from is omitted when negative, as for a single dtv)
+    void append_distance_row(std::string &out, metrics::src_vertex from, metrics::distance_to_vertices &connections){
+        for (auto &connection : connections){
+            if (from >= 0){
+                text_output::append_int(out, from);
+                out += ' ';
+            }
+            out += "-> ";
+            text_output::append_int(out, connection.first);
+            out += " = INFO:";
+            text_output::append_general(out, connection.second.info_distance);
+            out += " | NET:";
+            text_output::append_int(out, connection.second.net_distance);
+            out += '\n';
+        }
+    }
 
-void metrics::print_distance_to_vertices(metrics::distance_to_vertices dtv){
-    for (auto iter : dtv){
-        std::cout << "-> " << iter.first << " = " << "INFO:" << iter.second.info_distance << " | " << "NET:" << iter.second.net_distance << "\n";
+    // Collects pointers to the rows of a dbv so they can be formatted by index in parallel
+    std::vector<std::pair<metrics::src_vertex, metrics::distance_to_vertices*>> dbv_rows(metrics::distance_btwn_vertices &dbv){
+        std::vector<std::pair<metrics::src_vertex, metrics::distance_to_vertices*>> rows;
+        rows.reserve(dbv.size());
+        for (auto &iter : dbv){
+            rows.emplace_back(iter.first, &iter.second);
+        }
+        return rows;
     }
 }
 
-void metrics::print_distance_to_vertices(metrics::distance_btwn_vertices dbv){
-    for (auto iter : dbv){
-        metrics::src_vertex from = iter.first;
-        metrics::distance_to_vertices connections = iter.second;
-        for (auto connection : connections){
-            metrics::dest_vertex to = connection.first;
-            metrics::distance_pair dp = connection.second;
-            std::cout << from << " -> " << to << " = " << "INFO:" << dp.info_distance << " | " << "NET:" << dp.net_distance << "\n";
-        }
+void metrics::print_distance_to_vertices(metrics::distance_to_vertices &dtv){
+    text_output::buffered_writer output(STDOUT_FILENO);
+    std::string lines;
+    append_distance_row(lines, -1, dtv);
+    output.write(lines);
+}
+
+void metrics::append_distance_to_vertices(std::string &out, metrics::distance_to_vertices &dtv){
+    append_distance_row(out, -1, dtv);
+}
+
+uint64_t metrics::dbv_memory_bytes(metrics::distance_btwn_vertices &dbv){
+    uint64_t bytes = 0;
+    for (auto &row : dbv){
+        bytes += memory::MAP_NODE_OVERHEAD_BYTES + sizeof(row) + row.second.size() * metrics::DTV_ENTRY_BYTES;
     }
+    return bytes;
+}
+
+void metrics::print_distance_to_vertices(metrics::distance_btwn_vertices &dbv){
+    text_output::buffered_writer output(STDOUT_FILENO);
+    auto rows = dbv_rows(dbv);
+    text_output::write_formatted_chunks(output, rows.size(), [&rows](std::string &out, size_t i){
+        append_distance_row(out, rows[i].first, *rows[i].second);
+    }, 16);
 }
 
 metrics::distance_to_vertices metrics::geodesic_distance_k(edgelist &edgelist, metrics::src_vertex src, int k){
     metrics::distance_to_vertices dtv; // Distance to vertex
     std::queue<int> priority_queue; // queue representing the frontier
+    instrument::search_probe probe(instrument::geodesic_k);
     std::set<int> priority_queue_contents;
 
     // Initialize the src vertex distances to zero
@@ -60,6 +111,7 @@ metrics::distance_to_vertices metrics::geodesic_distance_k(edgelist &edgelist, m
 
         // Iterate through adjacent edges
         std::vector<edge> edges = edgelist.get_edges(from);
+        probe.pop(edges.size());
         for (struct edge edge: edges){
             // Get edge destination and weight
             metrics::src_vertex to = edge.dest;
@@ -97,26 +149,32 @@ metrics::distance_to_vertices metrics::geodesic_distance_k(edgelist &edgelist, m
                     .net_distance = possible_to_net_distance
                 };
                 dtv[to] = dtp;
+                probe.relaxation();
                 if (priority_queue_contents.find(to) == priority_queue_contents.end()){
                     priority_queue.push(to); // If updated, add to the frontier
+                    probe.frontier(priority_queue.size());
                     priority_queue_contents.emplace(to);
                 }
             } else if (std::abs(current_to_info_distance - possible_to_info_distance) < possible_to_info_distance*MINIMAL_PERCENT_ROUNDING_ERR && current_to_net_distance > possible_to_net_distance){
                 dtv.at(to).net_distance = possible_to_net_distance;
+                probe.relaxation();
                 if (priority_queue_contents.find(to) == priority_queue_contents.end()){
                     priority_queue.push(to); // If updated, add to the frontier
+                    probe.frontier(priority_queue.size());
                     priority_queue_contents.emplace(to);
                 }
             }
         }
     }
 
+    probe.finish(dtv.size());
     return dtv;
 }
 
 metrics::distance_to_vertices metrics::geodesic_distance_tau(edgelist &edgelist, metrics::src_vertex src, double tau){
     metrics::distance_to_vertices dtv; // Distance to vertex
     std::queue<int> priority_queue; // queue representing the frontier
+    instrument::search_probe probe(instrument::geodesic_tau);
     std::set<int> priority_queue_contents;
 
     // Initialize the src vertex distances to zero
@@ -138,6 +196,7 @@ metrics::distance_to_vertices metrics::geodesic_distance_tau(edgelist &edgelist,
 
         // Iterate through adjacent edges
         std::vector<edge> edges = edgelist.get_edges(from);
+        probe.pop(edges.size());
         for (struct edge edge: edges){
             // Get edge destination and weight
             metrics::src_vertex to = edge.dest;
@@ -175,24 +234,260 @@ metrics::distance_to_vertices metrics::geodesic_distance_tau(edgelist &edgelist,
                     .net_distance = possible_to_net_distance
                 };
                 dtv[to] = dtp;
+                probe.relaxation();
                 if (priority_queue_contents.find(to) == priority_queue_contents.end()){
                     priority_queue.push(to); // If updated, add to the frontier
+                    probe.frontier(priority_queue.size());
                     priority_queue_contents.emplace(to);
                 }
             } else if (std::abs(current_to_info_distance - possible_to_info_distance) < possible_to_info_distance*MINIMAL_PERCENT_ROUNDING_ERR  && current_to_net_distance > possible_to_net_distance){
                 dtv.at(to).net_distance = possible_to_net_distance;
+                probe.relaxation();
                 if (priority_queue_contents.find(to) == priority_queue_contents.end()){
                     priority_queue.push(to); // If updated, add to the frontier
+                    probe.frontier(priority_queue.size());
                     priority_queue_contents.emplace(to);
                 }
             }
         }
     }
 
+    probe.finish(dtv.size());
     return dtv;
 }
 
-metrics::distance_btwn_vertices metrics::cross_geodesic_distance_k(edgelist &edgelist, int k){
+namespace {
+    // Whether the searches of an edgelist reduce to breadth first searches: every edge has the same non-negative weight
+    bool uniform_hops(edgelist &edgelist, double &weight){
+        return edgelist.uniform_weight(weight) && weight >= 0;
+    }
+
+    // Largest number of edges of a path within tau when every edge has the given weight (negative for no limit), summing the weights as the searches do
+    int tau_hops(double weight, double tau, int vertices){
+        if (weight == 0){
+            return tau >= 0 ? -1 : 0;
+        }
+        long double info_distance = 0;
+        int hops = 0;
+        while (hops < vertices && info_distance + (long double)weight <= tau){
+            info_distance += weight;
+            hops++;
+        }
+        return hops;
+    }
+
+    // Information distance after each number of edges up to MAX_HOPS (or the number of vertices), the weights summed as the searches sum them
+    std::vector<long double> hop_info_distances(double weight, int MAX_HOPS, int vertices){
+        std::vector<long double> hop_info(1, 0);
+        int longest = MAX_HOPS < 0 ? vertices : std::min(MAX_HOPS, vertices);
+        for (int hops = 1; hops <= longest; hops++){
+            hop_info.push_back(hop_info.back() + (long double)weight);
+        }
+        return hop_info;
+    }
+
+    // Converts a row of the BFS to distances, skipping the destinations below FIRST_DEST
+    void hop_row_to_dtv(const bfs::hop_row &row, const std::vector<long double> &hop_info, metrics::distance_to_vertices &dtv, int FIRST_DEST = 0){
+        dtv.clear();
+        for (const std::pair<int, int> &reached : row){
+            if (reached.first >= FIRST_DEST){
+                dtv.emplace_hint(dtv.end(), reached.first, metrics::distance_pair{.info_distance = hop_info[reached.second], .net_distance = reached.second});
+            }
+        }
+    }
+
+    // Searches the sources FIRST to LAST with the multi-source BFS into res[src - FIRST]
+    void hop_distances(const compact_graph &graph, double weight, int MAX_HOPS, int FIRST, int LAST, std::vector<metrics::distance_to_vertices> &res, bool UPPER_PAIRS = false){
+        std::vector<long double> hop_info = hop_info_distances(weight, MAX_HOPS, graph.Vertices);
+        bfs::multi_source_hops(graph, FIRST, LAST, MAX_HOPS, [&res, &hop_info, FIRST, UPPER_PAIRS](int src, bfs::hop_row &row){
+            hop_row_to_dtv(row, hop_info, res[src - FIRST], UPPER_PAIRS ? src : 0);
+        });
+    }
+
+    // Number of sources whose tau searches decide between the dense Floyd-Warshall and one search per source
+    const int DENSE_SAMPLE_SOURCES = 8;
+
+    // Whether the dense Floyd-Warshall is expected to beat one tau search per source: every weight is positive, the matrices fit in half the available
+    // memory and in DENSE_BUDGET, and the searches of a few sources spread over the network reach at least half of it (so the results are close to every pair anyway)
+    bool dense_pays_off(edgelist &edgelist, const compact_graph &graph, double tau, uint64_t DENSE_BUDGET){
+        int vertices = graph.Vertices;
+        if (vertices < dense::BLOCK || dense::matrix_bytes(vertices) > std::min(memory::available_bytes() / 2, DENSE_BUDGET)){
+            return false;
+        }
+        for (int64_t i = 0; i < graph.edge_count(); i++){
+            if ( !( graph.Weights[i] > 0 ) ){
+                return false;
+            }
+        }
+        int64_t reached = 0;
+        #pragma omp parallel for reduction(+:reached)
+        for (int sample = 0; sample < DENSE_SAMPLE_SOURCES; sample++){
+            reached += metrics::geodesic_distance_tau(edgelist, (int64_t) sample * vertices / DENSE_SAMPLE_SOURCES, tau).size();
+        }
+        return 2 * reached >= (int64_t) DENSE_SAMPLE_SOURCES * vertices;
+    }
+
+    // cross_geodesic_distance_tau from the dense Floyd-Warshall distances, keeping only the destinations from each source upward if asked to
+    metrics::distance_btwn_vertices cross_dense_distances(const compact_graph &graph, double tau, bool UPPER_PAIRS = false){
+        dense::distance_matrix matrix(graph);
+        std::vector<metrics::distance_to_vertices> res(graph.Vertices);
+        #pragma omp parallel for schedule(dynamic, 64)
+        for (int src = 0; src < graph.Vertices; src++){
+            const double *row_info = matrix.Info.data() + (int64_t) src * matrix.Stride;
+            const double *row_hops = matrix.Hops.data() + (int64_t) src * matrix.Stride;
+            for (int dest = UPPER_PAIRS ? src : 0; dest < graph.Vertices; dest++){
+                if ((long double) row_info[dest] <= tau){
+                    res[src].emplace_hint(res[src].end(), dest, metrics::distance_pair{.info_distance = row_info[dest], .net_distance = (int) row_hops[dest]});
+                }
+            }
+        }
+
+        metrics::distance_btwn_vertices dbn;
+        for (int src = 0; src < graph.Vertices; src++){
+            dbn.emplace_hint(dbn.end(), src, std::move(res[src]));
+        }
+        return dbn;
+    }
+
+    // Searches one source with the direction-optimizing BFS over a compact copy of an edgelist whose edges all have the given weight
+    metrics::distance_to_vertices single_source_hop_distances(edgelist &edgelist, metrics::src_vertex src, double weight, int MAX_HOPS){
+        compact_graph graph(edgelist);
+        compact_graph reverse_graph;
+        if (graph.Directional){
+            reverse_graph = graph.reversed();
+        }
+        metrics::distance_to_vertices dtv;
+        hop_row_to_dtv(bfs::direction_optimizing_hops(graph, graph.Directional ? reverse_graph : graph, src, MAX_HOPS), hop_info_distances(weight, MAX_HOPS, graph.Vertices), dtv);
+        return dtv;
+    }
+
+    // cross_geodesic_distance_k and _tau of an edgelist whose edges all have the given weight, keeping only the destinations from each source upward if asked to
+    metrics::distance_btwn_vertices cross_hop_distances(edgelist &edgelist, double weight, int MAX_HOPS, bool UPPER_PAIRS = false){
+        int dim = edgelist.max_vertex();
+        compact_graph graph(edgelist);
+        std::vector<metrics::distance_to_vertices> res(dim+1);
+        hop_distances(graph, weight, MAX_HOPS, 0, dim, res, UPPER_PAIRS);
+
+        metrics::distance_btwn_vertices dbn;
+        for (int src = 0; src <= dim; src++){
+            dbn.emplace_hint(dbn.end(), src, std::move(res[src]));
+        }
+        return dbn;
+    }
+
+    // Row of a twin from the row of its representative: the swap of the two maps the distances of one onto the other
+    metrics::distance_to_vertices twin_row(const metrics::distance_to_vertices &row, metrics::src_vertex representative, metrics::src_vertex twin){
+        metrics::distance_to_vertices swapped = row;
+        auto to_representative = swapped.extract(representative);
+        auto to_twin = swapped.extract(twin);
+        if (to_representative){
+            to_representative.key() = twin;
+            swapped.insert(std::move(to_representative));
+        }
+        if (to_twin){
+            to_twin.key() = representative;
+            swapped.insert(std::move(to_twin));
+        }
+        return swapped;
+    }
+
+    // Searches the representative of every twin class in parallel and copies its row to its twins, keeping only the destinations from each source upward if asked to
+    template <typename SearchFunc>
+    metrics::distance_btwn_vertices cross_twin_sources(int dim, const twins::twin_classes &classes, SearchFunc search, bool UPPER_PAIRS = false){
+        std::vector<metrics::distance_to_vertices> res(dim+1);
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (int src = 0; src <= dim; src++){
+            if (classes.is_representative(src)){
+                res[src] = search(src);
+            }
+        }
+        // Every row is whole until the twins are copied, then trimmed
+        #pragma omp parallel for schedule(dynamic, 64)
+        for (int src = 0; src <= dim; src++){
+            if (!classes.is_representative(src)){
+                res[src] = twin_row(res[classes.Representative[src]], classes.Representative[src], src);
+            }
+        }
+
+        metrics::distance_btwn_vertices dbn;
+        for (int src = 0; src <= dim; src++){
+            if (UPPER_PAIRS){
+                res[src].erase(res[src].begin(), res[src].lower_bound(src));
+            }
+            dbn.emplace_hint(dbn.end(), src, std::move(res[src]));
+        }
+        return dbn;
+    }
+}
+
+namespace {
+    // Searches every source of a relabeled graph in the order of the new IDs, each thread reusing its scratch over consecutive sources, and files the
+    // rows under the original IDs (keeping only the destinations from each source upward if asked to)
+    template <typename SearchFunc>
+    metrics::distance_btwn_vertices cross_relabeled_sources(const compact_graph &graph, const reorder::vertex_order &order, bool UPPER_PAIRS, const twins::twin_classes *classes, SearchFunc search){
+        const int V = graph.Vertices;
+        std::vector<metrics::distance_to_vertices> rows(V);
+        #pragma omp parallel
+        {
+            metrics::search_scratch scratch;
+            #pragma omp for schedule(dynamic, 64)
+            for (int src = 0; src < V; src++){
+                if (classes == nullptr || classes->is_representative(src)){
+                    rows[src] = search(src, scratch);
+                }
+            }
+        }
+        if (classes != nullptr){
+            #pragma omp parallel for schedule(dynamic, 64)
+            for (int src = 0; src < V; src++){
+                if (!classes->is_representative(src)){
+                    rows[src] = twin_row(rows[classes->Representative[src]], classes->Representative[src], src);
+                }
+            }
+        }
+
+        std::vector<metrics::distance_to_vertices> res(V);
+        #pragma omp parallel for schedule(dynamic, 64)
+        for (int src = 0; src < V; src++){
+            const int original = order.OriginalId[src];
+            for (const auto &[dst, distance] : rows[src]){
+                if (!UPPER_PAIRS || order.OriginalId[dst] >= original){
+                    res[original].emplace(order.OriginalId[dst], distance);
+                }
+            }
+            rows[src] = metrics::distance_to_vertices();
+        }
+
+        metrics::distance_btwn_vertices dbn;
+        for (int src = 0; src < V; src++){
+            dbn.emplace_hint(dbn.end(), src, std::move(res[src]));
+        }
+        return dbn;
+    }
+}
+
+metrics::distance_btwn_vertices metrics::cross_geodesic_distance_k(const compact_graph &graph, int k, const reorder::vertex_order &order, bool UPPER_PAIRS, const twins::twin_classes *classes){
+    return cross_relabeled_sources(graph, order, UPPER_PAIRS, classes, [&graph, k](int src, metrics::search_scratch &scratch){
+        return metrics::geodesic_distance_k(graph, src, k, scratch);
+    });
+}
+
+metrics::distance_btwn_vertices metrics::cross_geodesic_distance_tau(const compact_graph &graph, double tau, const reorder::vertex_order &order, bool UPPER_PAIRS, const twins::twin_classes *classes){
+    return cross_relabeled_sources(graph, order, UPPER_PAIRS, classes, [&graph, tau](int src, metrics::search_scratch &scratch){
+        return metrics::geodesic_distance_tau(graph, src, tau, scratch);
+    });
+}
+
+metrics::distance_btwn_vertices metrics::cross_geodesic_distance_k(edgelist &edgelist, int k, const twins::twin_classes *classes){
+    double weight;
+    if (uniform_hops(edgelist, weight)){
+        return cross_hop_distances(edgelist, weight, k);
+    }
+    if (classes != nullptr){
+        return cross_twin_sources(edgelist.max_vertex(), *classes, [&edgelist, k](int src){
+            return metrics::geodesic_distance_k(edgelist, src, k);
+        });
+    }
     metrics::distance_btwn_vertices dbn;
     int dim = edgelist.max_vertex();
     metrics::distance_to_vertices* res = new metrics::distance_to_vertices[dim+1];
@@ -202,13 +497,26 @@ metrics::distance_btwn_vertices metrics::cross_geodesic_distance_k(edgelist &edg
     }
 
     for (int src = 0; src <= dim; src++){
-        dbn[src] = res[src];
+        dbn[src] = std::move(res[src]);
     }
     delete[] res;
     return dbn;
 }
 
-metrics::distance_btwn_vertices metrics::cross_geodesic_distance_tau(edgelist &edgelist, double tau){
+metrics::distance_btwn_vertices metrics::cross_geodesic_distance_tau(edgelist &edgelist, double tau, const twins::twin_classes *classes, uint64_t DENSE_BUDGET){
+    double weight;
+    if (uniform_hops(edgelist, weight)){
+        return cross_hop_distances(edgelist, weight, tau_hops(weight, tau, edgelist.max_vertex() + 1));
+    }
+    compact_graph graph(edgelist);
+    if (dense_pays_off(edgelist, graph, tau, DENSE_BUDGET)){
+        return cross_dense_distances(graph, tau);
+    }
+    if (classes != nullptr){
+        return cross_twin_sources(edgelist.max_vertex(), *classes, [&edgelist, tau](int src){
+            return metrics::geodesic_distance_tau(edgelist, src, tau);
+        });
+    }
     metrics::distance_btwn_vertices dbn;
     int dim = edgelist.max_vertex();
     metrics::distance_to_vertices* res = new metrics::distance_to_vertices[dim+1];
@@ -218,26 +526,281 @@ metrics::distance_btwn_vertices metrics::cross_geodesic_distance_tau(edgelist &e
     }
 
     for (int src = 0; src <= dim; src++){
-        dbn[src] = res[src];
+        dbn[src] = std::move(res[src]);
     }
     delete[] res;
     return dbn;
 }
 
-void metrics::save_distance_btwn_vertices_to_file(std::string filepath, metrics::distance_btwn_vertices dbv){
-    std::ofstream output_file;
-    output_file.open(filepath);
-    output_file << "FROM, TO, INFO_DISTANCE, NET_DISTANCE" << "\n";
-    for (auto iter : dbv){
-        metrics::src_vertex from = iter.first;
-        metrics::distance_to_vertices connections = iter.second;
-        for (auto connection : connections){
-            metrics::dest_vertex to = connection.first;
-            metrics::distance_pair dp = connection.second;
-            output_file << from << ", " << to << ", " << dp.info_distance << ", " << dp.net_distance << "\n";
+metrics::distance_to_vertices metrics::query_geodesic_distance_k(edgelist &edgelist, metrics::src_vertex src, int k){
+    double weight;
+    if (uniform_hops(edgelist, weight)){
+        return single_source_hop_distances(edgelist, src, weight, k);
+    }
+    return metrics::geodesic_distance_k(edgelist, src, k);
+}
+
+metrics::distance_to_vertices metrics::query_geodesic_distance_tau(edgelist &edgelist, metrics::src_vertex src, double tau){
+    double weight;
+    if (uniform_hops(edgelist, weight)){
+        return single_source_hop_distances(edgelist, src, weight, tau_hops(weight, tau, edgelist.max_vertex() + 1));
+    }
+    return metrics::geodesic_distance_tau(edgelist, src, tau);
+}
+
+namespace {
+    // Searches every source in parallel, keeping only the destinations from each source upward. The searches cannot stop at lower vertices
+    // (paths to higher vertices pass through them), so each runs in full and holds its whole row until the lower half is dropped.
+    template <typename SearchFunc>
+    metrics::distance_btwn_vertices cross_upper_pairs(int dim, SearchFunc search){
+        metrics::distance_btwn_vertices dbn;
+        std::vector<metrics::distance_to_vertices> res(dim+1);
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (int src = 0; src <= dim; src++){
+            res[src] = search(src);
+            res[src].erase(res[src].begin(), res[src].lower_bound(src));
+        }
+
+        for (int src = 0; src <= dim; src++){
+            dbn.emplace_hint(dbn.end(), src, std::move(res[src]));
         }
+        return dbn;
+    }
+
+    // Rows of the sources whose searches finished, published once complete so the searches running at the same time can reuse them (nullptr until then)
+    typedef std::vector<std::atomic<const metrics::distance_to_vertices*>> finished_rows;
+
+    // geodesic_distance_tau that relaxes the rows of finished sources instead of their edges and does not expand the vertices covered by those rows
+    metrics::distance_to_vertices geodesic_distance_tau_pruned(edgelist &edgelist, metrics::src_vertex src, double tau, finished_rows &finished){
+        metrics::distance_to_vertices dtv; // Distance to vertex
+        std::queue<int> priority_queue; // queue representing the frontier
+        instrument::search_probe probe(instrument::geodesic_tau);
+        std::set<int> priority_queue_contents;
+        std::set<int> covered; // Vertices whose distance came from the row of a finished source
+
+        // Lowers the distance to a vertex if the given distances are shorter (information > network), adding it to the frontier
+        auto improve = [&](int to, long double possible_to_info_distance, int possible_to_net_distance){
+            long double current_to_info_distance = INFINITY;
+            int current_to_net_distance = INT32_MAX;
+            if (dtv.find(to) != dtv.end()){
+                current_to_info_distance = dtv.at(to).info_distance;
+                current_to_net_distance = dtv.at(to).net_distance;
+            }
+            if (current_to_info_distance - possible_to_info_distance > possible_to_info_distance*MINIMAL_PERCENT_ROUNDING_ERR){
+                dtv[to] = {.info_distance = possible_to_info_distance, .net_distance = possible_to_net_distance};
+            } else if (std::abs(current_to_info_distance - possible_to_info_distance) < possible_to_info_distance*MINIMAL_PERCENT_ROUNDING_ERR && current_to_net_distance > possible_to_net_distance){
+                dtv.at(to).net_distance = possible_to_net_distance;
+            } else {
+                return false;
+            }
+            probe.relaxation();
+            if (priority_queue_contents.find(to) == priority_queue_contents.end()){
+                priority_queue.push(to);
+                probe.frontier(priority_queue.size());
+                priority_queue_contents.emplace(to);
+            }
+            return true;
+        };
+
+        dtv[src].info_distance = 0;
+        dtv[src].net_distance = 0;
+        priority_queue.push(src);
+        priority_queue_contents.emplace(src);
+
+        while (!priority_queue.empty()){
+            metrics::src_vertex from = priority_queue.front();
+            priority_queue.pop();
+            priority_queue_contents.extract(from);
+            long double from_info_distance = dtv.at(from).info_distance;
+            int from_net_distance = dtv.at(from).net_distance;
+
+            // A shortest path through a covered vertex continues within the row that covered it
+            if (covered.find(from) != covered.end()){
+                continue;
+            }
+
+            // Everything within tau of a finished source is in its row, so the row replaces the edges
+            const metrics::distance_to_vertices *row = from == src ? nullptr : finished[from].load(std::memory_order_acquire);
+            if (row != nullptr){
+                probe.pop(row->size());
+                for (auto &entry : *row){
+                    if (entry.first == from || from_info_distance + entry.second.info_distance > tau){
+                        continue;
+                    }
+                    if (improve(entry.first, from_info_distance + entry.second.info_distance, from_net_distance + entry.second.net_distance)){
+                        covered.insert(entry.first);
+                    }
+                }
+                continue;
+            }
+
+            std::vector<edge> edges = edgelist.get_edges(from);
+            probe.pop(edges.size());
+            for (struct edge edge: edges){
+                if (edge.dest == from || from_info_distance + edge.weight > tau){
+                    continue;
+                }
+                if (improve(edge.dest, from_info_distance + edge.weight, from_net_distance + 1)){
+                    covered.erase(edge.dest);
+                }
+            }
+        }
+
+        probe.finish(dtv.size());
+        return dtv;
     }
-    output_file.close();
+}
+
+metrics::distance_btwn_vertices metrics::cross_geodesic_distance_k_undirected(edgelist &edgelist, int k, const twins::twin_classes *classes){
+    double weight;
+    if (uniform_hops(edgelist, weight)){
+        return cross_hop_distances(edgelist, weight, k, true);
+    }
+    if (classes != nullptr){
+        return cross_twin_sources(edgelist.max_vertex(), *classes, [&edgelist, k](int src){
+            return metrics::geodesic_distance_k(edgelist, src, k);
+        }, true);
+    }
+    return cross_upper_pairs(edgelist.max_vertex(), [&edgelist, k](int src){
+        return metrics::geodesic_distance_k(edgelist, src, k);
+    });
+}
+
+uint64_t metrics::dense_tau_bytes(edgelist &edgelist){
+    double weight;
+    const int vertices = edgelist.max_vertex() + 1;
+    if (uniform_hops(edgelist, weight) || vertices < dense::BLOCK){
+        return 0;
+    }
+    for (const edge &e : edgelist.get_edges()){
+        if ( !( e.weight > 0 ) ){
+            return 0;
+        }
+    }
+    return dense::matrix_bytes(vertices);
+}
+
+metrics::distance_btwn_vertices metrics::cross_geodesic_distance_tau_undirected(edgelist &edgelist, double tau, bool PRUNE, const twins::twin_classes *classes, uint64_t DENSE_BUDGET){
+    int dim = edgelist.max_vertex();
+    // The bitsets and the dense matrices already share the work between sources, so pruning does not apply
+    double weight;
+    if (uniform_hops(edgelist, weight)){
+        return cross_hop_distances(edgelist, weight, tau_hops(weight, tau, dim + 1), true);
+    }
+    compact_graph graph(edgelist);
+    if (dense_pays_off(edgelist, graph, tau, DENSE_BUDGET)){
+        return cross_dense_distances(graph, tau, true);
+    }
+    if (!PRUNE && classes != nullptr){
+        return cross_twin_sources(dim, *classes, [&edgelist, tau](int src){
+            return metrics::geodesic_distance_tau(edgelist, src, tau);
+        }, true);
+    }
+    if (!PRUNE){
+        return cross_upper_pairs(dim, [&edgelist, tau](int src){
+            return metrics::geodesic_distance_tau(edgelist, src, tau);
+        });
+    }
+
+    // The whole rows are kept until every search is done since any search may still reach them
+    std::vector<metrics::distance_to_vertices> res(dim+1);
+    finished_rows finished(dim+1);
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int src = 0; src <= dim; src++){
+        res[src] = geodesic_distance_tau_pruned(edgelist, src, tau, finished);
+        finished[src].store(&res[src], std::memory_order_release);
+    }
+
+    metrics::distance_btwn_vertices dbn;
+    for (int src = 0; src <= dim; src++){
+        res[src].erase(res[src].begin(), res[src].lower_bound(src));
+        dbn.emplace_hint(dbn.end(), src, std::move(res[src]));
+    }
+    return dbn;
+}
+
+void metrics::keep_upper_pairs(metrics::distance_btwn_vertices &dbv){
+    for (auto &row : dbv){
+        row.second.erase(row.second.begin(), row.second.lower_bound(row.first));
+    }
+}
+
+namespace {
+    // Searches the sources in blocks of consecutive sources and hands each block on before the next is searched, search_block(first, last, res) fills res[src - first]
+    template <typename BlockFunc>
+    void stream_cross_geodesic_distance(int dim, int BLOCK_SOURCES, int FIRST_SOURCE, std::function<void(metrics::distance_btwn_vertices&)> &consume, BlockFunc search_block){
+        BLOCK_SOURCES = std::max(BLOCK_SOURCES, 1);
+        std::vector<metrics::distance_to_vertices> res(std::max(std::min(BLOCK_SOURCES, dim + 1 - FIRST_SOURCE), 0));
+        for (int first = FIRST_SOURCE; first <= dim; first += BLOCK_SOURCES){
+            int last = std::min(dim, first + BLOCK_SOURCES - 1);
+            search_block(first, last, res);
+            metrics::distance_btwn_vertices block;
+            for (int src = first; src <= last; src++){
+                block.emplace_hint(block.end(), src, std::move(res[src - first]));
+            }
+            consume(block);
+        }
+    }
+
+    // Block search running one search per source, the sources of the block in parallel
+    template <typename SearchFunc>
+    auto each_source(SearchFunc search){
+        return [search](int first, int last, std::vector<metrics::distance_to_vertices> &res){
+            #pragma omp parallel for schedule(dynamic, 1)
+            for (int src = first; src <= last; src++){
+                res[src - first] = search(src);
+            }
+        };
+    }
+
+    // Streams the hop distances of an edgelist whose edges all have the given weight, searching each block with the multi-source BFS
+    void stream_hop_distances(edgelist &edgelist, double weight, int MAX_HOPS, int BLOCK_SOURCES, std::function<void(metrics::distance_btwn_vertices&)> &consume, int FIRST_SOURCE){
+        compact_graph graph(edgelist);
+        stream_cross_geodesic_distance(edgelist.max_vertex(), BLOCK_SOURCES, FIRST_SOURCE, consume, [&graph, weight, MAX_HOPS](int first, int last, std::vector<metrics::distance_to_vertices> &res){
+            hop_distances(graph, weight, MAX_HOPS, first, last, res);
+        });
+    }
+}
+
+void metrics::stream_cross_geodesic_distance_k(edgelist &edgelist, int k, int BLOCK_SOURCES, std::function<void(metrics::distance_btwn_vertices&)> consume, int FIRST_SOURCE){
+    double weight;
+    if (uniform_hops(edgelist, weight)){
+        stream_hop_distances(edgelist, weight, k, BLOCK_SOURCES, consume, FIRST_SOURCE);
+        return;
+    }
+    stream_cross_geodesic_distance(edgelist.max_vertex(), BLOCK_SOURCES, FIRST_SOURCE, consume, each_source([&edgelist, k](int src){
+        return metrics::geodesic_distance_k(edgelist, src, k);
+    }));
+}
+
+void metrics::stream_cross_geodesic_distance_tau(edgelist &edgelist, double tau, int BLOCK_SOURCES, std::function<void(metrics::distance_btwn_vertices&)> consume, int FIRST_SOURCE){
+    double weight;
+    if (uniform_hops(edgelist, weight)){
+        stream_hop_distances(edgelist, weight, tau_hops(weight, tau, edgelist.max_vertex() + 1), BLOCK_SOURCES, consume, FIRST_SOURCE);
+        return;
+    }
+    stream_cross_geodesic_distance(edgelist.max_vertex(), BLOCK_SOURCES, FIRST_SOURCE, consume, each_source([&edgelist, tau](int src){
+        return metrics::geodesic_distance_tau(edgelist, src, tau);
+    }));
+}
+
+void metrics::save_distance_btwn_vertices_to_file(std::string filepath, metrics::distance_btwn_vertices &dbv){
+    text_output::buffered_writer output_file(filepath);
+    output_file.write("FROM, TO, INFO_DISTANCE, NET_DISTANCE\n");
+    auto rows = dbv_rows(dbv);
+    text_output::write_formatted_chunks(output_file, rows.size(), [&rows](std::string &out, size_t i){
+        metrics::src_vertex from = rows[i].first;
+        for (auto &connection : *rows[i].second){
+            text_output::append_int(out, from);
+            out += ", ";
+            text_output::append_int(out, connection.first);
+            out += ", ";
+            text_output::append_general(out, connection.second.info_distance);
+            out += ", ";
+            text_output::append_int(out, connection.second.net_distance);
+            out += '\n';
+        }
+    }, 16);
 }
 
 void metrics::dbv_to_sqlite(std::string filepath, std::string table_name, metrics::distance_btwn_vertices dbv){
@@ -279,36 +842,429 @@ void metrics::dbv_to_sqlite(std::string filepath, std::string table_name, metric
     sqlite3_close(db);
 }
 
-metrics::distance_btwn_vertices dtv_to_dbv(metrics::distance_to_vertices dtv, metrics::src_vertex src){
+namespace {
+    // Identifies the columnar binary distance format (and its revision) at the start of the file
+    const char DBV_BINARY_MAGIC[8] = {'N', 'L', 'E', 'D', 'B', 'V', '1', '\0'};
+    const uint32_t DBV_BINARY_VERSION = 1;
+    // Header flag set when the DST column holds differences to the previous DST of the same row
+    const uint32_t DBV_BINARY_FLAG_DELTA_DST = 1;
+    // Size of the fixed header: magic, version, flags and seven 64 bit counts/offsets
+    const uint64_t DBV_BINARY_HEADER_SIZE = 72;
+
+    struct dbv_binary_header {
+        uint32_t flags;
+        uint64_t num_sources;
+        uint64_t num_pairs;
+        uint64_t index_offset; // Sorted int32 SRC ids followed (8 byte aligned) by num_sources+1 uint64 row offsets
+        uint64_t src_offset;
+        uint64_t dst_offset;
+        uint64_t info_offset;
+        uint64_t net_offset;
+    };
+
+    // Rounds a byte offset up to the next multiple of 8 so every column can be mapped as an aligned array
+    uint64_t align_8(uint64_t offset){
+        return (offset + 7) & ~uint64_t(7);
+    }
+
+    // Converts between host and little-endian byte order (a no-op on little-endian hosts)
+    template <typename T>
+    T host_to_little_endian(T value){
+        if constexpr (std::endian::native == std::endian::big){
+            unsigned char bytes[sizeof(T)];
+            std::memcpy(bytes, &value, sizeof(T));
+            std::reverse(bytes, bytes + sizeof(T));
+            std::memcpy(&value, bytes, sizeof(T));
+        }
+        return value;
+    }
+
+    template <typename T>
+    void write_le(std::ofstream &output_file, T value){
+        value = host_to_little_endian(value);
+        output_file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    // Writes values as a contiguous little-endian array
+    template <typename T>
+    void write_values_le(std::ofstream &output_file, const std::vector<T> &values){
+        if constexpr (std::endian::native == std::endian::little){
+            output_file.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+        } else {
+            for (T value : values){
+                write_le(output_file, value);
+            }
+        }
+    }
+
+    // Pads a section of the given length with zeros to the next 8 byte boundary
+    void write_padding(std::ofstream &output_file, uint64_t written){
+        const char padding[8] = {0};
+        output_file.write(padding, align_8(written) - written);
+    }
+
+    // Writes a column as a contiguous little-endian array padded with zeros to the next 8 byte boundary
+    template <typename T>
+    void write_column_le(std::ofstream &output_file, const std::vector<T> &column){
+        write_values_le(output_file, column);
+        write_padding(output_file, column.size() * sizeof(T));
+    }
+
+    // Lays out the sections of a binary file with the given counts, each starting on an 8 byte boundary
+    dbv_binary_header layout_dbv_binary(uint64_t num_sources, uint64_t num_pairs, bool delta_encode_dst){
+        dbv_binary_header header;
+        header.flags = delta_encode_dst ? DBV_BINARY_FLAG_DELTA_DST : 0;
+        header.num_sources = num_sources;
+        header.num_pairs = num_pairs;
+        header.index_offset = DBV_BINARY_HEADER_SIZE;
+        header.src_offset = align_8(header.index_offset + header.num_sources * sizeof(int32_t)) + (header.num_sources + 1) * sizeof(uint64_t);
+        header.dst_offset = align_8(header.src_offset + num_pairs * sizeof(int32_t));
+        header.info_offset = align_8(header.dst_offset + num_pairs * sizeof(int32_t));
+        header.net_offset = align_8(header.info_offset + num_pairs * sizeof(double));
+        return header;
+    }
+
+    // Opens a binary file for writing and writes its header, exits if the file cannot be opened
+    void write_dbv_binary_header(std::ofstream &output_file, std::string &filepath, dbv_binary_header &header){
+        output_file.open(filepath, std::ios::binary | std::ios::trunc);
+        if (!output_file.is_open()){
+            std::cerr << "ERROR: Failed to open binary distance file " << filepath << " for writing.\n";
+            exit(1);
+        }
+        output_file.write(DBV_BINARY_MAGIC, 8);
+        write_le<uint32_t>(output_file, DBV_BINARY_VERSION);
+        write_le<uint32_t>(output_file, header.flags);
+        write_le<uint64_t>(output_file, header.num_sources);
+        write_le<uint64_t>(output_file, header.num_pairs);
+        write_le<uint64_t>(output_file, header.index_offset);
+        write_le<uint64_t>(output_file, header.src_offset);
+        write_le<uint64_t>(output_file, header.dst_offset);
+        write_le<uint64_t>(output_file, header.info_offset);
+        write_le<uint64_t>(output_file, header.net_offset);
+    }
+
+    template <typename T>
+    T read_le(std::ifstream &input_file){
+        T value;
+        input_file.read(reinterpret_cast<char*>(&value), sizeof(T));
+        return host_to_little_endian(value);
+    }
+
+    // Reads count values of a column starting at the element first_element
+    template <typename T>
+    std::vector<T> read_column_le(std::ifstream &input_file, uint64_t column_offset, uint64_t first_element, uint64_t count){
+        std::vector<T> column(count);
+        input_file.seekg(column_offset + first_element * sizeof(T));
+        input_file.read(reinterpret_cast<char*>(column.data()), count * sizeof(T));
+        if constexpr (std::endian::native == std::endian::big){
+            for (T &value : column){
+                value = host_to_little_endian(value);
+            }
+        }
+        return column;
+    }
+
+    // Opens a columnar binary file and reads its header, exits if the file is not in the expected format
+    dbv_binary_header read_dbv_binary_header(std::ifstream &input_file, std::string &filepath){
+        if (!input_file.is_open()){
+            std::cerr << "ERROR: Failed to open binary distance file " << filepath << "\n";
+            exit(1);
+        }
+        char magic[8];
+        input_file.read(magic, 8);
+        uint32_t version = read_le<uint32_t>(input_file);
+        if (!input_file || std::memcmp(magic, DBV_BINARY_MAGIC, 8) != 0 || version != DBV_BINARY_VERSION){
+            std::cerr << "ERROR: " << filepath << " is not a supported binary distance file.\n";
+            exit(1);
+        }
+        dbv_binary_header header;
+        header.flags = read_le<uint32_t>(input_file);
+        header.num_sources = read_le<uint64_t>(input_file);
+        header.num_pairs = read_le<uint64_t>(input_file);
+        header.index_offset = read_le<uint64_t>(input_file);
+        header.src_offset = read_le<uint64_t>(input_file);
+        header.dst_offset = read_le<uint64_t>(input_file);
+        header.info_offset = read_le<uint64_t>(input_file);
+        header.net_offset = read_le<uint64_t>(input_file);
+        return header;
+    }
+
+    // Decodes one row of the DST column in place if it was delta encoded
+    void decode_dst_row(std::vector<int32_t> &dst_row, uint32_t flags){
+        if (flags & DBV_BINARY_FLAG_DELTA_DST){
+            for (size_t i = 1; i < dst_row.size(); i++){
+                dst_row[i] += dst_row[i-1];
+            }
+        }
+    }
+}
+
+void metrics::save_distance_btwn_vertices_to_binary(std::string filepath, metrics::distance_btwn_vertices &dbv, bool delta_encode_dst){
+    // Build the index and the columns (dbv is ordered by SRC then DST, so rows are contiguous and sorted)
+    std::vector<int32_t> source_ids;
+    std::vector<uint64_t> row_offsets;
+    std::vector<int32_t> src_column;
+    std::vector<int32_t> dst_column;
+    std::vector<double> info_column;
+    std::vector<int32_t> net_column;
+
+    uint64_t num_pairs = 0;
+    for (auto &iter : dbv){
+        num_pairs += iter.second.size();
+    }
+    source_ids.reserve(dbv.size());
+    row_offsets.reserve(dbv.size() + 1);
+    src_column.reserve(num_pairs);
+    dst_column.reserve(num_pairs);
+    info_column.reserve(num_pairs);
+    net_column.reserve(num_pairs);
+
+    for (auto &iter : dbv){
+        metrics::src_vertex from = iter.first;
+        source_ids.push_back(from);
+        row_offsets.push_back(src_column.size());
+        metrics::dest_vertex previous_to = 0;
+        for (auto &connection : iter.second){
+            metrics::dest_vertex to = connection.first;
+            src_column.push_back(from);
+            dst_column.push_back(delta_encode_dst ? to - previous_to : to);
+            info_column.push_back(double(connection.second.info_distance));
+            net_column.push_back(connection.second.net_distance);
+            previous_to = to;
+        }
+    }
+    row_offsets.push_back(src_column.size());
+
+    // Lay out the sections, each starting on an 8 byte boundary
+    dbv_binary_header header = layout_dbv_binary(source_ids.size(), num_pairs, delta_encode_dst);
+    std::ofstream output_file;
+    write_dbv_binary_header(output_file, filepath, header);
+
+    write_column_le(output_file, source_ids);
+    write_column_le(output_file, row_offsets);
+    write_column_le(output_file, src_column);
+    write_column_le(output_file, dst_column);
+    write_column_le(output_file, info_column);
+    write_column_le(output_file, net_column);
+
+    if (!output_file){
+        std::cerr << "ERROR: Failed to write binary distance file " << filepath << "\n";
+        exit(1);
+    }
+    output_file.close();
+}
+
+metrics::dbv_binary_writer::dbv_binary_writer(std::string filepath, bool delta_encode_dst, uint64_t kept_pairs){
+    this->filepath = filepath;
+    this->delta_encode_dst = delta_encode_dst;
+    const char *suffixes[4] = {".src.part", ".dst.part", ".info.part", ".net.part"};
+    const uint64_t column_bytes[4] = {sizeof(int32_t), sizeof(int32_t), sizeof(double), sizeof(int32_t)};
+    for (int column = 0; column < 4; column++){
+        this->column_filepaths[column] = filepath + suffixes[column];
+        if (kept_pairs > 0){
+            // Cut the pairs appended after the kept ones, then append after them
+            std::error_code error;
+            if (std::filesystem::file_size(this->column_filepaths[column], error) < kept_pairs * column_bytes[column] || error){
+                std::cerr << "ERROR: The temporary column file " << this->column_filepaths[column] << " is missing pairs to resume from.\n";
+                exit(1);
+            }
+            std::filesystem::resize_file(this->column_filepaths[column], kept_pairs * column_bytes[column]);
+            this->column_files[column].open(this->column_filepaths[column], std::ios::binary | std::ios::app);
+        } else {
+            this->column_files[column].open(this->column_filepaths[column], std::ios::binary | std::ios::trunc);
+        }
+        if (!this->column_files[column].is_open()){
+            std::cerr << "ERROR: Failed to open temporary column file " << this->column_filepaths[column] << " for writing.\n";
+            exit(1);
+        }
+    }
+
+    // Every row holds at least its source, so the index is rebuilt from the SRC column of the kept pairs
+    this->num_pairs = kept_pairs;
+    std::ifstream src_file(this->column_filepaths[0], std::ios::binary);
+    const uint64_t CHUNK_PAIRS = 1 << 20;
+    for (uint64_t first = 0; first < kept_pairs; first += CHUNK_PAIRS){
+        std::vector<int32_t> src_column = read_column_le<int32_t>(src_file, 0, first, std::min(CHUNK_PAIRS, kept_pairs - first));
+        for (uint64_t i = 0; i < src_column.size(); i++){
+            if (this->source_ids.empty() || this->source_ids.back() != src_column[i]){
+                this->source_ids.push_back(src_column[i]);
+                this->row_offsets.push_back(first + i);
+            }
+        }
+    }
+}
+
+uint64_t metrics::dbv_binary_writer::pairs() const {
+    return this->num_pairs;
+}
+
+void metrics::dbv_binary_writer::flush(){
+    for (int column = 0; column < 4; column++){
+        this->column_files[column].flush();
+        if (!this->column_files[column]){
+            std::cerr << "ERROR: Failed to write temporary column file " << this->column_filepaths[column] << "\n";
+            exit(1);
+        }
+    }
+}
+
+void metrics::dbv_binary_writer::append(metrics::distance_btwn_vertices &rows){
+    std::vector<int32_t> src_column;
+    std::vector<int32_t> dst_column;
+    std::vector<double> info_column;
+    std::vector<int32_t> net_column;
+    for (auto &iter : rows){
+        metrics::src_vertex from = iter.first;
+        this->source_ids.push_back(from);
+        this->row_offsets.push_back(this->num_pairs + src_column.size());
+        metrics::dest_vertex previous_to = 0;
+        for (auto &connection : iter.second){
+            metrics::dest_vertex to = connection.first;
+            src_column.push_back(from);
+            dst_column.push_back(this->delta_encode_dst ? to - previous_to : to);
+            info_column.push_back(double(connection.second.info_distance));
+            net_column.push_back(connection.second.net_distance);
+            previous_to = to;
+        }
+    }
+    this->num_pairs += src_column.size();
+    write_values_le(this->column_files[0], src_column);
+    write_values_le(this->column_files[1], dst_column);
+    write_values_le(this->column_files[2], info_column);
+    write_values_le(this->column_files[3], net_column);
+}
+
+void metrics::dbv_binary_writer::finish(){
+    this->row_offsets.push_back(this->num_pairs);
+    dbv_binary_header header = layout_dbv_binary(this->source_ids.size(), this->num_pairs, this->delta_encode_dst);
+    std::ofstream output_file;
+    write_dbv_binary_header(output_file, this->filepath, header);
+    write_column_le(output_file, this->source_ids);
+    write_column_le(output_file, this->row_offsets);
+
+    // Copy each spooled column after the index
+    const uint64_t column_bytes[4] = {sizeof(int32_t), sizeof(int32_t), sizeof(double), sizeof(int32_t)};
+    for (int column = 0; column < 4; column++){
+        this->column_files[column].close();
+        std::ifstream column_file(this->column_filepaths[column], std::ios::binary);
+        if (this->num_pairs > 0){
+            output_file << column_file.rdbuf();
+        }
+        write_padding(output_file, this->num_pairs * column_bytes[column]);
+        column_file.close();
+        std::remove(this->column_filepaths[column].c_str());
+    }
+
+    if (!output_file){
+        std::cerr << "ERROR: Failed to write binary distance file " << this->filepath << "\n";
+        exit(1);
+    }
+    output_file.close();
+}
+
+metrics::distance_to_vertices metrics::load_distance_to_vertices_from_binary(std::string filepath, metrics::src_vertex src){
+    metrics::distance_to_vertices dtv;
+    std::ifstream input_file(filepath, std::ios::binary);
+    dbv_binary_header header = read_dbv_binary_header(input_file, filepath);
+
+    // Binary search the sorted SRC ids of the index for the requested source
+    std::vector<int32_t> source_ids = read_column_le<int32_t>(input_file, header.index_offset, 0, header.num_sources);
+    auto source_iter = std::lower_bound(source_ids.begin(), source_ids.end(), src);
+    if (source_iter == source_ids.end() || *source_iter != src){
+        return dtv;
+    }
+    uint64_t row = source_iter - source_ids.begin();
+    uint64_t row_offsets_offset = align_8(header.index_offset + header.num_sources * sizeof(int32_t));
+    std::vector<uint64_t> row_bounds = read_column_le<uint64_t>(input_file, row_offsets_offset, row, 2);
+    uint64_t row_length = row_bounds[1] - row_bounds[0];
+
+    // Read only the slices of the columns belonging to the row
+    std::vector<int32_t> dst_row = read_column_le<int32_t>(input_file, header.dst_offset, row_bounds[0], row_length);
+    std::vector<double> info_row = read_column_le<double>(input_file, header.info_offset, row_bounds[0], row_length);
+    std::vector<int32_t> net_row = read_column_le<int32_t>(input_file, header.net_offset, row_bounds[0], row_length);
+    decode_dst_row(dst_row, header.flags);
+
+    for (uint64_t i = 0; i < row_length; i++){
+        dtv[dst_row[i]] = {
+            .info_distance = info_row[i],
+            .net_distance = net_row[i]
+        };
+    }
+    return dtv;
+}
+
+metrics::distance_btwn_vertices metrics::load_distance_btwn_vertices_from_binary(std::string filepath){
+    metrics::distance_btwn_vertices dbv;
+    std::ifstream input_file(filepath, std::ios::binary);
+    dbv_binary_header header = read_dbv_binary_header(input_file, filepath);
+
+    std::vector<int32_t> source_ids = read_column_le<int32_t>(input_file, header.index_offset, 0, header.num_sources);
+    uint64_t row_offsets_offset = align_8(header.index_offset + header.num_sources * sizeof(int32_t));
+    std::vector<uint64_t> row_offsets = read_column_le<uint64_t>(input_file, row_offsets_offset, 0, header.num_sources + 1);
+    std::vector<int32_t> dst_column = read_column_le<int32_t>(input_file, header.dst_offset, 0, header.num_pairs);
+    std::vector<double> info_column = read_column_le<double>(input_file, header.info_offset, 0, header.num_pairs);
+    std::vector<int32_t> net_column = read_column_le<int32_t>(input_file, header.net_offset, 0, header.num_pairs);
+
+    for (uint64_t row = 0; row < header.num_sources; row++){
+        metrics::distance_to_vertices &dtv = dbv[source_ids[row]];
+        metrics::dest_vertex to = 0;
+        for (uint64_t i = row_offsets[row]; i < row_offsets[row+1]; i++){
+            to = (header.flags & DBV_BINARY_FLAG_DELTA_DST && i != row_offsets[row]) ? to + dst_column[i] : dst_column[i];
+            dtv[to] = {
+                .info_distance = info_column[i],
+                .net_distance = net_column[i]
+            };
+        }
+    }
+    return dbv;
+}
+
+metrics::distance_btwn_vertices metrics::dtv_to_dbv(metrics::distance_to_vertices dtv, metrics::src_vertex src){
     metrics::distance_btwn_vertices dbn;
     dbn[src] = dtv;
     return dbn;
 }
 
+metrics::laplacian_stats metrics::compute_laplacian_stats(edgelist &neg_laplacian_edgelist){
+    metrics::laplacian_stats stats;
+    stats.dim = neg_laplacian_edgelist.max_vertex();
+    stats.kappa = -INFINITY;
+    stats.mu.assign(stats.dim + 1, -INFINITY);
+    std::vector<edge> neg_laplacian_edges = neg_laplacian_edgelist.get_edges();
+    for (edge edge: neg_laplacian_edges){
+        double abs_weight = std::abs(edge.weight);
+        if (abs_weight > stats.kappa){
+            stats.kappa = abs_weight;
+        }
+        // An edge contributes to the MU of both of its endpoints
+        if (abs_weight > stats.mu[edge.src]){
+            stats.mu[edge.src] = abs_weight;
+        }
+        if (abs_weight > stats.mu[edge.dest]){
+            stats.mu[edge.dest] = abs_weight;
+        }
+    }
+    return stats;
+}
+
 metrics::distance_to_vertices metrics::n_tilda_gamma_neighborhood(edgelist &neg_laplacian_edgelist, edgelist &g_tilda_edgelist, int src, const double gamma){
+    metrics::laplacian_stats stats = metrics::compute_laplacian_stats(neg_laplacian_edgelist);
+    return metrics::n_tilda_gamma_neighborhood(g_tilda_edgelist, stats, src, gamma);
+}
+
+metrics::distance_to_vertices metrics::n_tilda_gamma_neighborhood(edgelist &g_tilda_edgelist, const metrics::laplacian_stats &stats, int src, const double gamma){
     metrics::distance_to_vertices dtv; // Distance to vertex
     std::queue<int> priority_queue; // queue representing the frontier
-    long double MU;
-    long double KAPPA;
+    instrument::search_probe probe(instrument::n_tilda);
 
     // Initialize the src vertex distances to zero
     dtv[src].info_distance = 0;
     dtv[src].net_distance = 0;
 
-    // Initialize MU & KAPPA
-    MU = -INFINITY;
-    KAPPA = -INFINITY;
-    std::vector<edge> neg_laplacian_edges = neg_laplacian_edgelist.get_edges();
-    for (edge edge: neg_laplacian_edges){
-        long double abs_weight = std::abs(edge.weight);
+    // Load MU & KAPPA from the laplacian statistics
+    const long double KAPPA = stats.kappa;
+    const long double MU = (src >= 0 && src <= stats.dim) ? stats.mu[src] : -INFINITY;
 
-        if (abs_weight > KAPPA){
-            KAPPA = abs_weight;
-        }
-        if ( (edge.src == src || edge.dest == src) && abs_weight > MU){
-            MU = abs_weight;
-        }
-    }
     // KAPPA *= funcs::v_func(funcs::EPSILON); Not according github
 
     // Threshold to stop using inverse approximation w_func and start using v_func
@@ -335,6 +1291,7 @@ metrics::distance_to_vertices metrics::n_tilda_gamma_neighborhood(edgelist &neg_
 
         // Iterate through adjacent edges
         std::vector<edge> edges = g_tilda_edgelist.get_edges(from);
+        probe.pop(edges.size());
         for (struct edge edge: edges){
             // Get edge destination and weight
             metrics::src_vertex to = edge.dest;
@@ -380,88 +1337,543 @@ metrics::distance_to_vertices metrics::n_tilda_gamma_neighborhood(edgelist &neg_
                     .net_distance = possible_to_net_distance
                 };
                 dtv[to] = dtp;
+                probe.relaxation();
                 priority_queue.push(to); // If updated, add to the frontier
+                probe.frontier(priority_queue.size());
             } else if (std::abs(current_to_info_distance - possible_to_info_distance) < possible_to_info_distance*MINIMAL_PERCENT_ROUNDING_ERR  && current_to_net_distance > possible_to_net_distance){
                 dtv.at(to).net_distance = possible_to_net_distance;
+                probe.relaxation();
                 priority_queue.push(to);
+                probe.frontier(priority_queue.size());
             }
         }
     }
 
+    probe.finish(dtv.size());
     return dtv;
 }
 
-long double metrics::s_avg_gamma(edgelist &neg_laplacian_edgelist, edgelist &g_tilda_edgelist, const double gamma){
-    int dim = neg_laplacian_edgelist.max_vertex();
-    metrics::distance_to_vertices* res = new metrics::distance_to_vertices[dim+1];
-    #pragma omp parallel for
-    for (int src = 0; src <= dim; src++){
-        res[src] = n_tilda_gamma_neighborhood(neg_laplacian_edgelist, g_tilda_edgelist, src, gamma);
+void metrics::search_scratch::prepare(int vertices){
+    if (this->info_distance.size() < (size_t) vertices){
+        this->info_distance.assign(vertices, INFINITY);
+        this->net_distance.assign(vertices, INT32_MAX);
+        this->in_frontier.assign(vertices, false);
+        this->reached.clear();
     }
-    long double total_size_summation = 0;
-    for (int src = 0; src <= dim; src++){
-        total_size_summation += res[src].size();
-        #ifndef _DEBUG
-        if (total_size_summation > 1E300){
-            std::cout << "Total Sum Of Neighborhood Sizes: " << total_size_summation << "\n";
-            std::cout << "Warning: Precision Loss Risk. Total sum of s_avg_gamma exceeded 1E300.\n";
+    // Only the vertices reached by the previous search need resetting
+    for (int vertex : this->reached){
+        this->info_distance[vertex] = INFINITY;
+        this->net_distance[vertex] = INT32_MAX;
+        this->in_frontier[vertex] = false;
+    }
+    this->reached.clear();
+    this->frontier.clear();
+    this->frontier_head = 0;
+}
+
+uint64_t metrics::search_scratch::bytes_for(int vertices){
+    // The distance arrays and the frontier flags, plus the reached list and the frontier (which can hold re-queued vertices, counted twice)
+    return (uint64_t) vertices * (sizeof(long double) + sizeof(int) + sizeof(char) + sizeof(int) + 2 * sizeof(int));
+}
+
+metrics::distance_to_vertices metrics::search_scratch::to_dtv() const {
+    metrics::distance_to_vertices dtv;
+    for (int vertex : this->reached){
+        dtv[vertex] = {
+            .info_distance = this->info_distance[vertex],
+            .net_distance = this->net_distance[vertex]
+        };
+    }
+    return dtv;
+}
+
+namespace {
+    /**
+     * Label correcting search of geodesic_distance_k / geodesic_distance_tau over a compact graph, leaving the distances in the scratch
+     * @param KERNEL The kernel the search is counted as by the instrumentation
+     * @param skip_edge Returns true if an edge leaving a vertex at the given network distance, reaching the given information distance, exceeds the limit
+    */
+    template <typename SkipFunc>
+    void bounded_geodesic_search(const compact_graph &graph, metrics::src_vertex src, metrics::search_scratch &scratch, instrument::kernel KERNEL, SkipFunc skip_edge){
+        instrument::search_probe probe(KERNEL);
+        scratch.prepare(graph.Vertices);
+        std::vector<long double> &info_distance = scratch.info_distance;
+        std::vector<int> &net_distance = scratch.net_distance;
+
+        // Initialize the src vertex distances to zero
+        info_distance[src] = 0;
+        net_distance[src] = 0;
+        scratch.reached.push_back(src);
+
+        scratch.frontier.push_back(src); // Add src vertex to frontier
+        scratch.in_frontier[src] = true;
+
+        while (scratch.frontier_head < scratch.frontier.size()){ // While frontier not empty
+            // Pop front of frontier to test adjacent endges
+            metrics::src_vertex from = scratch.frontier[scratch.frontier_head++];
+            scratch.in_frontier[from] = false;
+            probe.pop(graph.degree(from));
+
+            // Preload the distances for the frontier vertex
+            long double from_info_distance = info_distance[from];
+            int from_net_distance = net_distance[from];
+
+            // Iterate through adjacent edges
+            for (int64_t e = graph.Offsets[from]; e < graph.Offsets[from+1]; e++){
+                metrics::src_vertex to = graph.Targets[e];
+
+                // Ignore self edges
+                if (to == from){
+                    continue;
+                }
+
+                // Unreached vertices are at INFINITY / INT32_MAX
+                long double current_to_info_distance = info_distance[to];
+                int current_to_net_distance = net_distance[to];
+
+                // Calculate the achieved distances passing through the edge being tested
+                long double possible_to_info_distance = from_info_distance + (long double) graph.Weights[e];
+                int possible_to_net_distance = from_net_distance + 1;
+
+                // Test that passing through the edge meets the condition
+                if (skip_edge(from_net_distance, possible_to_info_distance)){
+                    continue;
+                }
+
+                // Update the data if passing the edge leads to a shorter distance (information > network)
+                bool updated = false;
+                if (current_to_info_distance - possible_to_info_distance > possible_to_info_distance*MINIMAL_PERCENT_ROUNDING_ERR){
+                    if (current_to_info_distance == INFINITY){
+                        scratch.reached.push_back(to);
+                    }
+                    info_distance[to] = possible_to_info_distance;
+                    net_distance[to] = possible_to_net_distance;
+                    updated = true;
+                    probe.relaxation();
+                } else if (std::abs(current_to_info_distance - possible_to_info_distance) < possible_to_info_distance*MINIMAL_PERCENT_ROUNDING_ERR && current_to_net_distance > possible_to_net_distance){
+                    net_distance[to] = possible_to_net_distance;
+                    updated = true;
+                    probe.relaxation();
+                }
+                if (updated && !scratch.in_frontier[to]){
+                    scratch.frontier.push_back(to); // If updated, add to the frontier
+                    scratch.in_frontier[to] = true;
+                    probe.frontier(scratch.frontier.size() - scratch.frontier_head);
+                }
+            }
         }
-        #endif
+        probe.finish(scratch.reached.size());
     }
-    delete[] res;
+}
+
+metrics::distance_to_vertices metrics::geodesic_distance_k(const compact_graph &graph, metrics::src_vertex src, int k, metrics::search_scratch &scratch){
+    bounded_geodesic_search(graph, src, scratch, instrument::geodesic_k, [k](int from_net_distance, long double){
+        return from_net_distance == k;
+    });
+    return scratch.to_dtv();
+}
+
+metrics::distance_to_vertices metrics::geodesic_distance_tau(const compact_graph &graph, metrics::src_vertex src, double tau, metrics::search_scratch &scratch){
+    metrics::geodesic_search_tau(graph, src, tau, scratch);
+    return scratch.to_dtv();
+}
+
+void metrics::geodesic_search_tau(const compact_graph &graph, metrics::src_vertex src, double tau, metrics::search_scratch &scratch){
+    bounded_geodesic_search(graph, src, scratch, instrument::geodesic_tau, [tau](int, long double possible_to_info_distance){
+        return possible_to_info_distance > tau;
+    });
+}
+
+namespace {
+    // Largest number of halvings of the bisection for the information distance bound of an N_tilda(GAMMA) neighborhood
+    const int N_TILDA_BOUND_STEPS = 128;
+
+    // The test of the paths from a source in its N_tilda(GAMMA) neighborhood: a path stays within the neighborhood while its information distance passes
+    class n_tilda_test {
+        public:
+            n_tilda_test(const metrics::laplacian_stats &stats, int src, const double gamma) :
+                // Load MU & KAPPA from the laplacian statistics
+                KAPPA(stats.kappa), MU((src >= 0 && src <= stats.dim) ? stats.mu[src] : -INFINITY), GAMMA(gamma),
+                // Threshold to stop using inverse approximation w_func and start using v_func
+                MAX_APPROX_X(funcs::max_approximation_threshold_w(KAPPA/(gamma * MU)).first) {}
+
+            /**
+             * Whether a path of an information distance stays within the neighborhood
+             * @param info_distance The information distance of the path
+             * @param WARN Whether to warn when v(x) of the distance would exceed the largest double
+             * @return Whether the distance passes
+            */
+            bool passes(long double info_distance, bool WARN) const {
+                if (info_distance < this->MAX_APPROX_X){
+                    // Meets the smaller than approximation condition
+                    return true;
+                } else if (funcs::ALPHA*std::pow(info_distance,funcs::BETA) > 705){
+                    if (WARN){
+                        std::cerr << "WARNING: possible_to_info_distance: " << info_distance << " about to exceed 1E300 after exponentiation. This may exceed max double value, therefor the value will not be calculated and will be considered too large! \n";
+                    }
+                    return false;
+                }
+                // Meets the v_func inequality condition
+                return this->KAPPA / funcs::v_func(info_distance) > this->GAMMA * this->MU;
+            }
+
+            // Returns an information distance that does not pass, found by bisection, every distance that passes is smaller (v(x) only grows with x)
+            double bound() const {
+                double low = 0;
+                // Past the distance whose v(x) would exceed the largest double
+                double high = std::nextafter(std::pow(705 / funcs::ALPHA, 1 / funcs::BETA), INFINITY);
+                while (this->passes(high, false)){
+                    high *= 2;
+                }
+                if (!this->passes(low, false)){
+                    return low;
+                }
+                for (int step = 0; step < N_TILDA_BOUND_STEPS; step++){
+                    double middle = low + (high - low) / 2;
+                    if (middle <= low || middle >= high){
+                        break;
+                    }
+                    (this->passes(middle, false) ? low : high) = middle;
+                }
+                return high;
+            }
+
+        private:
+            const long double KAPPA;
+            const long double MU;
+            const double GAMMA;
+            const long double MAX_APPROX_X;
+    };
+}
+
+size_t metrics::n_tilda_gamma_neighborhood_size(const compact_graph &g_tilda_graph, const metrics::laplacian_stats &stats, int src, const double gamma, metrics::search_scratch &scratch){
+    // Same search as n_tilda_gamma_neighborhood, with the distance map replaced by the scratch arrays
+    scratch.prepare(std::max(g_tilda_graph.Vertices, stats.dim + 1));
+    std::vector<long double> &info_distance = scratch.info_distance;
+    std::vector<int> &net_distance = scratch.net_distance;
+    instrument::search_probe probe(instrument::n_tilda);
+
+    // Initialize the src vertex distances to zero
+    info_distance[src] = 0;
+    net_distance[src] = 0;
+    scratch.reached.push_back(src);
+
+    const n_tilda_test test(stats, src, gamma);
+
+    scratch.frontier.push_back(src); // Add src vertex to frontier
+
+    while (scratch.frontier_head < scratch.frontier.size()){ // While frontier not empty
+        // Pop front of frontier to test adjacent endges
+        metrics::src_vertex from = scratch.frontier[scratch.frontier_head++];
+
+        // Preload the distances for the frontier vertex
+        long double from_info_distance = info_distance[from];
+        int from_net_distance = net_distance[from];
+        probe.pop(g_tilda_graph.degree(from));
+
+        // Iterate through adjacent edges
+        for (int64_t e = g_tilda_graph.Offsets[from]; e < g_tilda_graph.Offsets[from+1]; e++){
+            // Get edge destination and weight
+            metrics::src_vertex to = g_tilda_graph.Targets[e];
+            long double weight = g_tilda_graph.Weights[e];
+
+            // Unreached vertices are at INFINITY / INT32_MAX
+            long double current_to_info_distance = info_distance[to];
+            int current_to_net_distance = net_distance[to];
+            if (current_to_info_distance != INFINITY && current_to_info_distance > 705){
+                std::cout << "current_to_info_distance: " << current_to_info_distance << "\n";
+                std::cout << "current_to_net_distance: " << current_to_net_distance << "\n";
+
+                std::cout << "Warning: Precision Loss Risk. current_to_info_distance exceeded 705.\n";
+            }
+
+            // Calculate the achieved distances passing through the edge being tested
+            long double possible_to_info_distance = from_info_distance + weight;
+            int possible_to_net_distance = from_net_distance + 1;
+
+            // Test that passing through the edge meets the condition
+            if (!test.passes(possible_to_info_distance, true)){
+                continue;
+            }
+
+            // Update the data if passing the edge leads to a shorter distance (information > network)
+            if (current_to_info_distance - possible_to_info_distance > possible_to_info_distance*MINIMAL_PERCENT_ROUNDING_ERR){
+                if (current_to_info_distance == INFINITY){
+                    scratch.reached.push_back(to);
+                }
+                info_distance[to] = possible_to_info_distance;
+                net_distance[to] = possible_to_net_distance;
+                scratch.frontier.push_back(to); // If updated, add to the frontier
+                probe.relaxation();
+                probe.frontier(scratch.frontier.size() - scratch.frontier_head);
+            } else if (std::abs(current_to_info_distance - possible_to_info_distance) < possible_to_info_distance*MINIMAL_PERCENT_ROUNDING_ERR  && current_to_net_distance > possible_to_net_distance){
+                net_distance[to] = possible_to_net_distance;
+                scratch.frontier.push_back(to);
+                probe.relaxation();
+                probe.frontier(scratch.frontier.size() - scratch.frontier_head);
+            }
+        }
+    }
+
+    probe.finish(scratch.reached.size());
+    return scratch.reached.size();
+}
+
+namespace {
+    // Sums the N_tilda(GAMMA) neighborhood sizes of all vertices, with one scratch per thread
+    // The graph searched by each thread. With --numa=replicate every NUMA node searches its own copy of the graph, copied by the first of its threads so the pages are local
+    class graph_replicas {
+        public:
+            graph_replicas(const compact_graph &graph) : graph(graph),
+                replicate(placement::get_numa_mode() == placement::numa_mode::replicate && placement::numa_nodes() > 1),
+                replicas(replicate ? placement::numa_nodes() : 0), replicated(replicas.size()) {}
+
+            // Returns the graph searched by the calling thread
+            const compact_graph* local(){
+                if (!this->replicate){
+                    return &this->graph;
+                }
+                int node = placement::current_numa_node();
+                std::call_once(this->replicated[node], [&](){
+                    this->replicas[node] = std::make_unique<compact_graph>(this->graph);
+                });
+                return this->replicas[node].get();
+            }
+
+        private:
+            const compact_graph &graph;
+            const bool replicate;
+            std::vector<std::unique_ptr<compact_graph>> replicas;
+            std::vector<std::once_flag> replicated;
+    };
+
+    // Adds the neighborhood sizes of the sources FIRST to LAST (inclusive) to total_size_summation in SRC order.
+    // With twin classes only the representatives are searched, each counted once per vertex of its class.
+    long double sum_neighborhood_sizes(graph_replicas &replicas, const metrics::laplacian_stats &stats, const double gamma, int FIRST, int LAST, long double total_size_summation, const twins::twin_classes *classes = nullptr){
+        std::vector<size_t> res(LAST - FIRST + 1);
+
+        #pragma omp parallel
+        {
+            const compact_graph *graph = replicas.local();
+            // Declared inside the parallel region so each thread's scratch is allocated (and first touched) by that thread
+            metrics::search_scratch scratch;
+            #pragma omp for schedule(dynamic, 64)
+            for (int src = FIRST; src <= LAST; src++){
+                if (classes == nullptr){
+                    res[src - FIRST] = metrics::n_tilda_gamma_neighborhood_size(*graph, stats, src, gamma, scratch);
+                } else if (classes->is_representative(src)){
+                    res[src - FIRST] = metrics::n_tilda_gamma_neighborhood_size(*graph, stats, src, gamma, scratch) * classes->ClassSize[src];
+                }
+            }
+        }
+        for (int src = FIRST; src <= LAST; src++){
+            total_size_summation += res[src - FIRST];
+            #ifndef _DEBUG
+            if (total_size_summation > 1E300){
+                std::cout << "Total Sum Of Neighborhood Sizes: " << total_size_summation << "\n";
+                std::cout << "Warning: Precision Loss Risk. Total sum of s_avg_gamma exceeded 1E300.\n";
+            }
+            #endif
+        }
+        return total_size_summation;
+    }
+
+    long double sum_neighborhood_sizes(const compact_graph &g_tilda_graph, const metrics::laplacian_stats &stats, const double gamma, const twins::twin_classes *classes = nullptr){
+        graph_replicas replicas(g_tilda_graph);
+        return sum_neighborhood_sizes(replicas, stats, gamma, 0, stats.dim, 0, classes);
+    }
+
+    // Evaluates a batch of sampled sources once per twin class (once per source without classes), copying the value of each class to its sampled sources
+    template <typename EvaluateFunc>
+    void evaluate_twin_sources(const std::vector<int> &sources, std::vector<double> &values, const twins::twin_classes *classes, EvaluateFunc evaluate){
+        if (classes == nullptr){
+            evaluate(sources, values);
+            return;
+        }
+        std::vector<int> representatives;
+        for (int src : sources){
+            representatives.push_back(classes->Representative[src]);
+        }
+        std::sort(representatives.begin(), representatives.end());
+        representatives.erase(std::unique(representatives.begin(), representatives.end()), representatives.end());
+        std::vector<double> representative_values(representatives.size());
+        evaluate(representatives, representative_values);
+        for (size_t i = 0; i < sources.size(); i++){
+            values[i] = representative_values[std::lower_bound(representatives.begin(), representatives.end(), classes->Representative[sources[i]]) - representatives.begin()];
+        }
+    }
+}
+
+long double metrics::s_avg_gamma(edgelist &neg_laplacian_edgelist, edgelist &g_tilda_edgelist, const double gamma){
+    metrics::laplacian_stats stats = metrics::compute_laplacian_stats(neg_laplacian_edgelist);
+    return metrics::s_avg_gamma(g_tilda_edgelist, stats, gamma);
+}
+
+long double metrics::s_avg_gamma(edgelist &g_tilda_edgelist, const metrics::laplacian_stats &stats, const double gamma){
+    long double total_size_summation = sum_neighborhood_sizes(compact_graph(g_tilda_edgelist, stats.dim + 1), stats, gamma);
     #ifndef _DEBUG
     std::cout << "Total Sum Of Neighborhood Sizes: " << total_size_summation << "\n";
     #endif
-    return total_size_summation / (dim+1);
+    return total_size_summation / (stats.dim+1);
 }
 
-long double metrics::L_neighborhood_reduction_rate(edgelist &neg_laplacian_edgelist, edgelist &g_tilda_edgelist, const int L, int src) {
-    // Can be at most (L-1) edges away
-    metrics::distance_to_vertices dtv = metrics::geodesic_distance_k(g_tilda_edgelist,src,L-1);
+long double metrics::s_avg_gamma(const compact_graph &g_tilda_graph, const metrics::laplacian_stats &stats, const double gamma, const twins::twin_classes *classes){
+    return sum_neighborhood_sizes(g_tilda_graph, stats, gamma, classes) / (stats.dim+1);
+}
 
-    std::vector<long double> distances;
-    for (auto iter : dtv){
-        distances.push_back(iter.second.info_distance);
+long double metrics::neighborhood_size_sum(const compact_graph &g_tilda_graph, const metrics::laplacian_stats &stats, const double gamma, checkpoint::source_progress &progress, const twins::twin_classes *classes){
+    if (!progress.enabled()){
+        return sum_neighborhood_sizes(g_tilda_graph, stats, gamma, classes);
+    }
+    // The running sum is kept exactly, so the sum continues as if the run was never stopped
+    long double total_size_summation = progress.values.empty() ? 0 : checkpoint::decode_long_double(progress.values[0]);
+    graph_replicas replicas(g_tilda_graph);
+    for (int first = progress.next_source; first <= stats.dim; first += progress.block_sources()){
+        int last = std::min(stats.dim, first + progress.block_sources() - 1);
+        total_size_summation = sum_neighborhood_sizes(replicas, stats, gamma, first, last, total_size_summation, classes);
+        progress.save(last + 1, {checkpoint::encode_long_double(total_size_summation)});
     }
-    sort(distances.begin(), distances.end());
+    progress.finish();
+    return total_size_summation;
+}
 
-    // Get the max distance within L vertices
-    long double max_distance = distances.at(std::min(L-1,int(distances.size()-1)));
+long double metrics::neighborhood_size_sum(const reduction::reduced_graph &g_tilda_reduced, const metrics::laplacian_stats &stats, const double gamma){
+    // The searches run to an information distance past every distance passing the test of their source, and each row is then tested like the search
+    std::vector<size_t> res(g_tilda_reduced.Vertices);
+    g_tilda_reduced.for_each_source([&stats, gamma](int src){
+        reduction::search_limit limit;
+        limit.Tau = n_tilda_test(stats, src, gamma).bound();
+        return limit;
+    }, [&res, &stats, gamma](int src, const reduction::distance_row &row){
+        const n_tilda_test test(stats, src, gamma);
+        size_t size = 0;
+        for (size_t i = 0; i < row.Vertices.size(); i++){
+            if (row.Vertices[i] == src || test.passes(row.Info[i], false)){
+                size++;
+            }
+        }
+        res[src] = size;
+    });
+    long double total_size_summation = 0;
+    for (int src = 0; src <= stats.dim; src++){
+        total_size_summation += res[src];
+    }
+    return total_size_summation;
+}
 
-    // Initialize MU & KAPPA
-    long double MU = -INFINITY;
-    long double KAPPA = -INFINITY;
-    std::vector<edge> neg_laplacian_edges = neg_laplacian_edgelist.get_edges();
-    for (edge edge: neg_laplacian_edges){
-        long double abs_weight = std::abs(edge.weight);
+sampling::estimate metrics::s_avg_gamma_estimate(const compact_graph &g_tilda_graph, const metrics::laplacian_stats &stats, const double gamma, const sampling::plan &PLAN, const twins::twin_classes *classes, const reorder::vertex_order *order){
+    std::vector<int> strata;
+    if (PLAN.Design == sampling::design::degree){
+        std::vector<int64_t> degrees(stats.dim + 1);
+        for (int v = 0; v <= stats.dim; v++){
+            degrees[v] = g_tilda_graph.degree(v);
+        }
+        strata = sampling::degree_strata(degrees);
+    }
+    graph_replicas replicas(g_tilda_graph);
+    return sampling::estimate_mean(stats.dim + 1, strata, PLAN, [&](const std::vector<int> &batch, std::vector<double> &batch_values){
+        evaluate_twin_sources(batch, batch_values, classes, [&](const std::vector<int> &sources, std::vector<double> &values){
+            #pragma omp parallel
+            {
+                const compact_graph *graph = replicas.local();
+                metrics::search_scratch scratch;
+                #pragma omp for schedule(dynamic, 64)
+                for (size_t i = 0; i < sources.size(); i++){
+                    values[i] = metrics::n_tilda_gamma_neighborhood_size(*graph, stats, sources[i], gamma, scratch);
+                }
+            }
+        });
+    }, order == nullptr ? nullptr : &order->NewId);
+}
 
-        if (abs_weight > KAPPA){
-            KAPPA = abs_weight;
+long double metrics::L_neighborhood_reduction_rate(edgelist &neg_laplacian_edgelist, edgelist &g_tilda_edgelist, const int L, int src) {
+    metrics::laplacian_stats stats = metrics::compute_laplacian_stats(neg_laplacian_edgelist);
+    return metrics::L_neighborhood_reduction_rate(g_tilda_edgelist, stats, L, src);
+}
+
+namespace {
+    // L_Neighborhood_Reduction_Rate(L) of a source from the information distances of the vertices within (L-1) edges of it
+    long double reduction_rate_of(std::vector<long double> &distances, const metrics::laplacian_stats &stats, const int L, int src){
+        sort(distances.begin(), distances.end());
+
+        // Get the max distance within L vertices
+        long double max_distance = distances.at(std::min(L-1,int(distances.size()-1)));
+
+        // Load MU & KAPPA from the laplacian statistics
+        long double MU = (src >= 0 && src <= stats.dim) ? stats.mu[src] : -INFINITY;
+        long double KAPPA = stats.kappa;
+        if (MU == 0){
+            return INFINITY;
         }
-        if ( (edge.src == src || edge.dest == src) && abs_weight > MU){
-            MU = abs_weight;
+        // KAPPA *= funcs::v_func(funcs::EPSILON); Removed in github
+        long double res = KAPPA / (funcs::v_func(max_distance) * MU);
+        if (res == INFINITY){
+            std::cerr << "L_neighborhood_reduction_rate resulted in infinity\n";
+            std::cerr << funcs::v_func(max_distance) <<"\n";
+            std::cerr << KAPPA << "/" << MU <<"\n";
+            return 0;
         }
+        return res;
     }
-    if (MU == 0){
-        return INFINITY;
+
+    long double reduction_rate_of(const metrics::distance_to_vertices &dtv, const metrics::laplacian_stats &stats, const int L, int src){
+        std::vector<long double> distances;
+        for (auto iter : dtv){
+            distances.push_back(iter.second.info_distance);
+        }
+        return reduction_rate_of(distances, stats, L, src);
     }
-    // KAPPA *= funcs::v_func(funcs::EPSILON); Removed in github
-    long double res = KAPPA / (funcs::v_func(max_distance) * MU);
-    if (res == INFINITY){
-        std::cerr << "L_neighborhood_reduction_rate resulted in infinity\n";
-        std::cerr << funcs::v_func(max_distance) <<"\n";
-        std::cerr << KAPPA << "/" << MU <<"\n";
-        return 0;
+
+    // L_Neighborhood_Reduction_Rate_Avg(L) from the rates of the sources 0 to dim, summed in that order
+    long double average_of_rates(const std::vector<long double> &res, int dim){
+        long double total = 0;
+        int count = 0;
+        for (int src = 0; src <= dim; src++){
+            long double val = res[src];
+            if (val != INFINITY){
+                total += val;
+                count ++;
+            }
+        }
+        if (total == INFINITY){
+            std::cerr << "Total Overflowed\n";
+            exit(1);
+        } else if (count == 0){
+            std::cerr << "No valid values\n";
+            exit(1);
+        }
+        return total / count;
     }
-    return res;
+}
+
+long double metrics::L_neighborhood_reduction_rate(edgelist &g_tilda_edgelist, const metrics::laplacian_stats &stats, const int L, int src) {
+    // Can be at most (L-1) edges away
+    return reduction_rate_of(metrics::geodesic_distance_k(g_tilda_edgelist, src, L-1), stats, L, src);
+}
+
+long double metrics::L_neighborhood_reduction_rate(const compact_graph &g_tilda_graph, const metrics::laplacian_stats &stats, const int L, int src, metrics::search_scratch &scratch) {
+    return reduction_rate_of(metrics::geodesic_distance_k(g_tilda_graph, src, L-1, scratch), stats, L, src);
 }
 
 long double metrics::L_neighborhood_reduction_rate_average(edgelist &neg_laplacian_edgelist, edgelist &g_tilda_edgelist, const int L) {
-    int dim = neg_laplacian_edgelist.max_vertex();
+    metrics::laplacian_stats stats = metrics::compute_laplacian_stats(neg_laplacian_edgelist);
+    return metrics::L_neighborhood_reduction_rate_average(g_tilda_edgelist, stats, L);
+}
+
+long double metrics::L_neighborhood_reduction_rate_average(edgelist &g_tilda_edgelist, const metrics::laplacian_stats &stats, const int L, const twins::twin_classes *classes) {
+    int dim = stats.dim;
     long double* res = new long double[dim+1];
     #pragma omp parallel for
     for (int src = 0; src <= dim; src++){
-        res[src] = L_neighborhood_reduction_rate(neg_laplacian_edgelist, g_tilda_edgelist, L, src);
+        if (classes == nullptr || classes->is_representative(src)){
+            res[src] = L_neighborhood_reduction_rate(g_tilda_edgelist, stats, L, src);
+        }
+    }
+    // Representatives are the smallest vertex of their class, so their rates are set first
+    if (classes != nullptr){
+        for (int src = 0; src <= dim; src++){
+            res[src] = res[classes->Representative[src]];
+        }
     }
     long double total = 0;
     int count = 0;
@@ -481,4 +1893,122 @@ long double metrics::L_neighborhood_reduction_rate_average(edgelist &neg_laplaci
         exit(1);
     }
     return total / count;
-}
\ No newline at end of file
+}
+
+long double metrics::L_neighborhood_reduction_rate_average(edgelist &g_tilda_edgelist, const metrics::laplacian_stats &stats, const int L, checkpoint::source_progress &progress, const twins::twin_classes *classes) {
+    if (!progress.enabled()){
+        return metrics::L_neighborhood_reduction_rate_average(g_tilda_edgelist, stats, L, classes);
+    }
+    int dim = stats.dim;
+    long double total = progress.values.size() == 2 ? checkpoint::decode_long_double(progress.values[0]) : 0;
+    long long count = progress.values.size() == 2 ? std::stoll(progress.values[1]) : 0;
+    std::vector<long double> res(std::min(progress.block_sources(), dim + 1));
+    for (int first = progress.next_source; first <= dim; first += progress.block_sources()){
+        int last = std::min(dim, first + progress.block_sources() - 1);
+        #pragma omp parallel for
+        for (int src = first; src <= last; src++){
+            if (classes == nullptr || classes->is_representative(src)){
+                res[src - first] = L_neighborhood_reduction_rate(g_tilda_edgelist, stats, L, src);
+            }
+        }
+        // A representative counts for every vertex of its class, its twins are skipped
+        for (int src = first; src <= last; src++){
+            long double val = res[src - first];
+            int weight = classes == nullptr ? 1 : classes->ClassSize[src];
+            if (weight > 0 && val != INFINITY){
+                total += val * weight;
+                count += weight;
+            }
+        }
+        progress.save(last + 1, {checkpoint::encode_long_double(total), std::to_string(count)});
+    }
+    progress.finish();
+    if (total == INFINITY){
+        std::cerr << "Total Overflowed\n";
+        exit(1);
+    } else if (count == 0){
+        std::cerr << "No valid values\n";
+        exit(1);
+    }
+    return total / count;
+}
+
+sampling::estimate metrics::L_neighborhood_reduction_rate_average_estimate(edgelist &g_tilda_edgelist, const metrics::laplacian_stats &stats, const int L, const sampling::plan &PLAN, const twins::twin_classes *classes) {
+    std::vector<int> strata;
+    if (PLAN.Design == sampling::design::degree){
+        std::vector<int64_t> degrees(stats.dim + 1);
+        for (int v = 0; v <= stats.dim; v++){
+            degrees[v] = g_tilda_edgelist.get_adjacent_vertices(v).size();
+        }
+        strata = sampling::degree_strata(degrees);
+    }
+    return sampling::estimate_mean(stats.dim + 1, strata, PLAN, [&](const std::vector<int> &batch, std::vector<double> &batch_values){
+        evaluate_twin_sources(batch, batch_values, classes, [&](const std::vector<int> &sources, std::vector<double> &values){
+            #pragma omp parallel for
+            for (size_t i = 0; i < sources.size(); i++){
+                values[i] = L_neighborhood_reduction_rate(g_tilda_edgelist, stats, L, sources[i]);
+            }
+        });
+    });
+}
+
+long double metrics::L_neighborhood_reduction_rate_average(const compact_graph &g_tilda_graph, const metrics::laplacian_stats &stats, const int L, const reorder::vertex_order &order, const twins::twin_classes *classes) {
+    const int V = g_tilda_graph.Vertices;
+    std::vector<long double> res(V);
+    #pragma omp parallel
+    {
+        metrics::search_scratch scratch;
+        #pragma omp for schedule(dynamic, 64)
+        for (int src = 0; src < V; src++){
+            if (classes == nullptr || classes->is_representative(src)){
+                res[src] = L_neighborhood_reduction_rate(g_tilda_graph, stats, L, src, scratch);
+            }
+        }
+    }
+    // Representatives are the smallest vertex of their class, so their rates are set first
+    if (classes != nullptr){
+        for (int src = 0; src < V; src++){
+            res[src] = res[classes->Representative[src]];
+        }
+    }
+    // Summed in the order of the original IDs, as over the edgelist
+    return average_of_rates(order.to_original_ids(res), stats.dim);
+}
+
+long double metrics::L_neighborhood_reduction_rate_average(const reduction::reduced_graph &g_tilda_reduced, const metrics::laplacian_stats &stats, const int L, const reorder::vertex_order *order) {
+    std::vector<long double> res(g_tilda_reduced.Vertices);
+    // Can be at most (L-1) edges away
+    reduction::search_limit limit;
+    limit.K = L - 1;
+    g_tilda_reduced.for_each_source([&limit](int){
+        return limit;
+    }, [&res, &stats, L](int src, const reduction::distance_row &row){
+        std::vector<long double> distances(row.Info);
+        res[src] = reduction_rate_of(distances, stats, L, src);
+    });
+    // Summed in the order of the original IDs, as over the edgelist
+    return average_of_rates(order == nullptr ? res : order->to_original_ids(res), stats.dim);
+}
+
+sampling::estimate metrics::L_neighborhood_reduction_rate_average_estimate(const compact_graph &g_tilda_graph, const metrics::laplacian_stats &stats, const int L, const sampling::plan &PLAN, const reorder::vertex_order &order, const twins::twin_classes *classes) {
+    std::vector<int> strata;
+    if (PLAN.Design == sampling::design::degree){
+        std::vector<int64_t> degrees(stats.dim + 1);
+        for (int v = 0; v <= stats.dim; v++){
+            degrees[v] = g_tilda_graph.degree(v);
+        }
+        strata = sampling::degree_strata(degrees);
+    }
+    return sampling::estimate_mean(stats.dim + 1, strata, PLAN, [&](const std::vector<int> &batch, std::vector<double> &batch_values){
+        evaluate_twin_sources(batch, batch_values, classes, [&](const std::vector<int> &sources, std::vector<double> &values){
+            #pragma omp parallel
+            {
+                metrics::search_scratch scratch;
+                #pragma omp for schedule(dynamic, 64)
+                for (size_t i = 0; i < sources.size(); i++){
+                    values[i] = L_neighborhood_reduction_rate(g_tilda_graph, stats, L, sources[i], scratch);
+                }
+            }
+        });
+    }, &order.NewId);
+}
@@ -1,8 +1,23 @@
 #pragma once
 
 #include <map>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <functional>
+#include <cstdint>
 
 #include "edgelist.h"
+#include "compact_graph.h"
+#include "memory_accounting.h"
+#include "checkpoint.h"
+#include "sampling.h"
+#include "twins.h"
+#include "reorder.h"
+#include "reduction.h"
+
+// Relative difference under which two information distances are equal, so the searches break the tie on the network distance
+const long double MINIMAL_PERCENT_ROUNDING_ERR = 0.00001;
 
 namespace metrics {
 
@@ -21,6 +36,9 @@ namespace metrics {
         distance_pair
     > distance_to_vertices;
 
+    // Estimated bytes of one entry of a distance_to_vertices map
+    const uint64_t DTV_ENTRY_BYTES = memory::MAP_NODE_OVERHEAD_BYTES + sizeof(std::pair<const dest_vertex, distance_pair>);
+
     // ID of the source (starting) vertex
     typedef int src_vertex;
 
@@ -30,17 +48,31 @@ namespace metrics {
         distance_to_vertices
     > distance_btwn_vertices;
 
+    /**
+     * Estimates the bytes held by the maps of a distance_btwn_vertices
+     * @param dbv The distances between vertices
+     * @return The estimated bytes
+    */
+    uint64_t dbv_memory_bytes(distance_btwn_vertices &dbv);
+
     /**
      * Prints the contents of a distance to vertices structure (one to all)
      * @param dtv The targeted distance_to_vertices struct to print
     */
-    void print_distance_to_vertices(distance_to_vertices dtv);
+    void print_distance_to_vertices(distance_to_vertices &dtv);
+
+    /**
+     * Appends the contents of a distance to vertices structure (one to all) in the printed format
+     * @param out The string the lines are appended to
+     * @param dtv The targeted distance_to_vertices struct to format
+    */
+    void append_distance_to_vertices(std::string &out, distance_to_vertices &dtv);
 
     /**
      * Prints the contents of a distance btwn vertices structure (all to all)
      * @param dbv The targeted distance_btwn_vertices struct to print
     */
-    void print_distance_to_vertices(distance_btwn_vertices dbv);
+    void print_distance_to_vertices(distance_btwn_vertices &dbv);
 
     /**
      * Calculates the shortest information distance (sum of edge weights) and network distance (count of edges) prioritized in that order within a maximum of k edges from src
@@ -60,28 +92,134 @@ namespace metrics {
     */
     distance_to_vertices geodesic_distance_tau(edgelist &edgelist, src_vertex src, double tau);
 
+    /**
+     * Same as geodesic_distance_k, but when every edge has the same non-negative weight it copies the edgelist to a compact graph (and its reverse if directed)
+     * and runs a direction-optimizing BFS instead. The copy costs about as much as a search reaching most of the network, so it suits single searches of a loaded network.
+     * @param edgelist The edgelist representing the network edgelist upon which calculations occur.
+     * @param src The vertex that distances are measured from.
+     * @param k The upper bound of network distance (count of edges traversed) that the function explores.
+     * @return A distance_to_vertices struct (one to all) containing the results
+    */
+    distance_to_vertices query_geodesic_distance_k(edgelist &edgelist, src_vertex src, int k);
+
+    /**
+     * Same as geodesic_distance_tau, with the direction-optimizing BFS of query_geodesic_distance_k when every edge has the same non-negative weight
+     * @param edgelist The edgelist representing the network edgelist upon which calculations occur.
+     * @param src The vertex that distances are measured from.
+     * @param tau The upper bound of information distance (sum of edge weights) that the function explores.
+     * @return A distance_to_vertices struct (one to all) containing the results
+    */
+    distance_to_vertices query_geodesic_distance_tau(edgelist &edgelist, src_vertex src, double tau);
+
     /**
      * Calculates the distance from all vertices (starting from vertex 0) in the given edgelist within the limit of k
      * @param edgelist The edgelist representing the network edgelist upon which calculations occur.
      * @param k The upper bound of network distance (count of edges traversed) that the function explores.
+     * @param classes If given, one source per twin class of the edgelist is searched and its row is copied to its twins (unless the sources are searched together anyway)
      * @return A distance_btwn_vertices struct (all to all) containing the results
     */
-    distance_btwn_vertices cross_geodesic_distance_k(edgelist &edgelist, int k);
+    distance_btwn_vertices cross_geodesic_distance_k(edgelist &edgelist, int k, const twins::twin_classes *classes = nullptr);
 
     /**
      * Calculates the distance from all vertices (starting from vertex 0) in the given edgelist within the limit of tau
      * @param edgelist The edgelist representing the network edgelist upon which calculations occur.
      * @param tau The upper bound of information distance (sum of edge weights) that the function explores.
+     * @param classes If given, one source per twin class of the edgelist is searched and its row is copied to its twins (unless the sources are searched together anyway)
+     * @param DENSE_BUDGET The bytes the dense all pairs matrices may take (at most half the available memory, which is also the default)
      * @return A distance_btwn_vertices struct (all to all) containing the results
     */
-    distance_btwn_vertices cross_geodesic_distance_tau(edgelist &edgelist, double tau);
+    distance_btwn_vertices cross_geodesic_distance_tau(edgelist &edgelist, double tau, const twins::twin_classes *classes = nullptr, uint64_t DENSE_BUDGET = UINT64_MAX);
+
+    /**
+     * Returns the bytes of the dense all pairs matrices cross_geodesic_distance_tau can compute the distances of an edgelist with
+     * @param edgelist The edgelist
+     * @return The bytes of the matrices, 0 if the dense path cannot be taken (uniform weights, fewer vertices than a tile or a weight that is not positive)
+    */
+    uint64_t dense_tau_bytes(edgelist &edgelist);
+
+    /**
+     * Calculates the same distances as cross_geodesic_distance_k, handing the rows to consume in blocks of consecutive sources (in SRC order) so only one block is held at a time
+     * @param edgelist The edgelist representing the network edgelist upon which calculations occur.
+     * @param k The upper bound of network distance (count of edges traversed) that the function explores.
+     * @param BLOCK_SOURCES The largest number of sources in a block
+     * @param consume Called with each block of rows
+     * @param FIRST_SOURCE The first source searched, the sources before it are skipped (eg. done before a checkpoint)
+    */
+    void stream_cross_geodesic_distance_k(edgelist &edgelist, int k, int BLOCK_SOURCES, std::function<void(distance_btwn_vertices&)> consume, int FIRST_SOURCE = 0);
+
+    /**
+     * Calculates the same distances as cross_geodesic_distance_tau, handing the rows to consume in blocks of consecutive sources (in SRC order) so only one block is held at a time
+     * @param edgelist The edgelist representing the network edgelist upon which calculations occur.
+     * @param tau The upper bound of information distance (sum of edge weights) that the function explores.
+     * @param BLOCK_SOURCES The largest number of sources in a block
+     * @param consume Called with each block of rows
+     * @param FIRST_SOURCE The first source searched, the sources before it are skipped (eg. done before a checkpoint)
+    */
+    void stream_cross_geodesic_distance_tau(edgelist &edgelist, double tau, int BLOCK_SOURCES, std::function<void(distance_btwn_vertices&)> consume, int FIRST_SOURCE = 0);
+
+    /**
+     * Calculates the distances between the vertices of an undirected network within the limit of k, each unordered pair once:
+     * the row of each source only holds the destinations from the source upward (DST >= SRC, the source keeps its zero distance to itself).
+     * Each search still runs in full, since shortest paths to higher vertices can pass through lower ones, so only the stored pairs are halved.
+     * @param edgelist The edgelist representing the undirected network upon which calculations occur.
+     * @param k The upper bound of network distance (count of edges traversed) that the function explores.
+     * @param classes If given, one source per twin class of the edgelist is searched and its row is copied to its twins (unless the sources are searched together anyway)
+     * @return A distance_btwn_vertices struct holding each unordered pair once
+    */
+    distance_btwn_vertices cross_geodesic_distance_k_undirected(edgelist &edgelist, int k, const twins::twin_classes *classes = nullptr);
+
+    /**
+     * Calculates the distances between the vertices of an undirected network within the limit of tau, each unordered pair once (DST >= SRC).
+     * Without PRUNE each search still runs in full and its lower half is dropped once it finishes, so only the stored pairs are halved.
+     * With PRUNE, a search that reaches a source whose search already finished relaxes that source's row instead of its edges,
+     * and the vertices whose distance came from such a row are not expanded (what lies behind them is covered by the row).
+     * The finished rows are kept whole until every search is done, so pruning trades memory for fewer expansions.
+     * Info distances found through a row can differ from the unpruned ones by floating point rounding.
+     * @param edgelist The edgelist representing the undirected network upon which calculations occur.
+     * @param tau The upper bound of information distance (sum of edge weights) that the function explores.
+     * @param PRUNE Whether if searches reuse the rows of the finished searches
+     * @param classes If given (without PRUNE), one source per twin class of the edgelist is searched and its row is copied to its twins (unless the sources are searched together anyway)
+     * @param DENSE_BUDGET The bytes the dense all pairs matrices may take (at most half the available memory, which is also the default)
+     * @return A distance_btwn_vertices struct holding each unordered pair once
+    */
+    distance_btwn_vertices cross_geodesic_distance_tau_undirected(edgelist &edgelist, double tau, bool PRUNE = false, const twins::twin_classes *classes = nullptr, uint64_t DENSE_BUDGET = UINT64_MAX);
+
+    /**
+     * Calculates the distances between the vertices of a relabeled compact graph within the limit of k. The sources are searched in the order of
+     * their new IDs (consecutive sources on the same thread), and the rows are returned under the original IDs.
+     * Each row keeps its edge order, so the distances are the same as cross_geodesic_distance_k over the edgelist, without its shortcuts for uniform weights.
+     * @param graph The relabeled graph
+     * @param k The upper bound of network distance (count of edges traversed) that the function explores.
+     * @param order The order the graph was relabeled with
+     * @param UPPER_PAIRS Whether each row only keeps the destinations from its source upward (original IDs, DST >= SRC), for undirected networks
+     * @param classes If given, the twin classes of the relabeled graph: one source per class is searched and its row is copied to its twins
+     * @return A distance_btwn_vertices struct under the original IDs
+    */
+    distance_btwn_vertices cross_geodesic_distance_k(const compact_graph &graph, int k, const reorder::vertex_order &order, bool UPPER_PAIRS = false, const twins::twin_classes *classes = nullptr);
+
+    /**
+     * Calculates the distances between the vertices of a relabeled compact graph within the limit of tau, like the relabeled cross_geodesic_distance_k
+     * @param graph The relabeled graph
+     * @param tau The upper bound of information distance (sum of edge weights) that the function explores.
+     * @param order The order the graph was relabeled with
+     * @param UPPER_PAIRS Whether each row only keeps the destinations from its source upward (original IDs, DST >= SRC), for undirected networks
+     * @param classes If given, the twin classes of the relabeled graph: one source per class is searched and its row is copied to its twins
+     * @return A distance_btwn_vertices struct under the original IDs
+    */
+    distance_btwn_vertices cross_geodesic_distance_tau(const compact_graph &graph, double tau, const reorder::vertex_order &order, bool UPPER_PAIRS = false, const twins::twin_classes *classes = nullptr);
+
+    /**
+     * Removes the pairs below the source from every row (DST < SRC), leaving each unordered pair of an undirected network once
+     * @param dbv The rows, eg. a block handed on by stream_cross_geodesic_distance_k
+    */
+    void keep_upper_pairs(distance_btwn_vertices &dbv);
 
     /**
      * Saves the contents of a distance_btwn_vertices struct in csv format
      * @param filename Filename (as path) of the output file (assumes file does not exist yet)
      * @param dbv The target distance_btwn_vertices struct to save
     */
-    void save_distance_btwn_vertices_to_file(std::string filename, distance_btwn_vertices dbv);
+    void save_distance_btwn_vertices_to_file(std::string filename, distance_btwn_vertices &dbv);
 
     /**
      * Saves the contents of a distance_btwn_vertices struct in SQLite3 database format
@@ -91,6 +229,71 @@ namespace metrics {
     */
     void dbv_to_sqlite(std::string filepath, std::string table_name, distance_btwn_vertices dbv);
 
+    /**
+     * Saves the contents of a distance_btwn_vertices struct in the columnar binary format (little-endian).
+     * Layout: 72 byte header, per-source index (sorted SRC ids and row offsets), then the SRC, DST, INFO_DIST (float64) and NET_DIST columns.
+     * Every section starts on an 8 byte boundary so each column can be memory mapped directly (see scripts/helpers/dbv_binary.py).
+     * @param filepath Filepath of the output binary file (overwritten if it exists)
+     * @param dbv The target distance_btwn_vertices struct to save
+     * @param delta_encode_dst Whether if the DST column is stored as the difference to the previous DST within the same source row
+    */
+    void save_distance_btwn_vertices_to_binary(std::string filepath, distance_btwn_vertices &dbv, bool delta_encode_dst = false);
+
+    /**
+     * Writes the columnar binary format of save_distance_btwn_vertices_to_binary from rows appended in blocks, without holding all of them.
+     * The columns are spooled to temporary files next to the output and assembled into the output by finish.
+    */
+    class dbv_binary_writer {
+        public:
+            /**
+             * Starts a binary file, or continues the temporary files of a writer that was stopped before finishing
+             * @param filepath Filepath of the output binary file (overwritten if it exists)
+             * @param delta_encode_dst Whether if the DST column is stored as the difference to the previous DST within the same source row
+             * @param kept_pairs The number of pairs of the stopped writer kept (its temporary files are cut to them), 0 starts over
+            */
+            dbv_binary_writer(std::string filepath, bool delta_encode_dst = false, uint64_t kept_pairs = 0);
+
+            /**
+             * Appends rows, their sources must be larger than the sources of the rows appended before
+             * @param rows The rows to append
+            */
+            void append(distance_btwn_vertices &rows);
+
+            // Returns the number of pairs appended
+            uint64_t pairs() const;
+
+            // Flushes the temporary files so the appended pairs survive the process stopping
+            void flush();
+
+            // Writes the output file and removes the temporary files
+            void finish();
+
+        private:
+            std::string filepath;
+            bool delta_encode_dst;
+            std::vector<int32_t> source_ids;
+            std::vector<uint64_t> row_offsets;
+            uint64_t num_pairs = 0;
+            // Temporary files of the SRC, DST, INFO_DIST and NET_DIST columns
+            std::string column_filepaths[4];
+            std::ofstream column_files[4];
+    };
+
+    /**
+     * Loads the row of a single source from a columnar binary file without scanning the rest of the file
+     * @param filepath Filepath of the binary file written by save_distance_btwn_vertices_to_binary
+     * @param src The vertex ID of the source whose row is loaded
+     * @return A distance_to_vertices struct containing the row (empty if the source is not in the file)
+    */
+    distance_to_vertices load_distance_to_vertices_from_binary(std::string filepath, src_vertex src);
+
+    /**
+     * Loads a complete columnar binary file back into a distance_btwn_vertices struct
+     * @param filepath Filepath of the binary file written by save_distance_btwn_vertices_to_binary
+     * @return A distance_btwn_vertices struct containing every row in the file
+    */
+    distance_btwn_vertices load_distance_btwn_vertices_from_binary(std::string filepath);
+
     /**
      * Casts a distance_to_vertices struct to the format of the distance_btwn_vertices struct
      * @param dtv The target distance_to_vertices struct to cast
@@ -98,6 +301,23 @@ namespace metrics {
     */
     distance_btwn_vertices dtv_to_dbv(distance_to_vertices dtv, src_vertex src);
 
+    // Statistics of a negative laplacian edgelist used by the gamma neighborhood and L reduction metrics
+    struct laplacian_stats {
+        // Largest vertex ID in the negative laplacian edgelist
+        int dim;
+        // KAPPA: the largest absolute edge weight in the negative laplacian
+        long double kappa;
+        // MU of each vertex: the largest absolute weight of the negative laplacian edges touching the vertex (-INFINITY if none)
+        std::vector<double> mu;
+    };
+
+    /**
+     * Calculates the laplacian statistics (KAPPA and MU of every vertex) of a negative laplacian edgelist in a single pass over its edges
+     * @param neg_laplacian_edgelist The negative laplacian edgelist
+     * @return A laplacian_stats struct containing the results
+    */
+    laplacian_stats compute_laplacian_stats(edgelist &neg_laplacian_edgelist);
+
     /**
      * Calculates a N_tilda(GAMMA) neighborhood with a given set of negative laplacian and g_tilda edgelists, src vertex, and gamma
      * @param neg_laplacian_edgelist The negative laplacian edgelist
@@ -108,6 +328,87 @@ namespace metrics {
     */
     metrics::distance_to_vertices n_tilda_gamma_neighborhood(edgelist &neg_laplacian_edgelist, edgelist &g_tilda_edgelist, int src, const double gamma);
 
+    /**
+     * Calculates a N_tilda(GAMMA) neighborhood using precomputed laplacian statistics instead of rescanning the negative laplacian
+     * @param g_tilda_edglist The G_tilda edgelist
+     * @param stats The laplacian statistics of the negative laplacian edgelist
+     * @param src The vertex ID of the source vertex the neighborhood is centered around
+     * @param gamma The value of Gamma used to calculate the neighborhood
+     * @return Returns a distance_to_vertices struct containing the distances to all the vertices within the neighborhood
+    */
+    metrics::distance_to_vertices n_tilda_gamma_neighborhood(edgelist &g_tilda_edgelist, const laplacian_stats &stats, int src, const double gamma);
+
+    // Per-thread working memory of the searches over a compact graph. Sized once per graph and reset in O(vertices reached) between sources, so repeated searches do not allocate.
+    struct search_scratch {
+        // Information distance to each vertex (INFINITY if not reached by the current search)
+        std::vector<long double> info_distance;
+        // Network distance to each vertex
+        std::vector<int> net_distance;
+        // Vertices reached by the current search
+        std::vector<int> reached;
+        // FIFO frontier of the current search, popped by advancing frontier_head
+        std::vector<int> frontier;
+        size_t frontier_head = 0;
+        // Whether if each vertex is currently in the frontier (for the searches that never queue a vertex twice)
+        std::vector<char> in_frontier;
+
+        /**
+         * Sizes the scratch for a graph and clears the previous search
+         * @param vertices The number of vertex slots of the graph searched
+        */
+        void prepare(int vertices);
+
+        // Returns the distances to the vertices reached by the last search
+        distance_to_vertices to_dtv() const;
+
+        /**
+         * Estimates the bytes of a scratch prepared for a graph (with every vertex reached)
+         * @param vertices The number of vertex slots of the graph searched
+         * @return The estimated bytes
+        */
+        static uint64_t bytes_for(int vertices);
+    };
+
+    /**
+     * Same as geodesic_distance_k, over a compact graph and reusing the given scratch
+     * @param graph The compact graph upon which calculations occur.
+     * @param src The vertex that distances are measured from.
+     * @param k The upper bound of network distance (count of edges traversed) that the function explores.
+     * @param scratch The scratch of the calling thread
+     * @return A distance_to_vertices struct (one to all) containing the results
+    */
+    distance_to_vertices geodesic_distance_k(const compact_graph &graph, src_vertex src, int k, search_scratch &scratch);
+
+    /**
+     * Same as geodesic_distance_tau, over a compact graph and reusing the given scratch
+     * @param graph The compact graph upon which calculations occur.
+     * @param src The vertex that distances are measured from.
+     * @param tau The upper bound of information distance (sum of edge weights) that the function explores.
+     * @param scratch The scratch of the calling thread
+     * @return A distance_to_vertices struct (one to all) containing the results
+    */
+    distance_to_vertices geodesic_distance_tau(const compact_graph &graph, src_vertex src, double tau, search_scratch &scratch);
+
+    /**
+     * Same as geodesic_distance_tau over a compact graph, leaving the distances in the scratch instead of copying them out, for callers that reduce them in place
+     * @param graph The compact graph upon which calculations occur.
+     * @param src The vertex that distances are measured from.
+     * @param tau The upper bound of information distance (sum of edge weights) that the function explores.
+     * @param scratch The scratch of the calling thread, holds the distances of the reached vertices afterwards
+    */
+    void geodesic_search_tau(const compact_graph &graph, src_vertex src, double tau, search_scratch &scratch);
+
+    /**
+     * Calculates the size of a N_tilda(GAMMA) neighborhood over a compact g_tilda graph, reusing the given scratch
+     * @param g_tilda_graph The compact G_tilda graph
+     * @param stats The laplacian statistics of the negative laplacian edgelist
+     * @param src The vertex ID of the source vertex the neighborhood is centered around
+     * @param gamma The value of Gamma used to calculate the neighborhood
+     * @param scratch The scratch of the calling thread, holds the distances of the neighborhood afterwards
+     * @return The number of vertices in the neighborhood
+    */
+    size_t n_tilda_gamma_neighborhood_size(const compact_graph &g_tilda_graph, const laplacian_stats &stats, int src, const double gamma, search_scratch &scratch);
+
     /**
      * Calculates S_avg(Gamma) for a given set of laplacian and g_tilda edgelists, and gamma
      * @param neg_laplacian_edgelist The negative laplacian edgelist
@@ -117,6 +418,61 @@ namespace metrics {
     */
     long double s_avg_gamma(edgelist &neg_laplacian_edgelist, edgelist &g_tilda_edgelist, const double gamma);
 
+    /**
+     * Calculates S_avg(Gamma) for a g_tilda edgelist with precomputed laplacian statistics, and gamma
+     * @param g_tilda_edglist The G_tilda edgelist
+     * @param stats The laplacian statistics of the negative laplacian edgelist
+     * @param gamma The value of Gamma used to calculate the neighborhood
+     * @return S_avg
+    */
+    long double s_avg_gamma(edgelist &g_tilda_edgelist, const laplacian_stats &stats, const double gamma);
+
+    /**
+     * Calculates S_avg(Gamma) for a compact g_tilda graph with precomputed laplacian statistics, and gamma
+     * @param g_tilda_graph The compact G_tilda graph
+     * @param stats The laplacian statistics of the negative laplacian edgelist
+     * @param gamma The value of Gamma used to calculate the neighborhood
+     * @param classes If given, the twin classes of the graph labelled by MU: one source per class is searched and counted once per vertex of the class
+     * @return S_avg
+    */
+    long double s_avg_gamma(const compact_graph &g_tilda_graph, const laplacian_stats &stats, const double gamma, const twins::twin_classes *classes = nullptr);
+
+    /**
+     * Calculates the sum of the N_tilda(Gamma) neighborhood sizes of every source behind S_avg(Gamma) (S_avg is the sum over stats.dim + 1) for a
+     * compact g_tilda graph, checkpointing the sum after each block of sources. Resumes after the sources done in the progress and gives the same
+     * sum as an uninterrupted run.
+     * @param g_tilda_graph The compact G_tilda graph
+     * @param stats The laplacian statistics of the negative laplacian edgelist
+     * @param gamma The value of Gamma used to calculate the neighborhood
+     * @param progress The progress of the calculation (calculated in one block if disabled)
+     * @param classes If given, the twin classes of the graph labelled by MU: one source per class is searched and counted once per vertex of the class
+     * @return The sum of the neighborhood sizes
+    */
+    long double neighborhood_size_sum(const compact_graph &g_tilda_graph, const laplacian_stats &stats, const double gamma, checkpoint::source_progress &progress, const twins::twin_classes *classes = nullptr);
+
+    /**
+     * Calculates the sum of the N_tilda(Gamma) neighborhood sizes of every source from the kernel searches of a reduced g_tilda graph (see reduction.h).
+     * The neighborhood of a source ends at an information distance that depends on its MU, so the searches shared by the vertices of a chain or
+     * a tree run to the largest of their bounds and each row is then tested with the bound of its own source.
+     * @param g_tilda_reduced The reduced G_tilda graph
+     * @param stats The laplacian statistics of the negative laplacian edgelist
+     * @param gamma The value of Gamma used to calculate the neighborhood
+     * @return The sum of the neighborhood sizes
+    */
+    long double neighborhood_size_sum(const reduction::reduced_graph &g_tilda_reduced, const laplacian_stats &stats, const double gamma);
+
+    /**
+     * Estimates S_avg(Gamma) for a compact g tilda graph from a sample of the sources, searching batches of sources until the plan is met
+     * @param g_tilda_graph The compact G_tilda graph
+     * @param stats The laplacian statistics of the negative laplacian edgelist
+     * @param gamma The value of Gamma used to calculate the neighborhood
+     * @param PLAN The sampling plan, the degree strata are the out-degrees of the graph
+     * @param classes If given, the twin classes of the graph labelled by MU: the sampled sources of a class share one search
+     * @param order If the graph was relabeled, its order: the sample is drawn over the original IDs, so it is the same as for the original graph
+     * @return The estimate of S_avg
+    */
+    sampling::estimate s_avg_gamma_estimate(const compact_graph &g_tilda_graph, const laplacian_stats &stats, const double gamma, const sampling::plan &PLAN, const twins::twin_classes *classes = nullptr, const reorder::vertex_order *order = nullptr);
+
     /**
      * Calculates L_Neighborhood_Reduction_Rate(L) for a given set of laplacian and g_tilda edgelists, and L
      * @param neg_laplacian_edgelist The negative laplacian edgelist
@@ -127,6 +483,16 @@ namespace metrics {
     */
     long double L_neighborhood_reduction_rate(edgelist &neg_laplacian_edgelist, edgelist &g_tilda_edgelist, const int L, int src);
 
+    /**
+     * Calculates L_Neighborhood_Reduction_Rate(L) for a g_tilda edgelist with precomputed laplacian statistics, and L
+     * @param g_tilda_edglist The G_tilda edgelist
+     * @param stats The laplacian statistics of the negative laplacian edgelist
+     * @param L The value of L used to calculate the neighborhood
+     * @param src The source vertex ID the neighborhood is centered around
+     * @return L_neighborhood_reduction_rate
+    */
+    long double L_neighborhood_reduction_rate(edgelist &g_tilda_edgelist, const laplacian_stats &stats, const int L, int src);
+
     /**
      * Calculates L_Neighborhood_Reduction_Rate_Avg(L) for a given set of laplacian and g_tilda edgelists, and L
      * @param neg_laplacian_edgelist The negative laplacian edgelist
@@ -135,4 +501,82 @@ namespace metrics {
      * @return L_neighborhood_reduction_rate_avg
     */
     long double L_neighborhood_reduction_rate_average(edgelist &neg_laplacian_edgelist, edgelist &g_tilda_edgelist, const int L);
+
+    /**
+     * Calculates L_Neighborhood_Reduction_Rate_Avg(L) for a g_tilda edgelist with precomputed laplacian statistics, and L
+     * @param g_tilda_edglist The G_tilda edgelist
+     * @param stats The laplacian statistics of the negative laplacian edgelist
+     * @param L The value of L used to calculate the neighborhood
+     * @param classes If given, the twin classes of the g_tilda edgelist labelled by MU: one source per class is searched and its rate is copied to its twins
+     * @return L_neighborhood_reduction_rate_avg
+    */
+    long double L_neighborhood_reduction_rate_average(edgelist &g_tilda_edgelist, const laplacian_stats &stats, const int L, const twins::twin_classes *classes = nullptr);
+
+    /**
+     * Calculates L_Neighborhood_Reduction_Rate_Avg(L) like L_neighborhood_reduction_rate_average, checkpointing the running total and count after each block of sources.
+     * Resumes after the sources done in the progress and gives the same result as an uninterrupted run.
+     * @param g_tilda_edglist The G_tilda edgelist
+     * @param stats The laplacian statistics of the negative laplacian edgelist
+     * @param L The value of L used to calculate the neighborhood
+     * @param progress The progress of the calculation
+     * @param classes If given, the twin classes of the g_tilda edgelist labelled by MU: one source per class is searched and its rate is copied to its twins
+     * @return L_neighborhood_reduction_rate_avg
+    */
+    long double L_neighborhood_reduction_rate_average(edgelist &g_tilda_edgelist, const laplacian_stats &stats, const int L, checkpoint::source_progress &progress, const twins::twin_classes *classes = nullptr);
+
+    /**
+     * Estimates L_Neighborhood_Reduction_Rate_Avg(L) from a sample of the sources, searching batches of sources until the plan is met
+     * @param g_tilda_edglist The G_tilda edgelist
+     * @param stats The laplacian statistics of the negative laplacian edgelist
+     * @param L The value of L used to calculate the neighborhood
+     * @param PLAN The sampling plan, the degree strata are the degrees in the edgelist
+     * @param classes If given, the twin classes of the g_tilda edgelist labelled by MU: the sampled sources of a class share one search
+     * @return The estimate of L_neighborhood_reduction_rate_avg
+    */
+    sampling::estimate L_neighborhood_reduction_rate_average_estimate(edgelist &g_tilda_edgelist, const laplacian_stats &stats, const int L, const sampling::plan &PLAN, const twins::twin_classes *classes = nullptr);
+
+    /**
+     * Calculates L_Neighborhood_Reduction_Rate(L) for a compact g_tilda graph, like the edgelist version
+     * @param g_tilda_graph The compact G_tilda graph
+     * @param stats The laplacian statistics of the negative laplacian edgelist (MU indexed like the graph)
+     * @param L The value of L used to calculate the neighborhood
+     * @param src The source vertex ID the neighborhood is centered around
+     * @param scratch The search scratch of the calling thread
+     * @return L_neighborhood_reduction_rate
+    */
+    long double L_neighborhood_reduction_rate(const compact_graph &g_tilda_graph, const laplacian_stats &stats, const int L, int src, search_scratch &scratch);
+
+    /**
+     * Calculates L_Neighborhood_Reduction_Rate_Avg(L) for a relabeled compact g_tilda graph. The sources are searched in the order of their new IDs,
+     * and the rates are summed in the order of the original IDs, so the average is the same as for the edgelist.
+     * @param g_tilda_graph The relabeled compact G_tilda graph
+     * @param stats The laplacian statistics of the negative laplacian edgelist (MU indexed by the new IDs)
+     * @param L The value of L used to calculate the neighborhood
+     * @param order The order the graph was relabeled with
+     * @param classes If given, the twin classes of the relabeled graph labelled by MU: each class is searched once
+     * @return L_neighborhood_reduction_rate_avg
+    */
+    long double L_neighborhood_reduction_rate_average(const compact_graph &g_tilda_graph, const laplacian_stats &stats, const int L, const reorder::vertex_order &order, const twins::twin_classes *classes = nullptr);
+
+    /**
+     * Calculates L_Neighborhood_Reduction_Rate_Avg(L) from the kernel searches of a reduced g_tilda graph (see reduction.h), limited to (L-1) edges
+     * @param g_tilda_reduced The reduced G_tilda graph
+     * @param stats The laplacian statistics of the negative laplacian edgelist (MU indexed like the graph)
+     * @param L The value of L used to calculate the neighborhood
+     * @param order If the graph was relabeled, its order: the rates are summed in the order of the original IDs
+     * @return L_neighborhood_reduction_rate_avg
+    */
+    long double L_neighborhood_reduction_rate_average(const reduction::reduced_graph &g_tilda_reduced, const laplacian_stats &stats, const int L, const reorder::vertex_order *order = nullptr);
+
+    /**
+     * Estimates L_Neighborhood_Reduction_Rate_Avg(L) for a relabeled compact g_tilda graph from a sample of the sources drawn over the original IDs
+     * @param g_tilda_graph The relabeled compact G_tilda graph
+     * @param stats The laplacian statistics of the negative laplacian edgelist (MU indexed by the new IDs)
+     * @param L The value of L used to calculate the neighborhood
+     * @param PLAN The sampling plan, the degree strata are the degrees of the graph (the adjacent vertices of the edgelist, unless it has parallel edges)
+     * @param order The order the graph was relabeled with
+     * @param classes If given, the twin classes of the relabeled graph labelled by MU: the sampled sources of a class share one search
+     * @return The estimate of L_neighborhood_reduction_rate_avg
+    */
+    sampling::estimate L_neighborhood_reduction_rate_average_estimate(const compact_graph &g_tilda_graph, const laplacian_stats &stats, const int L, const sampling::plan &PLAN, const reorder::vertex_order &order, const twins::twin_classes *classes = nullptr);
 };
\ No newline at end of file
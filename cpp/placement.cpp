@@ -0,0 +1,229 @@
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <filesystem>
+#include <cstdlib>
+#include <omp.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include "placement.h"
+
+namespace {
+    placement::numa_mode NumaMode = placement::numa_mode::first_touch;
+    placement::huge_page_mode HugePageMode = placement::huge_page_mode::off;
+    // CPUs the process was allowed to run on before the OpenMP threads were pinned, restored by unpin_current_thread
+    cpu_set_t ProcessMask;
+    bool Pinned = false;
+
+    // Size of a huge page, large arrays are mapped in multiples of it
+    const size_t HUGE_PAGE_BYTES = 2 << 20;
+
+    // CPUs of each NUMA node, read once
+    struct numa_topology {
+        std::vector<std::vector<int>> node_cpus;
+        std::vector<int> cpu_node;
+    };
+
+    // Parses a sysfs CPU list such as "0-3,8-11"
+    std::vector<int> parse_cpu_list(std::string list){
+        std::vector<int> cpus;
+        std::stringstream items(list);
+        std::string item;
+        while (std::getline(items, item, ',')){
+            size_t dash = item.find('-');
+            try {
+                int first = std::stoi(item.substr(0, dash));
+                int last = dash == std::string::npos ? first : std::stoi(item.substr(dash + 1));
+                for (int cpu = first; cpu <= last; cpu++){
+                    cpus.push_back(cpu);
+                }
+            } catch (...){
+                continue;
+            }
+        }
+        return cpus;
+    }
+
+    const numa_topology& topology(){
+        static numa_topology topology = [](){
+            numa_topology read;
+            std::error_code ec;
+            for (int node = 0; std::filesystem::exists("/sys/devices/system/node/node" + std::to_string(node), ec); node++){
+                std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+                std::string list;
+                std::getline(file, list);
+                read.node_cpus.push_back(parse_cpu_list(list));
+            }
+            if (read.node_cpus.empty()){
+                // No NUMA information: a single node with every CPU
+                std::vector<int> cpus;
+                for (int cpu = 0; cpu < CPU_SETSIZE; cpu++){
+                    cpus.push_back(cpu);
+                }
+                read.node_cpus.push_back(cpus);
+            }
+            for (size_t node = 0; node < read.node_cpus.size(); node++){
+                for (int cpu : read.node_cpus[node]){
+                    if ((int) read.cpu_node.size() <= cpu){
+                        read.cpu_node.resize(cpu + 1, 0);
+                    }
+                    read.cpu_node[cpu] = node;
+                }
+            }
+            return read;
+        }();
+        return topology;
+    }
+
+    // Pins every OpenMP thread to one CPU of the process' allowed set
+    void pin_threads(placement::pin_mode mode){
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        sched_getaffinity(0, sizeof(allowed), &allowed);
+        ProcessMask = allowed;
+        Pinned = true;
+
+        // The allowed CPUs of each node, in node order
+        std::vector<std::vector<int>> node_cpus;
+        for (const std::vector<int> &cpus : topology().node_cpus){
+            std::vector<int> usable;
+            for (int cpu : cpus){
+                if (CPU_ISSET(cpu, &allowed)){
+                    usable.push_back(cpu);
+                }
+            }
+            if (!usable.empty()){
+                node_cpus.push_back(usable);
+            }
+        }
+        if (node_cpus.empty()){
+            return;
+        }
+
+        size_t usable_count = 0;
+        for (std::vector<int> &cpus : node_cpus){
+            usable_count += cpus.size();
+        }
+        std::vector<int> order;
+        if (mode == placement::pin_mode::compact){
+            for (std::vector<int> &cpus : node_cpus){
+                order.insert(order.end(), cpus.begin(), cpus.end());
+            }
+        } else {
+            for (size_t i = 0; order.size() < usable_count; i++){
+                for (std::vector<int> &cpus : node_cpus){
+                    if (i < cpus.size()){
+                        order.push_back(cpus[i]);
+                    }
+                }
+            }
+        }
+
+        // The OpenMP runtime keeps its threads, so pinning them once pins every later parallel region of the same size
+        #pragma omp parallel
+        {
+            cpu_set_t cpu;
+            CPU_ZERO(&cpu);
+            CPU_SET(order[omp_get_thread_num() % order.size()], &cpu);
+            pthread_setaffinity_np(pthread_self(), sizeof(cpu), &cpu);
+        }
+    }
+}
+
+void placement::configure(std::map<std::string, std::string> &flags){
+    if (flags.count("numa")){
+        if (flags["numa"] == "first-touch"){
+            NumaMode = placement::numa_mode::first_touch;
+        } else if (flags["numa"] == "replicate"){
+            NumaMode = placement::numa_mode::replicate;
+        } else {
+            std::cerr << "ERROR: Unknown --numa mode " << flags["numa"] << ".\n";
+            exit(1);
+        }
+    }
+    if (flags.count("huge-pages")){
+        if (flags["huge-pages"] == "off"){
+            HugePageMode = placement::huge_page_mode::off;
+        } else if (flags["huge-pages"] == "transparent"){
+            HugePageMode = placement::huge_page_mode::transparent;
+        } else if (flags["huge-pages"] == "explicit"){
+            HugePageMode = placement::huge_page_mode::explicit_;
+        } else {
+            std::cerr << "ERROR: Unknown --huge-pages mode " << flags["huge-pages"] << ".\n";
+            exit(1);
+        }
+    }
+    if (flags.count("pin")){
+        if (flags["pin"] == "compact"){
+            pin_threads(placement::pin_mode::compact);
+        } else if (flags["pin"] == "spread"){
+            pin_threads(placement::pin_mode::spread);
+        } else if (flags["pin"] != "none"){
+            std::cerr << "ERROR: Unknown --pin mode " << flags["pin"] << ".\n";
+            exit(1);
+        }
+    }
+}
+
+void placement::unpin_current_thread(){
+    if (Pinned){
+        pthread_setaffinity_np(pthread_self(), sizeof(ProcessMask), &ProcessMask);
+    }
+}
+
+placement::numa_mode placement::get_numa_mode(){
+    return NumaMode;
+}
+
+int placement::numa_nodes(){
+    return topology().node_cpus.size();
+}
+
+int placement::current_numa_node(){
+    int cpu = sched_getcpu();
+    const std::vector<int> &cpu_node = topology().cpu_node;
+    if (cpu < 0 || cpu >= (int) cpu_node.size()){
+        return 0;
+    }
+    return cpu_node[cpu];
+}
+
+void* placement::allocate_array(size_t bytes){
+    if (bytes < placement::HUGE_PAGE_MIN_BYTES){
+        void *memory = std::malloc(bytes == 0 ? 1 : bytes);
+        if (memory == nullptr){
+            throw std::bad_alloc();
+        }
+        return memory;
+    }
+
+    // Large arrays are always mapped (so free_array only depends on the size), rounded up to whole huge pages
+    size_t mapped_bytes = (bytes + HUGE_PAGE_BYTES - 1) / HUGE_PAGE_BYTES * HUGE_PAGE_BYTES;
+    void *memory = MAP_FAILED;
+    if (HugePageMode == placement::huge_page_mode::explicit_){
+        memory = mmap(nullptr, mapped_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    }
+    if (memory == MAP_FAILED){
+        memory = mmap(nullptr, mapped_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED){
+            throw std::bad_alloc();
+        }
+        if (HugePageMode != placement::huge_page_mode::off){
+            madvise(memory, mapped_bytes, MADV_HUGEPAGE);
+        }
+    }
+    return memory;
+}
+
+void placement::free_array(void *memory, size_t bytes){
+    if (bytes < placement::HUGE_PAGE_MIN_BYTES){
+        std::free(memory);
+        return;
+    }
+    munmap(memory, (bytes + HUGE_PAGE_BYTES - 1) / HUGE_PAGE_BYTES * HUGE_PAGE_BYTES);
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cstddef>
+#include <new>
+#include <utility>
+
+/**
+ * Thread and memory placement: pinning of the OpenMP threads, NUMA placement of the graph arrays and huge page backing of large arrays.
+ * The NUMA topology is read from /sys/devices/system/node, machines without it are treated as a single node.
+*/
+namespace placement {
+    // How the OpenMP threads are pinned to CPUs
+    enum class pin_mode {
+        none,    // Left to the OS
+        compact, // Thread i on the i-th allowed CPU, filling one NUMA node before the next
+        spread   // Threads round-robin over the NUMA nodes
+    };
+
+    // Where the arrays of the graphs searched by s_avg_gamma live
+    enum class numa_mode {
+        first_touch, // Pages land on the node of the thread filling them (the arrays are filled in parallel)
+        replicate    // Every NUMA node searches its own copy of the graph
+    };
+
+    // How large arrays are backed
+    enum class huge_page_mode {
+        off,         // Regular pages
+        transparent, // Regular mapping with madvise(MADV_HUGEPAGE)
+        explicit_    // MAP_HUGETLB from the reserved huge page pool, falling back to transparent when the pool is empty
+    };
+
+    // Arrays smaller than this are allocated normally whatever the huge page mode
+    const size_t HUGE_PAGE_MIN_BYTES = 2 << 20;
+
+    /**
+     * Sets the placement from the --pin=none|compact|spread, --numa=first-touch|replicate and --huge-pages=off|transparent|explicit flags
+     * and pins the OpenMP threads. Exits if a value is unknown.
+     * @param flags The flags given on the command line
+    */
+    void configure(std::map<std::string, std::string> &flags);
+
+    // Lets the calling thread run on every CPU the process was allowed before --pin. Threads started by the main thread inherit the CPU it
+    // was pinned to (the one of OpenMP thread 0), so threads working alongside the OpenMP threads call this first. Does nothing without --pin.
+    void unpin_current_thread();
+
+    // Returns the current NUMA mode
+    numa_mode get_numa_mode();
+
+    // Returns the number of NUMA nodes
+    int numa_nodes();
+
+    // Returns the NUMA node of the CPU the calling thread runs on
+    int current_numa_node();
+
+    /**
+     * Allocates memory for an array, backed by huge pages according to the huge page mode when it is large enough. The memory is not touched.
+     * @param bytes The size of the array
+     * @return The memory
+    */
+    void* allocate_array(size_t bytes);
+
+    /**
+     * Frees memory from allocate_array
+     * @param memory The memory
+     * @param bytes The size given to allocate_array
+    */
+    void free_array(void *memory, size_t bytes);
+
+    /**
+     * Allocator for the large arrays of the compact graphs. Allocates through allocate_array and default-initializes elements
+     * (so trivial elements are left untouched until the threads filling them first touch their pages).
+    */
+    template <typename T>
+    struct array_allocator {
+        typedef T value_type;
+
+        array_allocator() = default;
+        template <typename U>
+        array_allocator(const array_allocator<U>&){}
+
+        T* allocate(size_t count){
+            return static_cast<T*>(allocate_array(count * sizeof(T)));
+        }
+
+        void deallocate(T *memory, size_t count){
+            free_array(memory, count * sizeof(T));
+        }
+
+        template <typename U>
+        void construct(U *element){
+            ::new (static_cast<void*>(element)) U;
+        }
+
+        template <typename U, typename... Args>
+        void construct(U *element, Args&&... args){
+            ::new (static_cast<void*>(element)) U(std::forward<Args>(args)...);
+        }
+
+        template <typename U>
+        bool operator==(const array_allocator<U>&) const {
+            return true;
+        }
+    };
+
+    // Vector with its storage from array_allocator
+    template <typename T>
+    using array = std::vector<T, array_allocator<T>>;
+};
@@ -0,0 +1,423 @@
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <iostream>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "edgelist.h"
+#include "utils.h"
+#include "funcs.h"
+#include "network_metrics.h"
+#include "derived_cache.h"
+#include "compact_graph.h"
+#include "text_output.h"
+#include "placement.h"
+
+#include "query_server.h"
+
+namespace {
+    // A graph kept in memory between requests
+    struct resident_graph {
+        compact_graph a_graph;
+        compact_graph g_tilda_graph;
+        metrics::laplacian_stats stats;
+    };
+
+    // Resident graphs by name. Requests hold a shared_ptr, so unloading a graph in use frees it once those requests finish.
+    std::map<std::string, std::shared_ptr<const resident_graph>> Graphs;
+    std::shared_mutex GraphsMutex;
+    // Loads run one at a time: each one already uses every OpenMP thread, and the derived graph cache entries are written per process
+    std::mutex LoadMutex;
+
+    // Most socket connections open at once, further clients wait in the listen backlog until one closes
+    const int MAX_CONNECTIONS = 64;
+
+    // Fixed set of worker threads running submitted jobs in submission order
+    class worker_pool {
+        private:
+            std::vector<std::thread> Workers;
+            std::deque<std::function<void()>> Jobs;
+            std::mutex JobsMutex;
+            std::condition_variable JobsChanged;
+            bool Stopping = false;
+        public:
+            worker_pool(int threads){
+                for (int i = 0; i < threads; i++){
+                    this->Workers.emplace_back([this](){
+                        // Workers are started by the main thread, so without this every worker would share its pinned CPU
+                        placement::unpin_current_thread();
+                        while (true){
+                            std::function<void()> job;
+                            {
+                                std::unique_lock<std::mutex> lock(this->JobsMutex);
+                                this->JobsChanged.wait(lock, [this](){ return this->Stopping || !this->Jobs.empty(); });
+                                if (this->Jobs.empty()){
+                                    return;
+                                }
+                                job = std::move(this->Jobs.front());
+                                this->Jobs.pop_front();
+                            }
+                            job();
+                        }
+                    });
+                }
+            }
+
+            // Finishes the queued jobs, then joins the workers
+            ~worker_pool(){
+                {
+                    std::lock_guard<std::mutex> lock(this->JobsMutex);
+                    this->Stopping = true;
+                }
+                this->JobsChanged.notify_all();
+                for (std::thread &worker : this->Workers){
+                    worker.join();
+                }
+            }
+
+            void submit(std::function<void()> job){
+                {
+                    std::lock_guard<std::mutex> lock(this->JobsMutex);
+                    this->Jobs.push_back(std::move(job));
+                }
+                this->JobsChanged.notify_one();
+            }
+    };
+
+    // Thrown by the request handlers, answered as "ERROR [MESSAGE]"
+    struct request_error {
+        std::string message;
+    };
+
+    std::shared_ptr<const resident_graph> find_graph(std::string name){
+        std::shared_lock<std::shared_mutex> lock(GraphsMutex);
+        auto iter = Graphs.find(name);
+        if (iter == Graphs.end()){
+            throw request_error{"Unknown graph " + name};
+        }
+        return iter->second;
+    }
+
+    // Derives G_tilda of a network and keeps both resident under a name
+    void make_resident(std::string name, edgelist &a_edgelist, std::string filepath, bool weighted){
+        std::lock_guard<std::mutex> load_lock(LoadMutex);
+        std::shared_ptr<resident_graph> graph = std::make_shared<resident_graph>();
+        edgelist nl_edgelist;
+        edgelist g_edgelist;
+        if (filepath.empty()){
+            nl_edgelist = a_edgelist.take_neg_laplacian();
+            g_edgelist = nl_edgelist.neg_laplacian_to_g();
+            graph->stats = metrics::compute_laplacian_stats(nl_edgelist);
+        } else {
+            derived_cache::load_or_derive(filepath, weighted, a_edgelist.is_directional(), a_edgelist, nl_edgelist, g_edgelist, graph->stats);
+        }
+        graph->a_graph = compact_graph(a_edgelist);
+        graph->g_tilda_graph = compact_graph(g_edgelist, graph->stats.dim + 1);
+
+        std::unique_lock<std::shared_mutex> lock(GraphsMutex);
+        Graphs[name] = graph;
+    }
+
+    // Reads a source vertex ID argument, which must be a vertex slot of the graph
+    int parse_src(std::string word, const compact_graph &graph){
+        int src = std::stoi(word);
+        if (src < 0 || src >= graph.Vertices){
+            throw request_error{"Invalid SRC vertex ID " + word};
+        }
+        return src;
+    }
+
+    /**
+     * Answers one request line
+     * @param line The request
+     * @param out The string the response is appended to
+     * @return False if the request ends the session
+    */
+    bool handle_request(std::string line, std::string &out){
+        // Reused by every request answered on this thread
+        thread_local metrics::search_scratch scratch;
+
+        std::vector<std::string> words;
+        std::istringstream stream(line);
+        std::string word;
+        while (stream >> word){
+            words.push_back(word);
+        }
+        if (words.empty()){
+            return true;
+        }
+        const std::string &command = words[0];
+
+        auto require = [&](size_t count){
+            if (words.size() != count + 1){
+                throw request_error{command + " takes " + std::to_string(count) + " arguments"};
+            }
+        };
+
+        try {
+            if (command == "quit" || command == "shutdown"){
+                out += "OK\n";
+                return false;
+            } else if (command == "load"){
+                require(4);
+                const bool weighted = bool(std::stoi(words[3]));
+                if (!std::ifstream(words[2]).is_open()){
+                    throw request_error{"Unable to open " + words[2]};
+                }
+                edgelist a_edgelist = edgelist_from_file(weighted, words[2]);
+                a_edgelist.set_directional(bool(std::stoi(words[4])));
+                make_resident(words[1], a_edgelist, words[2], weighted);
+            } else if (command == "gen_watts_strogatz"){
+                require(5);
+                const int SIZE = std::stoi(words[2]);
+                const int AVG_DEG = std::stoi(words[3]);
+                const double REWIRING_PROB = std::stod(words[4]);
+                if ( !(SIZE > 0 && AVG_DEG > 0 && AVG_DEG % 2 == 0 && REWIRING_PROB >= 0 && REWIRING_PROB <= 1 && AVG_DEG < SIZE && (REWIRING_PROB == 0 || SIZE > 2 * AVG_DEG)) ){
+                    throw request_error{"Invalid Watts Strogatz configuration"};
+                }
+                edgelist a_edgelist;
+                generate_watts_strogatz_small_world_network(a_edgelist, SIZE, AVG_DEG, REWIRING_PROB, std::stoull(words[5]));
+                make_resident(words[1], a_edgelist, "", false);
+            } else if (command == "unload"){
+                require(1);
+                std::unique_lock<std::shared_mutex> lock(GraphsMutex);
+                if (Graphs.erase(words[1]) == 0){
+                    throw request_error{"Unknown graph " + words[1]};
+                }
+            } else if (command == "list"){
+                require(0);
+                std::shared_lock<std::shared_mutex> lock(GraphsMutex);
+                for (auto &iter : Graphs){
+                    out += iter.first + " vertices=" + std::to_string(iter.second->a_graph.Vertices) + " edges=" + std::to_string(iter.second->a_graph.edge_count()) + "\n";
+                }
+            } else if (command == "dtv_k" || command == "dtv_tau"){
+                require(3);
+                std::shared_ptr<const resident_graph> graph = find_graph(words[1]);
+                const int src = parse_src(words[2], graph->a_graph);
+                metrics::distance_to_vertices dtv;
+                if (command == "dtv_k"){
+                    const int k = std::stoi(words[3]);
+                    if ( !( k > 0 ) ){
+                        throw request_error{"Invalid limit k"};
+                    }
+                    dtv = metrics::geodesic_distance_k(graph->a_graph, src, k, scratch);
+                } else {
+                    const double tau = std::stod(words[3]);
+                    if ( !( tau > 0 ) ){
+                        throw request_error{"Invalid limit tau"};
+                    }
+                    dtv = metrics::geodesic_distance_tau(graph->a_graph, src, tau, scratch);
+                }
+                metrics::append_distance_to_vertices(out, dtv);
+            } else if (command == "n_tilda"){
+                require(3);
+                std::shared_ptr<const resident_graph> graph = find_graph(words[1]);
+                const int src = parse_src(words[2], graph->g_tilda_graph);
+                const double gamma = std::stod(words[3]);
+                if ( !( gamma > 0 && gamma < 1) ){
+                    throw request_error{"Invalid Gamma value given"};
+                }
+                metrics::n_tilda_gamma_neighborhood_size(graph->g_tilda_graph, graph->stats, src, gamma, scratch);
+                metrics::distance_to_vertices dtv = scratch.to_dtv();
+                metrics::append_distance_to_vertices(out, dtv);
+            } else if (command == "s_avg"){
+                require(2);
+                std::shared_ptr<const resident_graph> graph = find_graph(words[1]);
+                const double gamma = std::stod(words[2]);
+                if ( !( gamma > 0 && gamma < 1) ){
+                    throw request_error{"Invalid Gamma value given"};
+                }
+                out += "S_avg= ";
+                text_output::append_general(out, metrics::s_avg_gamma(graph->g_tilda_graph, graph->stats, gamma));
+                out += '\n';
+            } else {
+                throw request_error{"Unknown command " + command};
+            }
+        } catch (request_error &error){
+            out += "ERROR " + error.message + "\n";
+            return true;
+        } catch (std::exception &error){
+            out += "ERROR Invalid arguments\n";
+            return true;
+        }
+        out += "OK\n";
+        return true;
+    }
+
+    // Writes all of a string to a file descriptor, returns false if the descriptor was closed
+    bool write_all(int fd, const std::string &text){
+        size_t written = 0;
+        while (written < text.size()){
+            ssize_t count = ::write(fd, text.data() + written, text.size() - written);
+            if (count <= 0){
+                return false;
+            }
+            written += count;
+        }
+        return true;
+    }
+}
+
+void query_server::serve_stdin(int threads){
+    // Shared by every request, generated before any worker reads it
+    funcs::w_func(1);
+
+    // Responses in request order, written by their own thread as they become ready
+    std::deque<std::future<std::string>> responses;
+    std::mutex responses_mutex;
+    std::condition_variable responses_changed;
+    bool reading_done = false;
+
+    std::thread writer([&](){
+        while (true){
+            std::future<std::string> response;
+            {
+                std::unique_lock<std::mutex> lock(responses_mutex);
+                responses_changed.wait(lock, [&](){ return reading_done || !responses.empty(); });
+                if (responses.empty()){
+                    return;
+                }
+                response = std::move(responses.front());
+                responses.pop_front();
+            }
+            write_all(STDOUT_FILENO, response.get());
+        }
+    });
+
+    {
+        worker_pool pool(threads);
+        std::string line;
+        while (std::getline(std::cin, line)){
+            std::shared_ptr<std::promise<std::string>> promise = std::make_shared<std::promise<std::string>>();
+            {
+                std::lock_guard<std::mutex> lock(responses_mutex);
+                responses.push_back(promise->get_future());
+            }
+            responses_changed.notify_all();
+
+            std::istringstream stream(line);
+            std::string command;
+            stream >> command;
+            if (command == "quit" || command == "shutdown"){
+                promise->set_value("OK\n");
+                break;
+            }
+            pool.submit([line, promise](){
+                std::string out;
+                handle_request(line, out);
+                promise->set_value(out);
+            });
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(responses_mutex);
+        reading_done = true;
+    }
+    responses_changed.notify_all();
+    writer.join();
+}
+
+void query_server::serve_unix_socket(std::string socket_path, int threads){
+    // Shared by every request, generated before any worker reads it
+    funcs::w_func(1);
+
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (listen_fd < 0 || socket_path.size() >= sizeof(address.sun_path)){
+        std::cerr << "ERROR: Unable to create socket " << socket_path << ".\n";
+        exit(1);
+    }
+    std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+    unlink(socket_path.c_str());
+    if (bind(listen_fd, (sockaddr*) &address, sizeof(address)) != 0 || listen(listen_fd, 16) != 0){
+        std::cerr << "ERROR: Unable to listen on socket " << socket_path << ".\n";
+        exit(1);
+    }
+    std::cout << "Listening on " << socket_path << "\n";
+
+    std::atomic<bool> stopping = false;
+    // Connections open, each read by its own thread that hands its requests to the pool one at a time, so idle clients hold no worker
+    int open_connections = 0;
+    std::mutex connections_mutex;
+    std::condition_variable connections_changed;
+    {
+        worker_pool pool(threads);
+        while (!stopping){
+            {
+                std::unique_lock<std::mutex> lock(connections_mutex);
+                connections_changed.wait(lock, [&](){ return open_connections < MAX_CONNECTIONS; });
+            }
+            int connection_fd = accept(listen_fd, NULL, NULL);
+            if (connection_fd < 0){
+                if (stopping){
+                    break;
+                }
+                continue;
+            }
+            {
+                std::lock_guard<std::mutex> lock(connections_mutex);
+                open_connections++;
+            }
+            std::thread([connection_fd, listen_fd, &stopping, &pool, &open_connections, &connections_mutex, &connections_changed](){
+                std::string buffer;
+                char block[4096];
+                bool open = true;
+                while (open){
+                    ssize_t count = ::read(connection_fd, block, sizeof(block));
+                    if (count <= 0){
+                        break;
+                    }
+                    buffer.append(block, count);
+                    // Answer every complete line received so far, in order
+                    size_t newline;
+                    while (open && (newline = buffer.find('\n')) != std::string::npos){
+                        std::string line = buffer.substr(0, newline);
+                        buffer.erase(0, newline + 1);
+                        std::string out;
+                        std::promise<bool> answered;
+                        std::future<bool> keep_open = answered.get_future();
+                        pool.submit([&line, &out, &answered](){
+                            answered.set_value(handle_request(line, out));
+                        });
+                        open = keep_open.get();
+                        std::istringstream stream(line);
+                        std::string command;
+                        stream >> command;
+                        if (command == "shutdown"){
+                            // Wakes the accept loop so the server stops once the open connections finish
+                            stopping = true;
+                            shutdown(listen_fd, SHUT_RDWR);
+                        }
+                        open = write_all(connection_fd, out) && open;
+                    }
+                }
+                close(connection_fd);
+                std::lock_guard<std::mutex> lock(connections_mutex);
+                open_connections--;
+                connections_changed.notify_all();
+            }).detach();
+        }
+        // The pool outlives every connection thread using it
+        std::unique_lock<std::mutex> lock(connections_mutex);
+        connections_changed.wait(lock, [&](){ return open_connections == 0; });
+    }
+    close(listen_fd);
+    unlink(socket_path.c_str());
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+
+/**
+ * Long lived query server keeping graphs (and their G_tilda) resident between requests.
+ * Requests are single lines of whitespace separated words, each response is its result lines followed by a line "OK" or "ERROR [MESSAGE]":
+ *  - load [NAME] [FILEPATH] [WEIGHTED] [DIRECTIONAL]: loads an edgelist file and derives its G_tilda (through the derived graph cache)
+ *  - gen_watts_strogatz [NAME] [SIZE] [AVG DEG] [REWIRING PROBABILITY] [SEED]: generates a Watts Strogatz network and derives its G_tilda
+ *  - unload [NAME], list
+ *  - dtv_k [NAME] [SRC] [k], dtv_tau [NAME] [SRC] [tau]: distances from SRC in the network, printed as by task.bin
+ *  - n_tilda [NAME] [SRC] [GAMMA]: the N_tilda(GAMMA) neighborhood of SRC (distances in G_tilda)
+ *  - s_avg [NAME] [GAMMA]: S_avg(GAMMA), calculated with all OpenMP threads
+ *  - quit: ends the session (the stdin server or the socket connection), shutdown: also stops the socket server
+ * Requests are answered on a pool of worker threads, each with its own search scratch reused across requests.
+*/
+namespace query_server {
+    /**
+     * Serves requests read from stdin, answering them concurrently. Responses are written to stdout in the order of the requests.
+     * @param threads The number of worker threads
+    */
+    void serve_stdin(int threads);
+
+    /**
+     * Serves requests over a Unix domain socket. Connections are handled concurrently, the requests of one connection in order.
+     * Each connection is read by its own thread, which hands one request at a time to the worker pool, and at most 64 connections are open at once.
+     * @param socket_path The filepath of the socket (replaced if it exists)
+     * @param threads The number of worker threads
+    */
+    void serve_unix_socket(std::string socket_path, int threads);
+};
@@ -0,0 +1,549 @@
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <algorithm>
+#include <tuple>
+#include <functional>
+#include <omp.h>
+
+#include "network_metrics.h"
+
+#include "reduction.h"
+
+namespace {
+    // Whether the distances (info, net) are shorter than (current_info, current_net), compared like the label correcting searches
+    bool shorter(long double info, int net, long double current_info, int current_net){
+        if (current_info - info > info*MINIMAL_PERCENT_ROUNDING_ERR){
+            return true;
+        }
+        return std::abs(current_info - info) < info*MINIMAL_PERCENT_ROUNDING_ERR && current_net > net;
+    }
+
+    /**
+     * Label correcting search of the kernel from a kernel vertex, with the network distance of each kernel edge given by its hops
+     * @param graph The reduced graph
+     * @param src The kernel ID of the source
+     * @param limit The limits of the search
+     * @param scratch The scratch of the calling thread, holds the distances by kernel ID afterwards
+    */
+    void kernel_search(const reduction::reduced_graph &graph, int src, const reduction::search_limit &limit, metrics::search_scratch &scratch){
+        scratch.prepare(graph.kernel_vertices());
+        std::vector<long double> &info_distance = scratch.info_distance;
+        std::vector<int> &net_distance = scratch.net_distance;
+
+        info_distance[src] = 0;
+        net_distance[src] = 0;
+        scratch.reached.push_back(src);
+        scratch.frontier.push_back(src);
+        scratch.in_frontier[src] = true;
+
+        while (scratch.frontier_head < scratch.frontier.size()){
+            int from = scratch.frontier[scratch.frontier_head++];
+            scratch.in_frontier[from] = false;
+            long double from_info_distance = info_distance[from];
+            int from_net_distance = net_distance[from];
+
+            for (int64_t e = graph.Offsets[from]; e < graph.Offsets[from+1]; e++){
+                int to = graph.Targets[e];
+                long double possible_to_info_distance = from_info_distance + (long double) graph.Info[e];
+                int possible_to_net_distance = from_net_distance + graph.Hops[e];
+                if (possible_to_info_distance > limit.Tau || possible_to_net_distance > limit.K || !shorter(possible_to_info_distance, possible_to_net_distance, info_distance[to], net_distance[to])){
+                    continue;
+                }
+                if (info_distance[to] == INFINITY){
+                    scratch.reached.push_back(to);
+                }
+                info_distance[to] = possible_to_info_distance;
+                net_distance[to] = possible_to_net_distance;
+                if (!scratch.in_frontier[to]){
+                    scratch.frontier.push_back(to);
+                    scratch.in_frontier[to] = true;
+                }
+            }
+        }
+    }
+
+    /**
+     * Distances of a chain vertex to the kernel, the shorter of the ways through either end of its chain
+     * @param from_u The kernel distances of end U of the chain
+     * @param from_w The kernel distances of end W of the chain
+     * @param u_info, u_net The distances of the chain vertex to end U
+     * @param w_info, w_net The distances of the chain vertex to end W
+     * @param limit The limits of the chain vertex
+     * @param combined Holds the distances by kernel ID afterwards
+    */
+    void combine_ends(int kernel_vertices, const metrics::search_scratch &from_u, const metrics::search_scratch &from_w, long double u_info, int u_net, long double w_info, int w_net, const reduction::search_limit &limit, metrics::search_scratch &combined){
+        combined.prepare(kernel_vertices);
+        for (int y : from_u.reached){
+            long double info = u_info + from_u.info_distance[y];
+            int net = u_net + from_u.net_distance[y];
+            if (info <= limit.Tau && net <= limit.K){
+                combined.info_distance[y] = info;
+                combined.net_distance[y] = net;
+                combined.reached.push_back(y);
+            }
+        }
+        for (int y : from_w.reached){
+            long double info = w_info + from_w.info_distance[y];
+            int net = w_net + from_w.net_distance[y];
+            if (info > limit.Tau || net > limit.K || !shorter(info, net, combined.info_distance[y], combined.net_distance[y])){
+                continue;
+            }
+            if (combined.info_distance[y] == INFINITY){
+                combined.reached.push_back(y);
+            }
+            combined.info_distance[y] = info;
+            combined.net_distance[y] = net;
+        }
+    }
+
+    // Adds a vertex that is not peeled to a row, followed by the vertices of its trees within the limits
+    void push_with_trees(const reduction::reduced_graph &graph, int vertex, long double info, int net, const reduction::search_limit &limit, reduction::distance_row &row, std::vector<std::pair<int, int>> &stack){
+        row.push(vertex, info, net);
+        // Row index of each tree vertex waiting for its children
+        stack.clear();
+        stack.push_back({vertex, row.Vertices.size() - 1});
+        while (!stack.empty()){
+            auto [from, index] = stack.back();
+            stack.pop_back();
+            for (int64_t i = graph.ChildOffsets[from]; i < graph.ChildOffsets[from+1]; i++){
+                int child = graph.Children[i];
+                long double child_info = row.Info[index] + graph.ParentInfo[child];
+                if (child_info <= limit.Tau && row.Net[index] < limit.K){
+                    row.push(child, child_info, row.Net[index] + 1);
+                    stack.push_back({child, row.Vertices.size() - 1});
+                }
+            }
+        }
+    }
+
+    /**
+     * Fills the row of a source that is not peeled from its distances to the kernel vertices
+     * @param kernel The distances of the source by kernel ID
+     * @param own_chain The chain of the source (-1 for a kernel vertex), whose vertices can also be reached directly along it
+     * @param own_index The entry of the source in ChainMembers
+     * @param seen Chains whose entry equals round were already expanded into the row
+    */
+    void expand_row(const reduction::reduced_graph &graph, const metrics::search_scratch &kernel, int own_chain, int64_t own_index, const reduction::search_limit &limit, std::vector<int> &seen, int round, reduction::distance_row &row, std::vector<std::pair<int, int>> &stack){
+        row.clear();
+        auto expand_chain = [&](int c){
+            seen[c] = round;
+            int u = graph.ChainU[c];
+            int w = graph.ChainW[c];
+            int64_t first = graph.ChainOffsets[c];
+            int64_t count = graph.ChainOffsets[c+1] - first;
+            for (int64_t i = first; i < first + count; i++){
+                int position = i - first;
+                long double best_info = INFINITY;
+                int best_net = INT32_MAX;
+                // Only the ways within K edges compete, a search limited by K never labels a vertex beyond them
+                if (c == own_chain && std::abs(i - own_index) <= limit.K){
+                    best_info = std::abs(graph.ChainPrefix[i] - graph.ChainPrefix[own_index]);
+                    best_net = std::abs(i - own_index);
+                }
+                if (kernel.info_distance[u] != INFINITY){
+                    long double info = kernel.info_distance[u] + graph.ChainPrefix[i];
+                    int net = kernel.net_distance[u] + position + 1;
+                    if (net <= limit.K && shorter(info, net, best_info, best_net)){
+                        best_info = info;
+                        best_net = net;
+                    }
+                }
+                if (kernel.info_distance[w] != INFINITY){
+                    long double info = kernel.info_distance[w] + (graph.ChainLength[c] - graph.ChainPrefix[i]);
+                    int net = kernel.net_distance[w] + count - position;
+                    if (net <= limit.K && shorter(info, net, best_info, best_net)){
+                        best_info = info;
+                        best_net = net;
+                    }
+                }
+                if (best_info <= limit.Tau){
+                    push_with_trees(graph, graph.ChainMembers[i], best_info, best_net, limit, row, stack);
+                }
+            }
+        };
+
+        for (int y : kernel.reached){
+            push_with_trees(graph, graph.KernelVertex[y], kernel.info_distance[y], kernel.net_distance[y], limit, row, stack);
+        }
+        if (own_chain >= 0){
+            expand_chain(own_chain);
+        }
+        for (int y : kernel.reached){
+            for (int64_t i = graph.IncidentOffsets[y]; i < graph.IncidentOffsets[y+1]; i++){
+                if (seen[graph.IncidentChains[i]] != round){
+                    expand_chain(graph.IncidentChains[i]);
+                }
+            }
+        }
+    }
+
+    /**
+     * Passes the row of every tree vertex rooted at a vertex that is not peeled: its own tree is walked directly, and every other
+     * vertex is reached through the root
+     * @param root The root
+     * @param root_row The row of the root
+    */
+    void consume_tree_rows(const reduction::reduced_graph &graph, int root, const reduction::distance_row &root_row, const reduction::search_limit &limit, reduction::distance_row &row, const std::function<void(int, const reduction::distance_row&)> &consume){
+        if (graph.ChildOffsets[root] == graph.ChildOffsets[root+1]){
+            return;
+        }
+        // Tree vertices with their distances to the root
+        std::vector<std::tuple<int, long double, int>> members;
+        members.push_back({root, 0, 0});
+        for (size_t m = 0; m < members.size(); m++){
+            auto [from, info, net] = members[m];
+            for (int64_t i = graph.ChildOffsets[from]; i < graph.ChildOffsets[from+1]; i++){
+                members.push_back({graph.Children[i], info + graph.ParentInfo[graph.Children[i]], net + 1});
+            }
+        }
+
+        // Walk of the tree edges: vertex, the vertex it was reached from, and its distances
+        std::vector<std::tuple<int, int, long double, int>> walk;
+        for (size_t m = 1; m < members.size(); m++){
+            auto [src, root_info, root_net] = members[m];
+            row.clear();
+            walk.clear();
+            walk.push_back({src, -1, 0, 0});
+            while (!walk.empty()){
+                auto [from, previous, info, net] = walk.back();
+                walk.pop_back();
+                row.push(from, info, net);
+                if (net == limit.K){
+                    continue;
+                }
+                if (graph.Parent[from] != -1 && graph.Parent[from] != previous && info + graph.ParentInfo[from] <= limit.Tau){
+                    walk.push_back({graph.Parent[from], from, info + graph.ParentInfo[from], net + 1});
+                }
+                for (int64_t i = graph.ChildOffsets[from]; i < graph.ChildOffsets[from+1]; i++){
+                    int child = graph.Children[i];
+                    if (child != previous && info + graph.ParentInfo[child] <= limit.Tau){
+                        walk.push_back({child, from, info + graph.ParentInfo[child], net + 1});
+                    }
+                }
+            }
+            for (size_t i = 0; i < root_row.Vertices.size(); i++){
+                int vertex = root_row.Vertices[i];
+                if (vertex == root || (graph.Parent[vertex] != -1 && graph.Root[vertex] == root)){
+                    continue;
+                }
+                long double info = root_info + root_row.Info[i];
+                int net = root_net + root_row.Net[i];
+                if (info <= limit.Tau && net <= limit.K){
+                    row.push(vertex, info, net);
+                }
+            }
+            consume(src, row);
+        }
+    }
+}
+
+reduction::reduced_graph::reduced_graph() {}
+
+reduction::reduced_graph::reduced_graph(const compact_graph &graph){
+    if (graph.Directional){
+        std::cerr << "ERROR: The reduction needs an undirected network.\n";
+        exit(1);
+    }
+    const int V = graph.Vertices;
+    this->Vertices = V;
+
+    // Distinct neighbors of each vertex with the shortest of their edges, without self loops
+    std::vector<int64_t> neighbor_offsets(V + 1, 0);
+    std::vector<int> neighbors;
+    std::vector<double> neighbor_info;
+    neighbors.reserve(graph.edge_count());
+    neighbor_info.reserve(graph.edge_count());
+    std::vector<std::pair<int, double>> edges;
+    for (int v = 0; v < V; v++){
+        edges.clear();
+        for (int64_t e = graph.Offsets[v]; e < graph.Offsets[v+1]; e++){
+            if (graph.Weights[e] < 0){
+                std::cerr << "ERROR: The reduction needs non-negative edge weights.\n";
+                exit(1);
+            }
+            if (graph.Targets[e] != v){
+                edges.push_back({graph.Targets[e], graph.Weights[e]});
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+        for (size_t i = 0; i < edges.size(); i++){
+            if (i == 0 || edges[i].first != edges[i-1].first){
+                neighbors.push_back(edges[i].first);
+                neighbor_info.push_back(edges[i].second);
+            }
+        }
+        neighbor_offsets[v+1] = neighbors.size();
+    }
+
+    // Peel the vertices left with a single neighbor, each hangs from that neighbor
+    std::vector<int> degree(V);
+    std::vector<int> peel_order;
+    this->Parent.assign(V, -1);
+    this->ParentInfo.assign(V, 0);
+    std::vector<char> peeled(V, false);
+    for (int v = 0; v < V; v++){
+        degree[v] = neighbor_offsets[v+1] - neighbor_offsets[v];
+        if (degree[v] == 1){
+            peel_order.push_back(v);
+        }
+    }
+    for (size_t i = 0; i < peel_order.size(); i++){
+        int v = peel_order[i];
+        // A vertex can lose its last neighbor while queued (the last two vertices of a tree component)
+        if (degree[v] != 1){
+            peel_order[i] = -1;
+            continue;
+        }
+        for (int64_t e = neighbor_offsets[v]; e < neighbor_offsets[v+1]; e++){
+            if (!peeled[neighbors[e]]){
+                this->Parent[v] = neighbors[e];
+                this->ParentInfo[v] = neighbor_info[e];
+                break;
+            }
+        }
+        peeled[v] = true;
+        degree[v] = 0;
+        if (--degree[this->Parent[v]] == 1){
+            peel_order.push_back(this->Parent[v]);
+        }
+    }
+    // Parents are peeled after their children, so the reverse order sets the root of a parent first
+    this->Root.assign(V, -1);
+    for (auto it = peel_order.rbegin(); it != peel_order.rend(); it++){
+        int v = *it;
+        if (v >= 0){
+            int parent = this->Parent[v];
+            this->Root[v] = peeled[parent] ? this->Root[parent] : parent;
+        }
+    }
+    this->ChildOffsets.assign(V + 1, 0);
+    for (int v = 0; v < V; v++){
+        if (this->Parent[v] != -1){
+            this->ChildOffsets[this->Parent[v] + 1]++;
+        }
+    }
+    for (int v = 0; v < V; v++){
+        this->ChildOffsets[v+1] += this->ChildOffsets[v];
+    }
+    this->Children.resize(this->ChildOffsets[V]);
+    std::vector<int64_t> child_fill(this->ChildOffsets.begin(), this->ChildOffsets.end() - 1);
+    for (int v = 0; v < V; v++){
+        if (this->Parent[v] != -1){
+            this->Children[child_fill[this->Parent[v]]++] = v;
+        }
+    }
+
+    // Contract the paths of the remaining vertices with two neighbors between the others (the kernel)
+    std::vector<char> in_kernel(V, false);
+    for (int v = 0; v < V; v++){
+        in_kernel[v] = !peeled[v] && degree[v] != 2;
+    }
+    std::vector<int> chain_of(V, -1);
+    this->ChainOffsets.push_back(0);
+    auto walk_chain = [&](int u, int64_t first_edge){
+        int c = this->ChainU.size();
+        this->ChainU.push_back(u);
+        int previous = u;
+        int current = neighbors[first_edge];
+        long double info = neighbor_info[first_edge];
+        while (!in_kernel[current]){
+            chain_of[current] = c;
+            this->ChainMembers.push_back(current);
+            this->ChainPrefix.push_back(info);
+            for (int64_t e = neighbor_offsets[current]; e < neighbor_offsets[current+1]; e++){
+                int next = neighbors[e];
+                if (!peeled[next] && next != previous){
+                    previous = current;
+                    current = next;
+                    info += neighbor_info[e];
+                    break;
+                }
+            }
+        }
+        this->ChainW.push_back(current);
+        this->ChainLength.push_back(info);
+        this->ChainOffsets.push_back(this->ChainMembers.size());
+    };
+    auto walk_chains_from = [&](int u){
+        for (int64_t e = neighbor_offsets[u]; e < neighbor_offsets[u+1]; e++){
+            int n = neighbors[e];
+            if (!peeled[n] && !in_kernel[n] && chain_of[n] == -1){
+                walk_chain(u, e);
+            }
+        }
+    };
+    for (int v = 0; v < V; v++){
+        if (in_kernel[v]){
+            walk_chains_from(v);
+        }
+    }
+    // Cycles without a kernel vertex are anchored at their smallest vertex
+    for (int v = 0; v < V; v++){
+        if (!peeled[v] && !in_kernel[v] && chain_of[v] == -1){
+            in_kernel[v] = true;
+            walk_chains_from(v);
+        }
+    }
+
+    this->KernelId.assign(V, -1);
+    for (int v = 0; v < V; v++){
+        if (in_kernel[v]){
+            this->KernelId[v] = this->KernelVertex.size();
+            this->KernelVertex.push_back(v);
+        }
+    }
+    const int K = this->KernelVertex.size();
+    const int C = this->ChainU.size();
+    for (int c = 0; c < C; c++){
+        this->ChainU[c] = this->KernelId[this->ChainU[c]];
+        this->ChainW[c] = this->KernelId[this->ChainW[c]];
+    }
+
+    // Kernel edges: the edges between kernel vertices, and one edge each way per chain between different ends
+    this->Offsets.assign(K + 1, 0);
+    this->IncidentOffsets.assign(K + 1, 0);
+    for (int k = 0; k < K; k++){
+        int v = this->KernelVertex[k];
+        for (int64_t e = neighbor_offsets[v]; e < neighbor_offsets[v+1]; e++){
+            if (in_kernel[neighbors[e]]){
+                this->Offsets[k+1]++;
+            }
+        }
+    }
+    for (int c = 0; c < C; c++){
+        this->IncidentOffsets[this->ChainU[c] + 1]++;
+        if (this->ChainU[c] != this->ChainW[c]){
+            this->Offsets[this->ChainU[c] + 1]++;
+            this->Offsets[this->ChainW[c] + 1]++;
+            this->IncidentOffsets[this->ChainW[c] + 1]++;
+        }
+    }
+    for (int k = 0; k < K; k++){
+        this->Offsets[k+1] += this->Offsets[k];
+        this->IncidentOffsets[k+1] += this->IncidentOffsets[k];
+    }
+    this->Targets.resize(this->Offsets[K]);
+    this->Info.resize(this->Offsets[K]);
+    this->Hops.resize(this->Offsets[K]);
+    this->IncidentChains.resize(this->IncidentOffsets[K]);
+    std::vector<int64_t> fill(this->Offsets.begin(), this->Offsets.end() - 1);
+    std::vector<int64_t> incident_fill(this->IncidentOffsets.begin(), this->IncidentOffsets.end() - 1);
+    auto add_edge = [&](int from, int to, double info, int hops){
+        int64_t slot = fill[from]++;
+        this->Targets[slot] = to;
+        this->Info[slot] = info;
+        this->Hops[slot] = hops;
+    };
+    for (int k = 0; k < K; k++){
+        int v = this->KernelVertex[k];
+        for (int64_t e = neighbor_offsets[v]; e < neighbor_offsets[v+1]; e++){
+            if (in_kernel[neighbors[e]]){
+                add_edge(k, this->KernelId[neighbors[e]], neighbor_info[e], 1);
+            }
+        }
+    }
+    for (int c = 0; c < C; c++){
+        int u = this->ChainU[c];
+        int w = this->ChainW[c];
+        this->IncidentChains[incident_fill[u]++] = c;
+        if (u != w){
+            int hops = this->ChainOffsets[c+1] - this->ChainOffsets[c] + 1;
+            add_edge(u, w, this->ChainLength[c], hops);
+            add_edge(w, u, this->ChainLength[c], hops);
+            this->IncidentChains[incident_fill[w]++] = c;
+        }
+    }
+}
+
+void reduction::reduced_graph::for_each_source(double tau, const std::function<void(int, const reduction::distance_row&)> &consume) const {
+    reduction::search_limit limit;
+    limit.Tau = tau;
+    this->for_each_source([&limit](int){
+        return limit;
+    }, consume);
+}
+
+void reduction::reduced_graph::for_each_source(const std::function<reduction::search_limit(int)> &limit_of, const std::function<void(int, const reduction::distance_row&)> &consume) const {
+    const int K = this->kernel_vertices();
+    const int C = this->ChainU.size();
+    const int V = this->Vertices;
+
+    std::vector<reduction::search_limit> limits(V);
+    #pragma omp parallel for schedule(dynamic, 256)
+    for (int v = 0; v < V; v++){
+        limits[v] = limit_of(v);
+    }
+    // One unit per kernel vertex, and one per chain whose vertices share the searches from its ends. Tree vertices belong to the unit of their root.
+    std::vector<int> chain_of(V, -1);
+    for (int c = 0; c < C; c++){
+        for (int64_t i = this->ChainOffsets[c]; i < this->ChainOffsets[c+1]; i++){
+            chain_of[this->ChainMembers[i]] = c;
+        }
+    }
+    std::vector<reduction::search_limit> unit_limits(K + C);
+    for (reduction::search_limit &unit_limit : unit_limits){
+        unit_limit.Tau = -INFINITY;
+        unit_limit.K = -1;
+    }
+    for (int v = 0; v < V; v++){
+        int base = this->Parent[v] == -1 ? v : this->Root[v];
+        int unit = this->KernelId[base] >= 0 ? this->KernelId[base] : K + chain_of[base];
+        unit_limits[unit].Tau = std::max(unit_limits[unit].Tau, limits[v].Tau);
+        unit_limits[unit].K = std::max(unit_limits[unit].K, limits[v].K);
+    }
+
+    #pragma omp parallel
+    {
+        metrics::search_scratch from_u;
+        metrics::search_scratch from_w;
+        metrics::search_scratch combined;
+        std::vector<int> seen(C, -1);
+        int round = 0;
+        reduction::distance_row row;
+        reduction::distance_row tree_row;
+        reduction::distance_row own_row;
+        std::vector<std::pair<int, int>> stack;
+        reduction::search_limit unit_limit;
+        // Hands on the row of a source found within the limits of its unit, cut to its own limits when they are narrower
+        auto consume_own = [&](int src, const reduction::distance_row &unit_row){
+            const reduction::search_limit &own = limits[src];
+            if (own.Tau >= unit_limit.Tau && own.K >= unit_limit.K){
+                consume(src, unit_row);
+                return;
+            }
+            own_row.clear();
+            for (size_t i = 0; i < unit_row.Vertices.size(); i++){
+                if (unit_row.Info[i] <= own.Tau && unit_row.Net[i] <= own.K){
+                    own_row.push(unit_row.Vertices[i], unit_row.Info[i], unit_row.Net[i]);
+                }
+            }
+            consume(src, own_row);
+        };
+        const std::function<void(int, const reduction::distance_row&)> consume_tree = consume_own;
+        #pragma omp for schedule(dynamic, 16)
+        for (int unit = 0; unit < K + C; unit++){
+            unit_limit = unit_limits[unit];
+            if (unit < K){
+                kernel_search(*this, unit, unit_limit, from_u);
+                expand_row(*this, from_u, -1, 0, unit_limit, seen, round++, row, stack);
+                consume_own(this->KernelVertex[unit], row);
+                consume_tree_rows(*this, this->KernelVertex[unit], row, unit_limit, tree_row, consume_tree);
+                continue;
+            }
+            int c = unit - K;
+            kernel_search(*this, this->ChainU[c], unit_limit, from_u);
+            kernel_search(*this, this->ChainW[c], unit_limit, from_w);
+            int64_t first = this->ChainOffsets[c];
+            int64_t count = this->ChainOffsets[c+1] - first;
+            for (int64_t i = first; i < first + count; i++){
+                int position = i - first;
+                combine_ends(K, from_u, from_w, this->ChainPrefix[i], position + 1, this->ChainLength[c] - this->ChainPrefix[i], count - position, unit_limit, combined);
+                expand_row(*this, combined, c, i, unit_limit, seen, round++, row, stack);
+                consume_own(this->ChainMembers[i], row);
+                consume_tree_rows(*this, this->ChainMembers[i], row, unit_limit, tree_row, consume_tree);
+            }
+        }
+    }
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+
+#include "compact_graph.h"
+
+/**
+ * Exact reduction of undirected networks for the computations searching from every source, for networks with many pendant trees and
+ * long paths of degree 2 vertices (eg. road networks).
+ * Pendant trees are peeled first: vertices with a single neighbor are removed until none is left, each keeping the edge to its parent.
+ * Maximal paths of the remaining degree 2 vertices (chains) are then contracted into one edge between their two end vertices, holding
+ * the information distance and the number of edges of the path. The remaining vertices and edges form the kernel.
+ * The distances from a source are found by searching the kernel only: from the source if it is a kernel vertex, or from both ends of its
+ * chain (once for every vertex of the chain). The distances to the chain vertices are the shorter of the ways through either end, and the
+ * distances to the tree vertices add the path up to their root. Each tree vertex takes the distances of its root, its own tree is walked directly.
+ * Distances compare like the label correcting searches (information, then network distance, information distances within
+ * MINIMAL_PERCENT_ROUNDING_ERR treated as equal), and the information distances of paths are summed in a different order, so
+ * distances can differ from the full searches in their last digits and between nearly equally long paths.
+ * Needs non-negative edge weights.
+*/
+namespace reduction {
+    // Limits of the searches from one source: the vertices within information distance Tau and network distance K of it
+    class search_limit {
+        public:
+            double Tau = INFINITY;
+            int K = INT32_MAX;
+    };
+
+    // Vertices reached from one source with their distances, the source itself included at 0
+    class distance_row {
+        public:
+            std::vector<int> Vertices;
+            std::vector<long double> Info;
+            std::vector<int> Net;
+
+            void clear(){
+                this->Vertices.clear();
+                this->Info.clear();
+                this->Net.clear();
+            }
+
+            void push(int vertex, long double info_distance, int net_distance){
+                this->Vertices.push_back(vertex);
+                this->Info.push_back(info_distance);
+                this->Net.push_back(net_distance);
+            }
+    };
+
+    class reduced_graph {
+        public:
+            // Number of vertex slots of the network
+            int Vertices = 0;
+
+            // Kernel vertex of each kernel ID, and the kernel ID of each vertex (-1 if removed)
+            std::vector<int> KernelVertex;
+            std::vector<int> KernelId;
+            // Edges of kernel vertex k are the entries Offsets[k] to Offsets[k+1] (exclusive) of Targets (kernel IDs), Info and Hops
+            std::vector<int64_t> Offsets;
+            std::vector<int> Targets;
+            std::vector<double> Info;
+            std::vector<int> Hops;
+
+            // The vertices of chain c, in order from its end ChainU[c] to its end ChainW[c] (kernel IDs, equal for a chain closing a cycle),
+            // are the entries ChainOffsets[c] to ChainOffsets[c+1] (exclusive) of ChainMembers
+            std::vector<int> ChainU;
+            std::vector<int> ChainW;
+            std::vector<int64_t> ChainOffsets;
+            std::vector<int> ChainMembers;
+            // Information distance from ChainU along the chain to each entry of ChainMembers
+            std::vector<long double> ChainPrefix;
+            // Information distance of the whole chain from end to end
+            std::vector<long double> ChainLength;
+            // Chains ending at kernel vertex k are the entries IncidentOffsets[k] to IncidentOffsets[k+1] (exclusive) of IncidentChains
+            std::vector<int64_t> IncidentOffsets;
+            std::vector<int> IncidentChains;
+
+            // Parent of each peeled tree vertex (-1 if not peeled) and the information distance of the edge to it
+            std::vector<int> Parent;
+            std::vector<double> ParentInfo;
+            // Vertex that is not peeled at the base of the tree of each peeled vertex
+            std::vector<int> Root;
+            // Peeled vertices whose parent is vertex v are the entries ChildOffsets[v] to ChildOffsets[v+1] (exclusive) of Children
+            std::vector<int64_t> ChildOffsets;
+            std::vector<int> Children;
+
+            // Construct an empty reduced graph
+            reduced_graph();
+
+            /**
+             * Reduces an undirected graph whose edges all have non-negative weights (parallel edges are reduced to the shortest, self loops are ignored)
+             * @param graph The graph
+            */
+            reduced_graph(const compact_graph &graph);
+
+            // Returns the number of kernel vertices
+            int kernel_vertices() const {
+                return this->KernelVertex.size();
+            }
+
+            // Returns the number of vertices in chains
+            int chain_vertices() const {
+                return this->ChainMembers.size();
+            }
+
+            // Returns the number of peeled tree vertices
+            int tree_vertices() const {
+                return this->Vertices - this->kernel_vertices() - this->chain_vertices();
+            }
+
+            /**
+             * Finds the vertices within information distance tau of every source, the kernel vertices and chains are searched in parallel
+             * @param tau The upper bound of information distance
+             * @param consume Called by the searching thread with each source and its row, the row is reused once it returns
+            */
+            void for_each_source(double tau, const std::function<void(int, const distance_row&)> &consume) const;
+
+            /**
+             * Finds the vertices within the limits of each source. The searches shared by a kernel vertex or a chain (and the trees hanging from them)
+             * run to the widest limits of their sources, and the row of each source is cut to its own limits.
+             * Searches limited by K keep the shortest information distance of each vertex found within K edges, like the label correcting searches,
+             * but the searches from the ends of a chain or from the root of a tree spend K edges from there. With weights other than constant, a
+             * vertex whose shortest information distance needs more edges can then be reached along a different path than from the source itself.
+             * @param limit_of Returns the limits of a source, called once per vertex (from several threads) before the searches
+             * @param consume Called by the searching thread with each source and its row, the row is reused once it returns
+            */
+            void for_each_source(const std::function<search_limit(int)> &limit_of, const std::function<void(int, const distance_row&)> &consume) const;
+    };
+};
@@ -0,0 +1,247 @@
+#include <vector>
+#include <cstdlib>
+#include <iostream>
+#include <algorithm>
+#include <omp.h>
+
+#include "reorder.h"
+
+namespace {
+    // Most breadth first sweeps made looking for a pseudo-peripheral vertex, the eccentricity grows with every sweep that is kept
+    const int MAX_PERIPHERAL_SWEEPS = 16;
+
+    // Undirected view of a graph: the edges leaving each vertex, and for a directed graph the edges entering it as well
+    class undirected_view {
+        public:
+            const compact_graph &Out;
+            compact_graph In;
+            std::vector<int64_t> Degree;
+
+            undirected_view(const compact_graph &graph) : Out(graph), In(graph.Directional ? graph.reversed() : compact_graph()), Degree(graph.Vertices) {
+                for (int v = 0; v < graph.Vertices; v++){
+                    this->Degree[v] = graph.degree(v) + (graph.Directional ? this->In.degree(v) : 0);
+                }
+            }
+
+            template<typename F>
+            void for_each_neighbor(int v, F visit) const {
+                for (int64_t e = this->Out.Offsets[v]; e < this->Out.Offsets[v+1]; e++){
+                    visit(this->Out.Targets[e]);
+                }
+                if (this->Out.Directional){
+                    for (int64_t e = this->In.Offsets[v]; e < this->In.Offsets[v+1]; e++){
+                        visit(this->In.Targets[e]);
+                    }
+                }
+            }
+    };
+
+    // Breadth first sweeps over one component, marking the vertices of each sweep with its own stamp so the marks are never reset
+    class level_search {
+        public:
+            const undirected_view &View;
+            std::vector<int> Stamp;
+            int CurrentStamp = 0;
+            std::vector<int> Queue;
+
+            level_search(const undirected_view &view) : View(view), Stamp(view.Out.Vertices, 0) {}
+
+            /**
+             * Searches from a vertex
+             * @param src The source
+             * @param last_level Set to the vertices of the last level reached
+             * @return The eccentricity of the source
+            */
+            int sweep(int src, std::vector<int> &last_level){
+                this->CurrentStamp++;
+                this->Queue.assign(1, src);
+                this->Stamp[src] = this->CurrentStamp;
+                size_t level_start = 0;
+                int eccentricity = 0;
+                while (true){
+                    size_t level_end = this->Queue.size();
+                    for (size_t i = level_start; i < level_end; i++){
+                        this->View.for_each_neighbor(this->Queue[i], [this](int target){
+                            if (this->Stamp[target] != this->CurrentStamp){
+                                this->Stamp[target] = this->CurrentStamp;
+                                this->Queue.push_back(target);
+                            }
+                        });
+                    }
+                    if (this->Queue.size() == level_end){
+                        last_level.assign(this->Queue.begin() + level_start, this->Queue.begin() + level_end);
+                        return eccentricity;
+                    }
+                    level_start = level_end;
+                    eccentricity++;
+                }
+            }
+    };
+
+    // Finds a vertex of large eccentricity in the component of a start vertex (George and Liu), moving to the smallest degree vertex of the last level while the eccentricity grows
+    int pseudo_peripheral(level_search &search, int start){
+        std::vector<int> last_level;
+        int eccentricity = search.sweep(start, last_level);
+        for (int sweep = 1; sweep < MAX_PERIPHERAL_SWEEPS; sweep++){
+            int candidate = *std::min_element(last_level.begin(), last_level.end(), [&search](int a, int b){
+                return std::make_pair(search.View.Degree[a], a) < std::make_pair(search.View.Degree[b], b);
+            });
+            std::vector<int> candidate_level;
+            int candidate_eccentricity = search.sweep(candidate, candidate_level);
+            if (candidate_eccentricity <= eccentricity){
+                break;
+            }
+            start = candidate;
+            eccentricity = candidate_eccentricity;
+            last_level.swap(candidate_level);
+        }
+        return start;
+    }
+
+    // Breadth first order of every component, each from a pseudo-peripheral vertex, components taken by their smallest degree vertex
+    std::vector<int> breadth_first_order(const undirected_view &view, bool BY_DEGREE){
+        const int V = view.Out.Vertices;
+        std::vector<int> starts(V);
+        for (int v = 0; v < V; v++){
+            starts[v] = v;
+        }
+        std::stable_sort(starts.begin(), starts.end(), [&view](int a, int b){
+            return view.Degree[a] < view.Degree[b];
+        });
+
+        level_search search(view);
+        std::vector<char> placed(V, 0);
+        std::vector<int> order;
+        order.reserve(V);
+        std::vector<int> children;
+        for (int start : starts){
+            if (placed[start]){
+                continue;
+            }
+            int src = pseudo_peripheral(search, start);
+            size_t head = order.size();
+            order.push_back(src);
+            placed[src] = 1;
+            while (head < order.size()){
+                int v = order[head++];
+                children.clear();
+                view.for_each_neighbor(v, [&placed, &children](int target){
+                    if (!placed[target]){
+                        placed[target] = 1;
+                        children.push_back(target);
+                    }
+                });
+                if (BY_DEGREE){
+                    std::stable_sort(children.begin(), children.end(), [&view](int a, int b){
+                        return view.Degree[a] < view.Degree[b];
+                    });
+                }
+                order.insert(order.end(), children.begin(), children.end());
+            }
+        }
+        return order;
+    }
+}
+
+reorder::method reorder::from_flags(std::map<std::string, std::string> &flags){
+    if (!flags.count("reorder") || flags["reorder"] == "none"){
+        return reorder::method::none;
+    } else if (flags["reorder"] == "rcm"){
+        return reorder::method::rcm;
+    } else if (flags["reorder"] == "bfs"){
+        return reorder::method::bfs;
+    } else if (flags["reorder"] == "hub"){
+        return reorder::method::hub;
+    }
+    std::cerr << "ERROR: Invalid --reorder value. Please pick none, rcm, bfs or hub.\n";
+    exit(1);
+}
+
+std::string reorder::method_name(reorder::method METHOD){
+    switch (METHOD){
+        case reorder::method::rcm:
+            return "rcm";
+        case reorder::method::bfs:
+            return "bfs";
+        case reorder::method::hub:
+            return "hub";
+        default:
+            return "none";
+    }
+}
+
+reorder::vertex_order reorder::find_order(const compact_graph &graph, reorder::method METHOD){
+    const int V = graph.Vertices;
+    reorder::vertex_order order;
+    if (METHOD == reorder::method::rcm || METHOD == reorder::method::bfs){
+        undirected_view view(graph);
+        order.OriginalId = breadth_first_order(view, METHOD == reorder::method::rcm);
+        if (METHOD == reorder::method::rcm){
+            std::reverse(order.OriginalId.begin(), order.OriginalId.end());
+        }
+    } else {
+        order.OriginalId.resize(V);
+        for (int v = 0; v < V; v++){
+            order.OriginalId[v] = v;
+        }
+        if (METHOD == reorder::method::hub && V > 0){
+            // Only the hubs move, so the rest keep whatever locality the input IDs had
+            const double AVERAGE_DEGREE = (double) graph.edge_count() / V;
+            std::stable_partition(order.OriginalId.begin(), order.OriginalId.end(), [&graph, AVERAGE_DEGREE](int v){
+                return graph.degree(v) > AVERAGE_DEGREE;
+            });
+            auto hubs_end = std::find_if(order.OriginalId.begin(), order.OriginalId.end(), [&graph, AVERAGE_DEGREE](int v){
+                return graph.degree(v) <= AVERAGE_DEGREE;
+            });
+            std::stable_sort(order.OriginalId.begin(), hubs_end, [&graph](int a, int b){
+                return graph.degree(a) > graph.degree(b);
+            });
+        }
+    }
+
+    order.NewId.resize(V);
+    for (int v = 0; v < V; v++){
+        order.NewId[order.OriginalId[v]] = v;
+    }
+    return order;
+}
+
+compact_graph reorder::relabeled(const compact_graph &graph, const reorder::vertex_order &order){
+    compact_graph relabeled_graph;
+    relabeled_graph.Vertices = graph.Vertices;
+    relabeled_graph.Directional = graph.Directional;
+
+    relabeled_graph.Offsets.assign(graph.Vertices + 1, 0);
+    for (int v = 0; v < graph.Vertices; v++){
+        relabeled_graph.Offsets[v+1] = relabeled_graph.Offsets[v] + graph.degree(order.OriginalId[v]);
+    }
+
+    // Resizing leaves the edge arrays untouched, so their pages are first touched (and placed) by the threads filling the rows
+    relabeled_graph.Targets.resize(graph.edge_count());
+    relabeled_graph.Weights.resize(graph.edge_count());
+    #pragma omp parallel for schedule(dynamic, 256)
+    for (int v = 0; v < graph.Vertices; v++){
+        int64_t position = relabeled_graph.Offsets[v];
+        const int original = order.OriginalId[v];
+        for (int64_t e = graph.Offsets[original]; e < graph.Offsets[original+1]; e++){
+            relabeled_graph.Targets[position] = order.NewId[graph.Targets[e]];
+            relabeled_graph.Weights[position] = graph.Weights[e];
+            position++;
+        }
+    }
+    return relabeled_graph;
+}
+
+double reorder::mean_edge_span(const compact_graph &graph){
+    if (graph.edge_count() == 0){
+        return 0;
+    }
+    double span = 0;
+    #pragma omp parallel for schedule(dynamic, 256) reduction(+:span)
+    for (int v = 0; v < graph.Vertices; v++){
+        for (int64_t e = graph.Offsets[v]; e < graph.Offsets[v+1]; e++){
+            span += std::abs(graph.Targets[e] - v);
+        }
+    }
+    return span / graph.edge_count();
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include "compact_graph.h"
+
+/**
+ * Vertex reordering of compact graphs for locality. Vertex IDs come from the input, so the neighbors of a vertex (and the entries of
+ * the per-vertex scratch arrays a search touches) are scattered over memory. A relabeled copy of the graph places vertices that are
+ * close in the network at nearby IDs, and the computations looping over every source then also take the sources in the new order, so
+ * consecutive sources touch overlapping memory. Results indexed by vertex are mapped back to the original IDs.
+ * The edges of each vertex keep their order, so the searches relax the same edges in the same order and find the same distances.
+*/
+namespace reorder {
+    // How the vertices are ordered
+    enum class method {
+        none, // The original IDs
+        rcm,  // Reverse Cuthill-McKee: breadth first from a pseudo-peripheral vertex of each component, neighbors by ascending degree, then reversed
+        bfs,  // Breadth first from a pseudo-peripheral vertex of each component, neighbors in edge order
+        hub   // Hub clustering: the vertices of above average degree first by descending degree, the other vertices in their original order
+    };
+
+    // Mapping between the original vertex IDs and the new ones
+    class vertex_order {
+        public:
+            // New ID of each original vertex
+            std::vector<int> NewId;
+            // Original vertex of each new ID
+            std::vector<int> OriginalId;
+
+            /**
+             * Returns per-vertex values indexed by the new IDs
+             * @param values The values indexed by the original IDs
+             * @param missing The value of the vertices past the end of values
+             * @return The values of every new ID
+            */
+            template<typename T>
+            std::vector<T> to_new_ids(const std::vector<T> &values, T missing) const {
+                std::vector<T> permuted(this->OriginalId.size(), missing);
+                for (size_t v = 0; v < this->OriginalId.size(); v++){
+                    if ((size_t) this->OriginalId[v] < values.size()){
+                        permuted[v] = values[this->OriginalId[v]];
+                    }
+                }
+                return permuted;
+            }
+
+            /**
+             * Returns per-vertex values indexed by the original IDs
+             * @param values The values indexed by the new IDs, one per vertex
+             * @return The values of every original vertex
+            */
+            template<typename T>
+            std::vector<T> to_original_ids(const std::vector<T> &values) const {
+                std::vector<T> permuted(values.size());
+                for (size_t v = 0; v < values.size(); v++){
+                    permuted[this->OriginalId[v]] = values[v];
+                }
+                return permuted;
+            }
+    };
+
+    /**
+     * Reads the method from the --reorder=none|rcm|bfs|hub flag. Exits if the value is unknown.
+     * @param flags The flags given on the command line
+     * @return The method, none without the flag
+    */
+    method from_flags(std::map<std::string, std::string> &flags);
+
+    /**
+     * Returns the name of a method as given to --reorder
+     * @param METHOD The method
+     * @return The name
+    */
+    std::string method_name(method METHOD);
+
+    /**
+     * Orders the vertices of a graph, treating the edges of a directed graph as undirected
+     * @param graph The graph
+     * @param METHOD The method
+     * @return The order
+    */
+    vertex_order find_order(const compact_graph &graph, method METHOD);
+
+    /**
+     * Copies a graph with its vertices relabeled, the rows filled in parallel
+     * @param graph The graph
+     * @param order The order of its vertices
+     * @return The relabeled graph, the edges of each vertex in their original order
+    */
+    compact_graph relabeled(const compact_graph &graph, const vertex_order &order);
+
+    /**
+     * Returns the mean distance between the IDs of the two ends of the edges of a graph, a measure of how far apart in memory neighbors are
+     * @param graph The graph
+     * @return The mean ID distance, 0 without edges
+    */
+    double mean_edge_span(const compact_graph &graph);
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+
+namespace rng {
+    // Increment of the Weyl sequence used by SplitMix64 (2^64 / golden ratio)
+    const uint64_t GOLDEN_GAMMA = 0x9E3779B97F4A7C15ULL;
+
+    // SplitMix64 finalizer: a bijective mix of the 64 bits of x
+    inline uint64_t mix64(uint64_t x){
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        return x ^ (x >> 31);
+    }
+
+    /**
+     * Counter-based random number stream. The n-th value of a stream only depends on (seed, stream, n),
+     * so results do not depend on which thread draws from which stream or in which order streams are used.
+     */
+    class counter_rng {
+        private:
+            uint64_t Key;
+            uint64_t Counter;
+        public:
+            /**
+             * Construct the stream with the given ID under a seed
+             * @param seed The seed shared by all streams of a computation
+             * @param stream The ID of the stream (eg. the vertex the values are drawn for)
+            */
+            counter_rng(uint64_t seed, uint64_t stream){
+                this->Key = mix64(seed ^ mix64(stream * GOLDEN_GAMMA + GOLDEN_GAMMA));
+                this->Counter = 0;
+            }
+
+            // Returns the next 64 random bits of the stream
+            uint64_t next(){
+                this->Counter++;
+                return mix64(this->Key + this->Counter * GOLDEN_GAMMA);
+            }
+
+            // Returns a uniformly distributed double in [0, 1)
+            double uniform(){
+                return (next() >> 11) * 0x1.0p-53;
+            }
+
+            // Returns a uniformly distributed integer in [0, n) (n > 0) without modulo bias
+            uint64_t below(uint64_t n){
+                uint64_t threshold = -n % n;
+                while (true){
+                    __uint128_t product = (__uint128_t) next() * n;
+                    if ((uint64_t) product >= threshold){
+                        return product >> 64;
+                    }
+                }
+            }
+    };
+};
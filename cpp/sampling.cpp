@@ -0,0 +1,299 @@
+#include <cmath>
+#include <chrono>
+#include <random>
+#include <iostream>
+#include <algorithm>
+#include <cstdio>
+
+#include "rng.h"
+
+#include "sampling.h"
+
+namespace {
+    // Mixed into the seed before drawing, so the order of the sources is not drawn from the same streams as the network the same --seed generated
+    const uint64_t SAMPLE_STREAM_TAG = 0x73616D706C65ULL;
+
+    // Running sums of the sampled sources of a stratum, y is the value of a source (0 if left out) and x whether it was counted
+    struct stratum_sums {
+        int64_t n = 0;
+        long double y = 0;
+        long double x = 0;
+        long double yy = 0;
+        long double xy = 0;
+    };
+
+    // Returns the z such that P(Z <= z) = p for a standard normal Z
+    double normal_quantile(double p){
+        double low = -40;
+        double high = 40;
+        for (int i = 0; i < 200; i++){
+            double mid = (low + high) / 2;
+            if (0.5 * std::erfc(-mid / std::sqrt(2.0)) < p){
+                low = mid;
+            } else {
+                high = mid;
+            }
+        }
+        return (low + high) / 2;
+    }
+
+    /**
+     * Returns the combined ratio estimate sum(y) / sum(x) over every source from the sampled sources of each stratum
+     * @param sizes The number of sources of each stratum
+     * @param sums The sums of the sampled sources of each stratum
+     * @param z The standard normal quantile of the confidence level
+     * @param half_width Set to the half width of the confidence interval (INFINITY if no source was counted yet)
+     * @return The estimate (NAN if no source was counted yet)
+    */
+    double ratio_estimate(const std::vector<int64_t> &sizes, const std::vector<stratum_sums> &sums, double z, double &half_width){
+        long double total_y = 0;
+        long double total_x = 0;
+        for (size_t h = 0; h < sizes.size(); h++){
+            if (sums[h].n > 0){
+                total_y += (long double) sizes[h] * sums[h].y / sums[h].n;
+                total_x += (long double) sizes[h] * sums[h].x / sums[h].n;
+            }
+        }
+        if (total_x == 0){
+            half_width = INFINITY;
+            return NAN;
+        }
+        long double ratio = total_y / total_x;
+        // Variance of the linearized residuals d = y - ratio * x of each stratum, without replacement
+        long double variance = 0;
+        for (size_t h = 0; h < sizes.size(); h++){
+            const stratum_sums &s = sums[h];
+            if (s.n >= sizes[h] || s.n < 2){
+                continue;
+            }
+            long double d_sum = s.y - ratio * s.x;
+            long double d_squares = s.yy - 2 * ratio * s.xy + ratio * ratio * s.x;
+            long double d_variance = std::max((long double) 0, (d_squares - d_sum * d_sum / s.n) / (s.n - 1));
+            variance += (long double) sizes[h] * sizes[h] * (1 - (long double) s.n / sizes[h]) * d_variance / s.n;
+        }
+        half_width = z * std::sqrt((double) variance) / (double) total_x;
+        return ratio;
+    }
+}
+
+sampling::plan sampling::from_flags(std::map<std::string, std::string> &flags){
+    sampling::plan plan;
+    if (!flags.count("sample")){
+        for (std::string flag : {"rel-error", "confidence", "time-budget"}){
+            if (flags.count(flag)){
+                std::cerr << "ERROR: --" << flag << " only applies with --sample.\n";
+                exit(1);
+            }
+        }
+        return plan;
+    }
+    plan.Enabled = true;
+    if (flags["sample"] == "uniform"){
+        plan.Design = sampling::design::uniform;
+    } else if (flags["sample"] == "degree"){
+        plan.Design = sampling::design::degree;
+    } else {
+        std::cerr << "ERROR: Invalid --sample value. Please pick uniform or degree.\n";
+        exit(1);
+    }
+
+    try {
+        if (flags.count("rel-error")){
+            plan.RelativeError = std::stod(flags["rel-error"]);
+        }
+        if (flags.count("confidence")){
+            plan.Confidence = std::stod(flags["confidence"]);
+        }
+        if (flags.count("time-budget")){
+            plan.TimeBudgetSeconds = std::stod(flags["time-budget"]);
+        }
+    } catch (...){
+        std::cerr << "ERROR: Invalid --rel-error, --confidence or --time-budget value.\n";
+        exit(1);
+    }
+    if ( !(plan.RelativeError > 0) ){
+        std::cerr << "ERROR: Invalid --rel-error value. Please pick a number above 0.\n";
+        exit(1);
+    } else if ( !(plan.Confidence > 0 && plan.Confidence < 1) ){
+        std::cerr << "ERROR: Invalid --confidence value. Please pick a number between 0 and 1 (exclusive).\n";
+        exit(1);
+    } else if ( !(plan.TimeBudgetSeconds >= 0) ){
+        std::cerr << "ERROR: Invalid --time-budget value.\n";
+        exit(1);
+    }
+
+    if (flags.count("seed")){
+        try {
+            plan.Seed = std::stoull(flags["seed"]);
+        } catch (...){
+            std::cerr << "ERROR: Invalid --seed value.\n";
+            exit(1);
+        }
+    } else {
+        std::random_device rd;
+        plan.Seed = ((uint64_t) rd() << 32) | rd();
+        std::cout << "Sample seed: " << plan.Seed << "\n";
+    }
+    return plan;
+}
+
+std::vector<int> sampling::degree_strata(const std::vector<int64_t> &degrees){
+    std::vector<int> strata(degrees.size());
+    for (size_t v = 0; v < degrees.size(); v++){
+        strata[v] = 63 - __builtin_clzll((uint64_t) degrees[v] + 1);
+    }
+    return strata;
+}
+
+sampling::estimate sampling::estimate_mean(int POPULATION, const std::vector<int> &strata, const sampling::plan &PLAN, const std::function<void(const std::vector<int>&, std::vector<double>&)> &evaluate, const std::vector<int> *new_ids){
+    const auto start = std::chrono::steady_clock::now();
+    const double z = normal_quantile(0.5 + PLAN.Confidence / 2);
+
+    // Random order of the sources of each stratum, the sample of each stratum is a prefix of its order
+    int stratum_count = 1;
+    for (int stratum : strata){
+        stratum_count = std::max(stratum_count, stratum + 1);
+    }
+    std::vector<std::vector<int>> order(stratum_count);
+    for (int original = 0; original < POPULATION; original++){
+        int v = new_ids == nullptr ? original : (*new_ids)[original];
+        order[strata.empty() ? 0 : strata[v]].push_back(v);
+    }
+    // Original ID of each relabeled source, the values are summed in the order of the original IDs as if the sources were not relabeled
+    std::vector<int> original_ids;
+    if (new_ids != nullptr){
+        original_ids.resize(POPULATION);
+        for (int original = 0; original < POPULATION; original++){
+            original_ids[(*new_ids)[original]] = original;
+        }
+    }
+    std::vector<int64_t> sizes(stratum_count);
+    for (int h = 0; h < stratum_count; h++){
+        rng::counter_rng generator(rng::mix64(PLAN.Seed ^ SAMPLE_STREAM_TAG), h);
+        for (int64_t i = (int64_t) order[h].size() - 1; i > 0; i--){
+            std::swap(order[h][i], order[h][generator.below(i + 1)]);
+        }
+        sizes[h] = order[h].size();
+    }
+
+    std::vector<stratum_sums> sums(stratum_count);
+    sampling::estimate result;
+    result.Population = POPULATION;
+    int64_t target = std::min<int64_t>(sampling::FIRST_BATCH_SOURCES, POPULATION);
+    double half_width = INFINITY;
+    std::vector<int> batch;
+    std::vector<double> values;
+    std::vector<size_t> summation_order;
+    while (true){
+        // Proportional allocation of the target, with at least two sources of each stratum so its variance is known
+        batch.clear();
+        while (batch.empty() && result.Samples < POPULATION){
+            for (int h = 0; h < stratum_count; h++){
+                int64_t allocated = std::min(sizes[h], std::max(std::min<int64_t>(2, sizes[h]), (target * sizes[h] + POPULATION - 1) / POPULATION));
+                for (int64_t i = sums[h].n; i < allocated; i++){
+                    batch.push_back(order[h][i]);
+                }
+            }
+            target = std::min<int64_t>(2 * target, POPULATION);
+        }
+        if (batch.empty()){
+            break;
+        }
+        // Ascending sources search the graph in the order it is stored
+        std::sort(batch.begin(), batch.end());
+        values.assign(batch.size(), 0);
+        evaluate(batch, values);
+        summation_order.resize(batch.size());
+        for (size_t i = 0; i < batch.size(); i++){
+            summation_order[i] = i;
+        }
+        if (new_ids != nullptr){
+            std::sort(summation_order.begin(), summation_order.end(), [&](size_t a, size_t b){
+                return original_ids[batch[a]] < original_ids[batch[b]];
+            });
+        }
+        for (size_t i : summation_order){
+            stratum_sums &s = sums[strata.empty() ? 0 : strata[batch[i]]];
+            s.n++;
+            if (values[i] != INFINITY){
+                s.y += values[i];
+                s.x += 1;
+                s.yy += (long double) values[i] * values[i];
+                s.xy += values[i];
+            }
+        }
+        result.Samples += batch.size();
+
+        result.Mean = ratio_estimate(sizes, sums, z, half_width);
+        if (result.Samples == POPULATION){
+            result.Exact = true;
+            break;
+        }
+        if (half_width <= PLAN.RelativeError * std::abs(result.Mean)){
+            result.ReachedError = true;
+            break;
+        }
+
+        // Aim for the sample size the current variance needs, at most doubling it per batch, and within the remaining time
+        int64_t next = 2 * result.Samples;
+        if (half_width != INFINITY && result.Mean != 0){
+            double needed = result.Samples * std::pow(half_width / (PLAN.RelativeError * std::abs(result.Mean)), 2) * 1.1;
+            next = std::min<double>(next, std::max<double>(needed, result.Samples + sampling::FIRST_BATCH_SOURCES));
+        }
+        if (PLAN.TimeBudgetSeconds > 0){
+            double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            double affordable = result.Samples * (PLAN.TimeBudgetSeconds - elapsed) / elapsed;
+            if (affordable < 1){
+                break;
+            }
+            next = std::min<double>(next, result.Samples + affordable);
+        }
+        target = std::min<int64_t>(next, POPULATION);
+    }
+
+    if (std::isnan(result.Mean)){
+        std::cerr << "No valid values\n";
+        exit(1);
+    }
+    result.Low = result.Exact ? result.Mean : result.Mean - half_width;
+    result.High = result.Exact ? result.Mean : result.Mean + half_width;
+    return result;
+}
+
+sampling::estimate sampling::exact(double mean, int64_t POPULATION){
+    sampling::estimate result;
+    result.Mean = mean;
+    result.Low = mean;
+    result.High = mean;
+    result.Samples = POPULATION;
+    result.Population = POPULATION;
+    result.Exact = true;
+    return result;
+}
+
+void sampling::print_estimate(const sampling::estimate &result, const sampling::plan &PLAN){
+    std::cout << "Confidence interval (" << PLAN.Confidence * 100 << "%): [" << result.Low << ", " << result.High << "] | Sources searched: " << result.Samples << " of " << result.Population;
+    if (result.Exact){
+        std::cout << " | Every source searched\n";
+    } else if (result.ReachedError){
+        std::cout << " | Relative error reached\n";
+    } else {
+        std::cout << " | Time budget reached\n";
+    }
+}
+
+void sampling::add_estimate_columns(sqlite3 *db, std::string table){
+    for (std::string column : {"ci_low REAL", "ci_high REAL", "sample_size INT"}){
+        char *zErrMsg = 0;
+        std::string sql_alter_query = "ALTER TABLE " + table + " ADD COLUMN " + column + ";";
+        if (sqlite3_exec(db, sql_alter_query.c_str(), NULL, 0, &zErrMsg) != SQLITE_OK){
+            // Tables created with the columns already have them
+            if (std::string(zErrMsg).rfind("duplicate column name", 0) != 0){
+                fprintf(stderr, "Table Alteration SQL error: %s\n", zErrMsg);
+                sqlite3_free(zErrMsg);
+                exit(1);
+            }
+            sqlite3_free(zErrMsg);
+        }
+    }
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <sqlite3.h>
+
+/**
+ * Sampling estimators of averages over every source vertex (S_avg, the L neighborhood reduction average) for networks too large to search from every source.
+ * The sources are drawn without replacement from a seeded random order, either uniformly or stratified by degree (proportional allocation over
+ * power of two degree classes, so the few hubs of heavy tailed networks are always represented). The sample grows in batches until the confidence
+ * interval of the mean is within the requested relative error, the time budget runs out, or every source was searched (the exact average).
+ * The interval is the normal approximation of the (stratified, ratio) estimator with the finite population correction, so sources whose value is
+ * left out of the average (INFINITY) are handled like the full averages do.
+*/
+namespace sampling {
+    const double DEFAULT_RELATIVE_ERROR = 0.01;
+    const double DEFAULT_CONFIDENCE = 0.95;
+    // Sources searched before the first check of the interval, fewer make the normal approximation unreliable
+    const int FIRST_BATCH_SOURCES = 256;
+
+    // How the sources are drawn
+    enum class design {
+        uniform,
+        degree
+    };
+
+    // Parameters of a sampling estimate, disabled (every source is searched) unless read from flags with --sample
+    class plan {
+        public:
+            // Whether the average is estimated from a sample
+            bool Enabled = false;
+            design Design = design::uniform;
+            // Half width of the confidence interval relative to the estimate at which sampling stops
+            double RelativeError = DEFAULT_RELATIVE_ERROR;
+            // Confidence level of the interval, between 0 and 1 (exclusive)
+            double Confidence = DEFAULT_CONFIDENCE;
+            // Seconds after which no further batch is started (0 for no limit)
+            double TimeBudgetSeconds = 0;
+            // Seed of the random order of the sources (the streams are derived from it apart from the generator's)
+            uint64_t Seed = 0;
+    };
+
+    // Estimate of an average over every source
+    class estimate {
+        public:
+            double Mean = 0;
+            // Bounds of the confidence interval (equal to Mean when exact)
+            double Low = 0;
+            double High = 0;
+            // Number of sources searched
+            int64_t Samples = 0;
+            // Number of sources
+            int64_t Population = 0;
+            // Whether every source was searched
+            bool Exact = false;
+            // Whether the interval reached the requested relative error
+            bool ReachedError = false;
+    };
+
+    /**
+     * Reads the plan from the --sample=uniform|degree, --rel-error=E, --confidence=C, --time-budget=SECONDS and --seed flags. Exits on invalid values.
+     * Without --seed the seed is drawn and printed so the sample can be repeated.
+     * @param flags The flags given on the command line
+     * @return The plan, disabled without --sample
+    */
+    plan from_flags(std::map<std::string, std::string> &flags);
+
+    /**
+     * Returns the degree class of every vertex, floor(log2(degree + 1))
+     * @param degrees The degree of every vertex
+     * @return The class of every vertex
+    */
+    std::vector<int> degree_strata(const std::vector<int64_t> &degrees);
+
+    /**
+     * Estimates the average of a value over the sources 0 to POPULATION - 1, leaving out the sources whose value is INFINITY
+     * @param POPULATION The number of sources
+     * @param strata The stratum of every source (a single stratum if empty)
+     * @param PLAN The plan of the estimate
+     * @param evaluate Called with a batch of sources (ascending) and a vector of the same size to fill with the value of each, may search the batch in parallel
+     * @param new_ids If the sources were relabeled, the new ID of each original source: the order is drawn over the original IDs, so the same sources are sampled
+     * @return The estimate. Exits if no source has a value.
+    */
+    estimate estimate_mean(int POPULATION, const std::vector<int> &strata, const plan &PLAN, const std::function<void(const std::vector<int>&, std::vector<double>&)> &evaluate, const std::vector<int> *new_ids = nullptr);
+
+    /**
+     * Returns the exact estimate of an average computed over every source
+     * @param mean The average
+     * @param POPULATION The number of sources
+     * @return The estimate
+    */
+    estimate exact(double mean, int64_t POPULATION);
+
+    /**
+     * Prints the interval and sample size of an estimate, the line following the estimate itself
+     * @param result The estimate
+     * @param PLAN The plan of the estimate
+    */
+    void print_estimate(const estimate &result, const plan &PLAN);
+
+    /**
+     * Adds the ci_low, ci_high and sample_size columns of the estimates to a results table created without them, so older result dbs keep working
+     * @param db The db holding the table
+     * @param table The table (with its schema prefix if attached)
+    */
+    void add_estimate_columns(sqlite3 *db, std::string table);
+};
@@ -0,0 +1,151 @@
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <omp.h>
+
+#include "sssp.h"
+
+namespace {
+    // A relaxation of an edge, applied by the thread owning its destination
+    struct relaxation {
+        int to;
+        int net_distance;
+        long double info_distance;
+    };
+}
+
+double sssp::default_delta(const compact_graph &graph){
+    long double total = 0;
+    for (int64_t i = 0; i < graph.edge_count(); i++){
+        total += graph.Weights[i];
+    }
+    if (graph.edge_count() == 0 || !(total > 0)){
+        return 1;
+    }
+    return total / graph.edge_count();
+}
+
+metrics::distance_to_vertices sssp::delta_stepping_tau(const compact_graph &graph, metrics::src_vertex src, double tau, double DELTA){
+    const int THREADS = omp_get_max_threads();
+    std::vector<long double> info_distance(graph.Vertices, INFINITY);
+    std::vector<int> net_distance(graph.Vertices, INT32_MAX);
+    // Bucket each vertex is queued in (-1 when it is not queued), entries of a bucket whose vertex moved to a lower bucket are skipped
+    std::vector<int64_t> queued_in(graph.Vertices, -1);
+    std::vector<std::vector<int>> buckets;
+    // Relaxations generated by each thread for each owning thread, and the vertices each owner improved
+    std::vector<std::vector<std::vector<relaxation>>> requests(THREADS, std::vector<std::vector<relaxation>>(THREADS));
+    std::vector<std::vector<int>> improved(THREADS);
+
+    // Queues a vertex in the bucket of its information distance, never below the bucket being emptied
+    auto queue = [&](int v, int64_t lowest){
+        int64_t bucket = std::max(lowest, (int64_t) (info_distance[v] / DELTA));
+        if (queued_in[v] == bucket){
+            return;
+        }
+        queued_in[v] = bucket;
+        if (bucket >= (int64_t) buckets.size()){
+            buckets.resize(bucket + 1);
+        }
+        buckets[bucket].push_back(v);
+    };
+
+    // Lowers the distances of a vertex if the relaxation is shorter (information > network), as the label correcting searches do
+    auto improve = [&](const relaxation &request){
+        long double current_to_info_distance = info_distance[request.to];
+        long double possible_to_info_distance = request.info_distance;
+        if (current_to_info_distance - possible_to_info_distance > possible_to_info_distance*MINIMAL_PERCENT_ROUNDING_ERR){
+            info_distance[request.to] = possible_to_info_distance;
+            net_distance[request.to] = request.net_distance;
+            return true;
+        }
+        if (std::abs(current_to_info_distance - possible_to_info_distance) < possible_to_info_distance*MINIMAL_PERCENT_ROUNDING_ERR && net_distance[request.to] > request.net_distance){
+            net_distance[request.to] = request.net_distance;
+            return true;
+        }
+        return false;
+    };
+
+    // Relaxes the light (weight <= DELTA) or heavy edges leaving the given vertices, then queues the improved vertices
+    auto relax = [&](const std::vector<int> &vertices, bool LIGHT, int64_t current){
+        #pragma omp parallel if(vertices.size() >= PARALLEL_PHASE_VERTICES)
+        {
+            std::vector<std::vector<relaxation>> &thread_requests = requests[omp_get_thread_num()];
+            #pragma omp for schedule(static)
+            for (size_t j = 0; j < vertices.size(); j++){
+                int from = vertices[j];
+                long double from_info_distance = info_distance[from];
+                int from_net_distance = net_distance[from];
+                for (int64_t i = graph.Offsets[from]; i < graph.Offsets[from+1]; i++){
+                    int to = graph.Targets[i];
+                    long double weight = graph.Weights[i];
+                    // Ignore self edges
+                    if (to == from || (weight <= DELTA) != LIGHT){
+                        continue;
+                    }
+                    long double possible_to_info_distance = from_info_distance + weight;
+                    if (possible_to_info_distance > tau){
+                        continue;
+                    }
+                    thread_requests[to % THREADS].push_back({to, from_net_distance + 1, possible_to_info_distance});
+                }
+            }
+
+            // Each owner applies the relaxations of its destinations, so no two threads write the same vertex
+            #pragma omp for schedule(static)
+            for (int owner = 0; owner < THREADS; owner++){
+                for (int thread = 0; thread < THREADS; thread++){
+                    for (const relaxation &request : requests[thread][owner]){
+                        if (improve(request)){
+                            improved[owner].push_back(request.to);
+                        }
+                    }
+                    requests[thread][owner].clear();
+                }
+            }
+        }
+        for (std::vector<int> &owner_improved : improved){
+            for (int v : owner_improved){
+                queue(v, current);
+            }
+            owner_improved.clear();
+        }
+    };
+
+    info_distance[src] = 0;
+    net_distance[src] = 0;
+    queue(src, 0);
+
+    std::vector<int> frontier;
+    std::vector<int> settled;
+    for (int64_t current = 0; current < (int64_t) buckets.size(); current++){
+        // Light edges can lead back into the bucket, heavy edges (almost always) lead past it
+        while (!buckets[current].empty()){
+            settled.clear();
+            while (!buckets[current].empty()){
+                frontier.clear();
+                for (int v : buckets[current]){
+                    if (queued_in[v] == current){
+                        queued_in[v] = -1;
+                        frontier.push_back(v);
+                    }
+                }
+                buckets[current].clear();
+                settled.insert(settled.end(), frontier.begin(), frontier.end());
+                relax(frontier, true, current);
+            }
+            std::sort(settled.begin(), settled.end());
+            settled.erase(std::unique(settled.begin(), settled.end()), settled.end());
+            relax(settled, false, current);
+        }
+        std::vector<int>().swap(buckets[current]);
+    }
+
+    metrics::distance_to_vertices dtv;
+    for (int v = 0; v < graph.Vertices; v++){
+        if (net_distance[v] != INT32_MAX){
+            dtv.emplace_hint(dtv.end(), v, metrics::distance_pair{.info_distance = info_distance[v], .net_distance = net_distance[v]});
+        }
+    }
+    return dtv;
+}
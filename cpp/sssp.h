@@ -0,0 +1,32 @@
+#pragma once
+
+#include "compact_graph.h"
+#include "network_metrics.h"
+
+/**
+ * Parallel single source searches for queries where the search itself is the only parallelism available (eg. one dtv_tau query on a large network).
+ * Delta-stepping keeps the reached vertices in buckets of information distance width DELTA. The vertices of the lowest bucket relax their light edges
+ * (weight <= DELTA) in parallel until the bucket stays empty, then relax their heavy edges once. Relaxations are generated by every thread and applied
+ * by the thread owning their destination, with the (information, network) tie-break of the label correcting searches.
+*/
+namespace sssp {
+    // Smallest number of vertices of a phase relaxed in parallel
+    const size_t PARALLEL_PHASE_VERTICES = 1024;
+
+    /**
+     * Returns the default bucket width of a graph, the average edge weight
+     * @param graph The graph searched
+     * @return The bucket width (1 for a graph without edges or weights)
+    */
+    double default_delta(const compact_graph &graph);
+
+    /**
+     * Calculates the same distances as metrics::geodesic_distance_tau with delta-stepping, up to the relative tolerance of the tie-break. Needs non-negative weights.
+     * @param graph The graph searched
+     * @param src The vertex that distances are measured from.
+     * @param tau The upper bound of information distance (sum of edge weights) that the function explores.
+     * @param DELTA The width of the buckets, between the work of Dijkstra (small) and of Bellman-Ford (large)
+     * @return A distance_to_vertices struct (one to all) containing the results
+    */
+    metrics::distance_to_vertices delta_stepping_tau(const compact_graph &graph, metrics::src_vertex src, double tau, double DELTA);
+};
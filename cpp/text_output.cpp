@@ -0,0 +1,109 @@
+#include <charconv>
+#include <string>
+#include <iostream>
+#include <cerrno>
+#include <cstring>
+#include <cctype>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "text_output.h"
+
+void text_output::append_int(std::string &out, long long value){
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    out.append(digits, result.ptr);
+}
+
+void text_output::append_scientific(std::string &out, double value, int precision){
+    char digits[64];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value, std::chars_format::scientific, precision);
+    // to_chars writes lower case (exponent, inf, nan) while %E writes upper case
+    for (char *c = digits; c != result.ptr; c++){
+        *c = std::toupper(*c);
+    }
+    out.append(digits, result.ptr);
+}
+
+void text_output::append_general(std::string &out, long double value, int precision){
+    char digits[64];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value, std::chars_format::general, precision);
+    out.append(digits, result.ptr);
+}
+
+text_output::buffered_writer::buffered_writer(int fd, size_t capacity){
+    std::cout.flush();
+    this->FD = fd;
+    this->OwnsFD = false;
+    this->Capacity = capacity;
+    this->Buffer.reserve(capacity);
+}
+
+text_output::buffered_writer::buffered_writer(std::string filepath, size_t capacity){
+    this->FD = open(filepath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (this->FD < 0){
+        std::cerr << "ERROR: Failed to open " << filepath << " for writing: " << strerror(errno) << "\n";
+        exit(1);
+    }
+    this->OwnsFD = true;
+    this->Capacity = capacity;
+    this->Buffer.reserve(capacity);
+}
+
+text_output::buffered_writer::~buffered_writer(){
+    flush();
+    if (this->OwnsFD){
+        close(this->FD);
+    }
+}
+
+void text_output::buffered_writer::write(std::string_view text){
+    if (this->Buffer.size() + text.size() > this->Capacity){
+        flush();
+        if (text.size() > this->Capacity){ // Hand large chunks straight to write() instead of copying them
+            this->Buffer.append(text);
+            flush();
+            return;
+        }
+    }
+    this->Buffer.append(text);
+}
+
+void text_output::buffered_writer::write_int(long long value){
+    if (this->Buffer.size() + 24 > this->Capacity){
+        flush();
+    }
+    append_int(this->Buffer, value);
+}
+
+void text_output::buffered_writer::write_scientific(double value, int precision){
+    if (this->Buffer.size() + 64 > this->Capacity){
+        flush();
+    }
+    append_scientific(this->Buffer, value, precision);
+}
+
+void text_output::buffered_writer::write_general(long double value, int precision){
+    if (this->Buffer.size() + 64 > this->Capacity){
+        flush();
+    }
+    append_general(this->Buffer, value, precision);
+}
+
+void text_output::buffered_writer::flush(){
+    const char *pending = this->Buffer.data();
+    size_t remaining = this->Buffer.size();
+    while (remaining > 0){
+        ssize_t written = ::write(this->FD, pending, remaining);
+        if (written < 0){
+            if (errno == EINTR){
+                continue;
+            }
+            std::cerr << "ERROR: Failed to write output: " << strerror(errno) << "\n";
+            exit(1);
+        }
+        pending += written;
+        remaining -= written;
+    }
+    this->Buffer.clear();
+}
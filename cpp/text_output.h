@@ -0,0 +1,113 @@
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <omp.h>
+
+namespace text_output {
+    // Size of the buffer a buffered_writer collects output in before handing it to write()
+    const size_t DEFAULT_BUFFER_SIZE = 1 << 20;
+
+    /**
+     * Appends the decimal representation of an integer to a string
+     * @param out The string appended to
+     * @param value The integer to format
+    */
+    void append_int(std::string &out, long long value);
+
+    /**
+     * Appends a value formatted like printf("%.<precision>E") to a string (eg. 1.2000000000E-01)
+     * @param out The string appended to
+     * @param value The value to format
+     * @param precision The number of digits after the decimal point
+    */
+    void append_scientific(std::string &out, double value, int precision = 10);
+
+    /**
+     * Appends a value formatted like the default std::ostream formatting (printf("%.<precision>Lg")) to a string
+     * @param out The string appended to
+     * @param value The value to format
+     * @param precision The number of significant digits
+    */
+    void append_general(std::string &out, long double value, int precision = 6);
+
+    // Collects output in a large reusable buffer and writes it to a file descriptor in bulk
+    class buffered_writer {
+        private:
+            // File descriptor the output is written to
+            int FD;
+            // Whether if the file descriptor was opened by (and is closed by) the writer
+            bool OwnsFD;
+            // Pending output not yet written to the file descriptor
+            std::string Buffer;
+            size_t Capacity;
+        public:
+            /**
+             * Construct a writer on an already open file descriptor (eg. STDOUT_FILENO), which is not closed by the writer.
+             * Flushes std::cout first so output already written through iostreams keeps its order.
+             * @param fd The file descriptor written to
+             * @param capacity Number of bytes buffered before a write() is issued
+            */
+            buffered_writer(int fd, size_t capacity = DEFAULT_BUFFER_SIZE);
+
+            /**
+             * Construct a writer that creates (or truncates) the file at the given path
+             * @param filepath Filepath of the output file
+             * @param capacity Number of bytes buffered before a write() is issued
+            */
+            buffered_writer(std::string filepath, size_t capacity = DEFAULT_BUFFER_SIZE);
+
+            // Flushes the remaining output and closes the file descriptor if it is owned
+            ~buffered_writer();
+
+            buffered_writer(const buffered_writer&) = delete;
+            buffered_writer& operator=(const buffered_writer&) = delete;
+
+            // Appends text to the output
+            void write(std::string_view text);
+
+            // Appends an integer to the output
+            void write_int(long long value);
+
+            // Appends a value to the output formatted like printf("%.<precision>E")
+            void write_scientific(double value, int precision = 10);
+
+            // Appends a value to the output formatted like the default std::ostream formatting
+            void write_general(long double value, int precision = 6);
+
+            // Writes all of the buffered output to the file descriptor
+            void flush();
+    };
+
+    /**
+     * Formats count items into the writer, in order, with the formatting of each chunk of items done in parallel.
+     * Chunks are formatted into per-thread strings that are reused between batches, so memory stays bounded by a batch.
+     * @param writer The writer the formatted chunks are written to (sequentially, in item order)
+     * @param count The number of items to format
+     * @param format_item Callable (std::string &out, size_t item) appending the text of one item to out
+     * @param chunk_size The number of items formatted together by one thread
+    */
+    template <typename FormatFunc>
+    void write_formatted_chunks(buffered_writer &writer, size_t count, FormatFunc format_item, size_t chunk_size = 64){
+        const size_t chunks_per_batch = 4 * omp_get_max_threads();
+        std::vector<std::string> chunk_buffers(chunks_per_batch);
+        for (size_t batch_start = 0; batch_start < count; batch_start += chunks_per_batch * chunk_size){
+            size_t batch_chunks = std::min(chunks_per_batch, (count - batch_start + chunk_size - 1) / chunk_size);
+            #pragma omp parallel for schedule(dynamic)
+            for (size_t chunk = 0; chunk < batch_chunks; chunk++){
+                std::string &out = chunk_buffers[chunk];
+                out.clear();
+                size_t first = batch_start + chunk * chunk_size;
+                size_t last = std::min(count, first + chunk_size);
+                for (size_t item = first; item < last; item++){
+                    format_item(out, item);
+                }
+            }
+            for (size_t chunk = 0; chunk < batch_chunks; chunk++){
+                writer.write(chunk_buffers[chunk]);
+            }
+        }
+    }
+};
@@ -0,0 +1,187 @@
+#include <vector>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+#include <omp.h>
+
+#include "rng.h"
+
+#include "twins.h"
+
+namespace {
+    typedef std::pair<int, double> weighted_target;
+
+    // Edges of every vertex sorted by target then weight, so the edges of two vertices compare in one pass
+    class sorted_adjacency {
+        public:
+            std::vector<int64_t> Offsets;
+            std::vector<weighted_target> Edges;
+
+            sorted_adjacency(const compact_graph &graph) : Offsets(graph.Offsets.begin(), graph.Offsets.end()), Edges(graph.edge_count()) {
+                #pragma omp parallel for schedule(dynamic, 256)
+                for (int v = 0; v < graph.Vertices; v++){
+                    for (int64_t e = graph.Offsets[v]; e < graph.Offsets[v+1]; e++){
+                        this->Edges[e] = {graph.Targets[e], graph.Weights[e]};
+                    }
+                    std::sort(this->Edges.begin() + graph.Offsets[v], this->Edges.begin() + graph.Offsets[v+1]);
+                }
+            }
+
+            int64_t degree(int v) const {
+                return this->Offsets[v+1] - this->Offsets[v];
+            }
+    };
+
+    // Bits of a weight for hashing, with -0 hashed like 0 since they compare equal
+    uint64_t weight_bits(double weight){
+        if (weight == 0){
+            return 0;
+        }
+        uint64_t bits;
+        std::memcpy(&bits, &weight, sizeof(bits));
+        return bits;
+    }
+
+    // Folds a value into a hash, dependent on the order of the values
+    uint64_t fold(uint64_t hash, uint64_t value){
+        return rng::mix64(hash + rng::GOLDEN_GAMMA + value);
+    }
+
+    // Whether swapping u and v maps the edges of u onto the edges of v
+    bool swap_matches(const sorted_adjacency &adjacency, int u, int v, std::vector<weighted_target> &mapped){
+        if (adjacency.degree(u) != adjacency.degree(v)){
+            return false;
+        }
+        mapped.clear();
+        for (int64_t e = adjacency.Offsets[u]; e < adjacency.Offsets[u+1]; e++){
+            int target = adjacency.Edges[e].first;
+            mapped.push_back({target == u ? v : (target == v ? u : target), adjacency.Edges[e].second});
+        }
+        std::sort(mapped.begin(), mapped.end());
+        return std::equal(mapped.begin(), mapped.end(), adjacency.Edges.begin() + adjacency.Offsets[v]);
+    }
+
+    // Returns the representative of the set of a vertex, halving the path to it
+    int find_set(std::vector<int> &parent, int v){
+        while (parent[v] != v){
+            parent[v] = parent[parent[v]];
+            v = parent[v];
+        }
+        return v;
+    }
+}
+
+int twins::twin_classes::classes() const {
+    int classes = 0;
+    for (int size : this->ClassSize){
+        classes += size > 0;
+    }
+    return classes;
+}
+
+twins::twin_classes twins::find_twin_classes(const compact_graph &graph, const std::vector<double> *labels){
+    const int V = graph.Vertices;
+    sorted_adjacency out_edges(graph);
+    // The edges entering a vertex have to match as well in a directed graph
+    sorted_adjacency in_edges(graph.Directional ? graph.reversed() : compact_graph());
+    auto label = [labels](int v){
+        return ((size_t) v < labels->size()) ? (*labels)[v] : -INFINITY;
+    };
+
+    // Twins that are not joined share their neighbors and weights, twins that are joined share their neighbors counting themselves,
+    // and the multiset of their weights (the weight of the edge between them replaces the weight of the same edge at the other twin)
+    std::vector<std::pair<uint64_t, int>> open_keys(V);
+    std::vector<std::pair<uint64_t, int>> closed_keys(V);
+    #pragma omp parallel
+    {
+        std::vector<int> closed;
+        #pragma omp for schedule(dynamic, 256)
+        for (int v = 0; v < V; v++){
+            uint64_t base = labels == nullptr ? 0 : weight_bits(label(v));
+            uint64_t open = fold(base, out_edges.degree(v));
+            uint64_t weights = 0;
+            closed.assign(1, v);
+            for (int64_t e = out_edges.Offsets[v]; e < out_edges.Offsets[v+1]; e++){
+                const weighted_target &edge = out_edges.Edges[e];
+                if (edge.first == v){
+                    continue;
+                }
+                open = fold(fold(open, edge.first), weight_bits(edge.second));
+                weights += rng::mix64(weight_bits(edge.second));
+                closed.push_back(edge.first);
+            }
+            std::sort(closed.begin(), closed.end());
+            closed.erase(std::unique(closed.begin(), closed.end()), closed.end());
+            uint64_t closed_key = fold(fold(base, out_edges.degree(v)), weights);
+            for (int target : closed){
+                closed_key = fold(closed_key, target);
+            }
+            open_keys[v] = {open, v};
+            closed_keys[v] = {closed_key, v};
+        }
+    }
+
+    // Every candidate pair is checked before merging, and swaps compose, so the classes hold only true twins
+    std::vector<int> parent(V);
+    for (int v = 0; v < V; v++){
+        parent[v] = v;
+    }
+    std::vector<weighted_target> mapped;
+    std::vector<int> run;
+    for (std::vector<std::pair<uint64_t, int>> *keys : {&open_keys, &closed_keys}){
+        std::sort(keys->begin(), keys->end());
+        for (int i = 0; i < V;){
+            int j = i;
+            while (j < V && (*keys)[j].first == (*keys)[i].first){
+                j++;
+            }
+            // Vertices of the run that matched none of the earlier ones, each compared against until one matches
+            run.clear();
+            for (int k = i; k < j; k++){
+                int v = (*keys)[k].second;
+                bool merged = false;
+                for (int r : run){
+                    int root_r = find_set(parent, r);
+                    int root_v = find_set(parent, v);
+                    if (root_r == root_v){
+                        merged = true;
+                        break;
+                    }
+                    if ((labels == nullptr || label(r) == label(v)) && swap_matches(out_edges, r, v, mapped) && (!graph.Directional || swap_matches(in_edges, r, v, mapped))){
+                        parent[std::max(root_r, root_v)] = std::min(root_r, root_v);
+                        merged = true;
+                        break;
+                    }
+                }
+                if (!merged){
+                    run.push_back(v);
+                }
+            }
+            i = j;
+        }
+    }
+
+    twins::twin_classes classes;
+    classes.Representative.resize(V);
+    classes.ClassSize.assign(V, 0);
+    for (int v = 0; v < V; v++){
+        classes.Representative[v] = find_set(parent, v);
+        classes.ClassSize[classes.Representative[v]]++;
+    }
+    return classes;
+}
+
+void twins::print_twin_stats(const twins::twin_classes &classes){
+    int twin_vertices = 0;
+    int twin_classes = 0;
+    int largest = 0;
+    for (int size : classes.ClassSize){
+        if (size > 1){
+            twin_vertices += size;
+            twin_classes++;
+        }
+        largest = std::max(largest, size);
+    }
+    std::cout << "Twin classes: " << classes.classes() << " for " << classes.Representative.size() << " vertices | Vertices with a twin: " << twin_vertices << " in " << twin_classes << " classes | Largest class: " << largest << "\n";
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "compact_graph.h"
+
+/**
+ * Structural twins: vertices u and v whose swap maps the graph onto itself, ie. every other vertex is joined to both by edges of the same
+ * weights (and direction), whether or not u and v are joined to each other. A search from v then finds the distances of the search from u
+ * with u and v swapped, so the computations over every source search once per class of twins and copy the result to the other vertices.
+ * Candidates are grouped by hashes of their neighbor sets (open for twins that are not joined, closed for twins that are) and every pair is
+ * checked on the full adjacency before it is merged, so the classes are exact. Twins are common in bipartite networks and in the ~G graph of
+ * networks with repeated local structure.
+*/
+namespace twins {
+    // Classes of twin vertices
+    class twin_classes {
+        public:
+            // Representative of the class of each vertex, its smallest vertex ID (the vertex itself if it has no twin)
+            std::vector<int> Representative;
+            // Number of vertices in the class of each representative (0 for the other vertices)
+            std::vector<int> ClassSize;
+
+            // Returns the number of classes, the searches needed to cover every source
+            int classes() const;
+
+            // Returns whether the vertex is the representative of its class
+            bool is_representative(int vertex) const {
+                return this->Representative[vertex] == vertex;
+            }
+    };
+
+    /**
+     * Finds the twin classes of a graph. Self loops must match too, and parallel edges count separately.
+     * @param graph The graph
+     * @param labels If given, only vertices with the same label can be twins (eg. the MU of each vertex when a search depends on its source)
+     * @return The classes
+    */
+    twin_classes find_twin_classes(const compact_graph &graph, const std::vector<double> *labels = nullptr);
+
+    /**
+     * Prints "Twin classes: c for v vertices | Vertices with a twin: t in n classes | Largest class: l"
+     * @param classes The classes
+    */
+    void print_twin_stats(const twin_classes &classes);
+};
@@ -1,10 +1,16 @@
 #include <string>
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <stdexcept>
 #include <assert.h>
 #include <random>
+#include <algorithm>
+#include <unordered_set>
+#include <cstdlib>
 
 #include "utils.h"
+#include "rng.h"
 
 #include "edgelist.h"
 
@@ -36,61 +42,157 @@ edgelist edgelist_from_file(bool weighted, std::string filepath){
     return new_edgelist;
 }
 
-/**
- * Generates a Watts Strogatz small world network into the given edgelist object according to the input parameters.
- * @param edgelist The edgelist (presumed empty) that the Watts Strogatz network will be generated into.
- * @param SIZE The size (vertex count) of the generated network.
- * @param AVG_DEG The average number of edges (undirected network) connected to each vertex in the generated network. Must be even.
- * @param REWIRING_PROB The probability that each edge in the initial network is rewired. Represented as a double between 0 and 1 (inclusive, accurate to 1E-3).
-*/
-void generate_watts_strogatz_small_world_network(edgelist &edgelist, int SIZE, int AVG_DEG, double REWIRING_PROB){
-    std::vector<edge> edges;
+void generate_watts_strogatz_small_world_network(edgelist &edgelist, int SIZE, int AVG_DEG, double REWIRING_PROB, uint64_t SEED){
     // Set the edgelist to be undirected
     edgelist.set_directional(false);
 
     assert(SIZE > 0);
     assert(AVG_DEG > 0);
     assert(AVG_DEG % 2 == 0);
+    assert(AVG_DEG < SIZE);
+    assert(REWIRING_PROB == 0 || SIZE > 2 * AVG_DEG); // Leave enough non-lattice targets for rewired edges
     assert(REWIRING_PROB >= 0);
     assert(REWIRING_PROB <= 1);
 
-    // Initialize the random number generators
-    std::random_device rd;  // a seed source for the random number engine
-    std::mt19937 gen(rd()); // mersenne_twister_engine seeded with rd()
-    std::uniform_int_distribution<> distrib_weight(0, 10E4);
-    std::uniform_int_distribution<> distrib_reroll(0, 1000);
-    std::uniform_int_distribution<> distrib_reroll_target(0, SIZE);
+    const int HALF_DEG = AVG_DEG / 2;
+    // Each vertex src owns the HALF_DEG lattice edges to (src + offset) % SIZE, stored at src * HALF_DEG + offset - 1
+    std::vector<edge> edges((size_t) SIZE * HALF_DEG);
+    std::vector<char> rewired(edges.size(), false);
 
-    
-    // Generate the initial edgelist (circular)
-    for (int src = 0; src < SIZE; src ++){ // For each node
-        for (int offset = 1; offset <= AVG_DEG/2; offset++){ // Target the next AVG_DEG/2 nodes (because half of AVG_DEG point in & half point out if it were directed)
+    // Returns whether if dest is one of the original lattice neighbors of src (circular distance of at most HALF_DEG)
+    auto is_lattice_neighbor = [SIZE, HALF_DEG](int src, int dest){
+        int distance = std::abs(src - dest);
+        return std::min(distance, SIZE - distance) <= HALF_DEG;
+    };
+
+    // Generate and rewire the edges of every vertex independently, drawing from the vertex's own random stream
+    std::vector<rng::counter_rng> streams;
+    streams.reserve(SIZE);
+    for (int src = 0; src < SIZE; src++){
+        streams.emplace_back(SEED, src);
+    }
+    #pragma omp parallel for schedule(static)
+    for (int src = 0; src < SIZE; src ++){
+        rng::counter_rng &stream = streams[src];
+        for (int offset = 1; offset <= HALF_DEG; offset++){
+            size_t edge_index = (size_t) src * HALF_DEG + offset - 1;
             int dest = (src + offset) % SIZE; // Wrap around if exceeded largest node count
-            double weight = distrib_weight(gen)/10E4; // Generate a random edge weight between 0 & 1 (distrib_weight is an int between 0 and 10E4)
+            double weight = stream.below(100001) / 1E5; // Random edge weight between 0 & 1 (in steps of 1E-5)
+            edges[edge_index] = {.src = src, .dest = dest, .weight = weight};
 
-            edgelist.insert_edge(src,dest,weight); // Add the edge
+            if (stream.uniform() < REWIRING_PROB){ // Roll for chance to change edge destination
+                // Select a new target that is neither src, one of its lattice neighbors (including the former destination), nor a target src was already rewired to
+                int new_dest;
+                bool duplicate;
+                do {
+                    new_dest = stream.below(SIZE);
+                    duplicate = new_dest == src || is_lattice_neighbor(src, new_dest);
+                    for (int prev = 1; prev < offset && !duplicate; prev++){
+                        size_t prev_index = (size_t) src * HALF_DEG + prev - 1;
+                        duplicate = rewired[prev_index] && edges[prev_index].dest == new_dest;
+                    }
+                } while (duplicate);
+                edges[edge_index].dest = new_dest;
+                edges[edge_index].weight = stream.below(100001) / 1E5; // Generate a new weight (no mathematical significance)
+                rewired[edge_index] = true;
+            }
         }
     }
-    
-    // For each exist edge (see above for loop structure explanation)
-    for (int src = 0; src < SIZE; src ++){
-        for (int offset = 1; offset <= AVG_DEG/2; offset++){
-            int dest_org = (src + offset) % SIZE; // This is the original destination of the edge
-            double weight = distrib_weight(gen)/10E4; // Generate a new weight (avoid annoyance of retrieving and saving weight, no mathematical significance)
 
-            if (distrib_reroll(gen)/(double)1000 <= REWIRING_PROB){ // Roll for chance to change edge destination
-                // Select a new target for the edge
-                int new_dest = distrib_reroll_target(gen);
-                // While the target for the edge causes a duplicate edge (including former edge destination) or a self edge, reroll the target.
-                std::vector<int> current_adjacent = edgelist.get_adjacent_vertices(src);
-                while(std::find(current_adjacent.begin(), current_adjacent.end(), new_dest) != current_adjacent.end() || new_dest == src){
-                    new_dest = distrib_reroll_target(gen);
-                }
+    // Rewired edges of different vertices only collide when two vertices were rewired to each other.
+    // Resolve those serially in vertex order (so the result does not depend on the thread count) using hashed edge membership.
+    auto edge_key = [](int a, int b){
+        return ((uint64_t) std::min(a, b) << 32) | (uint32_t) std::max(a, b);
+    };
+    std::unordered_set<uint64_t> rewired_edges;
+    for (size_t edge_index = 0; edge_index < edges.size(); edge_index++){
+        if (!rewired[edge_index]){
+            continue;
+        }
+        edge &edge = edges[edge_index];
+        while (!rewired_edges.insert(edge_key(edge.src, edge.dest)).second){
+            rng::counter_rng &stream = streams[edge.src];
+            int new_dest;
+            do {
+                new_dest = stream.below(SIZE);
+            } while (new_dest == edge.src || is_lattice_neighbor(edge.src, new_dest) || rewired_edges.count(edge_key(edge.src, new_dest)));
+            edge.dest = new_dest;
+        }
+    }
+
+    edgelist.insert_edges(edges);
+}
 
-                // Once a new edge has been rolled, add the new edge and remove the old edge
-                edgelist.insert_edge(src,new_dest,weight);
-                edgelist.rm_edge(src,dest_org);
+std::map<std::string, std::string> extract_flags(int &argc, char* argv[]){
+    std::map<std::string, std::string> flags;
+    int kept = 1;
+    for (int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        if (arg.rfind("--", 0) == 0 && arg.size() > 2){
+            size_t equals = arg.find('=');
+            if (equals == std::string::npos){
+                flags[arg.substr(2)] = "";
+            } else {
+                flags[arg.substr(2, equals - 2)] = arg.substr(equals + 1);
             }
+        } else {
+            argv[kept++] = argv[i];
         }
     }
-}
\ No newline at end of file
+    argc = kept;
+    return flags;
+}
+
+std::vector<double> parse_value_list(std::string spec){
+    std::vector<double> values;
+    std::stringstream items(spec);
+    std::string item;
+    while (std::getline(items, item, ',')){
+        try {
+            size_t first_colon = item.find(':');
+            if (first_colon == std::string::npos){
+                values.push_back(std::stod(item));
+                continue;
+            }
+            size_t second_colon = item.find(':', first_colon + 1);
+            if (second_colon == std::string::npos){
+                throw std::invalid_argument(item);
+            }
+            double start = std::stod(item.substr(0, first_colon));
+            double stop = std::stod(item.substr(first_colon + 1, second_colon - first_colon - 1));
+            double step = std::stod(item.substr(second_colon + 1));
+            if (!(step > 0) || stop < start){
+                throw std::invalid_argument(item);
+            }
+            // Computed from the index so rounding errors do not accumulate, the tolerance keeps STOP despite rounding
+            for (long long i = 0; start + i * step <= stop + step * 1E-9; i++){
+                values.push_back(start + i * step);
+            }
+        } catch (...){
+            std::cerr << "ERROR: Invalid value list item \"" << item << "\".\n";
+            exit(1);
+        }
+    }
+    return values;
+}
+
+uint64_t parse_bytes(std::string value){
+    try {
+        size_t end;
+        uint64_t bytes = std::stoull(value, &end);
+        std::string suffix = value.substr(end);
+        if (suffix == "K" || suffix == "k"){
+            bytes <<= 10;
+        } else if (suffix == "M" || suffix == "m"){
+            bytes <<= 20;
+        } else if (suffix == "G" || suffix == "g"){
+            bytes <<= 30;
+        } else if (!suffix.empty()){
+            throw std::invalid_argument(value);
+        }
+        return bytes;
+    } catch (...){
+        std::cerr << "ERROR: Invalid byte count " << value << ".\n";
+        exit(1);
+    }
+}
@@ -1,5 +1,10 @@
 #pragma once
 
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdint>
+
 #include "edgelist.h"
 #include "network_metrics.h"
 
@@ -11,4 +16,36 @@
 */
 edgelist edgelist_from_file(bool weighted, std::string filepath);
 
-void generate_watts_strogatz_small_world_network(edgelist &edgelist, int SIZE, int AVG_DEG, double REWIRING_PROB);
\ No newline at end of file
+/**
+ * Generates a Watts Strogatz small world network into the given edgelist object according to the input parameters.
+ * Every vertex draws its edge weights and rewiring from its own counter-based random stream and the vertices are processed in parallel,
+ * so the same SEED always generates the same network regardless of the thread count.
+ * @param edgelist The edgelist (presumed empty) that the Watts Strogatz network will be generated into.
+ * @param SIZE The size (vertex count) of the generated network.
+ * @param AVG_DEG The average number of edges (undirected network) connected to each vertex in the generated network. Must be even and smaller than SIZE.
+ * @param REWIRING_PROB The probability that each edge in the initial network is rewired. Represented as a double between 0 and 1 (inclusive).
+ * @param SEED The seed of the random streams.
+*/
+void generate_watts_strogatz_small_world_network(edgelist &edgelist, int SIZE, int AVG_DEG, double REWIRING_PROB, uint64_t SEED);
+
+/**
+ * Removes the "--NAME=VALUE" (or "--NAME") flags from the command line arguments so positional arguments keep their usual positions
+ * @param argc The argument count, updated to the count of remaining arguments
+ * @param argv The arguments, compacted to the remaining arguments
+ * @return A map from flag NAME to VALUE ("" for flags without a value)
+*/
+std::map<std::string, std::string> extract_flags(int &argc, char* argv[]);
+/**
+ * Parses a comma separated list of values where each item is either a number or an inclusive range "START:STOP:STEP"
+ * Eg. "0:0.2:0.05,0.5,1" gives 0, 0.05, 0.1, 0.15, 0.2, 0.5, 1
+ * @param spec The list specification
+ * @return The values in the order given, exits if an item is invalid
+*/
+std::vector<double> parse_value_list(std::string spec);
+
+/**
+ * Parses a byte count with an optional K, M or G suffix (powers of 1024)
+ * @param value The byte count
+ * @return The number of bytes, exits if the value is invalid
+*/
+uint64_t parse_bytes(std::string value);
@@ -5,49 +5,25 @@ import sqlite3
 
 con = sqlite3.connect("database_path.db")
 cur = con.cursor()
-connections = cur.execute("SELECT SRC, DST, INFO_DIST FROM a_dbv_tau").fetchall()
+# Pairs by g_tilda information distance bucket and network distance, counted by figure_1_distance_frequency_generator.bin
+# (the per pair a_dbv_tau and g_dbv_tau tables are only saved with --pairs)
+buckets = cur.execute("SELECT INFO_DIST_START, INFO_DIST_END, NET_DIST, PAIRS FROM g_info_a_net_histogram").fetchall()
 
-TOTAL_COUNT = len(connections)
-MAX_NET_DIST = cur.execute("SELECT MAX(NET_DIST) FROM a_dbv_tau").fetchone()[0]
+# The frequencies are relative to every pair within the network distance limit, each vertex paired with itself included (the rows of
+# a_dbv_tau). The histogram leaves out the self pairs, so one per vertex of the summary table is added back.
+VERTEX_COUNT = cur.execute("SELECT COUNT(*) FROM g_info_a_net_vertex_summary").fetchone()[0]
+TOTAL_COUNT = sum(pairs for _, _, _, pairs in buckets) + VERTEX_COUNT
+MAX_NET_DIST = max(net_dist for _, _, net_dist, _ in buckets)
 
 WEIGHT_SCALE = 2
 
 Z = [[np.NaN for i in range(MAX_NET_DIST)] for j in range(MAX_NET_DIST*WEIGHT_SCALE)]
 
-for INFO_DIST_step_count in range(0,MAX_NET_DIST*WEIGHT_SCALE):
-    for NET_DIST_step_count in range(0,MAX_NET_DIST):
-        INFO_DIST_range_start = INFO_DIST_step_count / WEIGHT_SCALE
-        INFO_DIST_range_end = INFO_DIST_range_start + 1/WEIGHT_SCALE
-        NET_DIST_range_start = NET_DIST_step_count
-        NET_DIST_range_end = NET_DIST_range_start + 1
-        
-        query = cur.execute("""
-                            SELECT COUNT(g.INFO_DIST)
-                            FROM g_dbv_tau g
-                            INNER JOIN a_dbv_tau a ON
-                            g.SRC = a.SRC AND g.DST = a.DST
-                            WHERE g.INFO_DIST > ? AND g.INFO_DIST <= ? AND a.NET_DIST >= ? AND a.NET_DIST < ?
-                            """, 
-                            [INFO_DIST_range_start,INFO_DIST_range_end,NET_DIST_range_start,NET_DIST_range_end])
-        
-        # query = cur.execute("""
-        #                     SELECT COUNT(g.INFO_DIST)
-        #                     FROM g_dbv_tau g
-        #                     INNER JOIN nl_dbv_tau a ON
-        #                     g.SRC = a.SRC AND g.DST = a.DST
-        #                     WHERE g.INFO_DIST > ? AND g.INFO_DIST <= ? AND a.INFO_DIST >= ? AND a.INFO_DIST < ?
-        #                     """, 
-        #                     [INFO_DIST_range_start,INFO_DIST_range_end,NET_DIST_range_start,NET_DIST_range_end])
-        
-        # query = cur.execute("""
-        #                     SELECT COUNT(l.INFO_DIST)
-        #                     FROM a_dbv_tau WHERE INFO_DIST > ? AND INFO_DIST <= ? AND NET_DIST >= ? AND NET_DIST < ?
-        #                     """, 
-        #                     [INFO_DIST_range_start,INFO_DIST_range_end,NET_DIST_range_start,NET_DIST_range_end])
-        
-        count = query.fetchone()[0]
-        if count != 0:
-            Z[INFO_DIST_step_count][NET_DIST_step_count] = count/TOTAL_COUNT
+# Each bucket covers (INFO_DIST_START, INFO_DIST_END], the generator buckets by 1/WEIGHT_SCALE
+for INFO_DIST_start, INFO_DIST_end, NET_DIST, pairs in buckets:
+    INFO_DIST_step_count = round(INFO_DIST_start * WEIGHT_SCALE)
+    if INFO_DIST_step_count < MAX_NET_DIST*WEIGHT_SCALE and NET_DIST < MAX_NET_DIST:
+        Z[INFO_DIST_step_count][NET_DIST] = pairs/TOTAL_COUNT
 
 max_network_distance = MAX_NET_DIST
 network_distance_resolution = 1
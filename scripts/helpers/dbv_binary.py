@@ -0,0 +1,80 @@
+#!/usr/bin/python3
+import numpy as np
+
+# Mirrors the columnar binary distance format written by metrics::save_distance_btwn_vertices_to_binary (cpp/network_metrics.cpp)
+MAGIC = b"NLEDBV1\x00"
+VERSION = 1
+FLAG_DELTA_DST = 1
+
+HEADER_DTYPE = np.dtype([
+    ("magic", "S8"),
+    ("version", "<u4"),
+    ("flags", "<u4"),
+    ("num_sources", "<u8"),
+    ("num_pairs", "<u8"),
+    ("index_offset", "<u8"),
+    ("src_offset", "<u8"),
+    ("dst_offset", "<u8"),
+    ("info_offset", "<u8"),
+    ("net_offset", "<u8"),
+])
+
+def _align_8(offset):
+    return (offset + 7) & ~7
+
+def read_header(filepath:str):
+    header = np.fromfile(filepath, dtype=HEADER_DTYPE, count=1)[0]
+    if header["magic"] != MAGIC.rstrip(b"\x00") or header["version"] != VERSION:
+        raise ValueError(f"{filepath} is not a supported binary distance file")
+    return header
+
+def open_dbv(filepath:str):
+    """
+    Memory maps every column of a binary distance file without reading it into memory.
+    Returns a dict with the SOURCE_IDS/ROW_OFFSETS index and the SRC, DST, INFO_DIST and NET_DIST columns.
+    DST is returned as stored, use decode_dst() if the file was delta encoded.
+    """
+    header = read_header(filepath)
+    num_sources = int(header["num_sources"])
+    num_pairs = int(header["num_pairs"])
+    index_offset = int(header["index_offset"])
+    row_offsets_offset = _align_8(index_offset + num_sources * 4)
+    def column(dtype, offset, count):
+        if count == 0:
+            return np.zeros(0, dtype=dtype)
+        return np.memmap(filepath, dtype=dtype, mode="r", offset=offset, shape=(count,))
+    return {
+        "FLAGS": int(header["flags"]),
+        "SOURCE_IDS": column("<i4", index_offset, num_sources),
+        "ROW_OFFSETS": column("<u8", row_offsets_offset, num_sources + 1),
+        "SRC": column("<i4", int(header["src_offset"]), num_pairs),
+        "DST": column("<i4", int(header["dst_offset"]), num_pairs),
+        "INFO_DIST": column("<f8", int(header["info_offset"]), num_pairs),
+        "NET_DIST": column("<i4", int(header["net_offset"]), num_pairs),
+    }
+
+def decode_dst(dbv):
+    """Returns the absolute DST column, undoing the per-row delta encoding if the file uses it."""
+    dst = np.asarray(dbv["DST"], dtype=np.int64)
+    if not dbv["FLAGS"] & FLAG_DELTA_DST:
+        return dst
+    row_offsets = np.asarray(dbv["ROW_OFFSETS"], dtype=np.int64)
+    decoded = np.cumsum(dst)
+    # Subtract the running total reached before each row starts so every row restarts from its first (absolute) DST
+    row_lengths = np.diff(row_offsets)
+    row_starts = np.repeat(row_offsets[:-1], row_lengths)
+    before_row = np.where(row_starts > 0, decoded[np.maximum(row_starts - 1, 0)], 0)
+    return decoded - before_row
+
+def load_row(filepath:str, src:int):
+    """Loads the DST, INFO_DIST and NET_DIST arrays of a single source, touching only that row's pages."""
+    dbv = open_dbv(filepath)
+    source_ids = dbv["SOURCE_IDS"]
+    row = int(np.searchsorted(source_ids, src))
+    if row >= len(source_ids) or source_ids[row] != src:
+        return np.zeros(0, dtype=np.int64), np.zeros(0, dtype=np.float64), np.zeros(0, dtype=np.int32)
+    start, end = int(dbv["ROW_OFFSETS"][row]), int(dbv["ROW_OFFSETS"][row + 1])
+    dst = np.asarray(dbv["DST"][start:end], dtype=np.int64)
+    if dbv["FLAGS"] & FLAG_DELTA_DST:
+        dst = np.cumsum(dst)
+    return dst, np.asarray(dbv["INFO_DIST"][start:end]), np.asarray(dbv["NET_DIST"][start:end])
@@ -0,0 +1,8 @@
+#!/bin/sh
+# Fetch command for cpp/figure_2_task_runner.bin: downloads a Konect archive and unpacks its out.* edgelist file
+# Usage: fetch_konect_task.sh TASK_ID URL DIR
+set -e
+mkdir -p "$3"
+wget -O "$3/data.tar.bz2" -q "$2"
+tar -xjf "$3/data.tar.bz2" -C "$3" --wildcards '*/out.*'
+rm -f "$3/data.tar.bz2"